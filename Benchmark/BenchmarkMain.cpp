@@ -0,0 +1,367 @@
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+#include "HP33120ADriver.h"
+#include "SimulatedVISA.h"
+#include "DeviceCommandThread.h"
+#include "MidiEventScheduler.h"
+
+//==============================================================================
+// Replays automation, MIDI and ARB-upload traffic through the real driver,
+// DeviceCommandThread and MidiEventScheduler against the simulated HP33120A, and
+// reports throughput and latency - so a change to the command pipeline can be
+// measured without a rack.
+//
+//   HP33120A_Benchmark [--workload=all|automation|midi|arb|arb+midi]
+//                      [--seconds=5] [--rs232] [--json]
+//
+// Everything runs in real time at the model's bus rate. Note lateness is when the
+// simulated parser executes a note's FREQ, relative to when the audio stream plays
+// that sample - positive is late.
+//==============================================================================
+namespace
+{
+    constexpr const char* SIM_RESOURCE = "SIM::10::INSTR";
+    constexpr double SAMPLE_RATE = 48000.0;
+    constexpr int BLOCK_SIZE = 256;
+    constexpr int NOTE_EVERY_BLOCKS = 8;   // ~23 notes per second
+    constexpr int MAX_NOTES = 4096;
+    constexpr double NOTE_BASE_HZ = 100.0;  // Note i plays NOTE_BASE_HZ + i, so the hook can tell them apart
+    constexpr int ARB_POINTS = 4096;
+    constexpr int ARB_NAMES = 3;            // Fewer than the four non-volatile slots - no evictions
+    constexpr int AUTOMATION_TICK_MS = 1;
+    constexpr int NOTE_DRAIN_MS = 250;      // After the last block, for notes still in flight
+
+    struct Options
+    {
+        double seconds = 5.0;
+        bool rs232 = false;
+        bool json = false;
+        juce::String workload = "all";
+    };
+
+    struct Workload
+    {
+        const char* name;
+        bool automation, midi, arb;
+    };
+
+    const Workload WORKLOADS[] = {
+        { "automation", true,  false, false },
+        { "midi",       false, true,  false },
+        { "arb",        false, false, true  },
+        { "arb+midi",   false, true,  true  },
+    };
+
+    // Written by the workload threads and the simulated instrument's command hook
+    struct Counters
+    {
+        std::atomic<uint64_t> commands { 0 };
+        std::atomic<int> deviceErrors { 0 };
+        std::atomic<int> uploads { 0 };
+        std::atomic<int> failedUploads { 0 };
+        std::atomic<int> notesScheduled { 0 };
+        std::array<std::atomic<double>, MAX_NOTES> intendedMs {};
+        std::array<std::atomic<double>, MAX_NOTES> executedMs {};
+    };
+
+    struct Result
+    {
+        juce::String name;
+        juce::String error;
+        BusTelemetry::Snapshot telemetry;
+        double seconds = 0.0;
+        uint64_t commands = 0;
+        int deviceErrors = 0, uploads = 0, failedUploads = 0, notesScheduled = 0, notesMissed = 0;
+        std::vector<double> noteLatenessMs;  // Sorted
+    };
+
+    double nowMs() { return juce::Time::getMillisecondCounterHiRes(); }
+
+    void sleepUntil(double deadlineMs)
+    {
+        for (double remainingMs = deadlineMs - nowMs(); remainingMs > 0.0; remainingMs = deadlineMs - nowMs())
+        {
+            if (remainingMs > 1.0)
+                std::this_thread::sleep_for(std::chrono::microseconds((long long)((remainingMs - 0.5) * 1000.0)));
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    // ============================================================================
+    // WORKLOADS
+    // ============================================================================
+    // A host dragging several automation lanes at once
+    void runAutomation(DeviceCommandThread& commandThread, double endMs)
+    {
+        for (int tick = 0; nowMs() < endMs; ++tick)
+        {
+            const double phase = tick * 0.01;
+            commandThread.queueUpdate(Parameters::DeviceParam::Frequency, 1000.0 + 500.0 * std::sin(phase));
+            commandThread.queueUpdate(Parameters::DeviceParam::Amplitude, 1.0 + 0.5 * std::sin(phase * 0.7));
+            if (tick % 5 == 0)
+                commandThread.queueUpdate(Parameters::DeviceParam::AMDepth, 50.0 + 40.0 * std::sin(phase * 1.3));
+            if (tick % 10 == 0)
+                commandThread.queueUpdate(Parameters::DeviceParam::Offset, 0.1 * std::sin(phase * 0.3));
+            std::this_thread::sleep_for(std::chrono::milliseconds(AUTOMATION_TICK_MS));
+        }
+    }
+
+    // An audio callback on an exact block clock, with a note every few blocks
+    void runAudioCallbacks(MidiEventScheduler& scheduler, Counters& counters, double endMs)
+    {
+        scheduler.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        const double blockMs = BLOCK_SIZE * 1000.0 / SAMPLE_RATE;
+        const double lookAheadMs = scheduler.getLookAheadMs();
+        const double streamStartMs = nowMs();
+
+        int note = 0;
+        for (int block = 0; ; ++block)
+        {
+            const double blockStartMs = streamStartMs + block * blockMs;
+            if (blockStartMs >= endMs) break;
+            sleepUntil(blockStartMs);
+            scheduler.beginBlock(BLOCK_SIZE);
+
+            if (block % NOTE_EVERY_BLOCKS == 0 && note < MAX_NOTES)
+            {
+                // Same target the scheduler aims for: the sample, one buffer later, plus the look-ahead
+                const int position = (block * 37) % BLOCK_SIZE;
+                counters.intendedMs[(size_t)note] = blockStartMs + (position + BLOCK_SIZE) * 1000.0 / SAMPLE_RATE + lookAheadMs;
+                if (scheduler.scheduleFrequency(position, NOTE_BASE_HZ + note))
+                    counters.notesScheduled = ++note;
+            }
+        }
+    }
+
+    // Back-to-back uploads, as the ARB transfer stage does them
+    void runUploads(HP33120ADriver& driver, Counters& counters, double endMs)
+    {
+        HP33120ADriver::setThreadLane(HP33120ADriver::CommandLane::Bulk);
+
+        std::vector<float> shape((size_t)ARB_POINTS);
+        for (int n = 0; nowMs() < endMs; ++n)
+        {
+            for (size_t i = 0; i < shape.size(); ++i)
+                shape[i] = (float)std::sin(juce::MathConstants<double>::twoPi * (double)i / (double)shape.size() * (1 + n % 4));
+
+            driver.downloadARBWaveform("BENCH" + std::to_string(n % ARB_NAMES), shape, ARB_POINTS);
+            if (driver.getLastError().empty())
+                ++counters.uploads;
+            else
+                ++counters.failedUploads;
+        }
+    }
+
+    Result runWorkload(const Workload& workload, const Options& options)
+    {
+        auto counters = std::make_unique<Counters>();
+        Result result;
+        result.name = workload.name;
+
+        // The session takes its copy of the model and hook when it opens
+        SimulatedVISA::setModel(options.rs232 ? SimulatedVISA::rs232() : SimulatedVISA::gpib());
+        Counters& c = *counters;
+        SimulatedVISA::setCommandHook([&c](std::string_view command, double atMs) {
+            c.commands.fetch_add(1, std::memory_order_relaxed);
+            if (!command.empty() && command[0] == ':') command.remove_prefix(1);
+            if (command.rfind("FREQ ", 0) != 0) return;
+
+            const int note = (int)std::lround(std::atof(std::string(command.substr(5)).c_str()) - NOTE_BASE_HZ);
+            double unset = 0.0;
+            if (note >= 0 && note < MAX_NOTES)
+                c.executedMs[(size_t)note].compare_exchange_strong(unset, atMs);
+        });
+
+        HP33120ADriver driver;
+        driver.logCallback = [&c](const std::string& line) {
+            if (line.rfind("[DEVICE ERROR]", 0) == 0) ++c.deviceErrors;
+        };
+
+        const bool connected = driver.connect(SIM_RESOURCE);
+        SimulatedVISA::setCommandHook(nullptr);
+        if (!connected)
+        {
+            result.error = "connect failed: " + driver.getLastError();
+            return result;
+        }
+
+        // The connect sequence isn't part of any workload
+        driver.getTelemetry().reset();
+        c.commands = 0;
+
+        DeviceCommandThread commandThread(driver);
+        MidiEventScheduler scheduler(driver);
+        if (workload.automation) commandThread.startThread();
+        if (workload.midi) scheduler.startThread(juce::Thread::Priority::highest);
+
+        const double startMs = nowMs();
+        const double endMs = startMs + options.seconds * 1000.0;
+        std::thread audioThread, uploadThread;
+        if (workload.midi) audioThread = std::thread([&] { runAudioCallbacks(scheduler, c, endMs); });
+        if (workload.arb) uploadThread = std::thread([&] { runUploads(driver, c, endMs); });
+
+        if (workload.automation)
+            runAutomation(commandThread, endMs);
+        else
+            sleepUntil(endMs);
+
+        if (audioThread.joinable()) audioThread.join();
+        if (uploadThread.joinable()) uploadThread.join();
+        if (workload.midi)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(NOTE_DRAIN_MS));
+            scheduler.stopScheduler();
+        }
+        if (workload.automation)
+            commandThread.stopThreadSafely();
+
+        driver.checkDeferredErrors();
+        result.telemetry = driver.getTelemetry().snapshot();
+        result.seconds = (nowMs() - startMs) / 1000.0;
+        driver.disconnect();
+
+        result.commands = c.commands.load();
+        result.deviceErrors = c.deviceErrors.load();
+        result.uploads = c.uploads.load();
+        result.failedUploads = c.failedUploads.load();
+        result.notesScheduled = c.notesScheduled.load();
+        for (int i = 0; i < result.notesScheduled; ++i)
+        {
+            const double executedMs = c.executedMs[(size_t)i].load();
+            if (executedMs > 0.0)
+                result.noteLatenessMs.push_back(executedMs - c.intendedMs[(size_t)i].load());
+            else
+                ++result.notesMissed;
+        }
+        std::sort(result.noteLatenessMs.begin(), result.noteLatenessMs.end());
+        return result;
+    }
+
+    // ============================================================================
+    // REPORTING
+    // ============================================================================
+    double percentile(const std::vector<double>& sorted, double fraction)
+    {
+        if (sorted.empty()) return 0.0;
+        size_t rank = (size_t)std::ceil(fraction * (double)sorted.size());
+        return sorted[std::min(sorted.size(), std::max((size_t)1, rank)) - 1];
+    }
+
+    void printResult(const Result& result)
+    {
+        std::printf("\n== %s ==\n", result.name.toRawUTF8());
+        if (result.error.isNotEmpty())
+        {
+            std::printf("  %s\n", result.error.toRawUTF8());
+            return;
+        }
+
+        const BusTelemetry::Snapshot& t = result.telemetry;
+        std::printf("  %.1f s, %.1f commands/s, %.1f kB/s written, %d device errors\n", result.seconds,
+                    (double)result.commands / result.seconds, t.writeBytesPerSecond / 1000.0, result.deviceErrors);
+
+        for (int i = 0; i < BusTelemetry::NUM_METRICS; ++i)
+        {
+            const BusTelemetry::Summary& s = t.metrics[(size_t)i];
+            if (s.count == 0) continue;
+            std::printf("  %-12s n=%-7llu p50 %7.3f ms  p99 %7.3f ms  max %7.3f ms\n",
+                        BusTelemetry::getMetricName((BusTelemetry::Metric)i), (unsigned long long)s.count,
+                        s.p50Ms, s.p99Ms, s.maxMs);
+        }
+
+        if (result.notesScheduled > 0)
+            std::printf("  notes        %d scheduled, %d missed, lateness p50 %+.2f ms  p99 %+.2f ms  max %+.2f ms\n",
+                        result.notesScheduled, result.notesMissed, percentile(result.noteLatenessMs, 0.50),
+                        percentile(result.noteLatenessMs, 0.99),
+                        result.noteLatenessMs.empty() ? 0.0 : result.noteLatenessMs.back());
+
+        if (result.uploads + result.failedUploads > 0)
+            std::printf("  arb          %d uploads, %d failed, %.1f kB/s while a block is on the bus\n",
+                        result.uploads, result.failedUploads, t.blockBytesPerSecond / 1000.0);
+    }
+
+    juce::var toJSON(const Result& result)
+    {
+        auto* entry = new juce::DynamicObject();
+        juce::var entryVar(entry);
+        entry->setProperty("workload", result.name);
+        if (result.error.isNotEmpty())
+        {
+            entry->setProperty("error", result.error);
+            return entryVar;
+        }
+
+        entry->setProperty("seconds", result.seconds);
+        entry->setProperty("commands_per_s", (double)result.commands / result.seconds);
+        entry->setProperty("device_errors", result.deviceErrors);
+        entry->setProperty("telemetry", juce::JSON::parse(BusTelemetry::toJSON(result.telemetry)));
+
+        if (result.notesScheduled > 0)
+        {
+            auto* notes = new juce::DynamicObject();
+            notes->setProperty("scheduled", result.notesScheduled);
+            notes->setProperty("missed", result.notesMissed);
+            notes->setProperty("lateness_p50_ms", percentile(result.noteLatenessMs, 0.50));
+            notes->setProperty("lateness_p99_ms", percentile(result.noteLatenessMs, 0.99));
+            notes->setProperty("lateness_max_ms", result.noteLatenessMs.empty() ? 0.0 : result.noteLatenessMs.back());
+            entry->setProperty("notes", juce::var(notes));
+        }
+
+        if (result.uploads + result.failedUploads > 0)
+        {
+            entry->setProperty("arb_uploads", result.uploads);
+            entry->setProperty("arb_failed_uploads", result.failedUploads);
+        }
+        return entryVar;
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    juce::ArgumentList args(argc, argv);
+    Options options;
+    options.rs232 = args.containsOption("--rs232");
+    options.json = args.containsOption("--json");
+    if (args.containsOption("--seconds"))
+        options.seconds = juce::jlimit(0.5, 600.0, args.getValueForOption("--seconds").getDoubleValue());
+    if (args.containsOption("--workload"))
+        options.workload = args.getValueForOption("--workload");
+
+    juce::Array<juce::var> results;
+    bool ranAny = false, allConnected = true;
+    for (const Workload& workload : WORKLOADS)
+    {
+        if (options.workload != "all" && options.workload != workload.name) continue;
+        ranAny = true;
+
+        if (!options.json)
+            std::printf("Running %s (%.1f s, %s model)...\n", workload.name, options.seconds, options.rs232 ? "RS-232" : "GPIB");
+        std::fflush(stdout);
+
+        Result result = runWorkload(workload, options);
+        allConnected = allConnected && result.error.isEmpty();
+        if (options.json)
+            results.add(toJSON(result));
+        else
+            printResult(result);
+    }
+
+    if (!ranAny)
+    {
+        std::fprintf(stderr, "Unknown workload '%s' - use all, automation, midi, arb or arb+midi\n", options.workload.toRawUTF8());
+        return 2;
+    }
+
+    if (options.json)
+        std::printf("%s\n", juce::JSON::toString(juce::var(results)).toRawUTF8());
+    return allConnected ? 0 : 1;
+}
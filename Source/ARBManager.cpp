@@ -1,233 +1,542 @@
 #include "ARBManager.h"
+#include "CycleExtractor.h"
 #include <algorithm>
 #include <cmath>
-#include <queue>
+#include <atomic>
+#include <deque>
 #include <juce_core/juce_core.h>
 #include <juce_events/juce_events.h>
 
-// Background thread for async ARB uploads
-class ARBManager::UploadThread : public juce::Thread
+// ============================================================================
+// UPLOAD PIPELINE
+// ============================================================================
+// Two stages on their own threads: prepare (resample + normalize, CPU only) and
+// transfer (residency check + bus), so slot N+1 is resampled while slot N is
+// still on the bus. Requests are keyed by slot - asking again for a slot that's
+// already queued joins that request, and work made stale by a newer request or a
+// cancel is dropped at the next stage boundary.
+class ARBManager::UploadPipeline
 {
 public:
-    UploadThread(ARBManager& manager, HP33120ADriver& driver)
-        : Thread("ARBUploadThread"), arbManager(manager), device(driver)
+    UploadPipeline(ARBManager& manager, HP33120ADriver& driver)
+        : arbManager(manager), device(driver),
+          prepareStage("ARBPrepareThread", [this] { runPrepareStage(); }),
+          transferStage("ARBUploadThread", [this] { runTransferStage(); })
     {
-        startThread();
+        prepareStage.startThread();
+        transferStage.startThread();
     }
     
-    ~UploadThread() override
+    ~UploadPipeline()
     {
-        stopThread(5000);  // Wait up to 5 seconds for thread to stop
+        cancelInFlight = true;  // Don't sit out the rest of a transfer
+        prepareStage.stop();
+        transferStage.stop();
     }
     
-    void queueUpload(int slotIndex, ARBManager::UploadCallback callback)
+    void queueUpload(int slotIndex, UploadCallback callback, ProgressCallback progress)
     {
-        juce::ScopedLock sl(queueLock);
-        uploadQueue.push({slotIndex, callback});
-        notify();  // Wake up thread
+        // isConnected() is an atomic read, so a request with no device fails here
+        // instead of waiting out the resample on the prepare stage
+        if (!device.isConnected())
+        {
+            std::vector<UploadCallback> callbacks;
+            if (callback) callbacks.push_back(std::move(callback));
+            complete(slotIndex, std::move(callbacks), false, "Device not connected");
+            return;
+        }
+        
+        {
+            const juce::ScopedLock sl(pipelineLock);
+            auto& request = requests[slotIndex];
+            ++request.generation;
+            request.active = true;
+            if (callback) request.callbacks.push_back(std::move(callback));
+            if (progress) request.progress = std::move(progress);
+            
+            if (!request.waitingToPrepare)
+            {
+                request.waitingToPrepare = true;
+                prepareQueue.push_back(slotIndex);
+            }
+        }
+        setSlotUploading(slotIndex, true);
+        prepareStage.workPending.signal();
     }
     
-    void run() override
+    bool cancel(int slotIndex)
     {
-        while (!threadShouldExit())
+        std::vector<UploadCallback> callbacks;
         {
-            // Wait for work or timeout
-            wait(100);
+            const juce::ScopedLock sl(pipelineLock);
+            auto& request = requests[slotIndex];
+            if (!request.active) return false;
             
-            // Process queued uploads
-            UploadTask task;
+            // Any prepared job for the slot is now stale and gets dropped by the transfer stage
+            ++request.generation;
+            request.active = false;
+            request.waitingToPrepare = false;
+            request.progress = nullptr;
+            callbacks.swap(request.callbacks);
+            prepareQueue.erase(std::remove(prepareQueue.begin(), prepareQueue.end(), slotIndex), prepareQueue.end());
+            
+            if (inFlightSlot == slotIndex) cancelInFlight = true;
+        }
+        setSlotUploading(slotIndex, false);
+        complete(slotIndex, std::move(callbacks), false, "Upload cancelled");
+        return true;
+    }
+    
+    bool isActive(int slotIndex) const
+    {
+        const juce::ScopedLock sl(pipelineLock);
+        return requests[slotIndex].active;
+    }
+    
+private:
+    class Stage : public juce::Thread
+    {
+    public:
+        Stage(const juce::String& name, std::function<void()> body)
+            : Thread(name), stageBody(std::move(body)) {}
+        
+        void run() override { stageBody(); }
+        
+        void stop()
+        {
+            signalThreadShouldExit();
+            workPending.signal();
+            stopThread(5000);  // Wait up to 5 seconds for thread to stop
+        }
+        
+        juce::WaitableEvent workPending;
+        
+    private:
+        std::function<void()> stageBody;
+    };
+    
+    struct Request
+    {
+        juce::uint64 generation = 0;  // Bumped by every request and cancel
+        bool active = false;          // Queued, preparing or transferring
+        bool waitingToPrepare = false;
+        std::vector<UploadCallback> callbacks;  // Everyone who asked since the last result
+        ProgressCallback progress;
+    };
+    
+    struct PreparedUpload
+    {
+        int slotIndex = -1;
+        juce::uint64 generation = 0;
+        juce::String name;
+        int pointCount = 0;
+        std::vector<float> points;
+        juce::String error;  // Set if preparation failed
+    };
+    
+    void runPrepareStage()
+    {
+        while (!prepareStage.threadShouldExit())
+        {
+            PreparedUpload job;
             {
-                juce::ScopedLock sl(queueLock);
-                if (!uploadQueue.empty())
+                const juce::ScopedLock sl(pipelineLock);
+                if (!prepareQueue.empty())
                 {
-                    task = uploadQueue.front();
-                    uploadQueue.pop();
+                    job.slotIndex = prepareQueue.front();
+                    prepareQueue.pop_front();
+                    requests[job.slotIndex].waitingToPrepare = false;
+                    job.generation = requests[job.slotIndex].generation;
                 }
+            }
+            
+            if (job.slotIndex < 0)
+            {
+                prepareStage.workPending.wait(-1);  // Woken by queueUpload() or stop()
+                continue;
+            }
+            
+            // Copy out under the slot lock, resample outside it
+            std::vector<float> master;
+            {
+                auto& slot = arbManager.getSlot(job.slotIndex);
+                const juce::ScopedLock sl(slot.lock);
+                job.name = slot.name;
+                job.pointCount = slot.targetPointCount;
+                if (slot.hasData) master = slot.originalAudioData;
+            }
+            
+            try
+            {
+                if (master.empty())
+                    job.error = "No data in slot";
                 else
+                    job.points = arbManager.resampleWithAntiAliasing(master, job.pointCount);
+                
+                if (job.error.isEmpty() && job.points.empty())
+                    job.error = "Resampling failed";
+            }
+            catch (const std::exception& e)
+            {
+                job.error = "Exception: " + juce::String(e.what());
+            }
+            
+            {
+                const juce::ScopedLock sl(pipelineLock);
+                transferQueue.push_back(std::move(job));
+            }
+            transferStage.workPending.signal();
+        }
+    }
+    
+    void runTransferStage()
+    {
+        HP33120ADriver::setThreadLane(HP33120ADriver::CommandLane::Bulk);
+        
+        while (!transferStage.threadShouldExit())
+        {
+            PreparedUpload job;
+            ProgressCallback progress;
+            {
+                const juce::ScopedLock sl(pipelineLock);
+                
+                // Skip anything a newer request or a cancel has made stale
+                while (!transferQueue.empty() && transferQueue.front().generation != requests[transferQueue.front().slotIndex].generation)
+                    transferQueue.pop_front();
+                
+                if (!transferQueue.empty())
                 {
-                    continue;  // No work, continue waiting
+                    job = std::move(transferQueue.front());
+                    transferQueue.pop_front();
+                    progress = requests[job.slotIndex].progress;
+                    inFlightSlot = job.slotIndex;
+                    cancelInFlight = false;
                 }
             }
             
-            // Perform the upload
+            if (job.slotIndex < 0)
+            {
+                transferStage.workPending.wait(-1);  // Woken by the prepare stage or stop()
+                continue;
+            }
+            
             bool success = false;
-            juce::String message;
+            juce::String message = job.error;
             
-            try
+            if (message.isEmpty())
             {
-                // Check device connection on background thread (not UI thread)
-                if (!device.isConnected())
+                try
                 {
-                    message = "Device not connected";
-                    if (task.callback)
+                    // Again here - the device can go away while the job waits behind another upload
+                    if (!device.isConnected())
                     {
-                        juce::MessageManager::getInstance()->callAsync([task, message]()
-                        {
-                            task.callback(task.slotIndex, false, message);
-                        });
+                        message = "Device not connected";
                     }
-                    continue;
-                }
-                
-                auto& slot = arbManager.getSlot(task.slotIndex);
-                {
-                    juce::ScopedLock sl(slot.lock);
-                    slot.isUploading = true;
-                }
-                
-                // Resample to target point count
-                // Yield control periodically during resampling to keep system responsive
-                std::vector<float> resampled = arbManager.resampleWithAntiAliasing(
-                    slot.originalAudioData,
-                    slot.targetPointCount
-                );
-                
-                // Yield after resampling (in case it was CPU-intensive)
-                Thread::yield();
-                
-                if (!resampled.empty())
-                {
-                    // Upload to device (this will take time, but it's on background thread)
-                    device.downloadARBWaveform(
-                        slot.name.toStdString(),
-                        resampled,
-                        slot.targetPointCount
-                    );
-                    
-                    // Yield after upload
-                    Thread::yield();
-                    
-                    // Check if upload was successful by checking for errors
-                    std::string lastError = device.getLastError();
-                    bool uploadFailed = !lastError.empty() && 
-                                        lastError.find("timeout") == std::string::npos &&
-                                        lastError.find("No error") == std::string::npos;
-                    
+                    else
                     {
-                        juce::ScopedLock sl(slot.lock);
-                        if (!uploadFailed)
-                        {
-                            slot.uploadedToDevice = true;
-                            success = true;
-                            message = "Uploaded " + juce::String(resampled.size()) + " points";
-                        }
-                        else
+                        const int slotIndex = job.slotIndex;
+                        int lastPercent = -1;
+                        auto onChunk = [this, slotIndex, &progress, &lastPercent](size_t sent, size_t total)
                         {
-                            slot.uploadedToDevice = false;
-                            success = false;
-                            message = "Upload failed: " + juce::String(lastError);
-                        }
-                        slot.isUploading = false;
+                            int percent = total > 0 ? (int)((sent * 100) / total) : 100;
+                            if (progress && percent != lastPercent)
+                            {
+                                lastPercent = percent;
+                                juce::MessageManager::getInstance()->callAsync([progress, slotIndex, percent]()
+                                {
+                                    progress(slotIndex, (float)percent / 100.0f);
+                                });
+                            }
+                            return !cancelInFlight.load();
+                        };
+                        
+                        success = arbManager.uploadIfNotResident(job.name, job.pointCount, job.points, message, onChunk);
+                        arbManager.applyEvictions();
                     }
                 }
-                else
+                catch (const std::exception& e)
                 {
-                    {
-                        juce::ScopedLock sl(slot.lock);
-                        slot.isUploading = false;
-                    }
-                    message = "Resampling failed";
+                    message = "Exception: " + juce::String(e.what());
                 }
-            }
-            catch (const std::exception& e)
-            {
-                auto& slot = arbManager.getSlot(task.slotIndex);
+                catch (...)
                 {
-                    juce::ScopedLock sl(slot.lock);
-                    slot.isUploading = false;
+                    message = "Unknown error";
                 }
-                message = "Exception: " + juce::String(e.what());
             }
-            catch (...)
+            
+            std::vector<UploadCallback> callbacks;
+            bool current = false;
             {
-                auto& slot = arbManager.getSlot(task.slotIndex);
+                const juce::ScopedLock sl(pipelineLock);
+                inFlightSlot = -1;
+                
+                // Superseded: the newer request reports for everyone. Cancelled: cancel() already has.
+                auto& request = requests[job.slotIndex];
+                current = (request.generation == job.generation);
+                if (current)
                 {
-                    juce::ScopedLock sl(slot.lock);
-                    slot.isUploading = false;
+                    request.active = false;
+                    request.progress = nullptr;
+                    callbacks.swap(request.callbacks);
                 }
-                message = "Unknown error";
             }
             
-            // Call callback on message thread
-            if (task.callback)
+            if (current)
             {
-                juce::MessageManager::getInstance()->callAsync([task, success, message]()
+                auto& slot = arbManager.getSlot(job.slotIndex);
                 {
-                    task.callback(task.slotIndex, success, message);
-                });
+                    const juce::ScopedLock sl(slot.lock);
+                    // Only if the slot still holds what was sent
+                    if (slot.name == job.name && slot.targetPointCount == job.pointCount)
+                        slot.uploadedToDevice = success;
+                    slot.isUploading = false;
+                }
+                complete(job.slotIndex, std::move(callbacks), success, message);
             }
         }
     }
     
-private:
+    void setSlotUploading(int slotIndex, bool uploading)
+    {
+        auto& slot = arbManager.getSlot(slotIndex);
+        const juce::ScopedLock sl(slot.lock);
+        slot.isUploading = uploading;
+    }
+    
+    static void complete(int slotIndex, std::vector<UploadCallback> callbacks, bool success, const juce::String& message)
+    {
+        if (callbacks.empty()) return;
+        
+        // Call callbacks on message thread
+        juce::MessageManager::getInstance()->callAsync([callbacks, slotIndex, success, message]()
+        {
+            for (auto& callback : callbacks)
+                callback(slotIndex, success, message);
+        });
+    }
+    
     ARBManager& arbManager;
     HP33120ADriver& device;
     
-    struct UploadTask
-    {
-        int slotIndex;
-        ARBManager::UploadCallback callback;
-    };
+    juce::CriticalSection pipelineLock;
+    Request requests[4];
+    std::deque<int> prepareQueue;
+    std::deque<PreparedUpload> transferQueue;
+    int inFlightSlot = -1;
+    std::atomic<bool> cancelInFlight { false };
     
-    juce::CriticalSection queueLock;
-    std::queue<UploadTask> uploadQueue;
+    Stage prepareStage;
+    Stage transferStage;
 };
 
 ARBManager::ARBManager(HP33120ADriver& driver)
-    : device(driver), uploadThread(std::make_unique<UploadThread>(*this, driver))
+    : device(driver), uploadPipeline(std::make_unique<UploadPipeline>(*this, driver))
 {
+    importFormats.registerBasicFormats();
+    
     // Initialize default slot names (avoid built-in names: USER, VOLATILE, SINC, etc.)
     slots[0].name = "MYARB";
     slots[1].name = "ARB_2";
     slots[2].name = "ARB_3";
     slots[3].name = "CUSTOM";
+    
+    // When the device is full, the least recently used waveform makes room
+    device.chooseWaveformToEvict = [this](const std::vector<std::string>& userWaveforms) {
+        auto key = getDeviceKey();
+        std::string victim = residencyCache->leastRecentlyUsed(key, userWaveforms);
+        residencyCache->forget(key, juce::String(victim));
+        
+        const juce::ScopedLock sl(evictedNamesLock);
+        evictedNames.add(juce::String(victim));
+        return victim;
+    };
 }
 
 ARBManager::~ARBManager()
 {
-    uploadThread.reset();  // Stop thread in destructor
+    // Jobs write into the slots. Decoding can't be interrupted, so wait for it to end -
+    // a timeout here would leave a job publishing into destroyed slots.
+    preparePool.removeAllJobs(true, -1);
+    uploadPipeline.reset();  // Stop both stages before the slots go
+    device.chooseWaveformToEvict = nullptr;
 }
 
-bool ARBManager::loadAudioFile(int slotIndex, const juce::File& file, juce::AudioFormatManager& formatManager)
+// ============================================================================
+// AUDIO IMPORT (any thread - nothing here touches a slot)
+// ============================================================================
+static std::unique_ptr<juce::AudioFormatReader> openReader(const juce::File& file, juce::AudioFormatManager& formatManager)
 {
-    if (slotIndex < 0 || slotIndex >= 4) return false;
-    
-    const juce::ScopedLock sl(slots[slotIndex].lock);
-    
-    // Create reader for the file
-    std::unique_ptr<juce::AudioFormatReader> reader(formatManager.createReaderFor(file));
-    if (!reader)
+    // Prefer a memory-mapped reader (WAV/AIFF): chunks are read straight out of the
+    // mapping instead of through a file buffer. Everything else is streamed.
+    std::unique_ptr<juce::AudioFormatReader> reader;
+    if (auto* format = formatManager.findFormatForFileExtension(file.getFileExtension()))
     {
-        return false;
+        std::unique_ptr<juce::MemoryMappedAudioFormatReader> mapped(format->createMemoryMappedReader(file));
+        if (mapped && mapped->mapEntireFile())
+            reader = std::move(mapped);
     }
+    if (!reader)
+        reader.reset(formatManager.createReaderFor(file));
+    
+    if (!reader || reader->numChannels == 0 || reader->lengthInSamples <= 0)
+        return nullptr;
+    return reader;
+}
+
+// Mono mix of [start, start + numSamples) at the file's own rate
+static std::vector<float> readMono(juce::AudioFormatReader& reader, juce::int64 start, int numSamples)
+{
+    const int numChannels = (int)reader.numChannels;
+    juce::AudioBuffer<float> buffer(numChannels, numSamples);
+    if (!reader.read(&buffer, 0, numSamples, start, true, true)) return {};
     
-    // Read audio data
-    juce::AudioBuffer<float> audioBuffer((int)reader->numChannels, (int)reader->lengthInSamples);
-    reader->read(&audioBuffer, 0, (int)reader->lengthInSamples, 0, true, true);
+    std::vector<float> mono((size_t)numSamples, 0.0f);
+    for (int ch = 0; ch < numChannels; ++ch)
+        juce::FloatVectorOperations::addWithMultiply(mono.data(), buffer.getReadPointer(ch), 1.0f / (float)numChannels, numSamples);
+    return mono;
+}
+
+bool ARBManager::readMaster(juce::AudioFormatReader& reader, std::vector<float>& master)
+{
+    // Read in fixed-size chunks, mixing to mono and box-averaging down to at most
+    // MASTER_POINTS on the fly - memory no longer depends on the length of the file
+    const juce::int64 length = reader.lengthInSamples;
+    const int numChannels = (int)reader.numChannels;
+    const int masterPoints = (int)juce::jmin<juce::int64>(length, MASTER_POINTS);
     
-    // Convert to mono and store
-    slots[slotIndex].originalAudioData.clear();
-    slots[slotIndex].originalAudioData.reserve(audioBuffer.getNumSamples());
+    master.assign((size_t)masterPoints, 0.0f);
+    std::vector<int> counts((size_t)masterPoints, 0);
+    juce::AudioBuffer<float> chunk(numChannels, IMPORT_CHUNK_SAMPLES);
     
-    for (int i = 0; i < audioBuffer.getNumSamples(); ++i)
+    for (juce::int64 start = 0; start < length; start += IMPORT_CHUNK_SAMPLES)
     {
-        float sample = 0.0f;
-        if (audioBuffer.getNumChannels() >= 2)
+        int numSamples = (int)juce::jmin<juce::int64>(IMPORT_CHUNK_SAMPLES, length - start);
+        if (!reader.read(&chunk, 0, numSamples, start, true, true))
+            return false;
+        
+        for (int i = 0; i < numSamples; ++i)
         {
-            // Mix stereo to mono
-            sample = (audioBuffer.getSample(0, i) + audioBuffer.getSample(1, i)) * 0.5f;
+            float sample = 0.0f;
+            for (int ch = 0; ch < numChannels; ++ch)
+                sample += chunk.getReadPointer(ch)[i];
+            
+            // Source sample n lands in master point n * masterPoints / length
+            auto point = (size_t)(((start + i) * masterPoints) / length);
+            master[point] += sample / (float)numChannels;
+            ++counts[point];
         }
-        else if (audioBuffer.getNumChannels() >= 1)
+    }
+    
+    for (size_t i = 0; i < master.size(); ++i)
+        if (counts[i] > 1) master[i] /= (float)counts[i];
+    
+    return !master.empty();
+}
+
+bool ARBManager::readCycles(juce::AudioFormatReader& reader, int cycles, std::vector<float>& points, double& pitchHz)
+{
+    // Analyse past the attack: a quarter of the way in, as long as there is room
+    const double sampleRate = reader.sampleRate;
+    const int maxPeriod = (int)std::ceil(sampleRate / CycleExtractor::MIN_FREQ_HZ);
+    const int wanted = CycleExtractor::getAnalysisLength(sampleRate) + cycles * maxPeriod;
+    const int numSamples = (int)juce::jmin<juce::int64>(wanted, reader.lengthInSamples);
+    const juce::int64 start = juce::jmin<juce::int64>(reader.lengthInSamples / 4, reader.lengthInSamples - numSamples);
+    
+    std::vector<float> analysis = readMono(reader, start, numSamples);
+    if (analysis.empty()) return false;
+    
+    double period = CycleExtractor::detectPeriod(analysis.data(), (int)analysis.size(), sampleRate);
+    if (period <= 0.0) return false;
+    
+    points = CycleExtractor::extractCycles(analysis.data(), (int)analysis.size(), period, cycles);
+    pitchHz = sampleRate / period;
+    return !points.empty();
+}
+
+bool ARBManager::prepareAudioFile(const juce::File& file, juce::AudioFormatManager& formatManager,
+                                  const ImportOptions& options, std::vector<float>& data, juce::String& message)
+{
+    auto reader = openReader(file, formatManager);
+    if (!reader)
+    {
+        message = "Failed to load " + file.getFileName();
+        return false;
+    }
+    
+    if (options.extractCycles)
+    {
+        double pitchHz = 0.0;
+        int cycles = juce::jlimit(1, MAX_EXTRACTED_CYCLES, options.cycles);
+        if (readCycles(*reader, cycles, data, pitchHz))
         {
-            sample = audioBuffer.getSample(0, i);
+            message = "Loaded " + file.getFileName() + " (" + juce::String(cycles) + (cycles == 1 ? " cycle" : " cycles")
+                    + " at " + juce::String(pitchHz, 1) + " Hz)";
+            return true;
         }
-        slots[slotIndex].originalAudioData.push_back(sample);
+        message = "Loaded " + file.getFileName() + " (no clear pitch - using the whole file)";
+    }
+    else
+    {
+        message = "Loaded " + file.getFileName();
     }
     
+    if (!readMaster(*reader, data))
+    {
+        message = "Failed to read " + file.getFileName();
+        return false;
+    }
+    return true;
+}
+
+bool ARBManager::loadAudioFile(int slotIndex, const juce::File& file, juce::AudioFormatManager& formatManager,
+                               const ImportOptions& options)
+{
+    if (slotIndex < 0 || slotIndex >= 4) return false;
+    
+    std::vector<float> data;
+    juce::String message;
+    if (!prepareAudioFile(file, formatManager, options, data, message)) return false;
+    
+    publishSlotData(slotIndex, std::move(data));
+    return true;
+}
+
+void ARBManager::publishSlotData(int slotIndex, std::vector<float> data)
+{
+    const juce::ScopedLock sl(slots[slotIndex].lock);
+    slots[slotIndex].originalAudioData = std::move(data);
     slots[slotIndex].hasData = !slots[slotIndex].originalAudioData.empty();
+    ++slots[slotIndex].dataVersion;
     slots[slotIndex].uploadedToDevice = false;  // Reset upload status when new file loaded
-    
-    return slots[slotIndex].hasData;
+}
+
+void ARBManager::loadAudioFilesAsync(int firstSlot, const juce::Array<juce::File>& files,
+                                     const SlotImportOptions& slotOptions, LoadCallback callback)
+{
+    // One job per file: decoding, pitch detection and decimation scale with core count.
+    // Only the upload itself has to go through the (single) bus.
+    for (int i = 0; i < files.size() && firstSlot + i < 4; ++i)
+    {
+        int slotIndex = firstSlot + i;
+        juce::File file = files[i];
+        ImportOptions options = slotOptions ? slotOptions(slotIndex) : ImportOptions { false, 1 };
+        
+        preparePool.addJob([this, slotIndex, file, options, callback]()
+        {
+            std::vector<float> data;
+            juce::String message;
+            bool success = prepareAudioFile(file, importFormats, options, data, message);
+            if (success) publishSlotData(slotIndex, std::move(data));
+            
+            if (callback)
+            {
+                juce::MessageManager::getInstance()->callAsync([callback, slotIndex, success, message]()
+                {
+                    callback(slotIndex, success, message);
+                });
+            }
+        });
+    }
 }
 
 void ARBManager::setSlotPointCount(int slotIndex, int pointCount)
@@ -238,48 +547,14 @@ void ARBManager::setSlotPointCount(int slotIndex, int pointCount)
     const juce::ScopedLock sl(slots[slotIndex].lock);
     
     bool wasUploaded = slots[slotIndex].uploadedToDevice;
+    bool changed = slots[slotIndex].targetPointCount != pointCount;
     slots[slotIndex].targetPointCount = pointCount;
     
-    // If slot was uploaded, re-upload with new point count
-    if (wasUploaded && slots[slotIndex].hasData)
+    // If slot was uploaded, re-upload with new point count - queued, so a slider
+    // drag coalesces into one upload of the last value
+    if (wasUploaded && changed && slots[slotIndex].hasData)
     {
-        uploadSlotToDevice(slotIndex);
-    }
-}
-
-void ARBManager::applyLowPassFilter(std::vector<float>& data, double cutoffRatio)
-{
-    if (data.empty()) return;
-    
-    // IIR biquad low-pass filter coefficients
-    // Based on JUCE's ResamplingAudioSource::createLowPass()
-    const double n = 1.0 / std::tan(juce::MathConstants<double>::pi * juce::jmax(0.001, cutoffRatio));
-    const double nSquared = n * n;
-    const double c1 = 1.0 / (1.0 + juce::MathConstants<double>::sqrt2 * n + nSquared);
-    
-    // Filter coefficients (normalized)
-    const double a = 1.0 / 1.0;  // a0 = 1.0
-    const double b0 = c1 * a;
-    const double b1 = c1 * 2.0 * a;
-    const double b2 = c1 * a;
-    const double a1 = c1 * 2.0 * (1.0 - nSquared) * a;
-    const double a2 = c1 * (1.0 - juce::MathConstants<double>::sqrt2 * n + nSquared) * a;
-    
-    // Apply filter (direct form II)
-    double x1 = 0.0, x2 = 0.0, y1 = 0.0, y2 = 0.0;
-    for (auto& sample : data)
-    {
-        double in = sample;
-        double out = b0 * in + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
-        
-        // Denormal protection
-        if (std::abs(out) < 1.0e-8) out = 0.0;
-        
-        x2 = x1;
-        x1 = in;
-        y2 = y1;
-        y1 = out;
-        sample = (float)out;
+        uploadSlotToDeviceAsync(slotIndex);
     }
 }
 
@@ -312,68 +587,12 @@ void ARBManager::normalize(std::vector<float>& data)
     }
 }
 
-std::vector<float> ARBManager::resampleWithAntiAliasing(const std::vector<float>& input, int targetPoints)
+std::vector<float> ARBManager::resampleWithAntiAliasing(const std::vector<float>& input, int targetPoints, ARBResampler::Mode mode)
 {
     if (input.empty() || targetPoints < 8) return {};
     
-    std::vector<float> output;
-    
-    if (input.size() == targetPoints)
-    {
-        output = input;
-    }
-    else if (input.size() > targetPoints)
-    {
-        // Downsampling: apply anti-aliasing filter first
-        std::vector<float> filtered = input;
-        double ratio = (double)targetPoints / input.size();
-        double cutoffRatio = 0.5 * ratio;  // Nyquist for target rate
-        applyLowPassFilter(filtered, cutoffRatio);
-        
-        // Linear interpolation resampling
-        output.resize(targetPoints);
-        if (targetPoints > 1)
-        {
-            double step = (double)(filtered.size() - 1) / (targetPoints - 1);
-            for (int i = 0; i < targetPoints; ++i)
-            {
-                double srcIndex = i * step;
-                int idx0 = (int)srcIndex;
-                int idx1 = std::min(idx0 + 1, (int)filtered.size() - 1);
-                double frac = srcIndex - idx0;
-                output[i] = (float)(filtered[idx0] * (1.0 - frac) + filtered[idx1] * frac);
-            }
-        }
-        else
-        {
-            output[0] = filtered[0];
-        }
-    }
-    else
-    {
-        // Upsampling: just interpolate (no filter needed)
-        output.resize(targetPoints);
-        if (input.size() > 1)
-        {
-            double step = (double)(input.size() - 1) / (targetPoints - 1);
-            for (int i = 0; i < targetPoints; ++i)
-            {
-                double srcIndex = i * step;
-                int idx0 = (int)srcIndex;
-                int idx1 = std::min(idx0 + 1, (int)input.size() - 1);
-                double frac = srcIndex - idx0;
-                output[i] = (float)(input[idx0] * (1.0 - frac) + input[idx1] * frac);
-            }
-        }
-        else
-        {
-            // Single sample - replicate
-            for (int i = 0; i < targetPoints; ++i)
-            {
-                output[i] = input[0];
-            }
-        }
-    }
+    // Windowed-sinc, zero-phase; Periodic keeps the loop point seamless
+    std::vector<float> output = ARBResampler::resample(input, targetPoints, mode);
     
     // Normalize to [-1, +1]
     normalize(output);
@@ -406,16 +625,11 @@ bool ARBManager::uploadSlotToDevice(int slotIndex)
         // HP33120A has 4 ARB memory slots
         // Uploading with the same name will overwrite the existing ARB
         // No need to explicitly delete - the device handles overwriting automatically
-        
-        // Upload to device (this will overwrite any existing ARB with the same name)
-        device.downloadARBWaveform(
-            slots[slotIndex].name.toStdString(),
-            resampled,
-            slots[slotIndex].targetPointCount
-        );
-        
-        slots[slotIndex].uploadedToDevice = true;
-        return true;
+        juce::String message;
+        bool success = uploadIfNotResident(slots[slotIndex].name, slots[slotIndex].targetPointCount, resampled, message);
+        slots[slotIndex].uploadedToDevice = success;
+        applyEvictions();
+        return success;
     }
     catch (const std::exception&)
     {
@@ -429,7 +643,7 @@ bool ARBManager::uploadSlotToDevice(int slotIndex)
     }
 }
 
-void ARBManager::uploadSlotToDeviceAsync(int slotIndex, UploadCallback callback)
+void ARBManager::uploadSlotToDeviceAsync(int slotIndex, UploadCallback callback, ProgressCallback progress)
 {
     if (slotIndex < 0 || slotIndex >= 4)
     {
@@ -458,24 +672,13 @@ void ARBManager::uploadSlotToDeviceAsync(int slotIndex, UploadCallback callback)
             }
             return;
         }
-        
-        if (slots[slotIndex].isUploading)
-        {
-            if (callback)
-            {
-                juce::MessageManager::getInstance()->callAsync([callback, slotIndex]()
-                {
-                    callback(slotIndex, false, "Upload already in progress");
-                });
-            }
-            return;
-        }
     }
     
-    // Queue upload on background thread (device.isConnected() will be checked there)
-    if (uploadThread)
+    // Queue on the pipeline (device.isConnected() is checked on queueing and again before the transfer).
+    // A slot that's already queued or uploading is coalesced, not rejected.
+    if (uploadPipeline)
     {
-        uploadThread->queueUpload(slotIndex, callback);
+        uploadPipeline->queueUpload(slotIndex, std::move(callback), std::move(progress));
     }
     else
     {
@@ -489,6 +692,12 @@ void ARBManager::uploadSlotToDeviceAsync(int slotIndex, UploadCallback callback)
     }
 }
 
+bool ARBManager::cancelUpload(int slotIndex)
+{
+    if (slotIndex < 0 || slotIndex >= 4 || !uploadPipeline) return false;
+    return uploadPipeline->cancel(slotIndex);
+}
+
 bool ARBManager::isUploading(int slotIndex) const
 {
     if (slotIndex < 0 || slotIndex >= 4) return false;
@@ -499,22 +708,119 @@ bool ARBManager::isUploading(int slotIndex) const
 bool ARBManager::deleteARBFromDevice(const juce::String& name)
 {
     if (!device.isConnected()) return false;
-    return device.deleteARBWaveform(name.toStdString());
+    if (!device.deleteARBWaveform(name.toStdString())) return false;
+    
+    residencyCache->forget(getDeviceKey(), name);
+    for (auto& slot : slots)
+    {
+        const juce::ScopedLock sl(slot.lock);
+        if (slot.name.equalsIgnoreCase(name)) slot.uploadedToDevice = false;
+    }
+    return true;
+}
+
+juce::String ARBManager::getDeviceKey() const
+{
+    const juce::ScopedLock sl(deviceKeyLock);
+    return currentDeviceKey;
+}
+
+bool ARBManager::uploadIfNotResident(const juce::String& name, int pointCount, const std::vector<float>& resampled,
+                                     juce::String& message, const HP33120ADriver::TransferProgress& progress)
+{
+    auto key = getDeviceKey();
+    auto hash = ARBResidencyCache::hashPoints(resampled);
+    
+    // The cache key can't tell two instruments apart (every 33120A reports serial 0), so
+    // the device confirms it still holds the waveform before the upload is skipped - and
+    // the skip still has to play it, like an upload would
+    if (key.isNotEmpty() && residencyCache->isResident(key, name, hash, pointCount))
+    {
+        const auto deviceName = name.toUpperCase().toStdString();
+        if (device.holdsWaveform(deviceName, pointCount))
+        {
+            if (device.setUserWaveform(deviceName))
+            {
+                residencyCache->touch(key, name);
+                message = "Already on device (" + juce::String(resampled.size()) + " points) - upload skipped";
+                return true;
+            }
+            // Listed but not selectable - upload it again rather than report a waveform that isn't playing
+        }
+        residencyCache->forget(key, name);
+    }
+    
+    const auto report = device.downloadARBWaveform(name.toStdString(), resampled, pointCount, progress);
+    
+    if (report.cancelled)
+    {
+        residencyCache->forget(key, name);  // VOLATILE was overwritten, the copy never happened
+        message = "Upload cancelled";
+        return false;
+    }
+    
+    // Only what the device confirmed counts - a clean error queue alone doesn't say the
+    // whole block arrived
+    if (!report.verified)
+    {
+        std::string lastError = device.getLastError();
+        residencyCache->forget(key, name);  // Whatever was there under this name may be gone
+        message = "Upload failed: " + (lastError.empty() ? juce::String("not confirmed by the device") : juce::String(lastError));
+        return false;
+    }
+    
+    // Recorded only if it's in non-volatile memory and the driver sent these points unchanged
+    if (report.nonVolatile && report.payloadHash == hash && key.isNotEmpty())
+        residencyCache->recordUpload(key, name, hash, pointCount);
+    else
+        residencyCache->forget(key, name);
+    
+    message = "Uploaded " + juce::String(report.pointsConfirmed) + " points"
+            + (report.nonVolatile ? "" : " (VOLATILE only)")
+            + (report.chunkResends > 0 ? ", " + juce::String(report.chunkResends) + " chunk(s) resent" : "");
+    return true;
+}
+
+void ARBManager::applyEvictions()
+{
+    juce::StringArray names;
+    {
+        const juce::ScopedLock sl(evictedNamesLock);
+        names.swapWith(evictedNames);
+    }
+    
+    for (auto& name : names)
+    {
+        for (auto& slot : slots)
+        {
+            const juce::ScopedLock sl(slot.lock);
+            if (slot.name.equalsIgnoreCase(name)) slot.uploadedToDevice = false;
+        }
+    }
 }
 
 void ARBManager::syncFromDevice()
 {
     if (!device.isConnected()) return;
     
-    // HP33120A does not support querying ARB names or data via SCPI
-    // We cannot determine which ARBs are currently in device memory
-    // Reset all slots to "not uploaded" state - user must upload manually
-    // This prevents crashes from unsupported query commands
+    // The 33120A can list its non-volatile waveforms but not read their points back.
+    // The residency cache fills that gap: it remembers what this plugin uploaded, to
+    // which instrument, and is pruned here against what the device actually holds.
+    auto key = ARBResidencyCache::deviceKey(juce::String(device.getIDN()), juce::String(device.getResourceName()));
+    {
+        const juce::ScopedLock sl(deviceKeyLock);
+        currentDeviceKey = key;
+    }
+    
+    std::vector<std::string> catalog = device.queryWaveformCatalog();
+    residencyCache->reconcile(key, catalog);
     
+    // A slot counts as uploaded if the device still holds what we last sent under its
+    // name. Whether that matches the slot's current data is checked again on upload.
     for (int i = 0; i < 4; ++i)
     {
         const juce::ScopedLock sl(slots[i].lock);
-        slots[i].uploadedToDevice = false;  // Reset - assume not uploaded until user uploads
+        slots[i].uploadedToDevice = !catalog.empty() && residencyCache->hasEntry(key, slots[i].name);
     }
 }
 
@@ -5,6 +5,8 @@
 #include <vector>
 #include <functional>
 #include "HP33120ADriver.h"
+#include "ARBResidencyCache.h"
+#include "ARBResampler.h"
 
 class ARBManager
 {
@@ -12,34 +14,58 @@ public:
     struct ARBSlot
     {
         juce::String name;
-        std::vector<float> originalAudioData;  // Store original for re-resampling
+        std::vector<float> originalAudioData;  // Mono master (at most MASTER_POINTS) for re-resampling
         int targetPointCount = 1024;
         bool hasData = false;
         bool uploadedToDevice = false;
         bool isUploading = false;  // Track upload in progress
+        int dataVersion = 0;  // Bumped whenever originalAudioData is replaced
         juce::CriticalSection lock;
     };
     
     // Callback type for async upload completion: (slotIndex, success, message)
     using UploadCallback = std::function<void(int, bool, const juce::String&)>;
+    // Transfer progress: (slotIndex, 0..1), on the message thread
+    using ProgressCallback = std::function<void(int, float)>;
     
     ARBManager(HP33120ADriver& driver);
     ~ARBManager();
     
     // Audio file loading (WAV/MP3)
-    bool loadAudioFile(int slotIndex, const juce::File& file, juce::AudioFormatManager& formatManager);
+    // extractCycles: keep only `cycles` whole pitch periods (see CycleExtractor.h) instead
+    // of the whole file; unpitched material falls back to the whole file
+    struct ImportOptions
+    {
+        bool extractCycles;
+        int cycles;  // 1..MAX_EXTRACTED_CYCLES
+    };
+    static constexpr int MAX_EXTRACTED_CYCLES = 16;
+    bool loadAudioFile(int slotIndex, const juce::File& file, juce::AudioFormatManager& formatManager,
+                       const ImportOptions& options = { false, 1 });
+    
+    // Loads files into consecutive slots from firstSlot, in parallel on preparePool, each
+    // with the options of the slot it goes to. The callback runs on the message thread
+    // once per file.
+    using LoadCallback = std::function<void(int, bool, const juce::String&)>;  // (slotIndex, success, message)
+    using SlotImportOptions = std::function<ImportOptions(int)>;  // slotIndex -> options, called before returning
+    void loadAudioFilesAsync(int firstSlot, const juce::Array<juce::File>& files,
+                             const SlotImportOptions& options, LoadCallback callback);
     
     // Point count control
     void setSlotPointCount(int slotIndex, int pointCount);
     
-    // Resampling with anti-aliasing
-    std::vector<float> resampleWithAntiAliasing(const std::vector<float>& input, int targetPoints);
+    // Resampling with anti-aliasing (polyphase windowed sinc, see ARBResampler.h)
+    // ARBs play as loops, so the default treats the data as one periodic cycle
+    std::vector<float> resampleWithAntiAliasing(const std::vector<float>& input, int targetPoints,
+                                                ARBResampler::Mode mode = ARBResampler::Mode::Periodic);
     
     // Device operations
     bool uploadSlotToDevice(int slotIndex);  // Synchronous (blocks)
-    void uploadSlotToDeviceAsync(int slotIndex, UploadCallback callback = nullptr);  // Asynchronous (non-blocking)
+    void uploadSlotToDeviceAsync(int slotIndex, UploadCallback callback = nullptr,
+                                 ProgressCallback progress = nullptr);  // Asynchronous (non-blocking)
+    bool cancelUpload(int slotIndex);  // Callbacks get "Upload cancelled"; false if nothing was queued
     bool deleteARBFromDevice(const juce::String& name);
-    void syncFromDevice();  // Read ARBs from device on plugin load
+    void syncFromDevice();  // Reconcile the residency cache with the device's catalog on connect
     
     // Check if upload is in progress
     bool isUploading(int slotIndex) const;
@@ -48,16 +74,47 @@ public:
     ARBSlot& getSlot(int index) { return slots[index]; }
     const ARBSlot& getSlot(int index) const { return slots[index]; }
     
+    // Imported audio is reduced to this many points - enough head room above the
+    // device's 16000 to re-resample to any point count without going back to the file
+    static constexpr int MASTER_POINTS = 65536;
+    
 private:
+    static constexpr int IMPORT_CHUNK_SAMPLES = 8192;
+    
+    bool prepareAudioFile(const juce::File& file, juce::AudioFormatManager& formatManager,
+                          const ImportOptions& options, std::vector<float>& data, juce::String& message);
+    bool readMaster(juce::AudioFormatReader& reader, std::vector<float>& master);
+    bool readCycles(juce::AudioFormatReader& reader, int cycles, std::vector<float>& points, double& pitchHz);
+    void publishSlotData(int slotIndex, std::vector<float> data);
+    
+    // Parallel preparation - its own format manager, since the processor's only
+    // exists between prepareToPlay() and releaseResources()
+    juce::AudioFormatManager importFormats;
+    juce::ThreadPool preparePool { juce::jmax(1, juce::SystemStats::getNumCpus() - 1) };
+    
     HP33120ADriver& device;
     ARBSlot slots[4];
     
-    // Background thread for async uploads
-    class UploadThread;
-    std::unique_ptr<UploadThread> uploadThread;
+    // Device-side residency - uploads of data the device already holds are skipped
+    juce::SharedResourcePointer<ARBResidencyCache> residencyCache;
+    juce::String currentDeviceKey;  // Empty until syncFromDevice()
+    juce::CriticalSection deviceKeyLock;
+    juce::String getDeviceKey() const;
+    
+    // Upload resampled points under a name unless they're already resident there.
+    // Returns false if the driver reported an error.
+    bool uploadIfNotResident(const juce::String& name, int pointCount, const std::vector<float>& resampled, juce::String& message,
+                             const HP33120ADriver::TransferProgress& progress = nullptr);
+    
+    // Names the driver evicted during an upload (LRU, see chooseWaveformToEvict)
+    juce::StringArray evictedNames;
+    juce::CriticalSection evictedNamesLock;
+    void applyEvictions();
+    
+    // Async uploads: prepare and transfer stages, each on its own thread
+    class UploadPipeline;
+    std::unique_ptr<UploadPipeline> uploadPipeline;
     
-    // Anti-aliasing filter
-    void applyLowPassFilter(std::vector<float>& data, double cutoffRatio);
     void normalize(std::vector<float>& data);
 };
 
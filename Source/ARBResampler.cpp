@@ -0,0 +1,143 @@
+#include "ARBResampler.h"
+#include <algorithm>
+#include <cmath>
+
+std::mutex ARBResampler::cacheMutex;
+std::map<std::pair<int, int>, std::shared_ptr<const ARBResampler::Table>> ARBResampler::cache;
+
+// ============================================================================
+// FILTER TABLES
+// ============================================================================
+double ARBResampler::besselI0(double x)
+{
+    // Power series - converges quickly for the beta range used here
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 50; ++k)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1.0e-12) break;
+    }
+    return sum;
+}
+
+std::shared_ptr<const ARBResampler::Table> ARBResampler::buildTable(double cutoff)
+{
+    auto table = std::make_shared<Table>();
+
+    // Kernel length in input samples, rounded up to a multiple of 4 for dot()
+    double halfWidth = ZERO_CROSSINGS / cutoff;
+    table->taps = (((int)std::ceil(halfWidth) * 2) + 3) & ~3;
+    table->phases = juce::jlimit(4, MAX_PHASES, MAX_TABLE_FLOATS / table->taps);
+    table->coefficients.assign((size_t)(table->taps * table->phases), 0.0f);
+
+    const double pi = juce::MathConstants<double>::pi;
+    const double windowNorm = besselI0(KAISER_BETA);
+    const int centre = table->taps / 2 - 1;  // Tap index of the input sample at or before the position
+
+    for (int phase = 0; phase < table->phases; ++phase)
+    {
+        double fraction = (double)phase / table->phases;
+        float* row = table->coefficients.data() + (size_t)(phase * table->taps);
+        double sum = 0.0;
+
+        for (int j = 0; j < table->taps; ++j)
+        {
+            double t = (double)(j - centre) - fraction;  // Distance from the output position
+            double ratio = t / halfWidth;
+            if (std::abs(ratio) >= 1.0) continue;
+
+            double x = pi * cutoff * t;
+            double sinc = (std::abs(x) < 1.0e-12) ? 1.0 : std::sin(x) / x;
+            double window = besselI0(KAISER_BETA * std::sqrt(1.0 - ratio * ratio)) / windowNorm;
+
+            double h = cutoff * sinc * window;
+            row[j] = (float)h;
+            sum += h;
+        }
+
+        // Unity gain at DC for every phase
+        if (sum != 0.0)
+            juce::FloatVectorOperations::multiply(row, (float)(1.0 / sum), table->taps);
+    }
+
+    return table;
+}
+
+std::shared_ptr<const ARBResampler::Table> ARBResampler::getTable(int inputSize, int outputSize)
+{
+    std::lock_guard<std::mutex> lock(cacheMutex);
+
+    auto key = std::make_pair(inputSize, outputSize);
+    auto found = cache.find(key);
+    if (found != cache.end()) return found->second;
+
+    // Cut off a little below the lower Nyquist rate so the transition band doesn't alias
+    double cutoff = juce::jmin(1.0, (double)outputSize / inputSize) * 0.95;
+    auto table = buildTable(cutoff);
+
+    if (cache.size() >= MAX_CACHED_TABLES) cache.clear();
+    cache.emplace(key, table);
+    return table;
+}
+
+// ============================================================================
+// RESAMPLING
+// ============================================================================
+float ARBResampler::dot(const float* a, const float* b, int count) noexcept
+{
+    // Four independent accumulators - no loop-carried dependency, so this
+    // vectorizes without -ffast-math. count is always a multiple of 4.
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    for (int i = 0; i < count; i += 4)
+    {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+std::vector<float> ARBResampler::resample(const std::vector<float>& input, int outputSize, Mode mode)
+{
+    const int inputSize = (int)input.size();
+    if (inputSize == 0 || outputSize < 1) return {};
+    if (inputSize == outputSize) return input;
+
+    auto table = getTable(inputSize, outputSize);
+    const int taps = table->taps;
+    const int centre = taps / 2 - 1;
+
+    // Input extended on both sides, so the inner loop never checks bounds
+    const int pad = taps;
+    std::vector<float> extended((size_t)(inputSize + 2 * pad));
+    for (int k = 0; k < (int)extended.size(); ++k)
+    {
+        int index = k - pad;
+        if (mode == Mode::Periodic)
+            index = ((index % inputSize) + inputSize) % inputSize;
+        else
+            index = juce::jlimit(0, inputSize - 1, index);
+        extended[(size_t)k] = input[(size_t)index];
+    }
+
+    const double step = (mode == Mode::Periodic || outputSize == 1)
+                            ? (double)inputSize / outputSize
+                            : (double)(inputSize - 1) / (outputSize - 1);
+
+    std::vector<float> output((size_t)outputSize);
+    for (int i = 0; i < outputSize; ++i)
+    {
+        double position = i * step;
+        int base = (int)position;
+        int phase = (int)((position - base) * table->phases + 0.5);
+        if (phase == table->phases) { ++base; phase = 0; }
+
+        const float* window = extended.data() + (base - centre + pad);
+        const float* row = table->coefficients.data() + (size_t)(phase * taps);
+        output[(size_t)i] = dot(window, row, taps);
+    }
+
+    return output;
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+//==============================================================================
+// Polyphase windowed-sinc resampler for ARB preparation
+//
+// A Kaiser-windowed sinc, cut off at the lower of the two Nyquist rates, is tabulated
+// at PHASES fractional offsets once per (input length, output length) pair and kept
+// in a small cache, so changing a slot's point count back and forth only costs the
+// dot products. The kernel is symmetric, so there is no phase shift.
+//
+// Periodic mode treats the input as one cycle of a loop: output point i samples
+// position i * N / K, and the filter wraps around the ends, so the loop point stays
+// seamless. Clamped mode maps the first and last points onto each other
+// (i * (N - 1) / (K - 1)) and extends the ends by repetition.
+//==============================================================================
+class ARBResampler
+{
+public:
+    enum class Mode { Periodic, Clamped };
+
+    static std::vector<float> resample(const std::vector<float>& input, int outputSize, Mode mode = Mode::Periodic);
+
+private:
+    struct Table
+    {
+        int taps = 0;                   // Per phase, multiple of 4
+        int phases = 0;
+        std::vector<float> coefficients;  // phases * taps, each row sums to 1
+    };
+
+    static std::shared_ptr<const Table> getTable(int inputSize, int outputSize);
+    static std::shared_ptr<const Table> buildTable(double cutoff);
+
+    static float dot(const float* a, const float* b, int count) noexcept;
+    static double besselI0(double x);
+
+    static constexpr int ZERO_CROSSINGS = 16;       // Kernel half-width, in cutoff periods
+    static constexpr int MAX_PHASES = 256;
+    static constexpr int MAX_TABLE_FLOATS = 1 << 20;  // Extreme downsampling trades phases for taps
+    static constexpr double KAISER_BETA = 9.0;      // ~90 dB stop band
+    static constexpr size_t MAX_CACHED_TABLES = 16;
+
+    static std::mutex cacheMutex;
+    static std::map<std::pair<int, int>, std::shared_ptr<const Table>> cache;
+};
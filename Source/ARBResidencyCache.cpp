@@ -0,0 +1,176 @@
+#include "ARBResidencyCache.h"
+#include "HP33120ADriver.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+ARBResidencyCache::ARBResidencyCache()
+{
+    load();
+}
+
+ARBResidencyCache::~ARBResidencyCache() = default;
+
+// ============================================================================
+// KEYS
+// ============================================================================
+juce::uint64 ARBResidencyCache::hashPoints(const std::vector<float>& points)
+{
+    // Over the 12-bit DAC codes - float noise below one DAC step doesn't change the hash
+    return (juce::uint64)HP33120ADriver::hashDACCodes(points);
+}
+
+juce::String ARBResidencyCache::deviceKey(const juce::String& idn, const juce::String& resource)
+{
+    return idn.trim() + "@" + resource.trim().toUpperCase();
+}
+
+// ============================================================================
+// LOOKUP
+// ============================================================================
+const ARBResidencyCache::Entry* ARBResidencyCache::find(const juce::String& device, const juce::String& name) const
+{
+    juce::String upperName = name.toUpperCase();
+    for (const auto& entry : entries)
+        if (entry.device == device && entry.name == upperName)
+            return &entry;
+    return nullptr;
+}
+
+ARBResidencyCache::Entry* ARBResidencyCache::find(const juce::String& device, const juce::String& name)
+{
+    return const_cast<Entry*>(static_cast<const ARBResidencyCache*>(this)->find(device, name));
+}
+
+bool ARBResidencyCache::isResident(const juce::String& device, const juce::String& name, juce::uint64 hash, int pointCount) const
+{
+    const juce::ScopedLock sl(lock);
+    auto* entry = find(device, name);
+    return entry != nullptr && entry->hash == hash && entry->pointCount == pointCount;
+}
+
+bool ARBResidencyCache::hasEntry(const juce::String& device, const juce::String& name) const
+{
+    const juce::ScopedLock sl(lock);
+    return find(device, name) != nullptr;
+}
+
+std::string ARBResidencyCache::leastRecentlyUsed(const juce::String& device, const std::vector<std::string>& candidates) const
+{
+    const juce::ScopedLock sl(lock);
+
+    std::string oldest;
+    juce::int64 oldestMs = std::numeric_limits<juce::int64>::max();
+    for (const auto& candidate : candidates)
+    {
+        auto* entry = find(device, juce::String(candidate));
+        juce::int64 usedMs = entry ? entry->lastUsedMs : 0;
+        if (usedMs < oldestMs)
+        {
+            oldestMs = usedMs;
+            oldest = candidate;
+        }
+    }
+    return oldest;
+}
+
+// ============================================================================
+// UPDATES
+// ============================================================================
+void ARBResidencyCache::reconcile(const juce::String& device, const std::vector<std::string>& catalog)
+{
+    const juce::ScopedLock sl(lock);
+
+    auto notInCatalog = [&](const Entry& entry) {
+        if (entry.device != device) return false;
+        return std::none_of(catalog.begin(), catalog.end(), [&entry](const std::string& name) {
+            return juce::String(name).toUpperCase() == entry.name;
+        });
+    };
+
+    auto before = entries.size();
+    entries.erase(std::remove_if(entries.begin(), entries.end(), notInCatalog), entries.end());
+    if (entries.size() != before) save();
+}
+
+void ARBResidencyCache::recordUpload(const juce::String& device, const juce::String& name, juce::uint64 hash, int pointCount)
+{
+    const juce::ScopedLock sl(lock);
+
+    auto* entry = find(device, name);
+    if (!entry)
+    {
+        entries.push_back({ device, name.toUpperCase() });
+        entry = &entries.back();
+    }
+    entry->hash = hash;
+    entry->pointCount = pointCount;
+    entry->lastUsedMs = juce::Time::currentTimeMillis();
+    save();
+}
+
+void ARBResidencyCache::touch(const juce::String& device, const juce::String& name)
+{
+    const juce::ScopedLock sl(lock);
+    if (auto* entry = find(device, name))
+    {
+        entry->lastUsedMs = juce::Time::currentTimeMillis();
+        save();
+    }
+}
+
+void ARBResidencyCache::forget(const juce::String& device, const juce::String& name)
+{
+    const juce::ScopedLock sl(lock);
+    juce::String upperName = name.toUpperCase();
+    auto before = entries.size();
+    entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const Entry& entry) {
+        return entry.device == device && entry.name == upperName;
+    }), entries.end());
+    if (entries.size() != before) save();
+}
+
+// ============================================================================
+// PERSISTENCE
+// ============================================================================
+juce::File ARBResidencyCache::getCacheFile()
+{
+    return juce::File::getSpecialLocation(juce::File::userApplicationDataDirectory)
+               .getChildFile("HP33120A").getChildFile("ARBCache.xml");
+}
+
+void ARBResidencyCache::load()
+{
+    auto xml = juce::XmlDocument::parse(getCacheFile());
+    if (!xml || !xml->hasTagName("ARBCache")) return;
+
+    for (auto* element : xml->getChildWithTagNameIterator("Entry"))
+    {
+        Entry entry;
+        entry.device = element->getStringAttribute("device");
+        entry.name = element->getStringAttribute("name").toUpperCase();
+        entry.hash = (juce::uint64)element->getStringAttribute("hash").getHexValue64();
+        entry.pointCount = element->getIntAttribute("points");
+        entry.lastUsedMs = element->getStringAttribute("lastUsed").getLargeIntValue();
+        if (entry.device.isNotEmpty() && entry.name.isNotEmpty())
+            entries.push_back(entry);
+    }
+}
+
+void ARBResidencyCache::save() const
+{
+    juce::XmlElement xml("ARBCache");
+    for (const auto& entry : entries)
+    {
+        auto* element = xml.createNewChildElement("Entry");
+        element->setAttribute("device", entry.device);
+        element->setAttribute("name", entry.name);
+        element->setAttribute("hash", juce::String::toHexString((juce::int64)entry.hash));
+        element->setAttribute("points", entry.pointCount);
+        element->setAttribute("lastUsed", juce::String(entry.lastUsedMs));
+    }
+
+    auto file = getCacheFile();
+    file.getParentDirectory().createDirectory();
+    xml.writeTo(file);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <string>
+#include <vector>
+
+//==============================================================================
+// Which ARB waveforms each instrument already holds in non-volatile memory
+//
+// Entries are keyed by a hash of the points as the DAC will see them (12-bit
+// quantized) plus the point count, so an upload of identical data is skipped even
+// after a reconnect or a project reload. Last-use times pick which of the 4 user
+// slots is evicted when the device is full. Persisted as XML in the user's
+// application data folder, shared by every plugin instance. Thread-safe.
+//==============================================================================
+class ARBResidencyCache
+{
+public:
+    ARBResidencyCache();
+    ~ARBResidencyCache();
+
+    // Content hash of resampled [-1, +1] points
+    static juce::uint64 hashPoints(const std::vector<float>& points);
+
+    // Device identity - *IDN? plus the VISA resource (the 33120A reports serial 0)
+    static juce::String deviceKey(const juce::String& idn, const juce::String& resource);
+
+    // Drops entries for names no longer in the device's catalog (front-panel deletes, *RST...)
+    void reconcile(const juce::String& device, const std::vector<std::string>& catalog);
+
+    bool isResident(const juce::String& device, const juce::String& name, juce::uint64 hash, int pointCount) const;
+    bool hasEntry(const juce::String& device, const juce::String& name) const;
+
+    void recordUpload(const juce::String& device, const juce::String& name, juce::uint64 hash, int pointCount);
+    void touch(const juce::String& device, const juce::String& name);  // Selected or skipped upload
+    void forget(const juce::String& device, const juce::String& name);
+
+    // Least recently used of the candidates; names the cache never saw count as oldest
+    std::string leastRecentlyUsed(const juce::String& device, const std::vector<std::string>& candidates) const;
+
+private:
+    struct Entry
+    {
+        juce::String device;
+        juce::String name;  // Upper case, as the catalog reports it
+        juce::uint64 hash = 0;
+        int pointCount = 0;
+        juce::int64 lastUsedMs = 0;
+    };
+
+    const Entry* find(const juce::String& device, const juce::String& name) const;
+    Entry* find(const juce::String& device, const juce::String& name);
+
+    void load();
+    void save() const;
+    static juce::File getCacheFile();
+
+    std::vector<Entry> entries;
+    juce::CriticalSection lock;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ARBResidencyCache)
+};
@@ -0,0 +1,180 @@
+#include "BusTelemetry.h"
+#include <cmath>
+
+BusTelemetry::BusTelemetry()
+{
+    startMs.store(juce::Time::getMillisecondCounterHiRes());
+}
+
+// ============================================================================
+// RECORDING
+// ============================================================================
+int BusTelemetry::bucketFor(double micros) noexcept
+{
+    if (!(micros >= 1.0)) return 0;  // Also catches NaN
+    int bucket = (int)(std::log2(micros) * BUCKETS_PER_OCTAVE);
+    return bucket < NUM_BUCKETS ? bucket : NUM_BUCKETS - 1;
+}
+
+double BusTelemetry::bucketMidpointMs(int bucket) noexcept
+{
+    // Geometric middle of [2^(b/N), 2^((b+1)/N)) us
+    return std::exp2((bucket + 0.5) / BUCKETS_PER_OCTAVE) / 1000.0;
+}
+
+void BusTelemetry::record(Metric metric, double ms) noexcept
+{
+    Histogram& histogram = histograms[(size_t)metric];
+    const double micros = ms * 1000.0;
+    const uint64_t wholeMicros = micros > 0.0 ? (uint64_t)micros : 0;
+
+    histogram.buckets[(size_t)bucketFor(micros)].fetch_add(1, std::memory_order_relaxed);
+    histogram.count.fetch_add(1, std::memory_order_relaxed);
+    histogram.sumMicros.fetch_add(wholeMicros, std::memory_order_relaxed);
+
+    uint64_t previousMax = histogram.maxMicros.load(std::memory_order_relaxed);
+    while (wholeMicros > previousMax
+           && !histogram.maxMicros.compare_exchange_weak(previousMax, wholeMicros, std::memory_order_relaxed))
+    {
+    }
+}
+
+void BusTelemetry::reset()
+{
+    for (auto& histogram : histograms)
+    {
+        for (auto& bucket : histogram.buckets)
+            bucket.store(0, std::memory_order_relaxed);
+        histogram.count.store(0, std::memory_order_relaxed);
+        histogram.sumMicros.store(0, std::memory_order_relaxed);
+        histogram.maxMicros.store(0, std::memory_order_relaxed);
+    }
+    bytesWritten.store(0, std::memory_order_relaxed);
+    bytesRead.store(0, std::memory_order_relaxed);
+    blockBytes.store(0, std::memory_order_relaxed);
+    startMs.store(juce::Time::getMillisecondCounterHiRes());
+}
+
+// ============================================================================
+// SNAPSHOTS
+// ============================================================================
+BusTelemetry::Summary BusTelemetry::summarize(const Histogram& histogram)
+{
+    // Buckets are read once into a local copy, so count and percentiles agree
+    std::array<uint64_t, NUM_BUCKETS> buckets;
+    uint64_t count = 0;
+    for (int i = 0; i < NUM_BUCKETS; ++i)
+    {
+        buckets[(size_t)i] = histogram.buckets[(size_t)i].load(std::memory_order_relaxed);
+        count += buckets[(size_t)i];
+    }
+
+    Summary summary;
+    summary.count = count;
+    if (count == 0) return summary;
+
+    summary.maxMs = (double)histogram.maxMicros.load(std::memory_order_relaxed) / 1000.0;
+    summary.meanMs = (double)histogram.sumMicros.load(std::memory_order_relaxed) / 1000.0 / (double)count;
+
+    auto percentile = [&](double fraction) {
+        uint64_t rank = juce::jmax((uint64_t)1, (uint64_t)std::ceil(fraction * (double)count));
+        uint64_t seen = 0;
+        for (int i = 0; i < NUM_BUCKETS; ++i)
+        {
+            seen += buckets[(size_t)i];
+            if (seen >= rank) return juce::jmin(bucketMidpointMs(i), summary.maxMs);
+        }
+        return summary.maxMs;
+    };
+
+    summary.p50Ms = percentile(0.50);
+    summary.p90Ms = percentile(0.90);
+    summary.p99Ms = percentile(0.99);
+    return summary;
+}
+
+BusTelemetry::Snapshot BusTelemetry::snapshot() const
+{
+    Snapshot snapshot;
+    for (int i = 0; i < NUM_METRICS; ++i)
+        snapshot.metrics[(size_t)i] = summarize(histograms[(size_t)i]);
+
+    snapshot.elapsedSeconds = juce::jmax(0.001, (juce::Time::getMillisecondCounterHiRes() - startMs.load()) / 1000.0);
+    snapshot.bytesWritten = bytesWritten.load(std::memory_order_relaxed);
+    snapshot.bytesRead = bytesRead.load(std::memory_order_relaxed);
+    snapshot.writeBytesPerSecond = (double)snapshot.bytesWritten / snapshot.elapsedSeconds;
+    snapshot.readBytesPerSecond = (double)snapshot.bytesRead / snapshot.elapsedSeconds;
+
+    const double blockSeconds = (double)histograms[(size_t)Metric::BlockTransfer].sumMicros.load(std::memory_order_relaxed) / 1.0e6;
+    if (blockSeconds > 0.0)
+        snapshot.blockBytesPerSecond = (double)blockBytes.load(std::memory_order_relaxed) / blockSeconds;
+    return snapshot;
+}
+
+// ============================================================================
+// EXPORT
+// ============================================================================
+const char* BusTelemetry::getMetricName(Metric metric)
+{
+    switch (metric)
+    {
+        case Metric::Write:         return "write";
+        case Metric::Read:          return "read";
+        case Metric::ErrorCheck:    return "error_check";
+        case Metric::QueueWait:     return "queue_wait";
+        case Metric::BlockTransfer: return "arb_block";
+        case Metric::NumMetrics:    break;
+    }
+    return "unknown";
+}
+
+juce::String BusTelemetry::toCSV(const Snapshot& snapshot)
+{
+    juce::String csv = "metric,count,mean_ms,p50_ms,p90_ms,p99_ms,max_ms\n";
+    for (int i = 0; i < NUM_METRICS; ++i)
+    {
+        const Summary& s = snapshot.metrics[(size_t)i];
+        csv << getMetricName((Metric)i) << "," << juce::String((juce::int64)s.count) << ","
+            << juce::String(s.meanMs, 3) << "," << juce::String(s.p50Ms, 3) << "," << juce::String(s.p90Ms, 3) << ","
+            << juce::String(s.p99Ms, 3) << "," << juce::String(s.maxMs, 3) << "\n";
+    }
+
+    csv << "\ncounter,value\n"
+        << "elapsed_s," << juce::String(snapshot.elapsedSeconds, 3) << "\n"
+        << "bytes_written," << juce::String((juce::int64)snapshot.bytesWritten) << "\n"
+        << "bytes_read," << juce::String((juce::int64)snapshot.bytesRead) << "\n"
+        << "write_bytes_per_s," << juce::String(snapshot.writeBytesPerSecond, 1) << "\n"
+        << "read_bytes_per_s," << juce::String(snapshot.readBytesPerSecond, 1) << "\n"
+        << "arb_block_bytes_per_s," << juce::String(snapshot.blockBytesPerSecond, 1) << "\n";
+    return csv;
+}
+
+juce::String BusTelemetry::toJSON(const Snapshot& snapshot)
+{
+    auto* root = new juce::DynamicObject();
+    juce::var rootVar(root);
+
+    auto* metrics = new juce::DynamicObject();
+    juce::var metricsVar(metrics);
+    for (int i = 0; i < NUM_METRICS; ++i)
+    {
+        const Summary& s = snapshot.metrics[(size_t)i];
+        auto* entry = new juce::DynamicObject();
+        entry->setProperty("count", (juce::int64)s.count);
+        entry->setProperty("mean_ms", s.meanMs);
+        entry->setProperty("p50_ms", s.p50Ms);
+        entry->setProperty("p90_ms", s.p90Ms);
+        entry->setProperty("p99_ms", s.p99Ms);
+        entry->setProperty("max_ms", s.maxMs);
+        metrics->setProperty(getMetricName((Metric)i), juce::var(entry));
+    }
+
+    root->setProperty("elapsed_s", snapshot.elapsedSeconds);
+    root->setProperty("metrics", metricsVar);
+    root->setProperty("bytes_written", (juce::int64)snapshot.bytesWritten);
+    root->setProperty("bytes_read", (juce::int64)snapshot.bytesRead);
+    root->setProperty("write_bytes_per_s", snapshot.writeBytesPerSecond);
+    root->setProperty("read_bytes_per_s", snapshot.readBytesPerSecond);
+    root->setProperty("arb_block_bytes_per_s", snapshot.blockBytesPerSecond);
+    return juce::JSON::toString(rootVar);
+}
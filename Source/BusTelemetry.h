@@ -0,0 +1,94 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+//==============================================================================
+// Latency and throughput counters for one driver's bus traffic
+//
+// Each metric is a log-scale histogram (BUCKETS_PER_OCTAVE buckets per doubling,
+// 1 us to ~70 s) of relaxed atomic counters, so record() is wait-free and safe from
+// any thread, including while the UI takes a snapshot. Percentiles come from the
+// bucket midpoints, so they're good to about 9% - plenty to compare adapters and
+// tune throttles. reset() isn't atomic as a whole: a sample that lands during it
+// may be counted in either period.
+//==============================================================================
+class BusTelemetry
+{
+public:
+    enum class Metric
+    {
+        Write,          // One SCPI message out (viWrite/viPrintf), bus already held
+        Read,           // Reply to a query (viRead)
+        ErrorCheck,     // *ESR? plus any SYST:ERR? drain
+        QueueWait,      // queueUpdate() to the value going out, including rate-limit holds
+        BlockTransfer,  // One ARB block (DATA:DAC / DATA VOLATILE)
+        NumMetrics
+    };
+    static constexpr int NUM_METRICS = (int)Metric::NumMetrics;
+
+    BusTelemetry();
+
+    void record(Metric metric, double ms) noexcept;
+    void addBytesWritten(size_t bytes) noexcept { bytesWritten.fetch_add((uint64_t)bytes, std::memory_order_relaxed); }
+    void addBytesRead(size_t bytes) noexcept { bytesRead.fetch_add((uint64_t)bytes, std::memory_order_relaxed); }
+    void addBlockBytes(size_t bytes) noexcept { blockBytes.fetch_add((uint64_t)bytes, std::memory_order_relaxed); }
+    void reset();
+
+    // Records the time from construction to destruction
+    class ScopedTimer
+    {
+    public:
+        ScopedTimer(BusTelemetry& t, Metric m) : telemetry(t), metric(m), startMs(juce::Time::getMillisecondCounterHiRes()) {}
+        ~ScopedTimer() { telemetry.record(metric, juce::Time::getMillisecondCounterHiRes() - startMs); }
+    private:
+        BusTelemetry& telemetry;
+        const Metric metric;
+        const double startMs;
+    };
+
+    struct Summary
+    {
+        uint64_t count = 0;
+        double meanMs = 0.0, p50Ms = 0.0, p90Ms = 0.0, p99Ms = 0.0, maxMs = 0.0;
+    };
+
+    struct Snapshot
+    {
+        std::array<Summary, NUM_METRICS> metrics;
+        double elapsedSeconds = 0.0;  // Since construction or reset()
+        uint64_t bytesWritten = 0, bytesRead = 0;
+        double writeBytesPerSecond = 0.0, readBytesPerSecond = 0.0;  // Averaged over elapsedSeconds
+        double blockBytesPerSecond = 0.0;  // While a block is actually on the bus
+    };
+
+    Snapshot snapshot() const;
+
+    static const char* getMetricName(Metric metric);
+    static juce::String toCSV(const Snapshot& snapshot);
+    static juce::String toJSON(const Snapshot& snapshot);
+
+private:
+    static constexpr int BUCKETS_PER_OCTAVE = 4;
+    static constexpr int NUM_BUCKETS = 26 * BUCKETS_PER_OCTAVE;  // 2^26 us ~ 67 s, last bucket open-ended
+
+    struct Histogram
+    {
+        std::array<std::atomic<uint64_t>, NUM_BUCKETS> buckets {};
+        std::atomic<uint64_t> count { 0 };
+        std::atomic<uint64_t> sumMicros { 0 };
+        std::atomic<uint64_t> maxMicros { 0 };
+    };
+
+    static int bucketFor(double micros) noexcept;
+    static double bucketMidpointMs(int bucket) noexcept;
+    static Summary summarize(const Histogram& histogram);
+
+    std::array<Histogram, NUM_METRICS> histograms;
+    std::atomic<uint64_t> bytesWritten { 0 };
+    std::atomic<uint64_t> bytesRead { 0 };
+    std::atomic<uint64_t> blockBytes { 0 };
+    std::atomic<double> startMs { 0.0 };
+};
@@ -0,0 +1,100 @@
+#include "CycleExtractor.h"
+#include <algorithm>
+#include <cmath>
+
+int CycleExtractor::getAnalysisLength(double sampleRate)
+{
+    // Two longest periods of integration window on top of the longest lag
+    return (int)std::ceil(sampleRate / MIN_FREQ_HZ) * 3;
+}
+
+double CycleExtractor::detectPeriod(const float* samples, int numSamples, double sampleRate)
+{
+    if (samples == nullptr || sampleRate <= 0.0) return 0.0;
+
+    const int minLag = std::max(2, (int)std::floor(sampleRate / MAX_FREQ_HZ));
+    const int maxLag = std::min((int)std::ceil(sampleRate / MIN_FREQ_HZ), numSamples / 2 - 1);
+    const int window = numSamples - maxLag - 1;
+    if (maxLag <= minLag + 2 || window <= 0) return 0.0;
+
+    double energy = 0.0;
+    for (int j = 0; j < window; ++j) energy += (double)samples[j] * samples[j];
+    if (energy < 1.0e-8 * window) return 0.0;  // Silence
+
+    // Difference function, then cumulative-mean normalization (YIN steps 2 and 3)
+    std::vector<double> cmnd((size_t)maxLag + 1, 1.0);
+    double runningSum = 0.0;
+    for (int tau = 1; tau <= maxLag; ++tau)
+    {
+        double difference = 0.0;
+        const float* shifted = samples + tau;
+        for (int j = 0; j < window; ++j)
+        {
+            double delta = (double)samples[j] - shifted[j];
+            difference += delta * delta;
+        }
+
+        runningSum += difference;
+        cmnd[(size_t)tau] = runningSum > 0.0 ? difference * tau / runningSum : 1.0;
+    }
+
+    // Absolute threshold (step 4): first dip below it, followed down to its minimum.
+    // Without one, the deepest dip - as long as it's deep enough to be a pitch.
+    int best = -1;
+    for (int tau = minLag; tau <= maxLag; ++tau)
+    {
+        if (cmnd[(size_t)tau] < YIN_THRESHOLD)
+        {
+            while (tau + 1 <= maxLag && cmnd[(size_t)tau + 1] < cmnd[(size_t)tau]) ++tau;
+            best = tau;
+            break;
+        }
+    }
+    if (best < 0)
+    {
+        best = (int)(std::min_element(cmnd.begin() + minLag, cmnd.end()) - cmnd.begin());
+        if (cmnd[(size_t)best] > UNPITCHED_LIMIT) return 0.0;
+    }
+
+    // Parabolic interpolation (step 5)
+    double period = best;
+    if (best > minLag && best < maxLag)
+    {
+        double a = cmnd[(size_t)best - 1], b = cmnd[(size_t)best], c = cmnd[(size_t)best + 1];
+        double denominator = a - 2.0 * b + c;
+        if (denominator > 0.0) period += 0.5 * (a - c) / denominator;
+    }
+    return period;
+}
+
+int CycleExtractor::findRisingZeroCrossing(const float* samples, int numSamples, int from, int to, int target)
+{
+    // Rising crossing in [from, to) closest to target, -1 if there is none
+    from = std::max(1, from);
+    to = std::min(numSamples, to);
+
+    int best = -1;
+    for (int i = from; i < to; ++i)
+        if (samples[i - 1] < 0.0f && samples[i] >= 0.0f)
+            if (best < 0 || std::abs(i - target) < std::abs(best - target))
+                best = i;
+    return best;
+}
+
+std::vector<float> CycleExtractor::extractCycles(const float* samples, int numSamples, double period, int cycles)
+{
+    if (samples == nullptr || period < 2.0 || cycles < 1) return {};
+
+    int start = findRisingZeroCrossing(samples, numSamples, 1, (int)std::ceil(period) + 1, 0);
+    if (start < 0) start = 0;
+
+    // End on the rising crossing nearest a whole number of periods (within a quarter period)
+    double target = start + cycles * period;
+    int slack = std::max(1, (int)(period / 4.0));
+    int nominalEnd = (int)std::lround(target);
+    int end = findRisingZeroCrossing(samples, numSamples, nominalEnd - slack, nominalEnd + slack + 1, nominalEnd);
+    if (end < 0) end = nominalEnd;
+
+    if (end <= start || end > numSamples) return {};
+    return std::vector<float>(samples + start, samples + end);
+}
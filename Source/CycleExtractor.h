@@ -0,0 +1,33 @@
+#pragma once
+
+#include <vector>
+
+//==============================================================================
+// Pulls a single cycle (or a few) out of a pitched sample, for use as an ARB
+//
+// The period is found with YIN (de Cheveigné & Kawahara) on a steady-state window
+// at the file's own sample rate, with parabolic interpolation between lags. The cut
+// starts on a rising zero crossing and ends on the rising crossing closest to a whole
+// number of periods, so the ARB loops without a click. Pure functions, any thread.
+//==============================================================================
+class CycleExtractor
+{
+public:
+    // Period in samples, or 0 if no clear pitch between MIN_FREQ_HZ and MAX_FREQ_HZ
+    static double detectPeriod(const float* samples, int numSamples, double sampleRate);
+
+    // cycles whole periods starting at the first rising zero crossing; empty if there isn't room
+    static std::vector<float> extractCycles(const float* samples, int numSamples, double period, int cycles);
+
+    // Samples the analysis needs for the lowest detectable pitch
+    static int getAnalysisLength(double sampleRate);
+
+    static constexpr double MIN_FREQ_HZ = 20.0;
+    static constexpr double MAX_FREQ_HZ = 5000.0;
+
+private:
+    static int findRisingZeroCrossing(const float* samples, int numSamples, int from, int to, int target);
+
+    static constexpr double YIN_THRESHOLD = 0.15;    // Cumulative-mean-normalized difference
+    static constexpr double UNPITCHED_LIMIT = 0.45;  // Best dip above this: treat as noise
+};
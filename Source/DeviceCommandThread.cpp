@@ -0,0 +1,240 @@
+#include "DeviceCommandThread.h"
+#include "InstrumentPool.h"
+#include "ModulationEngine.h"
+#include <cmath>
+
+DeviceCommandThread::DeviceCommandThread(HP33120ADriver& dev)
+    : Thread("DeviceCommandThread"), device(dev)
+{
+    // writeFast() from other threads (MIDI, ARB) also needs a check - schedule it instead of polling
+    device.setUncheckedCommandHook([this]() {
+        errorCheckPending.store(true);
+        commandPending.notify();
+    });
+}
+
+void DeviceCommandThread::run()
+{
+    while (!threadShouldExit())
+    {
+        // Wait for a command, for the next held-back parameter, or for a pending error check
+        commandPending.wait(computeWaitMs(juce::Time::getMillisecondCounterHiRes()), [this]() { return hasWork(); });
+        
+        drainNoteEvents();
+        
+        bool isConnected = device.isConnected();
+        if (isConnected && !wasConnected)
+            commandCostMs = DEFAULT_COMMAND_COST_MS;  // New transport - measure again
+        wasConnected = isConnected;
+        
+        if (!isConnected)
+        {
+            // Nothing to ask - this just drops the records, so the hook fires again after reconnecting
+            if (errorCheckPending.exchange(false))
+                device.checkDeferredErrors();
+            continue;
+        }
+        
+        StateSyncRequest::Values syncValues;
+        int stateRegister = 0;
+        if (canSyncState() && stateSync.take(syncValues, stateRegister))
+            StateSyncRequest::apply(device, syncValues, stateRegister);  // Its own batch - changes queued meanwhile follow below
+        
+        // One error check per pass instead of a SYST:ERR? round trip per command
+        double passStart = juce::Time::getMillisecondCounterHiRes();
+        int sent = 0;
+        {
+            HP33120ADriver::ScopedErrorBatch batch(device);
+            sent = processPendingUpdates(passStart);
+        }
+        
+        if (sent > 0)
+        {
+            double costPerCommand = (juce::Time::getMillisecondCounterHiRes() - passStart) / sent;
+            commandCostMs += (costPerCommand - commandCostMs) * COST_SMOOTHING;
+        }
+        
+        // Catches errors from writeFast() calls made outside this thread (MIDI notes,
+        // LFO) as well as this pass's. Cleared first: anything sent during the check
+        // raises it again.
+        juce::int64 currentTime = juce::Time::currentTimeMillis();
+        if (errorCheckPending.load() && currentTime - lastErrorCheck >= ERROR_CHECK_INTERVAL_MS)
+        {
+            lastErrorCheck = currentTime;
+            errorCheckPending.store(false);
+            device.checkDeferredErrors();
+        }
+    }
+}
+
+int DeviceCommandThread::computeWaitMs(double nowMs) const
+{
+    // Disconnected, nextDueMs is never moved on - held values wait for the connect notify()
+    int waitMs = -1;
+    if ((heldMask != 0 || modulatedParam >= 0) && device.isConnected())
+        waitMs = juce::jlimit(1, 100, (int)std::ceil(nextDueMs - nowMs));
+    
+    if (stateSync.isPending() && device.isConnected())
+        waitMs = waitMs < 0 ? STATE_SYNC_RETRY_MS : juce::jmin(waitMs, STATE_SYNC_RETRY_MS);
+    
+    if (errorCheckPending.load())
+    {
+        auto untilCheck = (int)juce::jmax((juce::int64)1, lastErrorCheck + ERROR_CHECK_INTERVAL_MS - juce::Time::currentTimeMillis());
+        waitMs = waitMs < 0 ? untilCheck : juce::jmin(waitMs, untilCheck);
+    }
+    return waitMs;
+}
+
+bool DeviceCommandThread::hasWork() const
+{
+    // Pending values while disconnected wait for notify() from connectDevice()
+    return threadShouldExit()
+           || noteFifo.getNumReady() > 0
+           || (pending.hasPending() && device.isConnected())
+           || canSyncState();
+}
+
+void DeviceCommandThread::requestStateSync(const StateSyncRequest::Values& values, int stateRegister)
+{
+    stateSync.post(values, stateRegister);
+    commandPending.notify();
+}
+
+void DeviceCommandThread::pushNoteEvent(const NoteEvent& event)
+{
+    int start1, size1, start2, size2;
+    noteFifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1) return;  // Full
+    
+    noteBuffer[(size_t)(size1 > 0 ? start1 : start2)] = event;
+    noteFifo.finishedWrite(1);
+    commandPending.notify();
+}
+
+void DeviceCommandThread::drainNoteEvents()
+{
+    int start1, size1, start2, size2;
+    noteFifo.prepareToRead(noteFifo.getNumReady(), start1, size1, start2, size2);
+    
+    if (onNoteEvent)
+    {
+        for (int i = 0; i < size1; ++i) onNoteEvent(noteBuffer[(size_t)(start1 + i)]);
+        for (int i = 0; i < size2; ++i) onNoteEvent(noteBuffer[(size_t)(start2 + i)]);
+    }
+    noteFifo.finishedRead(size1 + size2);
+}
+
+double DeviceCommandThread::currentSendIntervalMs(double nowMs) const
+{
+    int moving = 0;
+    for (double changed : lastChangedMs)
+        if (nowMs - changed < ACTIVE_WINDOW_MS) ++moving;
+    
+    return juce::jlimit(MIN_SEND_INTERVAL_MS, MAX_SEND_INTERVAL_MS, commandCostMs * juce::jmax(1, moving));
+}
+
+int DeviceCommandThread::processPendingUpdates(double nowMs)
+{
+    // One atomic exchange claims every newly changed parameter
+    uint64_t changed = pending.takeDirty();
+    for (int i = 0; i < Parameters::NUM_DEVICE_PARAMS; ++i)
+        if ((changed >> i) & 1u) lastChangedMs[(size_t)i] = nowMs;
+    
+    uint64_t ready = changed | heldMask;
+    heldMask = 0;
+    nextDueMs = nowMs + MAX_SEND_INTERVAL_MS;
+    
+    double interval = currentSendIntervalMs(nowMs);
+    int sent = 0;
+    
+    // Modulation switched off or moved to another parameter - put the old target back on its base
+    int target = (modulation && modulation->isActive()) ? (int)modulation->getTargetParam() : -1;
+    if (modulatedParam >= 0 && modulatedParam != target)
+    {
+        auto previous = (Parameters::DeviceParam)modulatedParam;
+        device.setParameter(previous, ModulationEngine::baseValue(device, previous).load());
+        ++sent;
+    }
+    modulatedParam = target;
+    
+    // Applied in table order; a parameter sent too recently waits for its slot,
+    // and picks up whatever value is latest when it does
+    for (int i = 0; ready != 0 && i < Parameters::NUM_DEVICE_PARAMS; ++i)
+    {
+        uint64_t bit = uint64_t(1) << i;
+        if ((ready & bit) == 0) continue;
+        ready &= ~bit;
+        
+        if (i == modulatedParam)
+        {
+            // The next modulation tick sends it, around the new base
+            queuedAtMs[(size_t)i].store(0.0);
+            double base = pending.load(i);
+            ModulationEngine::baseValue(device, (Parameters::DeviceParam)i).store(base);
+            if (pool) pool->mirror((Parameters::DeviceParam)i, base);
+            continue;
+        }
+        
+        double dueAt = lastSentMs[(size_t)i] + interval;
+        if (nowMs < dueAt)
+        {
+            heldMask |= bit;
+            nextDueMs = juce::jmin(nextDueMs, dueAt);
+            continue;
+        }
+        
+        double value = pending.load(i);
+        device.setParameter((Parameters::DeviceParam)i, value);
+        recordQueueWait(i);
+        if (pool) pool->mirror((Parameters::DeviceParam)i, value);
+        lastSentMs[(size_t)i] = nowMs;
+        ++sent;
+    }
+    
+    // The modulated parameter counts as moving and gets its share of the bus like any other;
+    // a value is only computed when it is actually going to be sent
+    if (modulatedParam >= 0)
+    {
+        auto index = (size_t)modulatedParam;
+        lastChangedMs[index] = nowMs;
+        
+        if (nowMs >= lastSentMs[index] + interval)
+        {
+            modulation->sendModulatedValue(device, nowMs);
+            lastSentMs[index] = nowMs;
+            ++sent;
+        }
+        nextDueMs = juce::jmin(nextDueMs, lastSentMs[index] + interval);
+    }
+    
+    return sent;
+}
+
+void DeviceCommandThread::queueUpdate(Parameters::DeviceParam param, double value)
+{
+    // Always stores the latest value - if several updates arrive between passes,
+    // only the most recent one is sent to the device
+    pending.store((int)param, value);
+    
+    // Only the first change waiting for a send is stamped - later ones are coalesced into it
+    double unstamped = 0.0;
+    queuedAtMs[(size_t)param].compare_exchange_strong(unstamped, juce::Time::getMillisecondCounterHiRes());
+    
+    // Wake the thread if it's asleep - usually just an atomic exchange
+    commandPending.notify();
+}
+
+void DeviceCommandThread::recordQueueWait(int index)
+{
+    double queuedAt = queuedAtMs[(size_t)index].exchange(0.0);
+    if (queuedAt > 0.0)
+        device.getTelemetry().record(BusTelemetry::Metric::QueueWait, juce::Time::getMillisecondCounterHiRes() - queuedAt);
+}
+
+void DeviceCommandThread::stopThreadSafely()
+{
+    device.setUncheckedCommandHook(nullptr);
+    signalThreadShouldExit();
+    commandPending.wakeNow();
+    stopThread(1000); // Wait up to 1 second for thread to finish
+}
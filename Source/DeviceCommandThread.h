@@ -0,0 +1,121 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <functional>
+#include "HP33120ADriver.h"
+#include "Parameters.h"
+#include "ParameterMailbox.h"
+#include "StateSyncRequest.h"
+#include "WorkerSignal.h"
+
+class ModulationEngine;
+class InstrumentPool;
+
+//==============================================================================
+// Background thread for non-blocking device communication
+//
+// Parameter changes from the audio thread, the UI and automation land in a
+// latest-value mailbox; this thread sends whatever is due, one error-check batch
+// per pass, rate-limited to what the transport can take. Owned by the processor,
+// and usable on its own (the benchmark drives it against the simulated backend).
+//==============================================================================
+class DeviceCommandThread : public juce::Thread
+{
+public:
+    DeviceCommandThread(HP33120ADriver& dev);
+    void run() override;
+    
+    // Queue the latest value for a device parameter (any thread, lock-free)
+    // Bools and choice indices are passed as their numeric value
+    void queueUpdate(Parameters::DeviceParam param, double value);
+    
+    // Audio thread -> this thread: note-ons for the MIDI status log. Wait-free, no
+    // allocation; onNoteEvent gets them here, where formatting costs nothing.
+    // A full FIFO drops the log line, never the note.
+    struct NoteEvent
+    {
+        int note = 0;
+        double frequency = 0.0;
+    };
+    void pushNoteEvent(const NoteEvent& event);
+    std::function<void(const NoteEvent&)> onNoteEvent;  // Set before startThread()
+    
+    // Wake up for something that isn't in the mailbox (e.g. a new connection)
+    void notify() { commandPending.notify(); }
+    
+    // Message thread: bring the instrument in line with a whole panel state (project
+    // load, connect, program change) - read back, then only the differences are sent,
+    // or a single *RCL when the register is known to hold it. Waits for a connection,
+    // and for any ARB transfer in progress to finish.
+    void requestStateSync(const StateSyncRequest::Values& values, int stateRegister = 0);
+    
+    // Modulation is evaluated here, each time its target is due to be sent
+    void setModulationEngine(ModulationEngine* engine) { modulation = engine; }
+    
+    // Everything applied to unit 0 is mirrored to the pool's other units (modulation stays on unit 0)
+    void setInstrumentPool(InstrumentPool* instrumentPool) { pool = instrumentPool; }
+    
+    void stopThreadSafely();
+    
+private:
+    HP33120ADriver& device;
+    WorkerSignal commandPending;
+    
+    // Nothing held, modulated or waiting for an error check: sleep until notified
+    int computeWaitMs(double nowMs) const;
+    bool hasWork() const;
+    void drainNoteEvents();
+    
+    static constexpr int NOTE_FIFO_SIZE = 128;
+    juce::AbstractFifo noteFifo { NOTE_FIFO_SIZE };
+    std::array<NoteEvent, NOTE_FIFO_SIZE> noteBuffer;
+    
+    // Applies pending changes that are due - called once per pass inside an error batch.
+    // Returns the number of parameters sent.
+    int processPendingUpdates(double nowMs);
+    
+    // Pending values, one slot per Parameters::DeviceParam
+    ParameterMailbox<Parameters::NUM_DEVICE_PARAMS> pending;
+    
+    // When each slot's oldest unsent change was queued (0: none) - for the queue wait telemetry
+    std::array<std::atomic<double>, Parameters::NUM_DEVICE_PARAMS> queuedAtMs {};
+    void recordQueueWait(int index);
+    
+    // Adaptive rate limiting
+    // The measured cost of one command on the current transport, times the number
+    // of parameters currently moving, is the minimum interval between sends of any
+    // one parameter - so GPIB-USB and RS-232 each run at their own ceiling and
+    // moving parameters share the bus evenly. A parameter that is held back keeps
+    // its mailbox slot, so the latest value always goes out once its interval ends.
+    double currentSendIntervalMs(double nowMs) const;
+    uint64_t heldMask = 0;  // Changed but not yet due
+    double nextDueMs = 0.0;
+    std::array<double, Parameters::NUM_DEVICE_PARAMS> lastSentMs {};
+    std::array<double, Parameters::NUM_DEVICE_PARAMS> lastChangedMs {};
+    double commandCostMs = DEFAULT_COMMAND_COST_MS;  // EMA, reset on reconnect
+    bool wasConnected = false;
+    
+    // Modulation state - the target's pending updates move its base instead of being sent
+    ModulationEngine* modulation = nullptr;
+    int modulatedParam = -1;  // Parameters::DeviceParam index, -1 when off
+    
+    InstrumentPool* pool = nullptr;
+    
+    StateSyncRequest stateSync;
+    bool canSyncState() const { return stateSync.isPending() && device.isConnected() && !device.isInLongOperation(); }
+    static constexpr int STATE_SYNC_RETRY_MS = 50;  // Polled while a transfer holds the driver
+    
+    static constexpr double DEFAULT_COMMAND_COST_MS = 5.0;
+    static constexpr double MIN_SEND_INTERVAL_MS = 2.0;
+    static constexpr double MAX_SEND_INTERVAL_MS = 250.0;
+    static constexpr double ACTIVE_WINDOW_MS = 500.0;  // A parameter counts as moving for this long after a change
+    static constexpr double COST_SMOOTHING = 0.2;
+    
+    // Error checking - every 500ms at most, and only once something has been sent
+    // (the driver's unchecked-command hook raises errorCheckPending, from any thread)
+    std::atomic<bool> errorCheckPending { false };
+    juce::int64 lastErrorCheck{0};
+    static constexpr int ERROR_CHECK_INTERVAL_MS = 500;
+};
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <array>
+#include <charconv>
+#include <cmath>
+#include <limits>
+#include <string_view>
+#include "Parameters.h"
+
+//==============================================================================
+// How each device parameter reaches the instrument, indexed by Parameters::DeviceParam
+//
+// One constexpr descriptor per parameter: SCPI header, argument kind, the range the
+// 33120A accepts (in the unit sent on the wire), wire resolution and how soon an
+// error is worth checking for. HP33120ADriver::setParameter() clamps, rounds and
+// formats from it without building strings, and its shadow cache keys on the same
+// index. The choice lists double as the host parameters' menu entries.
+//==============================================================================
+namespace DeviceParameterTable
+{
+    enum class Kind { Number, Integer, Toggle, Choice, Unsupported };
+
+    // Switches and menus are checked straight away (outside a batch); continuous values
+    // defer their check so a dragged slider isn't slowed down by round trips
+    enum class Check { Immediate, Deferred };
+
+    struct Command
+    {
+        std::string_view header;                 // Canonical short form
+        Kind kind = Kind::Unsupported;
+        double minValue = 0.0, maxValue = 0.0;   // Wire units
+        int decimals = 0;                        // Wire resolution, digits after the point
+        bool reciprocal = false;                 // The parameter is 1 / wire value (period -> rate)
+        Check check = Check::Deferred;
+        const std::string_view* choices = nullptr;
+        int numChoices = 0;
+        bool queryable = true;                   // false: no "<header>?" - readBackState() leaves it unknown
+    };
+
+    inline constexpr std::string_view WAVEFORMS[] = { "SIN", "SQU", "TRI", "RAMP", "NOIS", "DC", "USER" };
+    inline constexpr std::string_view MOD_WAVEFORMS[] = { "SIN", "SQU", "TRI", "RAMP", "NOIS", "USER" };  // No DC
+    inline constexpr std::string_view AM_SOURCES[] = { "BOTH", "EXT" };
+    inline constexpr std::string_view INT_EXT_SOURCES[] = { "INT", "EXT" };
+    inline constexpr std::string_view TRIGGER_SOURCES[] = { "IMM", "EXT", "BUS" };
+
+    constexpr Command number(std::string_view header, double minValue, double maxValue, int decimals = 6)
+    {
+        return { header, Kind::Number, minValue, maxValue, decimals, false, Check::Deferred, nullptr, 0 };
+    }
+
+    constexpr Command reciprocalNumber(std::string_view header, double minValue, double maxValue, int decimals = 6)
+    {
+        return { header, Kind::Number, minValue, maxValue, decimals, true, Check::Deferred, nullptr, 0 };
+    }
+
+    constexpr Command integer(std::string_view header, double minValue, double maxValue)
+    {
+        return { header, Kind::Integer, minValue, maxValue, 0, false, Check::Deferred, nullptr, 0 };
+    }
+
+    constexpr Command toggle(std::string_view header)
+    {
+        return { header, Kind::Toggle, 0.0, 1.0, 0, false, Check::Immediate, nullptr, 0 };
+    }
+
+    // A setting the 33120A takes but can't report (-113 Undefined header on "<header>?")
+    constexpr Command writeOnly(Command command)
+    {
+        command.queryable = false;
+        return command;
+    }
+
+    template <size_t N>
+    constexpr Command choice(std::string_view header, const std::string_view (&names)[N])
+    {
+        return { header, Kind::Choice, 0.0, (double)(N - 1), 0, false, Check::Immediate, names, (int)N };
+    }
+
+    inline constexpr std::array<Command, Parameters::NUM_DEVICE_PARAMS> COMMANDS =
+    {{
+        choice("FUNC", WAVEFORMS),                          // Waveform
+        writeOnly(toggle("OUTP")),                          // OutputEnabled
+        number("FREQ", 0.0001, 15.0e6),                     // Frequency
+        number("VOLT", 0.05, 10.0),                         // Amplitude (Vpp into 50 ohms)
+        number("VOLT:OFFS", -5.0, 5.0),                     // Offset
+        writeOnly(number("PHAS", -360.0, 359.999, 3)),      // Phase
+        number("FUNC:SQU:DCYC", 20.0, 80.0),                // DutyCycle
+        toggle("AM:STAT"),                                  // AMEnabled
+        number("AM:DEPT", 0.0, 120.0),                      // AMDepth
+        choice("AM:SOUR", AM_SOURCES),                      // AMSource
+        choice("AM:INT:FUNC", MOD_WAVEFORMS),               // AMIntWaveform
+        number("AM:INT:FREQ", 0.01, 20000.0),               // AMIntFreq
+        toggle("FM:STAT"),                                  // FMEnabled
+        number("FM:DEV", 0.01, 7.5e6),                      // FMDeviation
+        choice("FM:SOUR", INT_EXT_SOURCES),                 // FMSource
+        choice("FM:INT:FUNC", MOD_WAVEFORMS),               // FMIntWaveform
+        number("FM:INT:FREQ", 0.01, 10000.0),               // FMIntFreq
+        toggle("FSK:STAT"),                                 // FSKEnabled
+        number("FSK:FREQ", 0.01, 15.0e6),                   // FSKFrequency
+        choice("FSK:SOUR", INT_EXT_SOURCES),                // FSKSource
+        number("FSK:INT:RATE", 0.01, 50000.0),              // FSKRate
+        toggle("SWE:STAT"),                                 // SweepEnabled
+        number("FREQ:STAR", 0.01, 15.0e6),                  // SweepStart
+        number("FREQ:STOP", 0.01, 15.0e6),                  // SweepStop
+        number("SWE:TIME", 0.001, 500.0),                   // SweepTime
+        toggle("BM:STAT"),                                  // BurstEnabled
+        integer("BM:NCYC", 1.0, 50000.0),                   // BurstCycles
+        number("BM:PHAS", -360.0, 360.0),                   // BurstPhase
+        reciprocalNumber("BM:INT:RATE", 0.01, 50000.0),     // BurstIntPeriod (sent as a rate)
+        choice("BM:SOUR", INT_EXT_SOURCES),                 // BurstSource
+        toggle("OUTP:SYNC"),                                // SyncEnabled
+        Command {},                                         // SyncPhase - no 33120A command, PHAS covers it
+        choice("TRIG:SOUR", TRIGGER_SOURCES),               // TriggerSource
+    }};
+
+    constexpr const Command& get(Parameters::DeviceParam param) { return COMMANDS[(size_t)param]; }
+
+    // A reordered or shortened table fails here rather than sending the wrong header
+    static_assert(get(Parameters::DeviceParam::Waveform).header == "FUNC", "Table out of order");
+    static_assert(get(Parameters::DeviceParam::Frequency).header == "FREQ", "Table out of order");
+    static_assert(get(Parameters::DeviceParam::BurstIntPeriod).header == "BM:INT:RATE", "Table out of order");
+    static_assert(get(Parameters::DeviceParam::TriggerSource).header == "TRIG:SOUR", "Table out of order");
+
+    constexpr bool isWellFormed(const Command& command)
+    {
+        return command.minValue <= command.maxValue && command.decimals >= 0 && command.decimals <= 9
+            && (command.kind == Kind::Choice) == (command.choices != nullptr)
+            && (command.kind == Kind::Unsupported) == command.header.empty();
+    }
+
+    constexpr bool allWellFormed()
+    {
+        for (const Command& command : COMMANDS)
+            if (!isWellFormed(command)) return false;
+        return true;
+    }
+    static_assert(allWellFormed(), "Malformed command descriptor");
+
+    inline constexpr double POWERS_OF_TEN[] = { 1.0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9 };
+
+    // Parameter value -> wire value: inverted if need be, clamped, rounded to the resolution.
+    // Toggles come out as 0/1 and choices as their index. Scaling by a power of ten and
+    // dividing back gives the double nearest the decimal that gets printed, which is what
+    // parseArgument() reads back for the same text.
+    inline double roundToResolution(const Command& command, double wireValue)
+    {
+        const double scale = POWERS_OF_TEN[command.decimals];
+        return std::round(wireValue * scale) / scale;
+    }
+
+    inline double toWire(const Command& command, double value)
+    {
+        value = command.reciprocal ? 1.0 / value : value;
+        value = value >= command.minValue ? value : command.minValue;  // Also catches NaN
+        value = value <= command.maxValue ? value : command.maxValue;
+        return roundToResolution(command, value);
+    }
+
+    inline int choiceIndex(const Command& command, std::string_view name)
+    {
+        for (int i = 0; i < command.numChoices; ++i)
+            if (command.choices[i] == name) return i;
+        return -1;
+    }
+
+    // The parameter that owns a canonical header, -1 if none
+    inline int findHeader(std::string_view header)
+    {
+        for (size_t i = 0; i < COMMANDS.size(); ++i)
+            if (!COMMANDS[i].header.empty() && COMMANDS[i].header == header) return (int)i;
+        return -1;
+    }
+
+    // Wire value of an argument sent as text (queued writes, writeFast) or of a query
+    // reply ("+1.00000000E+03", "SIN", "1"), NaN if it isn't one
+    inline double parseArgument(const Command& command, std::string_view argument)
+    {
+        constexpr double unknown = std::numeric_limits<double>::quiet_NaN();
+        switch (command.kind)
+        {
+            case Kind::Toggle:
+                if (argument == "ON" || argument == "1") return 1.0;
+                if (argument == "OFF" || argument == "0") return 0.0;
+                return unknown;
+            case Kind::Choice:
+            {
+                int index = choiceIndex(command, argument);
+                return index >= 0 ? (double)index : unknown;
+            }
+            case Kind::Number:
+            case Kind::Integer:
+            {
+                if (!argument.empty() && argument[0] == '+') argument.remove_prefix(1);
+                double value = 0.0;
+                auto result = std::from_chars(argument.data(), argument.data() + argument.size(), value);
+                return (result.ec == std::errc() && result.ptr == argument.data() + argument.size()) ? value : unknown;
+            }
+            case Kind::Unsupported:
+                break;
+        }
+        return unknown;
+    }
+}
@@ -1,4 +1,5 @@
 #include "HP33120ADriver.h"
+#include "SimulatedVISA.h"
 #include <juce_core/juce_core.h>
 #include <cmath>
 #include <sstream>
@@ -8,6 +9,11 @@
 #include <chrono>
 #include <vector>
 #include <string>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <utility>
 
 #ifdef _WIN32
 #include <windows.h>
@@ -22,11 +28,19 @@
 HP33120ADriver::HP33120ADriver()
 {
     baseFreq = 1000.0;
-    loadVISALibrary();
+    
+    // Preallocate everything the live write path touches
+    uncheckedCommands.reserve(MAX_UNCHECKED_COMMANDS);
+    checkingCommands.reserve(MAX_UNCHECKED_COMMANDS);
+    compoundLine.reserve(MAX_COMPOUND_LINE_LENGTH + ScpiLine::CAPACITY);
+    shadowParams.fill(std::numeric_limits<double>::quiet_NaN());
+    // The VISA library is loaded by the first connect() - constructing a plugin instance
+    // shouldn't cost a library load (and the scan some VISA installs do on load)
 }
 
 HP33120ADriver::~HP33120ADriver()
 {
+    ioPool.removeAllJobs(true, 2000);  // Jobs use the session
     disconnect();
     unloadVISALibrary();
 }
@@ -53,6 +67,15 @@ bool HP33120ADriver::loadVISALibrary()
         viScanf = (ViScanf)GetProcAddress((HMODULE)visaLib, "viScanf");
         viSetAttribute = (ViSetAttribute)GetProcAddress((HMODULE)visaLib, "viSetAttribute");
         viFlush = (ViFlush)GetProcAddress((HMODULE)visaLib, "viFlush");
+        viAssertTrigger = (ViAssertTrigger)GetProcAddress((HMODULE)visaLib, "viAssertTrigger");
+        viGpibCommand = (ViGpibCommand)GetProcAddress((HMODULE)visaLib, "viGpibCommand");
+        viClear = (ViClear)GetProcAddress((HMODULE)visaLib, "viClear");
+        viWriteAsync = (ViWriteAsync)GetProcAddress((HMODULE)visaLib, "viWriteAsync");
+        viWaitOnEvent = (ViWaitOnEvent)GetProcAddress((HMODULE)visaLib, "viWaitOnEvent");
+        viEnableEvent = (ViEnableEvent)GetProcAddress((HMODULE)visaLib, "viEnableEvent");
+        viDisableEvent = (ViDisableEvent)GetProcAddress((HMODULE)visaLib, "viDisableEvent");
+        viGetAttribute = (ViGetAttribute)GetProcAddress((HMODULE)visaLib, "viGetAttribute");
+        viTerminate = (ViTerminate)GetProcAddress((HMODULE)visaLib, "viTerminate");
     }
 #else
     visaLib = dlopen(VISA_LIB_NAME, RTLD_LAZY);
@@ -67,213 +90,1240 @@ bool HP33120ADriver::loadVISALibrary()
         viScanf = (ViScanf)dlsym(visaLib, "viScanf");
         viSetAttribute = (ViSetAttribute)dlsym(visaLib, "viSetAttribute");
         viFlush = (ViFlush)dlsym(visaLib, "viFlush");
+        viAssertTrigger = (ViAssertTrigger)dlsym(visaLib, "viAssertTrigger");
+        viGpibCommand = (ViGpibCommand)dlsym(visaLib, "viGpibCommand");
+        viClear = (ViClear)dlsym(visaLib, "viClear");
+        viWriteAsync = (ViWriteAsync)dlsym(visaLib, "viWriteAsync");
+        viWaitOnEvent = (ViWaitOnEvent)dlsym(visaLib, "viWaitOnEvent");
+        viEnableEvent = (ViEnableEvent)dlsym(visaLib, "viEnableEvent");
+        viDisableEvent = (ViDisableEvent)dlsym(visaLib, "viDisableEvent");
+        viGetAttribute = (ViGetAttribute)dlsym(visaLib, "viGetAttribute");
+        viTerminate = (ViTerminate)dlsym(visaLib, "viTerminate");
+    }
+#endif
+    return (viOpenDefaultRM != nullptr && viOpen != nullptr);
+}
+
+void HP33120ADriver::unloadVISALibrary()
+{
+    if (visaLib)
+    {
+#ifdef _WIN32
+        FreeLibrary((HMODULE)visaLib);
+#else
+        dlclose(visaLib);
+#endif
+        visaLib = nullptr;
+    }
+    
+    viOpenDefaultRM = nullptr;
+    viOpen = nullptr;
+    viClose = nullptr;
+    viWrite = nullptr;
+    viRead = nullptr;
+    viPrintf = nullptr;
+    viScanf = nullptr;
+    viSetAttribute = nullptr;
+    viFlush = nullptr;
+    viAssertTrigger = nullptr;
+    viGpibCommand = nullptr;
+    viClear = nullptr;
+    viWriteAsync = nullptr;
+    viWaitOnEvent = nullptr;
+    viEnableEvent = nullptr;
+    viDisableEvent = nullptr;
+    viGetAttribute = nullptr;
+    viTerminate = nullptr;
+    usingSimulatedVISA = false;
+}
+
+void HP33120ADriver::useSimulatedVISA()
+{
+    unloadVISALibrary();
+    
+    // No async I/O or viGpibCommand, so the driver takes its synchronous paths
+    viOpenDefaultRM = &SimulatedVISA::openDefaultRM;
+    viOpen = &SimulatedVISA::open;
+    viClose = &SimulatedVISA::close;
+    viWrite = &SimulatedVISA::write;
+    viRead = &SimulatedVISA::read;
+    viPrintf = &SimulatedVISA::printf;
+    viSetAttribute = &SimulatedVISA::setAttribute;
+    viFlush = &SimulatedVISA::flush;
+    viClear = &SimulatedVISA::clear;
+    viAssertTrigger = &SimulatedVISA::assertTrigger;
+    usingSimulatedVISA = true;
+}
+
+bool HP33120ADriver::connect(const std::string& resource)
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    lastError.clear();
+    
+    if (connected)
+        disconnect();
+    
+    // "SIM..." is served in-process (benchmarks, no rack); anything else needs the real library back
+    const bool simulated = SimulatedVISA::isSimulatedResource(resource);
+    if (simulated && !usingSimulatedVISA)
+        useSimulatedVISA();
+    else if (!simulated && (usingSimulatedVISA || !visaLib))
+    {
+        unloadVISALibrary();
+        loadVISALibrary();
+    }
+    
+    if (!viOpenDefaultRM || !viOpen)
+    {
+        lastError = "VISA library not loaded.";
+        return false;
+    }
+    
+    this->resourceName = resource;
+    
+    ViSession defaultRMSession = nullptr;
+    ViSession sessionObj = nullptr;
+    
+    ViStatus status = acquireResourceManager(&defaultRMSession);
+    if (status != VI_SUCCESS)
+    {
+        lastError = "Failed to open the VISA resource manager.";
+        return false;
+    }
+    rm = (void*)defaultRMSession;
+    
+    status = viOpen(defaultRMSession, (ViRsrc)resourceName.c_str(), VI_NULL, VI_NULL, &sessionObj);
+    if (status != VI_SUCCESS)
+    {
+        releaseResourceManager();
+        lastError = "Failed to open device.";
+        return false;
+    }
+    
+    this->session = (void*)sessionObj;
+    
+    if (viSetAttribute)
+    {
+        // Set timeout to 500ms - short enough for UI responsiveness, long enough for most commands
+        // If device is slow or unresponsive, commands will fail quickly rather than blocking the UI
+        viSetAttribute((ViObject)sessionObj, VI_ATTR_TMO_VALUE, 500); // 500ms timeout
+    }
+    
+    // I/O completion events for asynchronous chunk writes - any piece missing: synchronous
+    asyncEventsEnabled = viWriteAsync && viWaitOnEvent && viEnableEvent && viDisableEvent && viGetAttribute && viTerminate
+                         && viEnableEvent(sessionObj, VI_EVENT_IO_COMPLETION, VI_QUEUE, VI_NULL) == VI_SUCCESS;
+    
+    connected = true;
+    byteOrderConfigured = false;
+    lateReplyPending = false;
+    blockBytesPerMs = DEFAULT_BLOCK_BYTES_PER_MS;  // New transport - measure again
+    invalidateShadowState();  // Front panel may have changed anything while we were away
+    gliding = false;
+    registerKnown.fill(false);
+    
+    // Ensure remote mode and clear status
+    write("SYST:REM"); 
+    write("*CLS");
+    waitForOperationComplete();
+    
+    std::string identity = query("*IDN?");
+    std::lock_guard<std::mutex> idnLock(idnMutex);
+    idn = identity;
+    return true;
+}
+
+void HP33120ADriver::connectAsync(const std::string& resource, ConnectCallback onProgress,
+                                  std::optional<std::array<double, Parameters::NUM_DEVICE_PARAMS>> initialState)
+{
+    connecting = true;
+    ioPool.addJob([this, resource, onProgress, initialState]()
+    {
+        auto report = [&](ConnectStage stage, const std::string& detail) { if (onProgress) onProgress(stage, detail); };
+        
+        // Holding the driver lock throughout keeps other threads from catching the
+        // session before the state has been brought in line
+        std::unique_lock<std::recursive_mutex> lock(driverMutex);
+        report(ConnectStage::Opening, resource);
+        if (!connect(resource))
+        {
+            std::string error = lastError.empty() ? std::string("Failed to connect.") : lastError;
+            lock.unlock();
+            connecting = false;
+            report(ConnectStage::Failed, error);
+            return;
+        }
+        
+        report(ConnectStage::Identifying, resource);
+        std::string identity = getIDN();  // Read by connect()
+        
+        report(ConnectStage::SyncingState, identity);
+        if (initialState)
+            syncState(*initialState);
+        else
+            readBackState();
+        
+        lock.unlock();
+        connecting = false;
+        report(ConnectStage::Connected, identity);
+    });
+}
+
+std::string HP33120ADriver::getIDN() const
+{
+    std::lock_guard<std::mutex> lock(idnMutex);
+    return idn;
+}
+
+void HP33120ADriver::disconnect()
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    
+    // Go to local mode before closing
+    if (connected) write("SYST:LOC");
+
+    if (interfaceSession && viClose)
+    {
+        viClose((ViObject)interfaceSession);
+        interfaceSession = nullptr;
+    }
+    if (session && asyncEventsEnabled)
+        viDisableEvent((ViSession)session, VI_EVENT_IO_COMPLETION, VI_ALL_MECH);
+    asyncEventsEnabled = false;
+    
+    if (session && viClose)
+    {
+        viClose((ViObject)session);
+        session = nullptr;
+    }
+    if (rm)
+        releaseResourceManager();
+    connected = false;
+    gliding = false;
+    std::lock_guard<std::mutex> idnLock(idnMutex);
+    idn.clear();
+}
+
+// ============================================================================
+// SHARED RESOURCE MANAGER
+// ============================================================================
+namespace
+{
+    // One default resource manager per VISA implementation (keyed by its viOpenDefaultRM),
+    // shared by every driver in the host process
+    struct SharedResourceManager
+    {
+        ViSession session = nullptr;
+        int users = 0;
+    };
+    
+    std::mutex& resourceManagerMutex()
+    {
+        static std::mutex mutex;
+        return mutex;
+    }
+    
+    std::map<void*, SharedResourceManager>& resourceManagers()
+    {
+        static std::map<void*, SharedResourceManager> managers;
+        return managers;
+    }
+}
+
+ViStatus HP33120ADriver::acquireResourceManager(ViSession* resourceManager)
+{
+    std::lock_guard<std::mutex> lock(resourceManagerMutex());
+    SharedResourceManager& shared = resourceManagers()[(void*)viOpenDefaultRM];
+    
+    if (shared.users == 0)
+    {
+        ViStatus status = viOpenDefaultRM(&shared.session);
+        if (status != VI_SUCCESS)
+        {
+            resourceManagers().erase((void*)viOpenDefaultRM);
+            return status;
+        }
+    }
+    
+    ++shared.users;
+    rmKey = (void*)viOpenDefaultRM;
+    *resourceManager = shared.session;
+    return VI_SUCCESS;
+}
+
+void HP33120ADriver::releaseResourceManager()
+{
+    std::lock_guard<std::mutex> lock(resourceManagerMutex());
+    auto it = resourceManagers().find(rmKey);
+    
+    // Closing a resource manager closes every session opened through it, so it stays
+    // open until its last user has gone
+    if (it != resourceManagers().end() && --it->second.users == 0)
+    {
+        if (viClose) viClose((ViObject)it->second.session);
+        resourceManagers().erase(it);
+    }
+    rm = nullptr;
+    rmKey = nullptr;
+}
+
+// ============================================================================
+// COMMAND LANES
+// ============================================================================
+namespace
+{
+    thread_local HP33120ADriver::CommandLane threadLane = HP33120ADriver::CommandLane::Interactive;
+}
+
+void HP33120ADriver::setThreadLane(CommandLane lane) { threadLane = lane; }
+HP33120ADriver::CommandLane HP33120ADriver::getThreadLane() { return threadLane; }
+
+std::unique_lock<std::recursive_mutex> HP33120ADriver::lockOrDefer(std::string_view cmd)
+{
+    std::unique_lock<std::recursive_mutex> lock(driverMutex, std::try_to_lock);
+    if (!lock.owns_lock() && threadLane != CommandLane::Bulk)
+    {
+        // Checked and queued under the mutex endLongOperation() counts down under, so a
+        // command can't land in the lane after the operation's last drain
+        std::lock_guard<std::mutex> laneLock(liveLaneMutex);
+        if (longOperations.load() > 0)
+        {
+            queueLive(cmd);
+            return lock;
+        }
+    }
+    
+    if (!lock.owns_lock())
+        lock.lock();  // Short transaction in progress, or bulk behind bulk - just wait for it
+    
+    // Held by the bulk operation itself: this is a message boundary, so queued
+    // live writes go first
+    if (longOperations.load() > 0 && !servicingLiveLane)
+        serviceLiveLane();
+    return lock;
+}
+
+void HP33120ADriver::queueLive(std::string_view cmd)
+{
+    // Arrival order is kept - FUNC before FREQ/VOLT matters, the shape re-clamps them.
+    // Only a repeat of the last setting replaces it (a slider drag); argument-less
+    // commands (*TRG) all go.
+    auto& lane = liveLanes[threadLane == CommandLane::Realtime ? 0 : 1];
+    size_t space = cmd.find(' ');
+    if (space != std::string_view::npos && !lane.empty())
+    {
+        std::string_view header = cmd.substr(0, space + 1);
+        if (lane.back().compare(0, header.size(), header) == 0)
+        {
+            lane.back().assign(cmd.data(), cmd.size());
+            return;
+        }
+    }
+    
+    if (lane.size() < MAX_LIVE_LANE)
+        lane.emplace_back(cmd);
+    else if (logCallback)
+        logCallback("Live lane full - dropped " + std::string(cmd));
+}
+
+void HP33120ADriver::endLongOperation()
+{
+    {
+        std::lock_guard<std::mutex> laneLock(liveLaneMutex);
+        --longOperations;
+    }
+    serviceLiveLane();  // Whatever was queued before the count dropped
+}
+
+void HP33120ADriver::serviceLiveLane()
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    if (servicingLiveLane) return;
+    
+    std::array<std::vector<std::string>, 2> commands;
+    {
+        std::lock_guard<std::mutex> laneLock(liveLaneMutex);
+        if (liveLanes[0].empty() && liveLanes[1].empty()) return;
+        commands[0].swap(liveLanes[0]);
+        commands[1].swap(liveLanes[1]);
+    }
+    
+    servicingLiveLane = true;
+    flushCompoundLine();
+    for (const auto& lane : commands)  // Realtime first
+        for (const auto& cmd : lane)
+            sendCommand(cmd, ErrorCheckPolicy::Deferred);
+    
+    // Checked now, so their errors aren't read back as the long operation's own
+    checkDeferredErrors();
+    servicingLiveLane = false;
+}
+
+// A binary block can't be interrupted once it's started, so it waits (a little)
+// for a gap between realtime writes that it fits into
+void HP33120ADriver::waitForRealtimeGap(size_t blockBytes)
+{
+    const double start = juce::Time::getMillisecondCounterHiRes();
+    const double blockMs = (double)blockBytes / juce::jmax(1.0, blockBytesPerMs);
+    
+    for (;;)
+    {
+        double now = juce::Time::getMillisecondCounterHiRes();
+        double deadline = nextRealtimeDeadlineMs.load();
+        bool overlaps = deadline > 0.0
+                        && deadline + REALTIME_GUARD_MS > now
+                        && deadline < now + blockMs + REALTIME_GUARD_MS;
+        
+        serviceLiveLane();
+        if (!overlaps || now - start >= MAX_BULK_DEFER_MS) return;
+        juce::Thread::sleep(1);
+    }
+}
+
+size_t HP33120ADriver::getLiveLaneDepth() const
+{
+    std::lock_guard<std::mutex> laneLock(liveLaneMutex);
+    return liveLanes[0].size() + liveLanes[1].size();
+}
+
+// ============================================================================
+// ASYNCHRONOUS I/O
+// ============================================================================
+void HP33120ADriver::queryAsync(const std::string& cmd, QueryCallback onReply)
+{
+    ioPool.addJob([this, cmd, onReply]()
+    {
+        std::string reply = query(cmd);
+        if (onReply) onReply(reply);
+    });
+}
+
+ViStatus HP33120ADriver::writeChunk(const unsigned char* bytes, ViUInt32 count, ViUInt32& written,
+                                    const std::function<bool()>& keepGoing)
+{
+    ViSession sess = (ViSession)session;
+    written = 0;
+    if (!asyncEventsEnabled)
+        return viWrite(sess, (ViBuf)bytes, count, &written);
+    
+    ViJobId job = 0;
+    ViStatus status = viWriteAsync(sess, (ViBuf)bytes, count, &job);
+    if (viFailed(status)) return status;
+    
+    // Completion arrives as an event even if the write finished synchronously (VI_SUCCESS_SYNC)
+    bool aborted = false;
+    for (int waitedMs = 0; ; waitedMs += ASYNC_WAIT_SLICE_MS)
+    {
+        ViEventType type = 0;
+        ViEvent event = nullptr;
+        status = viWaitOnEvent(sess, VI_EVENT_IO_COMPLETION, aborted ? OPC_TIMEOUT_MS : ASYNC_WAIT_SLICE_MS, &type, &event);
+        
+        if (!viFailed(status))
+        {
+            ViStatus ioStatus = VI_SUCCESS;
+            ViUInt32 transferred = 0;
+            viGetAttribute((ViObject)event, VI_ATTR_STATUS, &ioStatus);
+            viGetAttribute((ViObject)event, VI_ATTR_RET_COUNT, &transferred);
+            viClose((ViObject)event);
+            
+            written = transferred;
+            return aborted ? VI_ERROR_TMO : ioStatus;
+        }
+        
+        if (status != VI_ERROR_TMO || aborted) return status;
+        
+        if (waitedMs >= ARB_CHUNK_TIMEOUT_MS || (keepGoing && !keepGoing()))
+        {
+            // The aborted job still posts its completion event - wait for it above
+            viTerminate((ViObject)sess, VI_NULL, job);
+            aborted = true;
+        }
+    }
+}
+
+// ============================================================================
+// SHARED BUS
+// ============================================================================
+void HP33120ADriver::setBusMutex(std::shared_ptr<std::recursive_mutex> mutex)
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    busMutex = std::move(mutex);
+}
+
+// Lock order is always driverMutex -> busMutex, and the bus lock is only held for
+// the duration of one VISA transaction
+std::unique_lock<std::recursive_mutex> HP33120ADriver::lockBus()
+{
+    if (busMutex) return std::unique_lock<std::recursive_mutex>(*busMutex);
+    return std::unique_lock<std::recursive_mutex>();
+}
+
+// "GPIB0::10::INSTR" -> "GPIB0", "ASRL3::INSTR" -> "ASRL3". GPIB boards and serial ports
+// are shared media; USB/TCPIP resources each have their own link, so the whole name is the key.
+std::string HP33120ADriver::interfaceKey(const std::string& resource)
+{
+    std::string upper = juce::String(resource).toUpperCase().toStdString();
+    size_t separator = upper.find("::");
+    std::string board = upper.substr(0, separator);
+    
+    if (board.rfind("GPIB", 0) == 0 || board.rfind("ASRL", 0) == 0 || board.rfind("COM", 0) == 0)
+        return board;
+    return upper;
+}
+
+// ============================================================================
+// BUS TRIGGER
+// ============================================================================
+int HP33120ADriver::gpibAddressOf(const std::string& resourceName)
+{
+    // "GPIB0::10::INSTR" -> 10 (secondary address, if any, is ignored)
+    juce::String resource = juce::String(resourceName).toUpperCase();
+    if (!resource.startsWith("GPIB")) return -1;
+    
+    juce::String address = resource.fromFirstOccurrenceOf("::", false, false).upToFirstOccurrenceOf("::", false, false);
+    if (address.isEmpty() || !address.containsOnly("0123456789")) return -1;
+    
+    int value = address.getIntValue();
+    return (value >= 0 && value <= 30) ? value : -1;
+}
+
+bool HP33120ADriver::assertTrigger()
+{
+    // A note's trigger mustn't wait out an ARB transfer - it follows the note's queued frequency
+    auto lock = lockOrDefer("*TRG");
+    if (!lock.owns_lock()) return true;
+    if (!connected) return false;
+    
+    flushCompoundLine();  // Staged commands have to reach the device before the trigger does
+    
+    if (viAssertTrigger && getGpibAddress() >= 0)
+    {
+        auto bus = lockBus();
+        ViStatus status = viAssertTrigger((ViSession)session, VI_TRIG_PROT_DEFAULT);
+        if (status == VI_SUCCESS) return true;
+        
+        if (logCallback)
+            logCallback("viAssertTrigger failed (status " + std::to_string(status) + ") - falling back to *TRG");
+    }
+    
+    sendCommand("*TRG", ErrorCheckPolicy::Deferred);
+    return true;
+}
+
+bool HP33120ADriver::sendGroupTrigger(const std::vector<int>& listenerAddresses)
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    if (!connected || !viGpibCommand || !viOpen || listenerAddresses.empty()) return false;
+    
+    if (!interfaceSession)
+    {
+        std::string board = juce::String(resourceName).upToFirstOccurrenceOf("::", false, false).toStdString() + "::INTFC";
+        ViSession intfc = nullptr;
+        if (viOpen((ViSession)rm, (ViRsrc)board.c_str(), VI_NULL, VI_NULL, &intfc) != VI_SUCCESS)
+        {
+            lastError = "Failed to open " + board + " for group trigger.";
+            if (logCallback) logCallback(lastError);
+            return false;
+        }
+        interfaceSession = (void*)intfc;
+    }
+    
+    // IEEE 488.1: UNL, listen-address every unit, GET (all listeners trigger on the same byte), UNL
+    unsigned char bytes[34];
+    ViUInt32 count = 0;
+    bytes[count++] = 0x3F;
+    for (int address : listenerAddresses)
+        if (address >= 0 && address <= 30 && count < sizeof(bytes) - 2)
+            bytes[count++] = (unsigned char)(0x20 | address);
+    bytes[count++] = 0x08;
+    bytes[count++] = 0x3F;
+    
+    flushCompoundLine();
+    
+    auto bus = lockBus();
+    ViUInt32 written = 0;
+    ViStatus status = viGpibCommand((ViSession)interfaceSession, bytes, count, &written);
+    if (status != VI_SUCCESS || written != count)
+    {
+        lastError = "Group trigger failed (status " + std::to_string(status) + ").";
+        if (logCallback) logCallback(lastError);
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// COMMAND TRANSPORT
+// ============================================================================
+// Every write goes through sendCommand(). The policy only decides when the error
+// queue is read:
+//   Immediate - check right after the command (write() outside a batch)
+//   Deferred  - record the command, check at the end of the batch or on the next
+//               checkDeferredErrors() call (writeFast(), and write() inside a batch)
+//   None      - caller reads SYST:ERR? itself (executeAndCheck, ARB upload)
+void HP33120ADriver::write(const std::string& cmd)
+{
+    auto lock = lockOrDefer(cmd);
+    if (!lock.owns_lock()) return;
+    sendCommand(cmd, batchDepth > 0 ? ErrorCheckPolicy::Deferred : ErrorCheckPolicy::Immediate);
+}
+
+// Fast write for real-time slider updates - doesn't wait for SYST:ERR?,
+// errors are picked up by the next batch/periodic check instead
+void HP33120ADriver::writeFast(const std::string& cmd)
+{
+    sendCommand(cmd, ErrorCheckPolicy::Deferred);
+}
+
+// Heap-formatted argument for a line that doesn't fit in a ScpiLine - same text the
+// stack path would have produced
+static std::string formatArgument(const DeviceParameterTable::Command& command, double wireValue)
+{
+    std::ostringstream text;
+    text.imbue(std::locale::classic());
+    switch (command.kind)
+    {
+        case DeviceParameterTable::Kind::Number:  text << std::fixed << std::setprecision(command.decimals) << wireValue; break;
+        case DeviceParameterTable::Kind::Integer: text << (long long)wireValue; break;
+        case DeviceParameterTable::Kind::Toggle:  text << (wireValue > 0.0 ? "ON" : "OFF"); break;
+        case DeviceParameterTable::Kind::Choice:  text << command.choices[(size_t)wireValue]; break;
+        case DeviceParameterTable::Kind::Unsupported: break;
+    }
+    return text.str();
+}
+
+// Table-driven path: "<header> <argument>" built on the stack from the parameter's
+// descriptor - no heap allocation and no parsing between the setter and viWrite
+void HP33120ADriver::sendParameter(Parameters::DeviceParam param, double value)
+{
+    const DeviceParameterTable::Command& command = DeviceParameterTable::get(param);
+    const double wireValue = DeviceParameterTable::toWire(command, value);
+    
+    ScpiLine line(command.header);
+    switch (command.kind)
+    {
+        case DeviceParameterTable::Kind::Number:  line.appendFixed(wireValue, command.decimals); break;
+        case DeviceParameterTable::Kind::Integer: line.appendInteger((long long)wireValue); break;
+        case DeviceParameterTable::Kind::Toggle:  line.append(wireValue > 0.0 ? "ON" : "OFF"); break;
+        case DeviceParameterTable::Kind::Choice:  line.append(command.choices[(size_t)wireValue]); break;
+        case DeviceParameterTable::Kind::Unsupported: return;
+    }
+    
+    // A truncated line would set the wrong value - an oversized one takes the heap instead
+    std::string heapLine;
+    std::string_view text = line.view();
+    if (line.overflowed())
+    {
+        heapLine = std::string(command.header) + " " + formatArgument(command, wireValue);
+        text = heapLine;
+    }
+    
+    auto lock = lockOrDefer(text);
+    if (!lock.owns_lock()) return;  // Queued behind a bulk transfer - goes out as text
+    
+    const bool immediate = command.check == DeviceParameterTable::Check::Immediate && batchDepth == 0;
+    sendCommand(text, immediate ? ErrorCheckPolicy::Immediate : ErrorCheckPolicy::Deferred, (int)param, wireValue);
+}
+
+void HP33120ADriver::sendChoice(Parameters::DeviceParam param, const std::string& name)
+{
+    const DeviceParameterTable::Command& command = DeviceParameterTable::get(param);
+    int index = DeviceParameterTable::choiceIndex(command, name);
+    if (index >= 0)
+        sendParameter(param, index);
+    else
+        write(std::string(command.header) + " " + name);  // Not in the list - the instrument decides
+}
+
+void HP33120ADriver::sendCommand(std::string_view cmd, ErrorCheckPolicy policy, int shadowParam, double shadowValue)
+{
+    auto lock = lockOrDefer(cmd);
+    if (!lock.owns_lock()) return;
+    if (!connected || !viPrintf) return;
+    
+    try
+    {
+        const bool changes = shadowParam >= 0 ? updateShadowParam(shadowParam, shadowValue)
+                                              : updateShadowState(cmd, policy);
+        if (!changes)
+        {
+            if (verboseLogging && logCallback)
+                logCallback(std::string(cmd) + " -> [skipped, device already has this value]");
+            return;
+        }
+        
+        bool coalesce = coalesceBatches && batchDepth > 0 && policy == ErrorCheckPolicy::Deferred;
+        
+        if (coalesce)
+        {
+            appendToCompoundLine(cmd);
+        }
+        else
+        {
+            // Anything already queued must reach the device first to keep command order
+            flushCompoundLine();
+            
+            ViStatus status = transmitLine(cmd);
+            if (status != VI_SUCCESS)
+            {
+                invalidateShadowState();
+                lastError = "Write failed: " + std::string(cmd);
+                if (policy == ErrorCheckPolicy::Immediate && logCallback)
+                    logCallback("[ERROR] Command failed: " + std::string(cmd) + " (status: " + std::to_string(status) + ")");
+                return;
+            }
+        }
+        
+        if (policy == ErrorCheckPolicy::None) return;
+        
+        // Remember the command so a later error can be tied back to it
+        // (fixed-size records in preallocated storage - nothing allocates here)
+        if (uncheckedCommands.empty() && droppedUncheckedCommands == 0 && uncheckedCommandHook)
+            uncheckedCommandHook();
+        ++commandSequence;
+        if (uncheckedCommands.size() < MAX_UNCHECKED_COMMANDS)
+        {
+            uncheckedCommands.emplace_back();
+            SentCommand& sent = uncheckedCommands.back();
+            sent.sequence = commandSequence;
+            sent.length = juce::jmin(cmd.size(), sizeof(sent.command));
+            std::memcpy(sent.command, cmd.data(), sent.length);
+        }
+        else
+        {
+            ++droppedUncheckedCommands;
+        }
+        
+        if (policy == ErrorCheckPolicy::Immediate)
+            checkDeferredErrors();
+    }
+    catch (const std::exception& e)
+    {
+        lastError = std::string("Exception: ") + e.what();
+        if (logCallback)
+            logCallback("[EXCEPTION] " + std::string(cmd) + " -> " + e.what());
+    }
+    catch (...)
+    {
+        lastError = "Unknown error";
+        if (logCallback)
+            logCallback("[ERROR] " + std::string(cmd) + " -> Unknown exception");
+    }
+}
+
+// Writes line + '\n' as a single message. viWrite sends the bytes as they are;
+// viPrintf (formatted I/O) is only the fallback for VISA builds without viWrite.
+ViStatus HP33120ADriver::transmitLine(std::string_view line)
+{
+    ViSession sess = (ViSession)session;
+    auto bus = lockBus();
+    BusTelemetry::ScopedTimer timer(telemetry, BusTelemetry::Metric::Write);
+    telemetry.addBytesWritten(line.size() + 1);
+    
+    char buffer[MAX_COMPOUND_LINE_LENGTH + 64];
+    if (viWrite && line.size() + 1 <= sizeof(buffer))
+    {
+        std::memcpy(buffer, line.data(), line.size());
+        buffer[line.size()] = '\n';
+        
+        const ViUInt32 count = (ViUInt32)(line.size() + 1);
+        ViUInt32 written = 0;
+        ViStatus status = viWrite(sess, (ViBuf)buffer, count, &written);
+        if (!viFailed(status) && written == count) return status;
+        
+        // Cut short - the parser holds part of a message with no END, and the next
+        // command would be appended to it. Clear it as writeChunked() does.
+        if (written > 0 && viClear) viClear(sess);
+        return viFailed(status) ? status : VI_ERROR_IO;
+    }
+    
+    std::string lineWithNewline = std::string(line) + "\n";
+    ViStatus status = viPrintf(sess, "%s", lineWithNewline.c_str());
+    
+    if (status == VI_SUCCESS && viFlush) viFlush(sess, VI_FLUSH_ON_WRITE);
+    return status;
+}
+
+// Joins batched commands into one SCPI message: "FREQ 1000;:VOLT 2;:AM:DEPT 40"
+// ";:" resets the header path to the root, common commands (*TRG) take a plain ";"
+void HP33120ADriver::appendToCompoundLine(std::string_view cmd)
+{
+    if (cmd.empty()) return;
+    
+    std::string_view separator = (cmd[0] == '*' || cmd[0] == ':') ? ";" : ";:";
+    
+    if (!compoundLine.empty() && compoundLine.size() + separator.size() + cmd.size() + 1 > MAX_COMPOUND_LINE_LENGTH)
+        flushCompoundLine();
+    
+    // compoundLine keeps its reserved capacity between flushes
+    if (!compoundLine.empty())
+        compoundLine.append(separator.data(), separator.size());
+    compoundLine.append(cmd.data(), cmd.size());
+    ++compoundLineCommands;
+}
+
+void HP33120ADriver::flushCompoundLine()
+{
+    if (compoundLine.empty()) return;
+    
+    ViStatus status = transmitLine(compoundLine);
+    if (status != VI_SUCCESS)
+    {
+        invalidateShadowState();
+        lastError = "Write failed: " + compoundLine;
+        if (logCallback)
+            logCallback("[ERROR] Command failed: " + compoundLine + " (status: " + std::to_string(status) + ")");
+    }
+    else if (verboseLogging && logCallback && compoundLineCommands > 1)
+    {
+        logCallback("[" + std::to_string(compoundLineCommands) + " commands in one write] " + compoundLine);
+    }
+    
+    compoundLine.clear();
+    compoundLineCommands = 0;
+}
+
+// ============================================================================
+// SHADOW STATE
+// ============================================================================
+// Remembers the last argument sent for each settings header ("FREQ" -> "1000.000000").
+// Setters format values at a fixed resolution, so an identical string means the
+// device already has that value and the write can be dropped.
+
+// "FUNCtion:SHAPe" -> "FUNC:SHAP" - keeps the short form so long/short spellings share a key.
+// Written into the caller's buffer; headers longer than it are truncated (still a unique prefix).
+static std::string_view canonicalHeader(std::string_view header, char* buffer, size_t capacity)
+{
+    size_t length = 0;
+    for (char c : header)
+    {
+        if (length == capacity) break;
+        if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == ':' || c == '*')
+            buffer[length++] = c;
+    }
+    
+    std::string_view result(buffer, length);
+    if (!result.empty() && result[0] == ':') result.remove_prefix(1);
+    if (result == "FUNC:SHAP") result = "FUNC";  // Same setting, two spellings
+    return result;
+}
+
+static bool startsWith(std::string_view text, std::string_view prefix)
+{
+    return text.substr(0, prefix.size()) == prefix;
+}
+
+void HP33120ADriver::invalidateShadowState()
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    clearShadowState();
+}
+
+void HP33120ADriver::clearShadowState()
+{
+    shadowState.clear();
+    shadowParams.fill(std::numeric_limits<double>::quiet_NaN());
+}
+
+bool HP33120ADriver::updateShadowParam(int param, double wireValue)
+{
+    if (!shadowCacheEnabled) return true;
+    
+    double& shadow = shadowParams[(size_t)param];
+    if (shadow == wireValue) return false;  // NaN never compares equal - unknown always sends
+    shadow = wireValue;
+    forgetCoupledSettings((Parameters::DeviceParam)param);
+    return true;
+}
+
+// The 33120A re-clamps some settings when another one changes - a new function can
+// pull the frequency (TRI/RAMP top out at 100 kHz) or the amplitude into its own
+// limits, and amplitude and offset bound each other (Vpp/2 + |offset| <= 5 V). What
+// the shadow holds for them may no longer be what the device has, so the next write
+// of it has to go out. Amplitude and offset only when the pair is past that limit,
+// so a state sync that sends both still ends up fully known.
+void HP33120ADriver::forgetCoupledSettings(Parameters::DeviceParam changed)
+{
+    using DP = Parameters::DeviceParam;
+    constexpr double unknown = std::numeric_limits<double>::quiet_NaN();
+    double& amplitude = shadowParams[(size_t)DP::Amplitude];
+    double& offset = shadowParams[(size_t)DP::Offset];
+    
+    switch (changed)
+    {
+        case DP::Waveform:
+            for (DP coupled : { DP::Frequency, DP::Amplitude, DP::Offset, DP::DutyCycle })
+                shadowParams[(size_t)coupled] = unknown;
+            break;
+        case DP::Amplitude:
+        case DP::Offset:
+            if (!(amplitude / 2.0 + std::abs(offset) <= MAX_PEAK_VOLTS))  // Also taken if either is unknown
+                (changed == DP::Amplitude ? offset : amplitude) = unknown;
+            break;
+        default:
+            break;
+    }
+}
+
+// Returns false if the command would not change anything on the device
+bool HP33120ADriver::updateShadowState(std::string_view cmd, ErrorCheckPolicy policy)
+{
+    if (cmd.find('?') != std::string_view::npos) return true;
+    
+    size_t space = cmd.find(' ');
+    char headerBuffer[48];
+    std::string_view header = canonicalHeader(cmd.substr(0, space), headerBuffer, sizeof(headerBuffer));
+    
+    // Commands that don't change settings
+    if (header == "*TRG" || header == "*CLS" || header == "*WAI" || header == "*OPC" || header == "*SAV" || header == "SYST:LOC")
+        return true;
+    
+    // Bulk state changes, internal sequences (policy None: ARB upload/delete),
+    // argument-less commands and data/memory operations - forget everything
+    if (!shadowCacheEnabled || policy == ErrorCheckPolicy::None || space == std::string_view::npos
+        || header.empty() || startsWith(header, "APPL") || startsWith(header, "DATA")
+        || startsWith(header, "MEM") || startsWith(header, "SYST") || header[0] == '*')
+    {
+        clearShadowState();
+        return true;
+    }
+    
+    std::string_view argument = cmd.substr(space + 1);
+    int param = DeviceParameterTable::findHeader(header);
+    if (param >= 0)
+        return updateShadowParam(param, DeviceParameterTable::parseArgument(DeviceParameterTable::COMMANDS[(size_t)param], argument));
+    
+    auto it = shadowState.find(header);  // Heterogeneous lookup - no temporary string
+    if (it == shadowState.end())
+    {
+        shadowState.emplace(std::string(header), std::string(argument));
+        return true;
+    }
+    
+    if (it->second == argument)
+        return false;
+    
+    it->second.assign(argument.data(), argument.size());  // Reuses the entry's capacity
+    return true;
+}
+
+// ============================================================================
+// STATE RECALL
+// ============================================================================
+// The 33120A has no *LRN?, so the table's headers are queried instead, joined with
+// ";:" into as few messages as the input buffer allows - three round trips for the
+// whole panel rather than one per parameter.
+bool HP33120ADriver::readBackState()
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    if (!connected) return false;
+    
+    std::string line;
+    std::vector<int> queried;
+    bool complete = true;
+    
+    auto sendLine = [&]()
+    {
+        if (queried.empty()) return;
+        
+        // "SIN;0;+1.00000000000000E+03;..." - none of the replies contain ';'
+        std::vector<std::string> replies;
+        std::string response = query(line);
+        for (size_t start = 0; !response.empty() && start <= response.size();)
+        {
+            size_t end = std::min(response.find(';', start), response.size());
+            std::string reply = response.substr(start, end - start);
+            while (!reply.empty() && reply.front() == ' ') reply.erase(0, 1);
+            while (!reply.empty() && reply.back() == ' ') reply.pop_back();
+            replies.push_back(reply);
+            start = end + 1;
+        }
+        
+        // A rejected header stops the instrument parsing the rest of the message, so
+        // the replies can't be matched up - clear its error and ask that line's headers
+        // one at a time, leaving only the ones that fail again unknown
+        const bool matched = replies.size() == queried.size();
+        if (!matched)
+        {
+            drainErrorQueue();
+            replies.clear();
+            for (int index : queried)
+            {
+                const auto& command = DeviceParameterTable::COMMANDS[(size_t)index];
+                std::string reply = query(std::string(command.header) + "?");
+                if (reply.empty())
+                {
+                    drainErrorQueue();
+                    complete = false;
+                }
+                replies.push_back(reply);
+            }
+        }
+        for (size_t i = 0; i < queried.size(); ++i)
+        {
+            const auto& command = DeviceParameterTable::COMMANDS[(size_t)queried[i]];
+            double value = replies[i].empty() ? std::numeric_limits<double>::quiet_NaN()
+                                              : DeviceParameterTable::parseArgument(command, replies[i]);
+            shadowParams[(size_t)queried[i]] = DeviceParameterTable::roundToResolution(command, value);
+        }
+        
+        line.clear();
+        queried.clear();
+    };
+    
+    for (int i = 0; i < Parameters::NUM_DEVICE_PARAMS; ++i)
+    {
+        const auto& command = DeviceParameterTable::COMMANDS[(size_t)i];
+        if (command.kind == DeviceParameterTable::Kind::Unsupported) continue;
+        if (!command.queryable)
+        {
+            shadowParams[(size_t)i] = std::numeric_limits<double>::quiet_NaN();  // Always sent on recall
+            continue;
+        }
+        
+        if (!line.empty() && line.size() + 2 + command.header.size() + 1 > MAX_COMPOUND_LINE_LENGTH)
+            sendLine();
+        
+        if (!line.empty()) line += ";:";
+        line.append(command.header.data(), command.header.size());
+        line += "?";
+        queried.push_back(i);
+    }
+    sendLine();
+    
+    if (!complete && logCallback)
+        logCallback("[STATE] Readback incomplete - unread settings will be sent");
+    return complete;
+}
+
+int HP33120ADriver::syncState(const std::array<double, Parameters::NUM_DEVICE_PARAMS>& values)
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    if (!connected) return 0;
+    
+    readBackState();
+    
+    int sent = 0, compared = 0;
+    {
+        ScopedErrorBatch batch(*this);
+        for (int i = 0; i < Parameters::NUM_DEVICE_PARAMS; ++i)
+        {
+            const auto param = (Parameters::DeviceParam)i;
+            const auto& command = DeviceParameterTable::get(param);
+            if (command.kind == DeviceParameterTable::Kind::Unsupported) continue;
+            ++compared;
+            
+            // Compared directly rather than through the shadow cache, which may be switched off.
+            // Mid-glide the instrument reports the glide's sweep, not the panel's.
+            const int restoreIndex = glideSettingIndex(param);
+            const double held = restoreIndex >= 0 && gliding.load() ? glideRestore[(size_t)restoreIndex].load()
+                                                                      : shadowParams[(size_t)i];
+            if (held == DeviceParameterTable::toWire(command, values[(size_t)i]))
+            {
+                if (auto* base = baseValueFor(param)) base->store(values[(size_t)i]);
+                continue;
+            }
+            
+            setParameter(param, values[(size_t)i]);
+            ++sent;
+        }
     }
-#endif
-    return (viOpenDefaultRM != nullptr && viOpen != nullptr);
+    
+    if (logCallback)
+        logCallback("[STATE] Synced - " + std::to_string(sent) + " of " + std::to_string(compared) + " settings differed");
+    return sent;
 }
 
-void HP33120ADriver::unloadVISALibrary()
+std::array<double, Parameters::NUM_DEVICE_PARAMS> HP33120ADriver::toWireState(const std::array<double, Parameters::NUM_DEVICE_PARAMS>& values) const
 {
-    if (visaLib)
+    std::array<double, Parameters::NUM_DEVICE_PARAMS> wire;
+    for (size_t i = 0; i < wire.size(); ++i)
     {
-#ifdef _WIN32
-        FreeLibrary((HMODULE)visaLib);
-#else
-        dlclose(visaLib);
-#endif
-        visaLib = nullptr;
+        const auto& command = DeviceParameterTable::COMMANDS[i];
+        wire[i] = command.kind == DeviceParameterTable::Kind::Unsupported ? 0.0 : DeviceParameterTable::toWire(command, values[i]);
     }
+    return wire;
 }
 
-bool HP33120ADriver::connect(const std::string& resource)
+int HP33120ADriver::recallStateRegister(int stateRegister, const std::array<double, Parameters::NUM_DEVICE_PARAMS>& values)
 {
     std::lock_guard<std::recursive_mutex> lock(driverMutex);
-    lastError.clear();
+    if (!connected) return 0;
+    if (stateRegister < 1 || stateRegister > NUM_STATE_REGISTERS) return syncState(values);
     
-    if (connected)
-        disconnect();
+    const auto wire = toWireState(values);
+    const std::string registerText = std::to_string(stateRegister);
     
-    if (!viOpenDefaultRM || !viOpen)
+    if (registerKnown[(size_t)stateRegister] && registerContents[(size_t)stateRegister] == wire)
     {
-        lastError = "VISA library not loaded.";
-        return false;
+        // One command; a failure shows up in the next deferred check, which also drops
+        // the shadow state seeded here
+        sendCommand("*RCL " + registerText, ErrorCheckPolicy::Deferred);
+        for (int i = 0; i < Parameters::NUM_DEVICE_PARAMS; ++i)
+        {
+            const auto param = (Parameters::DeviceParam)i;
+            if (DeviceParameterTable::get(param).kind == DeviceParameterTable::Kind::Unsupported) continue;
+            shadowParams[(size_t)i] = wire[(size_t)i];
+            if (auto* base = baseValueFor(param)) base->store(values[(size_t)i]);
+        }
+        if (logCallback) logCallback("[STATE] Recalled register " + registerText);
+        return 1;
     }
     
-    this->resourceName = resource;
-    
-    ViSession defaultRMSession = nullptr;
-    ViSession sessionObj = nullptr;
-    
-    ViStatus status = viOpenDefaultRM(&defaultRMSession);
-    if (status != VI_SUCCESS) return false;
+    // Stale or never saved - bring the instrument in line, then store it for next time
+    int sent = syncState(values);
     
-    status = viOpen(defaultRMSession, (ViRsrc)resourceName.c_str(), VI_NULL, VI_NULL, &sessionObj);
-    if (status != VI_SUCCESS)
+    // Only if every setting is known to have landed - device errors and write
+    // failures drop the shadow state
+    auto inLine = [this, &wire]()
     {
-        viClose((ViObject)defaultRMSession);
-        lastError = "Failed to open device.";
-        return false;
-    }
-    
-    rm = (void*)defaultRMSession;
-    this->session = (void*)sessionObj;
+        for (size_t i = 0; i < wire.size(); ++i)
+            if (DeviceParameterTable::COMMANDS[i].kind != DeviceParameterTable::Kind::Unsupported
+                && shadowParams[i] != wire[i])
+                return false;
+        return true;
+    };
     
-    if (viSetAttribute)
+    registerKnown[(size_t)stateRegister] = false;
+    if (inLine())
     {
-        // Set timeout to 500ms - short enough for UI responsiveness, long enough for most commands
-        // If device is slow or unresponsive, commands will fail quickly rather than blocking the UI
-        viSetAttribute((ViObject)sessionObj, 0x3FFF001A, 500); // 500ms timeout
+        sendCommand("*SAV " + registerText, ErrorCheckPolicy::Deferred);
+        if (!checkDeferredErrors() && inLine())
+        {
+            registerContents[(size_t)stateRegister] = wire;
+            registerKnown[(size_t)stateRegister] = true;
+            ++sent;
+            if (logCallback) logCallback("[STATE] Saved register " + registerText);
+        }
     }
-    
-    connected = true;
-    
-    // Ensure remote mode and clear status
-    write("SYST:REM"); 
-    write("*CLS");
-    std::this_thread::sleep_for(std::chrono::milliseconds(50));
-    
-    return true;
+    return sent;
 }
 
-void HP33120ADriver::disconnect()
+// ============================================================================
+// DEFERRED ERROR CHECKING
+// ============================================================================
+void HP33120ADriver::beginBatch()
 {
     std::lock_guard<std::recursive_mutex> lock(driverMutex);
-    
-    // Go to local mode before closing
-    if (connected) write("SYST:LOC");
+    ++batchDepth;
+}
 
-    if (session && viClose)
-    {
-        viClose((ViObject)session);
-        session = nullptr;
-    }
-    if (rm && viClose)
+void HP33120ADriver::endBatch()
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    if (batchDepth > 0 && --batchDepth == 0)
     {
-        viClose((ViObject)rm);
-        rm = nullptr;
+        flushCompoundLine();
+        checkDeferredErrors();
     }
-    connected = false;
 }
 
-void HP33120ADriver::write(const std::string& cmd)
+void HP33120ADriver::setUncheckedCommandHook(std::function<void()> hook)
 {
     std::lock_guard<std::recursive_mutex> lock(driverMutex);
-    if (!connected || !viPrintf) return;
+    uncheckedCommandHook = std::move(hook);
+}
+
+// *ESR? costs one round trip and tells us whether anything since the last check went
+// wrong (query/device/execution/command error bits). Only then is SYST:ERR? drained.
+// Returns true if the device reported errors.
+bool HP33120ADriver::checkDeferredErrors()
+{
+    // Another thread's check waits for the end of an ARB transfer rather than sitting on it
+    std::unique_lock<std::recursive_mutex> lock(driverMutex, std::defer_lock);
+    if (!lock.try_lock())
+    {
+        if (longOperations.load() > 0) return false;
+        lock.lock();
+    }
+    if (uncheckedCommands.empty() && droppedUncheckedCommands == 0) return false;
+    if (!connected || !viRead)
+    {
+        uncheckedCommands.clear();
+        droppedUncheckedCommands = 0;
+        return false;
+    }
     
-    try
+    // Move the batch out first - the queries below must not be recorded against it.
+    // The two vectors trade places, so their capacity is reused every time.
+    std::vector<SentCommand>& batch = checkingCommands;
+    batch.clear();
+    batch.swap(uncheckedCommands);
+    size_t dropped = droppedUncheckedCommands;
+    droppedUncheckedCommands = 0;
+    
+    BusTelemetry::ScopedTimer timer(telemetry, BusTelemetry::Metric::ErrorCheck);
+    
+    std::string esrResponse = query("*ESR?");
+    int esr = esrResponse.empty() ? ESR_ERROR_BITS : std::atoi(esrResponse.c_str());  // No reply: drain to be safe
+    
+    if ((esr & ESR_ERROR_BITS) == 0)
     {
-        std::string cmdWithNewline = cmd + "\n";
-        ViSession sess = (ViSession)session;
-        ViStatus status = viPrintf(sess, "%s", cmdWithNewline.c_str());
-        
-        if (status != VI_SUCCESS)
-        {
-            lastError = "Write failed: " + cmd;
-            if (logCallback)
-                logCallback("[ERROR] Command failed: " + cmd + " (status: " + std::to_string(status) + ")");
-            return;
-        }
-        
-        if (viFlush) viFlush(sess, VI_FLUSH_ON_WRITE);
-        
-        // ALWAYS check for device errors (not just in verbose mode)
-        // This is important for user feedback - they need to know when commands fail
-        if (viPrintf && viRead)
+        if (verboseLogging && logCallback)
         {
-            // Query SYST:ERR? to check if device had any problems with the command
-            status = viPrintf(sess, "SYST:ERR?\n");
-            if (status == VI_SUCCESS && viFlush) viFlush(sess, VI_FLUSH_ON_WRITE);
-            
-            char buffer[256] = {0};
-            ViUInt32 retCount = 0;
-            status = viRead(sess, (ViBuf)buffer, sizeof(buffer) - 1, &retCount);
-            
-            if (status == VI_SUCCESS && retCount > 0)
-            {
-                buffer[retCount] = '\0';
-                std::string response(buffer);
-                
-                // Remove trailing whitespace
-                while (!response.empty() && (response.back() == '\n' || response.back() == '\r' || response.back() == ' '))
-                    response.pop_back();
-                
-                // Check if there's an actual error (not "+0,No error")
-                bool hasError = !response.empty() && response[0] != '+' && response.find("No error") == std::string::npos;
-                
-                // Also check for error codes like "-222,Data out of range"
-                if (response.find("-") == 0 || (response.find(",") != std::string::npos && response[0] == '-'))
-                {
-                    hasError = true;
-                }
-                
-                if (hasError && logCallback)
-                {
-                    // Log the error with the command that caused it
-                    logCallback("[DEVICE ERROR] " + cmd + " -> " + response);
-                    lastError = response;
-                }
-                else if (verboseLogging && logCallback)
-                {
-                    // In verbose mode, log all commands even if no error
-                    logCallback(cmd + " -> " + response);
-                }
-            }
-            else if (status == (ViStatus)0xBFFF0015)  // VI_ERROR_TMO - timeout
-            {
-                // Timeout on error query - device might be busy or command was slow
-                // Don't log this as an error, just continue
-                if (verboseLogging && logCallback)
-                {
-                    logCallback(cmd + " -> [no response - device may be processing]");
-                }
-            }
-            else if (logCallback && verboseLogging)
-            {
-                logCallback(cmd + " -> [read failed: " + std::to_string(status) + "]");
-            }
+            for (const auto& sent : batch)
+                logCallback(sent.text() + " -> OK");
         }
+        return false;
     }
-    catch (const std::exception& e)
+    
+    std::vector<std::string> errors = drainErrorQueue();
+    if (errors.empty()) return false;  // Already read by someone else (e.g. executeAndCheck)
+    
+    // A rejected or clipped command leaves the device in a state we can't infer
+    invalidateShadowState();
+    
+    // Attribute errors: with a single command the culprit is exact, otherwise
+    // report the sequence range and the commands that were in flight
+    std::string context;
+    if (batch.size() == 1 && dropped == 0)
     {
-        lastError = std::string("Exception: ") + e.what();
-        if (logCallback)
-            logCallback("[EXCEPTION] " + cmd + " -> " + e.what());
+        context = batch.front().text();
     }
-    catch (...)
+    else if (!batch.empty())
     {
-        lastError = "Unknown error";
+        context = "batch #" + std::to_string(batch.front().sequence) + "-#" +
+                  std::to_string(batch.back().sequence + dropped) + " [";
+        for (size_t i = 0; i < batch.size(); ++i)
+            context += (i > 0 ? "; " : "") + batch[i].text();
+        if (dropped > 0)
+            context += "; +" + std::to_string(dropped) + " more";
+        context += "]";
+    }
+    
+    for (const auto& error : errors)
+    {
+        lastError = error;
         if (logCallback)
-            logCallback("[ERROR] " + cmd + " -> Unknown exception");
+            logCallback("[DEVICE ERROR] " + context + " -> " + error);
     }
+    
+    return true;
 }
 
-// Fast write without error checking - for real-time slider updates
-// This is ~50-100ms faster than write() because it skips SYST:ERR? query
-void HP33120ADriver::writeFast(const std::string& cmd)
+// SYST:ERR? replies "<code>,\"<message>\"" and only code 0 is "No error". A reply
+// without a leading number (nothing read, timed out) doesn't count as one.
+static bool isNoError(const std::string& reply)
 {
-    std::lock_guard<std::recursive_mutex> lock(driverMutex);
-    if (!connected || !viPrintf) return;
+    const char* text = reply.c_str();
+    char* end = nullptr;
+    const long code = std::strtol(text, &end, 10);
+    return end != text && code == 0;
+}
+
+std::vector<std::string> HP33120ADriver::drainErrorQueue()
+{
+    std::vector<std::string> errors;
     
-    try
-    {
-        std::string cmdWithNewline = cmd + "\n";
-        ViSession sess = (ViSession)session;
-        ViStatus status = viPrintf(sess, "%s", cmdWithNewline.c_str());
-        
-        if (status != VI_SUCCESS)
-        {
-            lastError = "Write failed: " + cmd;
-            // Don't log errors for fast writes - they're fire-and-forget
-            return;
-        }
-        
-        if (viFlush) viFlush(sess, VI_FLUSH_ON_WRITE);
-        // NO error query - that's what makes this fast!
-    }
-    catch (...)
+    // The 33120A queue holds up to 20 errors
+    for (int i = 0; i < 20; ++i)
     {
-        // Silently ignore exceptions in fast mode
+        std::string error = query("SYST:ERR?");
+        if (error.empty() || isNoError(error))
+            break;
+        errors.push_back(error);
     }
+    
+    return errors;
 }
 
 std::string HP33120ADriver::query(const std::string& cmd)
@@ -281,11 +1331,29 @@ std::string HP33120ADriver::query(const std::string& cmd)
     std::lock_guard<std::recursive_mutex> lock(driverMutex);
     if (!connected || !viPrintf || !viRead) return "";
     
+    // A message boundary inside a bulk operation - queued live writes go first
+    if (longOperations.load() > 0 && !servicingLiveLane)
+        serviceLiveLane();
+    
+    // A query needs its own reply - send any queued batch commands first
+    flushCompoundLine();
+    
     try
     {
+        auto bus = lockBus();  // Write and read back as one bus transaction
         std::string cmdWithNewline = cmd + "\n";
         ViSession sess = (ViSession)session;
         
+        if (lateReplyPending)
+        {
+            // A timed-out *OPC? answered after all - that reply isn't this query's
+            lateReplyPending = false;
+            char stale[64] = {0};
+            ViUInt32 staleCount = 0;
+            viRead(sess, (ViBuf)stale, sizeof(stale) - 1, &staleCount);
+        }
+        
+        double startMs = juce::Time::getMillisecondCounterHiRes();
         ViStatus writeStatus = viPrintf(sess, "%s", cmdWithNewline.c_str());
         if (writeStatus != VI_SUCCESS)
         {
@@ -294,6 +1362,9 @@ std::string HP33120ADriver::query(const std::string& cmd)
         }
         
         if (viFlush) viFlush(sess, VI_FLUSH_ON_WRITE);
+        double writtenMs = juce::Time::getMillisecondCounterHiRes();
+        telemetry.record(BusTelemetry::Metric::Write, writtenMs - startMs);
+        telemetry.addBytesWritten(cmdWithNewline.size());
         
         // No delay needed - the VISA read will use the configured timeout
         
@@ -301,11 +1372,13 @@ std::string HP33120ADriver::query(const std::string& cmd)
         ViUInt32 retCount = 0;
         
         ViStatus status = viRead(sess, (ViBuf)buffer, sizeof(buffer) - 1, &retCount);
+        telemetry.record(BusTelemetry::Metric::Read, juce::Time::getMillisecondCounterHiRes() - writtenMs);
+        telemetry.addBytesRead(retCount);
         
         if (status != VI_SUCCESS) 
         {
-            // VI_ERROR_TMO (0xBFFF0015) is timeout - common for unsupported queries
-            if (status != (ViStatus)0xBFFF0015)
+            // A timeout is common for unsupported queries
+            if (status != VI_ERROR_TMO)
             {
                 lastError = "Query read failed: " + cmd + " (status: " + std::to_string(status) + ")";
                 if (logCallback)
@@ -342,6 +1415,56 @@ std::string HP33120ADriver::query(const std::string& cmd)
 std::string HP33120ADriver::queryIDN() { return query("*IDN?"); }
 std::string HP33120ADriver::queryError() { return query("SYST:ERR?"); }
 
+// *OPC? is answered only after every pending operation has finished, so the read
+// returns as soon as the instrument is done instead of after a worst-case sleep.
+// (Serial-poll/SRQ would need VISA event support and doesn't exist over RS-232)
+bool HP33120ADriver::waitForOperationComplete(int timeoutMs)
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    if (!connected || !viPrintf || !viRead) return false;
+    
+    ViSession sess = (ViSession)session;
+    if (viSetAttribute)
+        viSetAttribute((ViObject)sess, VI_ATTR_TMO_VALUE, (ViUInt32)timeoutMs);
+    
+    std::string response = query("*OPC?");
+    
+    if (viSetAttribute)
+        viSetAttribute((ViObject)sess, VI_ATTR_TMO_VALUE, 500); // Restore 500ms timeout
+    
+    bool complete = !response.empty() && (response[0] == '1' || response.rfind("+1", 0) == 0);
+    if (!complete && logCallback)
+        logCallback("*OPC? -> " + (response.empty() ? std::string("[timeout after ") + std::to_string(timeoutMs) + " ms]" : response));
+    
+    // The "1" still comes once the operation finishes, and would be read as the reply
+    // to the next query (SYST:ERR? typically). Device clear drops it together with the
+    // pending *OPC?; without viClear, query() reads it off before its next command.
+    if (response.empty())
+    {
+        if (viClear)
+        {
+            auto bus = lockBus();
+            viClear(sess);
+        }
+        else
+        {
+            lateReplyPending = true;
+        }
+    }
+    
+    return complete;
+}
+
+// Sends a command, waits for it to complete, and returns its SYST:ERR? entry.
+// Uses writeFast so the error queue is read exactly once - by the caller, via the return value.
+std::string HP33120ADriver::executeAndCheck(const std::string& cmd, int timeoutMs)
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    sendCommand(cmd, ErrorCheckPolicy::None);
+    waitForOperationComplete(timeoutMs);
+    return queryError();
+}
+
 // --- THE FIX: APPLy Command ---
 void HP33120ADriver::applyWaveform(const std::string& shape, double freq, double amp, double offset)
 {
@@ -363,14 +1486,17 @@ void HP33120ADriver::applyWaveform(const std::string& shape, double freq, double
     write(cmd.toStdString());
 }
 
-void HP33120ADriver::setWaveform(const std::string& waveform) { write("FUNC " + waveform); }
+void HP33120ADriver::setWaveform(const std::string& waveform) { sendChoice(Parameters::DeviceParam::Waveform, waveform); }
 
-void HP33120ADriver::setUserWaveform(const std::string& name)
+bool HP33120ADriver::setUserWaveform(const std::string& name)
 {
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    
     // Select a specific ARB waveform by name
     // First set shape to USER, then select the specific waveform
     write("FUNCtion:SHAPe USER");
-    write("FUNCtion:USER " + name);
+    std::string error = executeAndCheck("FUNCtion:USER " + name);
+    return isNoError(error);
 }
 
 void HP33120ADriver::selectUserWaveform(const std::string& name)
@@ -380,95 +1506,218 @@ void HP33120ADriver::selectUserWaveform(const std::string& name)
     write("FUNCtion:USER " + name);
 }
 
-void HP33120ADriver::setFrequency(double freqHz)
+void HP33120ADriver::setParameter(Parameters::DeviceParam param, double value)
 {
-    baseFreq = freqHz;
-    // Use juce::String for locale-safe formatting (guarantees dots, not commas)
-    juce::String cmd = "FREQ " + juce::String(freqHz, 6);
-    writeFast(cmd.toStdString());  // Fast for instant slider response
+    if (auto* base = baseValueFor(param)) base->store(value);
+    
+    // Mid-glide a new frequency lands straight away - finishGlide() sends it
+    if (param == Parameters::DeviceParam::Frequency && gliding.load())
+    {
+        glideTargetHz.store(value);
+        finishGlide();
+        return;
+    }
+    
+    // The sweep settings belong to the glide while it runs - the new value is what
+    // finishGlide() puts back. Checked again after the store: a glide that ended in
+    // between may already have restored the old one, so it goes out as usual.
+    const int restoreIndex = glideSettingIndex(param);
+    if (restoreIndex >= 0 && gliding.load())
+    {
+        glideRestore[(size_t)restoreIndex].store(DeviceParameterTable::toWire(DeviceParameterTable::get(param), value));
+        if (gliding.load()) return;
+    }
+    sendParameter(param, value);
 }
 
-void HP33120ADriver::setAmplitude(double ampVpp)
+std::atomic<double>* HP33120ADriver::baseValueFor(Parameters::DeviceParam param)
 {
-    baseAmp = ampVpp;
-    // Use juce::String for locale-safe formatting (guarantees dots, not commas)
-    juce::String cmd = "VOLT " + juce::String(ampVpp, 6);
-    writeFast(cmd.toStdString());  // Fast for instant slider response
+    switch (param)
+    {
+        case Parameters::DeviceParam::Frequency:   return &baseFreq;
+        case Parameters::DeviceParam::Amplitude:   return &baseAmp;
+        case Parameters::DeviceParam::Offset:      return &baseOffset;
+        case Parameters::DeviceParam::DutyCycle:   return &baseDuty;
+        case Parameters::DeviceParam::AMDepth:     return &baseAMDepth;
+        case Parameters::DeviceParam::FMDeviation: return &baseFMDev;
+        default:                                   return nullptr;
+    }
 }
 
-void HP33120ADriver::setOffset(double offsetV)
+// The setters below are thin wrappers - ranges, resolution, header and check policy
+// all come from DeviceParameterTable
+using DP = Parameters::DeviceParam;
+
+void HP33120ADriver::setFrequency(double freqHz) { setParameter(DP::Frequency, freqHz); }
+void HP33120ADriver::setAmplitude(double ampVpp) { setParameter(DP::Amplitude, ampVpp); }
+void HP33120ADriver::setOffset(double offsetV) { setParameter(DP::Offset, offsetV); }
+void HP33120ADriver::setPhase(double phaseDeg) { setParameter(DP::Phase, phaseDeg); }
+void HP33120ADriver::setDutyCycle(double duty) { setParameter(DP::DutyCycle, duty); }
+void HP33120ADriver::setOutputEnabled(bool enabled) { setParameter(DP::OutputEnabled, enabled ? 1.0 : 0.0); }
+
+// Live updates write the value without moving the base the modulation engine works around
+void HP33120ADriver::updateFrequencyLive(double freqHz) { sendParameter(DP::Frequency, freqHz); }
+void HP33120ADriver::updateAmplitudeLive(double ampVpp) { sendParameter(DP::Amplitude, ampVpp); }
+void HP33120ADriver::updateDutyCycleLive(double duty) { sendParameter(DP::DutyCycle, duty); }
+
+// AM
+void HP33120ADriver::setAMEnabled(bool enabled) { setParameter(DP::AMEnabled, enabled ? 1.0 : 0.0); }
+void HP33120ADriver::setAMDepth(double depth) { setParameter(DP::AMDepth, depth); }
+void HP33120ADriver::setAMSource(const std::string& source) { sendChoice(DP::AMSource, source); }
+void HP33120ADriver::setAMInternalWaveform(const std::string& waveform) { sendChoice(DP::AMIntWaveform, waveform); }
+void HP33120ADriver::setAMInternalFrequency(double freqHz) { setParameter(DP::AMIntFreq, freqHz); }
+
+// FM
+void HP33120ADriver::setFMEnabled(bool enabled) { setParameter(DP::FMEnabled, enabled ? 1.0 : 0.0); }
+void HP33120ADriver::setFMDeviation(double devHz) { setParameter(DP::FMDeviation, devHz); }
+void HP33120ADriver::setFMSource(const std::string& source) { sendChoice(DP::FMSource, source); }
+void HP33120ADriver::setFMInternalWaveform(const std::string& waveform) { sendChoice(DP::FMIntWaveform, waveform); }
+void HP33120ADriver::setFMInternalFrequency(double freqHz) { setParameter(DP::FMIntFreq, freqHz); }
+
+// FSK
+void HP33120ADriver::setFSKEnabled(bool enabled) { setParameter(DP::FSKEnabled, enabled ? 1.0 : 0.0); }
+void HP33120ADriver::setFSKFrequency(double freqHz) { setParameter(DP::FSKFrequency, freqHz); }
+void HP33120ADriver::setFSKSource(const std::string& source) { sendChoice(DP::FSKSource, source); }
+void HP33120ADriver::setFSKInternalRate(double rateHz) { setParameter(DP::FSKRate, rateHz); }
+
+// Sweep
+void HP33120ADriver::setSweepEnabled(bool enabled) { setParameter(DP::SweepEnabled, enabled ? 1.0 : 0.0); }
+void HP33120ADriver::setSweepStartFreq(double freqHz) { setParameter(DP::SweepStart, freqHz); }
+void HP33120ADriver::setSweepStopFreq(double freqHz) { setParameter(DP::SweepStop, freqHz); }
+void HP33120ADriver::setSweepTime(double timeS) { setParameter(DP::SweepTime, timeS); }
+
+// Burst
+void HP33120ADriver::setBurstEnabled(bool enabled) { setParameter(DP::BurstEnabled, enabled ? 1.0 : 0.0); }
+void HP33120ADriver::setBurstCycles(int cycles) { setParameter(DP::BurstCycles, cycles); }
+void HP33120ADriver::setBurstPhase(double phaseDeg) { setParameter(DP::BurstPhase, phaseDeg); }
+void HP33120ADriver::setBurstInternalPeriod(double periodS) { setParameter(DP::BurstIntPeriod, periodS); }
+void HP33120ADriver::setBurstSource(const std::string& source) { sendChoice(DP::BurstSource, source); }
+
+// Sync/Trig
+void HP33120ADriver::setSyncEnabled(bool enabled) { setParameter(DP::SyncEnabled, enabled ? 1.0 : 0.0); }
+void HP33120ADriver::setSyncPhase(double phaseDeg) { setParameter(DP::SyncPhase, phaseDeg); }  // No 33120A command - use setPhase()
+void HP33120ADriver::setTriggerSource(const std::string& source) { sendChoice(DP::TriggerSource, source); }
+
+// ============================================================================
+// GLIDE
+// ============================================================================
+// The 33120A runs one modulation mode at a time - switching sweep on would turn the
+// others off - and doesn't sweep noise or DC. All of that has to be known, not assumed.
+bool HP33120ADriver::canSweep() const
 {
-    baseOffset = offsetV;
-    // Use juce::String for locale-safe formatting (guarantees dots, not commas)
-    juce::String cmd = "VOLT:OFFS " + juce::String(offsetV, 6);
-    writeFast(cmd.toStdString());  // Fast for instant slider response
+    const DeviceParameterTable::Command& shape = DeviceParameterTable::get(DP::Waveform);
+    const double waveform = shadowParams[(size_t)DP::Waveform];
+    auto isOff = [this](DP param) { return shadowParams[(size_t)param] == 0.0; };
+    
+    return waveform == waveform  // NaN: unknown
+        && waveform != DeviceParameterTable::choiceIndex(shape, "NOIS")
+        && waveform != DeviceParameterTable::choiceIndex(shape, "DC")
+        && isOff(DP::AMEnabled) && isOff(DP::FMEnabled) && isOff(DP::FSKEnabled) && isOff(DP::BurstEnabled);
 }
 
-void HP33120ADriver::setPhase(double phaseDeg)
+// Where a logarithmic sweep has got to - driver locked, glide in progress
+double HP33120ADriver::glideFrequencyAt(double nowMs) const
 {
-    if (phaseDeg >= 360.0) phaseDeg = 359.999;
-    juce::String cmd = "PHAS " + juce::String(phaseDeg, 3);
-    writeFast(cmd.toStdString());  // Fast for instant slider response
+    const double span = glideEndMs.load() - glideStartMs;
+    const double progress = span > 0.0 ? juce::jlimit(0.0, 1.0, (nowMs - glideStartMs) / span) : 1.0;
+    return glideFromHz * std::pow(glideTargetHz.load() / glideFromHz, progress);
 }
 
-void HP33120ADriver::setDutyCycle(double duty)
+bool HP33120ADriver::startGlide(double toHz, double durationMs)
 {
-    baseDuty = duty;
-    juce::String cmd = "FUNC:SQU:DCYC " + juce::String(duty, 6);
-    writeFast(cmd.toStdString());  // Fast for instant slider response
+    std::unique_lock<std::recursive_mutex> lock(driverMutex, std::try_to_lock);
+    if (!lock.owns_lock() && longOperations.load() == 0) lock.lock();
+    
+    const double nowMs = juce::Time::getMillisecondCounterHiRes();
+    double fromHz = std::numeric_limits<double>::quiet_NaN();
+    if (lock.owns_lock())
+        fromHz = gliding.load() ? glideFrequencyAt(nowMs) : shadowParams[(size_t)DP::Frequency];
+    
+    // Behind a bulk transfer the setup couldn't go out as one piece - jump instead
+    if (!lock.owns_lock() || !connected || durationMs < MIN_GLIDE_MS || !canSweep()
+        || !(fromHz > 0.0) || std::abs(toHz - fromHz) < 0.01)
+    {
+        setFrequency(toHz);  // Also lands a glide in progress
+        return false;
+    }
+    
+    // A glide started mid-glide keeps the settings from before the first one
+    if (!gliding.load())
+        for (size_t i = 0; i < GLIDE_SETTINGS.size(); ++i)
+            glideRestore[i].store(shadowParams[(size_t)GLIDE_SETTINGS[i]]);
+    
+    const double seconds = juce::jlimit(DeviceParameterTable::get(DP::SweepTime).minValue,
+                                        DeviceParameterTable::get(DP::SweepTime).maxValue, durationMs / 1000.0);
+    baseFreq = toHz;
+    glideFromHz = fromHz;
+    glideStartMs = nowMs;
+    glideTargetHz.store(toHz);
+    glideEndMs.store(nowMs + seconds * 1000.0);
+    gliding.store(true);
+    
+    // One compound line: the sweep waits at its start frequency until the trigger
+    ScopedErrorBatch batch(*this);
+    sendParameter(DP::SweepStart, fromHz);
+    sendParameter(DP::SweepStop, toHz);
+    sendParameter(DP::SweepTime, seconds);
+    sendCommand("SWE:SPAC LOG", ErrorCheckPolicy::Deferred);  // Constant semitones per second
+    sendParameter(DP::TriggerSource, DeviceParameterTable::choiceIndex(DeviceParameterTable::get(DP::TriggerSource), "BUS"));
+    sendParameter(DP::SweepEnabled, 1.0);
+    sendCommand("*TRG", ErrorCheckPolicy::Deferred);
+    return true;
 }
 
-void HP33120ADriver::setOutputEnabled(bool enabled)
+bool HP33120ADriver::serviceGlide(double nowMs)
 {
-    write(enabled ? "OUTP ON" : "OUTP OFF");
+    if (!gliding.load() || nowMs < glideEndMs.load()) return true;
+    return finishGlide();
 }
 
-// AM - use writeFast for slider-controlled values, write for toggles/combos
-void HP33120ADriver::setAMEnabled(bool enabled) { write(enabled ? "AM:STAT ON" : "AM:STAT OFF"); }
-void HP33120ADriver::setAMDepth(double depth) { writeFast("AM:DEPT " + std::to_string(depth)); }
-void HP33120ADriver::setAMSource(const std::string& source) { write("AM:SOUR " + source); }
-void HP33120ADriver::setAMInternalWaveform(const std::string& waveform) { write("AM:INT:FUNC " + waveform); }
-void HP33120ADriver::setAMInternalFrequency(double freqHz) { writeFast("AM:INT:FREQ " + std::to_string(freqHz)); }
-
-// FM - use writeFast for slider-controlled values, write for toggles/combos
-void HP33120ADriver::setFMEnabled(bool enabled) { write(enabled ? "FM:STAT ON" : "FM:STAT OFF"); }
-void HP33120ADriver::setFMDeviation(double devHz) { writeFast("FM:DEV " + std::to_string(devHz)); }
-void HP33120ADriver::setFMSource(const std::string& source) { write("FM:SOUR " + source); }
-void HP33120ADriver::setFMInternalWaveform(const std::string& waveform) { write("FM:INT:FUNC " + waveform); }
-void HP33120ADriver::setFMInternalFrequency(double freqHz) { writeFast("FM:INT:FREQ " + std::to_string(freqHz)); }
-
-// FSK - use writeFast for slider-controlled values, write for toggles/combos
-void HP33120ADriver::setFSKEnabled(bool enabled) { write(enabled ? "FSK:STAT ON" : "FSK:STAT OFF"); }
-void HP33120ADriver::setFSKFrequency(double freqHz) { writeFast("FSK:FREQ " + std::to_string(freqHz)); }
-void HP33120ADriver::setFSKSource(const std::string& source) { write("FSK:SOUR " + source); }
-void HP33120ADriver::setFSKInternalRate(double rateHz) { writeFast("FSK:INT:RATE " + std::to_string(rateHz)); }
-
-// Sweep - use writeFast for slider-controlled values, write for toggles
-void HP33120ADriver::setSweepEnabled(bool enabled) { write(enabled ? "SWE:STAT ON" : "SWE:STAT OFF"); }
-void HP33120ADriver::setSweepStartFreq(double freqHz) { writeFast("FREQ:STAR " + std::to_string(freqHz)); }
-void HP33120ADriver::setSweepStopFreq(double freqHz) { writeFast("FREQ:STOP " + std::to_string(freqHz)); }
-void HP33120ADriver::setSweepTime(double timeS) { writeFast("SWE:TIME " + std::to_string(timeS)); }
-
-// Burst - use writeFast for slider-controlled values, write for toggles/combos
-void HP33120ADriver::setBurstEnabled(bool enabled) { write(enabled ? "BM:STAT ON" : "BM:STAT OFF"); }
-void HP33120ADriver::setBurstCycles(int cycles) { writeFast("BM:NCYC " + std::to_string(cycles)); }
-void HP33120ADriver::setBurstPhase(double phaseDeg) { writeFast("BM:PHAS " + std::to_string(phaseDeg)); }
-void HP33120ADriver::setBurstInternalPeriod(double periodS) { writeFast("BM:INT:RATE " + std::to_string(1.0/periodS)); }
-void HP33120ADriver::setBurstSource(const std::string& source) { write("BM:SOUR " + source); }
+bool HP33120ADriver::finishGlide()
+{
+    std::unique_lock<std::recursive_mutex> lock(driverMutex, std::try_to_lock);
+    if (!lock.owns_lock() && longOperations.load() == 0) lock.lock();
+    if (!lock.owns_lock()) return false;  // Behind a bulk transfer - serviceGlide() again later
+    if (!gliding.exchange(false) || !connected) return true;
+    
+    // FREQ first, so switching the sweep off doesn't show the old frequency
+    ScopedErrorBatch batch(*this);
+    sendParameter(DP::Frequency, glideTargetHz.load());
+    
+    const double sweepWasOn = glideRestore[0].load() == 1.0 ? 1.0 : 0.0;  // Unknown: off
+    sendParameter(DP::SweepEnabled, sweepWasOn);
+    for (size_t i = 1; i < GLIDE_SETTINGS.size(); ++i)
+    {
+        const double value = glideRestore[i].load();
+        if (value == value)
+            sendParameter(GLIDE_SETTINGS[i], value);
+    }
+    // The panel's sweeps are linear - an off sweep too, or the next one would start out LOG
+    sendCommand("SWE:SPAC LIN", ErrorCheckPolicy::Deferred);
+    return true;
+}
 
-// Sync/Trig
-void HP33120ADriver::setSyncEnabled(bool enabled) { write(enabled ? "OUTP:SYNC ON" : "OUTP:SYNC OFF"); }
-void HP33120ADriver::setSyncPhase(double phaseDeg) 
-{ 
-    // Not supported directly on 33120A via specific command, uses standard Phase
-    // Use setPhase() instead for phase control
-    (void)phaseDeg; // Suppress unused parameter warning
+int HP33120ADriver::glideSettingIndex(Parameters::DeviceParam param)
+{
+    for (size_t i = 0; i < GLIDE_SETTINGS.size(); ++i)
+        if (GLIDE_SETTINGS[i] == param) return (int)i;
+    return -1;
 }
-void HP33120ADriver::setTriggerSource(const std::string& source) { write("TRIG:SOUR " + source); }
 
-void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vector<float>& data, int maxPoints)
+HP33120ADriver::ARBUploadReport HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vector<float>& data,
+                                                                   int maxPoints, const TransferProgress& progress)
 {
     std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    LongOperation longOperation(*this);  // Live settings from other threads queue meanwhile
+    
+    ARBUploadReport report;
+    uploadARB(name, data, maxPoints, progress, report);
+    return report;
+}
+
+void HP33120ADriver::uploadARB(const std::string& name, const std::vector<float>& data, int maxPoints,
+                               const TransferProgress& progress, ARBUploadReport& report)
+{
     if (!connected || data.empty()) return;
     
     // Validate point count (ARBManager should have already resampled, but validate anyway)
@@ -520,50 +1769,14 @@ void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vec
     for (auto& val : finalData)
         val = std::max(-1.0f, std::min(1.0f, val));
     
-    // Build SCPI command: DATA VOLATILE, val1,val2,...,valN
+    report.pointsSent = (int)finalData.size();
+    report.payloadHash = hashDACCodes(finalData);
+    
     // According to HP33120A manual, we must:
-    // 1. Upload to VOLATILE memory using DATA VOLATILE
+    // 1. Upload to VOLATILE memory (DATA:DAC VOLATILE binary block, or DATA VOLATILE ASCII)
     // 2. Copy to non-volatile memory with DATA:COPY <name>, VOLATILE
     // 3. Select with FUNCtion:USER <name>
     // 4. Set shape to USER with FUNCtion:SHAPe USER
-    // Use std::ostringstream for efficient string building, then convert to juce::String
-    // This is much faster than concatenating juce::String objects
-    std::ostringstream oss;
-    oss.imbue(std::locale("C"));  // Force C locale to ensure dot decimal separator
-    oss << std::fixed << std::setprecision(6);
-    oss << "DATA VOLATILE";
-    
-    // Build data string efficiently using ostringstream
-    // For very large datasets, yield periodically to keep system responsive
-    const size_t yieldInterval = 1000;  // Yield every 1000 points
-    for (size_t i = 0; i < finalData.size(); ++i)
-    {
-        oss << "," << finalData[i];
-        
-        // Yield periodically during string building for very large datasets
-        if (i > 0 && (i % yieldInterval == 0) && finalData.size() > 5000)
-        {
-            std::this_thread::yield();
-        }
-    }
-    
-    juce::String cmd = juce::String(oss.str());
-    
-    // For very large commands, log a warning but proceed
-    if (cmd.length() > 100000 && logCallback)
-    {
-        logCallback("Warning: Large ARB command (" + std::to_string(cmd.length()) + " chars) - upload may take time");
-    }
-    
-    // Debug: Log first part of command to verify format
-    if (logCallback && cmd.length() > 0)
-    {
-        juce::String firstPart = cmd.substring(0, juce::jmin(100, (int)cmd.length()));
-        logCallback(("ARB command start: " + firstPart + "...").toStdString());
-    }
-    
-    // Send the ARB data command directly (bypass normal write() to avoid error query on huge command)
-    // This prevents crashes from querying errors on very large commands
     // Note: driverMutex is already locked at function start
     if (!connected || !viPrintf)
     {
@@ -575,59 +1788,17 @@ void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vec
     
     // Clear last error before starting
     lastError.clear();
-    
-    try
-    {
-        std::string cmdStr = cmd.toStdString();
-        ViSession sess = (ViSession)session;
-        
-        // Temporarily increase timeout for large ARB uploads
-        // Large waveform data (8000+ points, 100KB+ of command text) needs more time
-        if (viSetAttribute)
-        {
-            viSetAttribute((ViObject)sess, 0x3FFF001A, 10000); // 10 second timeout for ARB upload
-        }
-        
+    
+    try
+    {
         // Step 1: Upload to VOLATILE memory
-        // Use viPrintf like the Python code does - it handles large strings correctly
-        ViStatus status = viPrintf(sess, "%s\n", cmdStr.c_str());
-        
-        // Restore normal timeout immediately after write
-        if (viSetAttribute)
-        {
-            viSetAttribute((ViObject)sess, 0x3FFF001A, 500); // Restore 500ms timeout
-        }
-        
-        if (status != VI_SUCCESS)
-        {
-            lastError = "VISA write error " + std::to_string(status);
-            if (logCallback)
-                logCallback("ARB upload failed: VISA write error " + std::to_string(status));
-            return;
-        }
-        
-        if (viFlush) viFlush(sess, VI_FLUSH_ON_WRITE);
-        
-        // For large ARB uploads, give device more time to process
-        // The device needs time to parse and store the large command
-        std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        if (!sendVolatileData(finalData, "DATA VOLATILE", progress, report))
+            return;  // Don't proceed if upload failed
         
-        // Query error to check if upload was successful
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        std::string error = queryError();
+        // VOLATILE is complete - let queued live settings through before the copy
+        serviceLiveLane();
         
-        if (error.find("No error") != std::string::npos || error.find("+0") != std::string::npos)
-        {
-            if (logCallback)
-                logCallback("DATA VOLATILE -> [Uploaded " + std::to_string(finalData.size()) + " points]");
-        }
-        else
-        {
-            lastError = "DATA VOLATILE: " + error;
-            if (logCallback)
-                logCallback("DATA VOLATILE -> " + error);
-            return;  // Don't proceed if upload failed
-        }
+        std::string error;
         
         // Step 2: Copy from VOLATILE to non-volatile memory with the specified name
         // Strategy: According to manual, copying to an existing name overwrites it (no error).
@@ -679,19 +1850,15 @@ void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vec
             
             if (!userWaveforms.empty())
             {
-                // Delete the first user waveform to make room
-                std::string wfToDelete = userWaveforms[0];
+                // Delete a user waveform to make room
+                std::string wfToDelete = pickWaveformToEvict(userWaveforms);
                 if (logCallback)
                     logCallback("Deleting '" + wfToDelete + "' to free memory slot...");
                 
                 // Switch to built-in waveform first to avoid "can't delete active" error
-                write("FUNCtion:SHAPe SIN");
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                queryError();  // Clear
+                executeAndCheck("FUNCtion:SHAPe SIN");
                 
-                write("DATA:DELete " + wfToDelete);
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                std::string delError = queryError();
+                std::string delError = executeAndCheck("DATA:DELete " + wfToDelete);
                 if (logCallback)
                     logCallback("DATA:DELete " + wfToDelete + " -> " + delError);
             }
@@ -699,16 +1866,13 @@ void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vec
         
         // Now try to copy
         std::string copyCmd = "DATA:COPY " + name + ",VOLATILE";
-        write(copyCmd);
-        std::this_thread::sleep_for(std::chrono::milliseconds(200));  // Give more time
-        error = queryError();
+        error = executeAndCheck(copyCmd);
         
         if (logCallback)
             logCallback("DATA:COPY " + name + " error check: " + error);
         
         // Check if copy succeeded by verifying the waveform appears in catalog
         // This is more reliable than just checking the error response
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
         std::string verifyCatalog = query("DATA:NVOLatile:CATalog?");
         bool copyVerified = (verifyCatalog.find("\"" + upperName + "\"") != std::string::npos);
         
@@ -748,9 +1912,7 @@ void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vec
                                         catalog.find("\"" + upperName + "\"") != std::string::npos);
                 
                 // Switch to built-in waveform to allow deletion
-                write("FUNCtion:SIN");
-                std::this_thread::sleep_for(std::chrono::milliseconds(50));
-                queryError();  // Clear error
+                executeAndCheck("FUNCtion:SIN");  // Clears any error
                 
                 // Delete the target name first (if it exists, this frees its slot)
                 if (targetNameExists)
@@ -759,9 +1921,7 @@ void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vec
                         logCallback("Deleting existing waveform '" + name + "' to free its slot...");
                     
                     std::string deleteCmd = "DATA:DELete " + name;
-                    write(deleteCmd);
-                    std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                    std::string delError = queryError();
+                    std::string delError = executeAndCheck(deleteCmd);
                     
                     if (logCallback)
                         logCallback("DATA:DELete " + name + " -> " + delError);
@@ -772,13 +1932,8 @@ void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vec
                         if (logCallback)
                             logCallback("Waveform still active. Switching to SINE again...");
                         
-                        write("FUNCtion:SIN");
-                        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                        queryError();
-                        
-                        write(deleteCmd);
-                        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                        delError = queryError();
+                        executeAndCheck("FUNCtion:SIN");
+                        delError = executeAndCheck(deleteCmd);
                         
                         if (logCallback)
                             logCallback("DATA:DELete " + name + " (retry) -> " + delError);
@@ -827,15 +1982,13 @@ void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vec
                     
                     if (!userWaveforms.empty())
                     {
-                        // Delete the first user waveform found (preferably not the target name)
-                        std::string wfToDelete = userWaveforms[0];
+                        // Delete a user waveform to make room (preferably not the target name)
+                        std::string wfToDelete = pickWaveformToEvict(userWaveforms);
                         if (logCallback)
                             logCallback("Deleting waveform '" + wfToDelete + "' to free memory slot...");
                         
                         std::string deleteCmd = "DATA:DELete " + wfToDelete;
-                        write(deleteCmd);
-                        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                        std::string delError = queryError();
+                        std::string delError = executeAndCheck(deleteCmd);
                         
                         if (logCallback)
                             logCallback("DATA:DELete " + wfToDelete + " -> " + delError);
@@ -843,13 +1996,8 @@ void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vec
                         if (delError.find("+787") != std::string::npos)
                         {
                             // Still active - try switching again
-                            write("FUNCtion:SIN");
-                            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                            queryError();
-                            
-                            write(deleteCmd);
-                            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-                            delError = queryError();
+                            executeAndCheck("FUNCtion:SIN");
+                            delError = executeAndCheck(deleteCmd);
                             
                             if (logCallback)
                                 logCallback("DATA:DELete " + wfToDelete + " (retry) -> " + delError);
@@ -900,50 +2048,21 @@ void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vec
         // Re-upload to VOLATILE if needed (only if +780 error occurred)
         if (needReupload)
         {
-            // Re-send the VOLATILE upload command
-            status = viPrintf(sess, "%s\n", cmdStr.c_str());
-            
-            if (status != VI_SUCCESS)
-            {
-                if (logCallback)
-                    logCallback("ARB re-upload failed: VISA write error " + std::to_string(status));
-                return;
-            }
-            
-            if (viFlush) viFlush(sess, VI_FLUSH_ON_WRITE);
-            
-            // Give device time to process
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
-            error = queryError();
-            
-            if (logCallback)
-            {
-                if (error.find("No error") != std::string::npos || error.find("+0") != std::string::npos)
-                {
-                    logCallback("DATA VOLATILE (re-upload) -> [Uploaded " + std::to_string(finalData.size()) + " points]");
-                }
-                else
-                {
-                    logCallback("DATA VOLATILE (re-upload) -> " + error);
-                    return;  // Don't proceed if re-upload failed
-                }
-            }
+            // Re-send the VOLATILE upload
+            if (!sendVolatileData(finalData, "DATA VOLATILE (re-upload)", progress, report))
+                return;  // Don't proceed if re-upload failed
         }
         
         // If we deleted a waveform or re-uploaded, try copying again
         if (!copySucceeded && (error.find("+781") != std::string::npos || needReupload))
         {
             copyCmd = "DATA:COPY " + name + ",VOLATILE";
-            write(copyCmd);
-            std::this_thread::sleep_for(std::chrono::milliseconds(200));
-            error = queryError();
+            error = executeAndCheck(copyCmd);
             
             if (logCallback)
                 logCallback("DATA:COPY " + name + " (retry) error check: " + error);
             
             // Verify via catalog
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
             verifyCatalog = query("DATA:NVOLatile:CATalog?");
             copyVerified = (verifyCatalog.find("\"" + upperName + "\"") != std::string::npos);
             
@@ -990,22 +2109,28 @@ void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vec
             }
         }
         
-        // Step 3: Select the waveform
-        // If we're using VOLATILE, select VOLATILE instead of the named waveform
-        if (useVolatile)
+        // The catalog has the name - make sure it's this waveform under it and not an
+        // older one the copy didn't replace
+        if (!useVolatile)
         {
-            write("FUNCtion:USER VOLATILE");
-        }
-        else
-        {
-            write("FUNCtion:USER " + name);
+            const int stored = queryPointCount(name);
+            if (stored != report.pointsSent)
+            {
+                lastError = "DATA:COPY " + name + ": device holds " + std::to_string(stored) + " of " +
+                            std::to_string(report.pointsSent) + " points";
+                if (logCallback)
+                    logCallback("Error: " + lastError);
+                return;
+            }
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(50));
-        error = queryError();
+        
+        // Step 3: Select the waveform
+        // If we're using VOLATILE, select VOLATILE instead of the named waveform
+        error = executeAndCheck(useVolatile ? std::string("FUNCtion:USER VOLATILE") : "FUNCtion:USER " + name);
         
         if (logCallback)
         {
-            if (error.find("No error") != std::string::npos || error.find("+0") != std::string::npos)
+            if (isNoError(error))
             {
                 if (useVolatile)
                 {
@@ -1024,6 +2149,9 @@ void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vec
         
         // Step 4: Set shape to USER (optional but recommended)
         write("FUNCtion:SHAPe USER");
+        
+        report.nonVolatile = !useVolatile;
+        report.verified = true;
     }
     catch (const std::exception& e)
     {
@@ -1037,6 +2165,409 @@ void HP33120ADriver::downloadARBWaveform(const std::string& name, const std::vec
     }
 }
 
+// Uploads data to VOLATILE memory using arbTransferMode, then checks the error queue.
+// Binary failures (adapter can't pass raw blocks, or device rejects the block) fall back to ASCII.
+bool HP33120ADriver::sendVolatileData(const std::vector<float>& data, const std::string& logLabel,
+                                      const TransferProgress& progress, ARBUploadReport& report)
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    
+    bool sent = false;
+    bool usedBinary = false;
+    
+    if (arbTransferMode == ARBTransferMode::Binary)
+    {
+        usedBinary = true;
+        sent = sendVolatileBinary(data, progress, report.cancelled);
+        report.chunkResends += std::exchange(chunkResends, 0);
+        if (report.cancelled)
+        {
+            if (logCallback)
+                logCallback(logLabel + " -> cancelled");
+            return false;
+        }
+        if (!sent)
+        {
+            arbTransferMode = ARBTransferMode::ASCII;
+            if (logCallback)
+                logCallback("Binary ARB transfer failed (" + lastError + ") - falling back to ASCII for this session");
+        }
+    }
+    
+    if (!sent)
+    {
+        usedBinary = false;
+        sent = sendVolatileASCII(data, progress, report.cancelled);
+        report.chunkResends += std::exchange(chunkResends, 0);
+    }
+    
+    if (!sent)
+    {
+        if (logCallback)
+            logCallback("ARB upload failed: " + lastError);
+        return false;
+    }
+    
+    // Wait until the device has parsed and stored the data, then check the error queue
+    waitForOperationComplete(ARB_COMPLETION_TIMEOUT_MS);
+    std::string error = queryError();
+    
+    if (isNoError(error))
+        return confirmVolatile(data.size(), logLabel, usedBinary, report);
+    
+    if (usedBinary)
+    {
+        // Device didn't accept the binary block - retry the same data as ASCII
+        arbTransferMode = ARBTransferMode::ASCII;
+        if (logCallback)
+            logCallback(logLabel + " (binary) -> " + error + " - retrying as ASCII");
+        
+        const bool resent = sendVolatileASCII(data, progress, report.cancelled);
+        report.chunkResends += std::exchange(chunkResends, 0);
+        if (resent)
+        {
+            waitForOperationComplete(ARB_COMPLETION_TIMEOUT_MS);
+            error = queryError();
+            if (isNoError(error))
+                return confirmVolatile(data.size(), logLabel, false, report);
+        }
+        if (report.cancelled) return false;
+    }
+    
+    lastError = logLabel + ": " + error;
+    if (logCallback)
+        logCallback(logLabel + " -> " + error);
+    return false;
+}
+
+// A clean error queue only says nothing was rejected - a block cut short by the
+// adapter can still leave the parser with fewer points than were sent
+bool HP33120ADriver::confirmVolatile(size_t points, const std::string& logLabel, bool binary, ARBUploadReport& report)
+{
+    const int confirmed = queryPointCount("VOLATILE");
+    report.pointsConfirmed = confirmed;
+    
+    if (confirmed != (int)points)
+    {
+        lastError = logLabel + ": device holds " + std::to_string(confirmed) + " of " + std::to_string(points) + " points";
+        if (logCallback)
+            logCallback(logLabel + " -> " + lastError);
+        return false;
+    }
+    
+    lastError.clear();
+    if (logCallback)
+        logCallback(logLabel + " -> [Uploaded " + std::to_string(points) + " points" +
+                    (binary ? ", binary" : ", ASCII") + ", confirmed]");
+    return true;
+}
+
+int HP33120ADriver::queryPointCount(const std::string& name)
+{
+    std::string reply = query("DATA:ATTR:POIN? " + name);
+    const char* text = reply.c_str();
+    char* end = nullptr;
+    const double points = std::strtod(text, &end);  // "16000" or "+1.60000000E+04"
+    if (end == text || *end != '\0' || !(points >= 1.0))
+    {
+        drainErrorQueue();  // +785 for a name it doesn't have
+        return -1;
+    }
+    return (int)std::lround(points);
+}
+
+uint64_t HP33120ADriver::hashDACCodes(const std::vector<float>& points)
+{
+    // Count first, then each code as four little-endian bytes - ARBResidencyCache
+    // entries on disk were written with this layout
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](uint32_t value) {
+        for (int i = 0; i < 4; ++i)
+        {
+            hash ^= (value >> (i * 8)) & 0xFF;
+            hash *= 1099511628211ull;
+        }
+    };
+    
+    mix((uint32_t)points.size());
+    for (float point : points)
+    {
+        const float clamped = std::max(-1.0f, std::min(1.0f, point));
+        mix((uint32_t)(int32_t)std::lround(clamped * (float)DAC_FULL_SCALE));
+    }
+    return hash;
+}
+
+// DATA:DAC VOLATILE, #<n><len><int16 big-endian...>
+// 2 bytes per point and no float-to-text formatting
+bool HP33120ADriver::sendVolatileBinary(const std::vector<float>& data, const TransferProgress& progress, bool& cancelled)
+{
+    if (!viWrite)
+    {
+        lastError = "viWrite not available";
+        return false;
+    }
+    
+    flushCompoundLine();  // The binary block must not be appended to a queued compound line
+    
+    // Byte order is set once per connection - FORM:BORD NORM is big-endian (MSB first)
+    if (!byteOrderConfigured)
+    {
+        write("FORM:BORD NORM");
+        byteOrderConfigured = true;
+    }
+    
+    std::vector<unsigned char> block = encodeDACBlock(data);
+    return writeChunked(block.data(), block.size(), progress, cancelled);
+}
+
+std::vector<unsigned char> HP33120ADriver::encodeDACBlock(const std::vector<float>& data)
+{
+    const size_t payloadBytes = data.size() * 2;
+    const std::string lengthDigits = std::to_string(payloadBytes);
+    const std::string header = "DATA:DAC VOLATILE, #" + std::to_string(lengthDigits.size()) + lengthDigits;
+    
+    std::vector<unsigned char> block(header.size() + payloadBytes + 1);
+    std::copy(header.begin(), header.end(), block.begin());
+    
+    unsigned char* out = block.data() + header.size();
+    for (float val : data)
+    {
+        const float clamped = std::max(-1.0f, std::min(1.0f, val));
+        const int dac = (int)std::lround(clamped * (float)DAC_FULL_SCALE);
+        const unsigned short word = (unsigned short)(short)dac;
+        *out++ = (unsigned char)(word >> 8);
+        *out++ = (unsigned char)(word & 0xFF);
+    }
+    *out = '\n';
+    return block;
+}
+
+bool HP33120ADriver::writeVolatileFrame(const std::vector<unsigned char>& block, bool selectShape)
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    LongOperation longOperation(*this);
+    if (!connected || !viWrite || block.empty()) return false;
+    
+    if (arbTransferMode != ARBTransferMode::Binary)
+    {
+        lastError = "Wavetable frames need binary ARB transfers";
+        return false;
+    }
+    
+    if (!byteOrderConfigured)
+    {
+        write("FORM:BORD NORM");
+        byteOrderConfigured = true;
+    }
+    
+    bool cancelled = false;  // No progress callback, so nothing can cancel a frame
+    if (!writeChunked(block.data(), block.size(), nullptr, cancelled))
+        return false;
+    
+    // The 33120A copies a user waveform into waveform RAM when it's selected, so
+    // VOLATILE is re-selected after every frame. Deferred: errors are picked up by
+    // checkDeferredErrors(). Rewriting VOLATILE invalidates the shadow anyway, and
+    // clearing it here keeps the repeated selection from being dropped as a duplicate.
+    // The shape goes through the Waveform parameter so the shadow knows it's USER now.
+    invalidateShadowState();
+    sendCommand("FUNC:USER VOLATILE", ErrorCheckPolicy::Deferred);
+    if (selectShape)
+        setWaveform("USER");
+    return true;
+}
+
+// DATA VOLATILE, v1,v2,...,vN - fallback for adapters that can't pass binary blocks
+bool HP33120ADriver::sendVolatileASCII(const std::vector<float>& data, const TransferProgress& progress, bool& cancelled)
+{
+    if (!viPrintf && !viWrite)
+    {
+        lastError = "viPrintf not available";
+        return false;
+    }
+    
+    // Use std::ostringstream for efficient string building
+    std::ostringstream oss;
+    oss.imbue(std::locale("C"));  // Force C locale to ensure dot decimal separator
+    oss << std::fixed << std::setprecision(6);
+    oss << "DATA VOLATILE";
+    
+    // For very large datasets, yield periodically to keep system responsive
+    const size_t yieldInterval = 1000;  // Yield every 1000 points
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        oss << "," << data[i];
+        
+        if (i > 0 && (i % yieldInterval == 0) && data.size() > 5000)
+        {
+            std::this_thread::yield();
+        }
+    }
+    
+    std::string cmdStr = oss.str();
+    
+    // For very large commands, log a warning but proceed
+    if (cmdStr.length() > 100000 && logCallback)
+    {
+        logCallback("Warning: Large ARB command (" + std::to_string(cmdStr.length()) + " chars) - upload may take time");
+    }
+    
+    // Debug: Log first part of command to verify format
+    if (logCallback)
+    {
+        logCallback("ARB command start: " + cmdStr.substr(0, 100) + "...");
+    }
+    
+    // Chunked like the binary block when viWrite is there, so progress and cancel work too
+    if (viWrite)
+    {
+        cmdStr += '\n';
+        return writeChunked((const unsigned char*)cmdStr.data(), cmdStr.size(), progress, cancelled);
+    }
+    
+    ViSession sess = (ViSession)session;
+    
+    // Large waveform data (8000+ points, 100KB+ of command text) needs more time
+    if (viSetAttribute)
+        viSetAttribute((ViObject)sess, VI_ATTR_TMO_VALUE, 10000); // 10 second timeout for ARB upload
+    
+    // Use viPrintf like the Python code does - it handles large strings correctly
+    auto bus = lockBus();
+    ViStatus status = viPrintf(sess, "%s\n", cmdStr.c_str());
+    bus.unlock();
+    
+    if (viSetAttribute)
+        viSetAttribute((ViObject)sess, VI_ATTR_TMO_VALUE, 500); // Restore 500ms timeout
+    
+    if (status != VI_SUCCESS)
+    {
+        lastError = "VISA write error " + std::to_string(status);
+        return false;
+    }
+    
+    if (viFlush) viFlush(sess, VI_FLUSH_ON_WRITE);
+    return true;
+}
+
+bool HP33120ADriver::writeChunked(const unsigned char* bytes, size_t size, const TransferProgress& progress,
+                                  bool& cancelled)
+{
+    flushCompoundLine();
+    ViSession sess = (ViSession)session;
+    
+    if (viSetAttribute)
+        viSetAttribute((ViObject)sess, VI_ATTR_TMO_VALUE, ARB_CHUNK_TIMEOUT_MS);
+    
+    // Once bytes are out, a cancel needs device clear to get the parser out of the
+    // block - without viClear the block is finished and the upload stopped after it.
+    // With async I/O the check also runs while a chunk is in flight, aborting it.
+    // Let realtime traffic through now if the block would otherwise sit on top of it
+    waitForRealtimeGap(size);
+    const double blockStartMs = juce::Time::getMillisecondCounterHiRes();
+    
+    size_t sent = 0;
+    chunkResends = 0;
+    bool cancelRequested = false;
+    auto keepGoing = [&]() {
+        if (!cancelRequested && progress && !progress(sent, size)) cancelRequested = true;
+        return !(cancelRequested && viClear);
+    };
+    
+    ViStatus status = VI_SUCCESS;
+    bool started = false;
+    int retries = 0;  // Of the current chunk
+    while (sent < size)
+    {
+        keepGoing();
+        if (cancelRequested && (sent == 0 || viClear)) break;
+        
+        // The bus is held per chunk: END is withheld, so another unit on the same
+        // board can be addressed in between without ending this block. This driver's
+        // own commands wait on driverMutex, which the caller holds throughout.
+        const size_t count = std::min(ARB_CHUNK_BYTES, size - sent);
+        const bool last = (sent + count == size);
+        auto bus = lockBus();
+        if (viSetAttribute)
+            viSetAttribute((ViObject)sess, VI_ATTR_SEND_END_EN, last ? VI_TRUE : VI_FALSE);
+        
+        ViUInt32 written = 0;
+        started = true;
+        status = writeChunk(bytes + sent, (ViUInt32)count, written, keepGoing);
+        sent += written;
+        if (!viFailed(status) && written == (ViUInt32)count)
+        {
+            retries = 0;
+            continue;
+        }
+        
+        // The bytes that got through are part of the block in the parser's input, and
+        // END hasn't been sent, so the rest of the chunk can simply follow them
+        const bool retryable = status == VI_ERROR_TMO || status == VI_ERROR_IO || !viFailed(status);
+        if (cancelRequested || !retryable || retries == ARB_CHUNK_RETRIES) break;
+        
+        ++retries;
+        ++chunkResends;
+        if (logCallback)
+            logCallback("ARB chunk at byte " + std::to_string(sent) + " failed (VISA " + std::to_string(status) +
+                        ") - resending the rest of it (" + std::to_string(retries) + "/" +
+                        std::to_string(ARB_CHUNK_RETRIES) + ")");
+        if (bus.owns_lock()) bus.unlock();
+        juce::Thread::sleep(ARB_CHUNK_RETRY_DELAY_MS);
+        status = VI_SUCCESS;
+    }
+    telemetry.addBytesWritten(sent);
+    
+    if (viSetAttribute)
+    {
+        viSetAttribute((ViObject)sess, VI_ATTR_SEND_END_EN, VI_TRUE);
+        viSetAttribute((ViObject)sess, VI_ATTR_TMO_VALUE, 500); // Restore 500ms timeout
+    }
+    
+    if (cancelRequested)
+    {
+        cancelled = true;
+        
+        // Device clear (SDC on GPIB) drops the partial block from the input buffer.
+        // Without viClear the block went out whole and is simply not used.
+        if (started && viClear)
+        {
+            auto bus = lockBus();
+            viClear(sess);
+            bus.unlock();
+            drainErrorQueue();
+        }
+        lastError = "ARB transfer cancelled";
+        return false;
+    }
+    
+    if (viFailed(status) || sent != size)
+    {
+        lastError = "VISA write error " + std::to_string(status) +
+                    " (" + std::to_string(sent) + "/" + std::to_string(size) + " bytes)";
+        
+        // A chunk timed out or was aborted mid-block - clear the parser as for a cancel
+        if (started && sent > 0 && viClear)
+        {
+            auto bus = lockBus();
+            viClear(sess);
+            bus.unlock();
+            drainErrorQueue();
+        }
+        return false;
+    }
+    
+    // Throughput for the next waitForRealtimeGap() estimate - full chunks only, small writes are all overhead
+    const double elapsedMs = juce::Time::getMillisecondCounterHiRes() - blockStartMs;
+    telemetry.record(BusTelemetry::Metric::BlockTransfer, elapsedMs);
+    telemetry.addBlockBytes(size);
+    if (size >= ARB_CHUNK_BYTES && elapsedMs > 0.0)
+        blockBytesPerMs += ((double)size / elapsedMs - blockBytesPerMs) * BLOCK_RATE_SMOOTHING;
+    
+    if (progress) progress(size, size);
+    if (viFlush) viFlush(sess, VI_FLUSH_ON_WRITE);
+    return true;
+}
+
 std::vector<float> HP33120ADriver::queryARBWaveform(const std::string& /*name*/)
 {
     std::lock_guard<std::recursive_mutex> lock(driverMutex);
@@ -1046,24 +2577,45 @@ std::vector<float> HP33120ADriver::queryARBWaveform(const std::string& /*name*/)
     
     // HP33120A does not support querying ARB waveform data via SCPI
     // This command is not in the manual and would cause read errors
-    // Return empty - ARB data must be tracked manually in the plugin
+    // Return empty - uploads are checked by point count instead (ARBUploadReport)
+    // and ARBResidencyCache tracks what they contained
     
     return result;
 }
 
-bool HP33120ADriver::deleteARBWaveform(const std::string& /*name*/)
+std::string HP33120ADriver::pickWaveformToEvict(const std::vector<std::string>& userWaveforms)
+{
+    if (chooseWaveformToEvict)
+    {
+        std::string choice = chooseWaveformToEvict(userWaveforms);
+        if (std::find(userWaveforms.begin(), userWaveforms.end(), choice) != userWaveforms.end())
+            return choice;
+    }
+    return userWaveforms.front();
+}
+
+bool HP33120ADriver::deleteARBWaveform(const std::string& name)
 {
     std::lock_guard<std::recursive_mutex> lock(driverMutex);
-    if (!connected) return false;
+    if (!connected || name.empty()) return false;
     
-    // HP33120A doesn't have a DELETE command for ARBs
-    // The device has 4 memory slots, and uploading with the same name overwrites
-    // However, to be safe, we can try to clear it by uploading zeros or a minimal waveform
-    // But actually, the device will just overwrite when we upload a new ARB with the same name
-    // So we don't need to delete - just upload will overwrite
+    // DATA:DELete frees the name's non-volatile slot. The waveform that is playing
+    // can't be deleted (+787), so switch to a built-in shape and try once more.
+    std::string deleteCmd = "DATA:DELete " + name;
+    std::string error = executeAndCheck(deleteCmd);
     
-    // Return true to indicate "handled" (we'll overwrite on next upload)
-    return true;
+    if (error.find("+787") != std::string::npos)
+    {
+        executeAndCheck("FUNCtion:SHAPe SIN");
+        error = executeAndCheck(deleteCmd);
+    }
+    
+    if (logCallback)
+        logCallback(deleteCmd + " -> " + error);
+    
+    bool deleted = error.empty() || isNoError(error);
+    if (!deleted) lastError = "Delete failed: " + error;
+    return deleted;
 }
 
 std::vector<std::string> HP33120ADriver::listARBNames()
@@ -1072,6 +2624,20 @@ std::vector<std::string> HP33120ADriver::listARBNames()
     return queryWaveformCatalog();
 }
 
+bool HP33120ADriver::holdsWaveform(const std::string& name, int pointCount)
+{
+    std::lock_guard<std::recursive_mutex> lock(driverMutex);
+    if (!connected) return false;
+    
+    // NAME and POIN together - a front-panel delete and re-save under the same name
+    // still fails the point count most of the time
+    const auto catalog = queryWaveformCatalog();
+    const bool listed = std::any_of(catalog.begin(), catalog.end(), [&name](const std::string& entry) {
+        return juce::String(entry).equalsIgnoreCase(juce::String(name));
+    });
+    return listed && queryPointCount(name) == pointCount;
+}
+
 std::vector<std::string> HP33120ADriver::queryWaveformCatalog()
 {
     std::lock_guard<std::recursive_mutex> lock(driverMutex);
@@ -1152,9 +2718,6 @@ std::vector<std::string> HP33120ADriver::queryWaveformCatalog()
     return result;
 }
 
-// Live Updates (LFO)
-void HP33120ADriver::updateFrequencyLive(double freqHz) { setFrequency(freqHz); }
-void HP33120ADriver::updateAmplitudeLive(double ampVpp) { setAmplitude(ampVpp); }
-void HP33120ADriver::updateDutyCycleLive(double duty) { setDutyCycle(duty); }
-void HP33120ADriver::updateAMDepthLive(double depth) { setAMDepth(depth); }
-void HP33120ADriver::updateFMDevLive(double devHz) { setFMDeviation(devHz); }
\ No newline at end of file
+// Live Updates (LFO) - frequency/amplitude/duty are next to their setters
+void HP33120ADriver::updateAMDepthLive(double depth) { sendParameter(Parameters::DeviceParam::AMDepth, depth); }
+void HP33120ADriver::updateFMDevLive(double devHz) { sendParameter(Parameters::DeviceParam::FMDeviation, devHz); }
\ No newline at end of file
@@ -3,8 +3,18 @@
 #include <juce_core/juce_core.h>
 #include <string>
 #include <vector>
+#include <map>
+#include <string_view>
 #include <mutex>
 #include <functional>
+#include <memory>
+#include <atomic>
+#include <array>
+#include <optional>
+#include <cstdint>
+#include "ScpiLine.h"
+#include "BusTelemetry.h"
+#include "DeviceParameterTable.h"
 
 // VISA type definitions
 typedef unsigned short ViUInt16;
@@ -16,11 +26,27 @@ typedef void* ViSession;
 typedef char* ViRsrc;
 typedef char* ViString;
 typedef unsigned char* ViBuf;
+typedef ViUInt32 ViJobId;
+typedef ViUInt32 ViEventType;
+typedef ViObject ViEvent;
 
 // VISA constants
 const ViUInt32 VI_NULL = 0;
 const ViStatus VI_SUCCESS = 0;
 const ViUInt16 VI_FLUSH_ON_WRITE = 0x0002;
+const ViUInt32 VI_ATTR_TMO_VALUE = 0x3FFF001A;
+const ViUInt32 VI_ATTR_SEND_END_EN = 0x3FFF0016;
+const ViUInt32 VI_TRUE = 1;
+const ViUInt32 VI_FALSE = 0;
+const ViUInt16 VI_TRIG_PROT_DEFAULT = 0;
+const ViStatus VI_SUCCESS_SYNC = 0x3FFF009B;
+const ViStatus VI_ERROR_TMO = (ViStatus)0xBFFF0015;
+const ViStatus VI_ERROR_IO = (ViStatus)0xBFFF003E;
+const ViUInt32 VI_EVENT_IO_COMPLETION = 0x3FFF2009;
+const ViUInt16 VI_QUEUE = 1;
+const ViUInt16 VI_ALL_MECH = 0xFFFF;
+const ViUInt32 VI_ATTR_STATUS = 0x3FFF0025;
+const ViUInt32 VI_ATTR_RET_COUNT = 0x3FFF0026;
 
 class HP33120ADriver
 {
@@ -35,23 +61,174 @@ public:
     // Set to false to only log errors or use logVerbose() for specific commands
     bool verboseLogging = false;
     
+    // ARB upload encoding
+    // Binary: DATA:DAC VOLATILE as an IEEE 488.2 definite-length block (2 bytes per point)
+    // ASCII:  DATA VOLATILE as comma-separated floats (~10 bytes per point) - slow, but works on any adapter
+    // A failed binary transfer falls back to ASCII automatically for the rest of the session
+    enum class ARBTransferMode { Binary, ASCII };
+    ARBTransferMode arbTransferMode = ARBTransferMode::Binary;
+    
+    // Picks which user waveform to delete when non-volatile memory is full
+    // (called with the driver locked). Unset or an unknown name: the first one in the catalog.
+    std::function<std::string(const std::vector<std::string>& userWaveforms)> chooseWaveformToEvict;
+    
     // Connection
+    // The VISA library is loaded on the first connect, not at construction, and the
+    // default resource manager is shared by every driver in the process that uses the
+    // same library - opening it is what can take seconds (interface scan on some installs)
     bool connect(const std::string& resourceName = "GPIB0::10::INSTR");
     void disconnect();
     bool isConnected() const { return connected; }
+    bool isConnecting() const { return connecting.load(); }
+    const std::string& getResourceName() const { return resourceName; }
     std::string getLastError() const { return lastError; }
+    std::string getIDN() const;  // Read during connect and kept - "" if not connected
+    
+    // Connects on the driver's I/O worker: opens the session, reads *IDN? and, given a
+    // panel state, brings the instrument in line with it (syncState(), so only the
+    // differences are sent) - without it the state is read back to seed the shadow.
+    // onProgress is called on that worker for each stage; detail is the IDN once
+    // connected, the error on failure.
+    enum class ConnectStage { Opening, Identifying, SyncingState, Connected, Failed };
+    using ConnectCallback = std::function<void(ConnectStage stage, const std::string& detail)>;
+    void connectAsync(const std::string& resourceName, ConnectCallback onProgress,
+                      std::optional<std::array<double, Parameters::NUM_DEVICE_PARAMS>> initialState = std::nullopt);
     
     // Query device
     std::string queryIDN();
     std::string queryError();
     
+    // Runs the query on the driver's I/O worker and calls onReply there ("" on failure),
+    // so a caller such as the UI thread never waits behind an ARB upload
+    using QueryCallback = std::function<void(const std::string&)>;
+    void queryAsync(const std::string& cmd, QueryCallback onReply);
+    
+    // Command lanes. Each thread declares its lane once; anything undeclared (the
+    // message thread) is Interactive. While a bulk operation (ARB upload, wavetable
+    // frame) holds the driver, Realtime and Interactive writes from other threads are
+    // queued - latest value per header - instead of waiting, and the bulk operation
+    // sends them at each of its message boundaries, Realtime first. They're checked
+    // like deferred commands. Bulk-lane writes wait for the driver as before.
+    // Nothing can go inside a binary block, so a queued write waits for at most the
+    // block on the bus; the block itself is held back if it would overlap an
+    // announced realtime deadline (see announceRealtimeDeadline).
+    enum class CommandLane { Realtime, Interactive, Bulk };
+    static void setThreadLane(CommandLane lane);
+    static CommandLane getThreadLane();
+    
+    size_t getLiveLaneDepth() const;  // Queued Realtime + Interactive writes
+    bool isInLongOperation() const { return longOperations.load() > 0; }
+    
+    // Time (getMillisecondCounterHiRes) of the next realtime write the caller knows
+    // about, 0 for none. A binary block that would still be on the bus then starts
+    // after it instead, waiting at most MAX_BULK_DEFER_MS.
+    void announceRealtimeDeadline(double atMs) { nextRealtimeDeadlineMs.store(atMs); }
+    
+    // viWriteAsync/viWaitOnEvent available: ARB chunks are written asynchronously and a
+    // cancel or timeout aborts the chunk on the bus instead of waiting it out
+    bool hasAsyncIO() const { return asyncEventsEnabled; }
+    
+    // Units on the same physical interface (GPIB board, serial port) share one bus lock so
+    // only one transaction is on that bus at a time; units on other interfaces run in parallel
+    void setBusMutex(std::shared_ptr<std::recursive_mutex> mutex);
+    static std::string interfaceKey(const std::string& resource);
+    
+    // Bus triggering (TRIG:SOUR BUS) - burst/sweep setups are staged, then fired together
+    bool assertTrigger();  // Addressed GET via viAssertTrigger on GPIB, *TRG elsewhere
+    bool sendGroupTrigger(const std::vector<int>& listenerAddresses);  // One GET to several units on this unit's GPIB board
+    int getGpibAddress() const { return gpibAddressOf(resourceName); }  // Primary address, -1 if this isn't a GPIB resource
+    static int gpibAddressOf(const std::string& resourceName);
+    
+    // Portamento rendered by the instrument: one logarithmic sweep from the frequency it is
+    // at to toHz, fired with *TRG on TRIG:SOUR BUS - one compound line per glide instead
+    // of a stream of FREQ steps. A glide started mid-glide starts from where the sweep has
+    // got to. Returns false, having just set the frequency, if the starting frequency isn't
+    // known, a modulation mode is on or might be, the shape can't sweep, or an ARB transfer
+    // holds the driver. serviceGlide() at getGlideEndMs() lands on the target and puts the
+    // sweep and trigger settings back; setting the frequency mid-glide lands there at once.
+    static constexpr double MIN_GLIDE_MS = 1.0;  // SWE:TIME minimum
+    bool startGlide(double toHz, double durationMs);
+    bool serviceGlide(double nowMs);  // false: held up by a bulk transfer - call again
+    bool isGliding() const { return gliding.load(); }
+    double getGlideEndMs() const { return glideEndMs.load(); }
+    
+    // Completion waiting (*OPC?) - returns as soon as the device has finished all pending operations
+    bool waitForOperationComplete(int timeoutMs = OPC_TIMEOUT_MS);
+    std::string executeAndCheck(const std::string& cmd, int timeoutMs = OPC_TIMEOUT_MS);  // Send, wait, return SYST:ERR?
+    
+    // Deferred error checking
+    // Commands sent inside a batch are not followed by SYST:ERR?. At the end of the
+    // outermost batch one *ESR? tells whether any failed; only then is the error
+    // queue drained and the errors logged against the batch's commands.
+    void beginBatch();
+    void endBatch();
+    bool checkDeferredErrors();  // Also catches writeFast() errors outside a batch
+    
+    // Called (driver locked, on the sending thread) when the first command since the
+    // last checkDeferredErrors() goes out, so a worker can schedule the check instead
+    // of polling for it. Keep it cheap.
+    void setUncheckedCommandHook(std::function<void()> hook);
+    
+    // Write/read/error-check/ARB block timings and byte counts (see BusTelemetry.h).
+    // Lock-free - callers outside the driver (queue wait) record into it directly.
+    BusTelemetry& getTelemetry() { return telemetry; }
+    
+    // Inside a batch, deferred commands are joined with ";:" and sent as one write
+    // (flushed when the line would overflow the input buffer, before any query, and at batch end)
+    bool coalesceBatches = true;
+    
+    // Shadow state - writes that repeat what the device already has are dropped
+    // Cleared on connect, *RST/*RCL/APPL, ARB operations, write failures and device errors
+    bool shadowCacheEnabled = true;
+    void invalidateShadowState();
+    
+    // State recall - project load and reconnect
+    // readBackState() asks for every table parameter in a few compound queries (each
+    // within the input buffer) and seeds the shadow state with the answers; settings
+    // it couldn't read stay unknown. syncState() then sends, in one batch, only the
+    // parameters whose value differs from the instrument's, and returns how many.
+    bool readBackState();
+    int syncState(const std::array<double, Parameters::NUM_DEVICE_PARAMS>& values);
+    
+    // Stored states (*SAV/*RCL 1..3 - register 0 is overwritten at power-down)
+    // If the driver knows the register holds exactly these values - it saved them there
+    // itself since connecting - a single *RCL switches the whole panel. Otherwise it
+    // falls back to syncState() and then saves the result, so the next recall is instant.
+    // Returns the number of commands sent.
+    static constexpr int NUM_STATE_REGISTERS = 3;
+    int recallStateRegister(int stateRegister, const std::array<double, Parameters::NUM_DEVICE_PARAMS>& values);
+    
+    // RAII batch - also holds the driver lock so other threads can't interleave
+    class ScopedErrorBatch
+    {
+    public:
+        explicit ScopedErrorBatch(HP33120ADriver& d) : driver(d), lock(d.driverMutex, std::defer_lock)
+        {
+            // During a long operation the batch's commands go to the live lane instead of waiting
+            if (!lock.try_lock() && (d.longOperations.load() == 0 || getThreadLane() == CommandLane::Bulk)) lock.lock();
+            if (lock.owns_lock()) driver.beginBatch();
+        }
+        ~ScopedErrorBatch() { if (lock.owns_lock()) driver.endBatch(); }
+    private:
+        HP33120ADriver& driver;
+        std::unique_lock<std::recursive_mutex> lock;
+    };
+    
+    static constexpr int OPC_TIMEOUT_MS = 2000;
+    static constexpr int ARB_COMPLETION_TIMEOUT_MS = 10000;  // 16k-point ASCII parse can take several seconds
+    
     // --- NEW: Atomic Apply Command (Per Manual Page 138) ---
     // This is the critical fix for MIDI notes. It sends Freq/Amp/Offset in one shot.
     void applyWaveform(const std::string& shape, double freq, double amp, double offset);
 
+    // Any device parameter, clamped, rounded and formatted from DeviceParameterTable.
+    // Moves the modulation base too, for the parameters that have one.
+    void setParameter(Parameters::DeviceParam param, double value);
+    std::atomic<double>* baseValueFor(Parameters::DeviceParam param);  // nullptr if it has none
+    
     // Basic SCPI commands
     void setWaveform(const std::string& waveform);
-    void setUserWaveform(const std::string& name);  // Select specific ARB waveform by name AND change to USER shape
+    bool setUserWaveform(const std::string& name);  // Select specific ARB waveform by name AND change to USER shape; false on a device error
     void selectUserWaveform(const std::string& name);  // Just select which ARB is active (doesn't change shape)
     void setFrequency(double freqHz);
     void setAmplitude(double ampVpp);
@@ -101,38 +278,211 @@ public:
     void setTriggerSource(const std::string& source);
     
     // ARB Operations
-    void downloadARBWaveform(const std::string& name, const std::vector<float>& data, int maxPoints = 16000);
-    std::vector<float> queryARBWaveform(const std::string& name);  // Returns empty if not supported
-    bool deleteARBWaveform(const std::string& name);  // Try SCPI DELETE, return success
+    // Called between chunks of the VOLATILE block with (bytes sent, total bytes); return
+    // false to abandon the upload. Runs on the uploading thread with the driver locked.
+    using TransferProgress = std::function<bool(size_t, size_t)>;
+    struct ARBUploadReport;
+    ARBUploadReport downloadARBWaveform(const std::string& name, const std::vector<float>& data, int maxPoints = 16000,
+                                        const TransferProgress& progress = nullptr);
+    
+    // What the instrument confirmed about a downloadARBWaveform(). The 33120A
+    // can't send points back, so an upload is verified when DATA:ATTR:POIN? reports the
+    // point count that was sent - for VOLATILE after the block, and for the name after
+    // DATA:COPY, which must also be in the catalog. payloadHash identifies the DAC codes
+    // actually sent (see hashDACCodes()), which differ from the caller's if they had to
+    // be padded or normalized.
+    struct ARBUploadReport
+    {
+        bool verified = false;
+        bool nonVolatile = false;    // false: only VOLATILE holds it (copy failed, memory full)
+        int pointsSent = 0;
+        int pointsConfirmed = -1;    // -1: the device didn't report a count
+        uint64_t payloadHash = 0;
+        int chunkResends = 0;        // Chunks resumed after a timeout or I/O error
+        bool cancelled = false;      // By the progress callback - VOLATILE overwritten, nothing copied
+    };
+    
+    // FNV-1a over the 12-bit DAC codes of [-1, +1] points, as encodeDACBlock() sends them
+    static uint64_t hashDACCodes(const std::vector<float>& points);
+    
+    // Wavetable frames: a block from encodeDACBlock() written to VOLATILE and re-selected,
+    // without the *OPC?/SYST:ERR? round trips of downloadARBWaveform - call
+    // checkDeferredErrors() every so often instead. Binary transfer mode only.
+    static std::vector<unsigned char> encodeDACBlock(const std::vector<float>& data);  // "DATA:DAC VOLATILE, #..." + '\n'
+    bool writeVolatileFrame(const std::vector<unsigned char>& block, bool selectShape);
+    std::vector<float> queryARBWaveform(const std::string& name);  // Always empty - see ARBUploadReport
+    bool deleteARBWaveform(const std::string& name);  // DATA:DEL, switching off the waveform first if it's playing
     std::vector<std::string> listARBNames();  // Query device for ARB names (if supported)
     std::vector<std::string> queryWaveformCatalog();  // Query DATA:CATalog? to get all available waveforms
+    bool holdsWaveform(const std::string& name, int pointCount);  // In the catalog, with that many points
     
-    // Live updates for LFO
+    // Live updates for LFO - send a modulated value, base* stays where the setter put it
     void updateFrequencyLive(double freqHz);
     void updateAmplitudeLive(double ampVpp);
     void updateDutyCycleLive(double duty);
     void updateAMDepthLive(double depth);
     void updateFMDevLive(double devHz);
     
-    // Base parameters for LFO
-    double baseFreq = 1000.0;
-    double baseAmp = 1.0;
-    double baseOffset = 0.0;
-    double baseDuty = 50.0;
-    double baseAMDepth = 50.0;
-    double baseFMDev = 100.0;
+    // Base parameters for LFO - set by the command thread, the MIDI scheduler and state
+    // sync, read by the modulation engine, so atomic
+    std::atomic<double> baseFreq { 1000.0 };
+    std::atomic<double> baseAmp { 1.0 };
+    std::atomic<double> baseOffset { 0.0 };
+    std::atomic<double> baseDuty { 50.0 };
+    std::atomic<double> baseAMDepth { 50.0 };
+    std::atomic<double> baseFMDev { 100.0 };
     
 private:
     void write(const std::string& cmd);
-    void writeFast(const std::string& cmd);  // Fast write without error checking - for real-time slider updates
+    void writeFast(const std::string& cmd);  // Fast write with deferred error checking - for real-time slider updates
     std::string query(const std::string& cmd);
     
-    // Mutex for thread safety (UI vs MIDI)
+    // Allocation-free table-driven writes: "<header> <argument>" formatted into a ScpiLine on the stack
+    void sendParameter(Parameters::DeviceParam param, double value);
+    void sendChoice(Parameters::DeviceParam param, const std::string& name);  // Unlisted names go out as text
+    
+    enum class ErrorCheckPolicy { Immediate, Deferred, None };
+    void sendCommand(std::string_view cmd, ErrorCheckPolicy policy, int shadowParam = -1, double shadowValue = 0.0);
+    std::vector<std::string> drainErrorQueue();
+    
+    // Compound-line coalescing for batches
+    ViStatus transmitLine(std::string_view line);  // Single write of line + '\n', no error check
+    void appendToCompoundLine(std::string_view cmd);
+    void flushCompoundLine();
+    std::string compoundLine;
+    int compoundLineCommands = 0;
+    static constexpr size_t MAX_COMPOUND_LINE_LENGTH = 128;  // Stay within the 33120A input buffer
+    
+    // Shadow state: table parameters by index, as the wire value (NaN: unknown), anything
+    // else as canonical header -> last argument sent. Text commands for a table header
+    // are parsed into the array, so each setting has exactly one record.
+    bool updateShadowState(std::string_view cmd, ErrorCheckPolicy policy);
+    bool updateShadowParam(int param, double wireValue);
+    void forgetCoupledSettings(Parameters::DeviceParam changed);  // Settings the device may have re-clamped
+    static constexpr double MAX_PEAK_VOLTS = 5.0;  // Vpp/2 + |offset|, into 50 ohms
+    void clearShadowState();
+    std::map<std::string, std::string, std::less<>> shadowState;
+    std::array<double, Parameters::NUM_DEVICE_PARAMS> shadowParams;
+    
+    // What each *SAV register holds, as wire values - only known for registers saved
+    // since connecting (someone else may have used them while we were away)
+    std::array<std::array<double, Parameters::NUM_DEVICE_PARAMS>, NUM_STATE_REGISTERS + 1> registerContents {};
+    std::array<bool, NUM_STATE_REGISTERS + 1> registerKnown {};
+    std::array<double, Parameters::NUM_DEVICE_PARAMS> toWireState(const std::array<double, Parameters::NUM_DEVICE_PARAMS>& values) const;
+    
+    // Glide in progress - the atomics are read without the driver lock, the rest is
+    // driver locked. glideRestore holds GLIDE_SETTINGS (wire values) as the panel has
+    // them: taken when the glide starts, updated by setParameter() while it runs.
+    bool canSweep() const;
+    double glideFrequencyAt(double nowMs) const;
+    bool finishGlide();
+    std::atomic<bool> gliding { false };
+    std::atomic<double> glideTargetHz { 0.0 };
+    std::atomic<double> glideEndMs { 0.0 };
+    double glideFromHz = 0.0;
+    double glideStartMs = 0.0;
+    static constexpr std::array<Parameters::DeviceParam, 5> GLIDE_SETTINGS = {
+        Parameters::DeviceParam::SweepEnabled, Parameters::DeviceParam::SweepStart, Parameters::DeviceParam::SweepStop,
+        Parameters::DeviceParam::SweepTime, Parameters::DeviceParam::TriggerSource };
+    std::array<std::atomic<double>, GLIDE_SETTINGS.size()> glideRestore {};
+    static int glideSettingIndex(Parameters::DeviceParam param);  // In GLIDE_SETTINGS, -1 if not
+    
+    // Commands sent since the last error check, numbered for attribution.
+    // Fixed-size records (long commands are truncated) so recording never allocates.
+    struct SentCommand
+    {
+        uint32_t sequence = 0;
+        size_t length = 0;
+        char command[64];
+        std::string text() const { return std::string(command, length); }
+    };
+    std::vector<SentCommand> uncheckedCommands;
+    std::vector<SentCommand> checkingCommands;  // Swapped with uncheckedCommands during a check
+    size_t droppedUncheckedCommands = 0;
+    std::function<void()> uncheckedCommandHook;
+    BusTelemetry telemetry;
+    uint32_t commandSequence = 0;
+    int batchDepth = 0;
+    static constexpr size_t MAX_UNCHECKED_COMMANDS = 64;
+    
+    // *ESR? bits: query error, device error, execution error, command error
+    static constexpr int ESR_ERROR_BITS = 0x3C;
+    
+    // ARB upload helpers - send data to VOLATILE memory and check the device accepted it
+    void uploadARB(const std::string& name, const std::vector<float>& data, int maxPoints,
+                   const TransferProgress& progress, ARBUploadReport& report);  // downloadARBWaveform() body
+    bool sendVolatileData(const std::vector<float>& data, const std::string& logLabel, const TransferProgress& progress,
+                          ARBUploadReport& report);
+    bool sendVolatileBinary(const std::vector<float>& data, const TransferProgress& progress, bool& cancelled);
+    bool sendVolatileASCII(const std::vector<float>& data, const TransferProgress& progress, bool& cancelled);
+    bool confirmVolatile(size_t points, const std::string& logLabel, bool binary, ARBUploadReport& report);
+    int queryPointCount(const std::string& name);  // DATA:ATTR:POIN?, -1 if there's no such waveform
+    
+    // One message written in ARB_CHUNK_BYTES pieces, END asserted only on the last,
+    // so progress can be reported and a cancel honoured between pieces. A piece that
+    // times out or fails partway is resumed where the device stopped taking bytes, up
+    // to ARB_CHUNK_RETRIES times, instead of abandoning the whole block. Sets cancelled
+    // when the progress callback stopped it.
+    bool writeChunked(const unsigned char* bytes, size_t size, const TransferProgress& progress, bool& cancelled);
+    static constexpr size_t ARB_CHUNK_BYTES = 1024;
+    int chunkResends = 0;  // By writeChunked(), until sendVolatileData() adds them to the report
+    static constexpr int ARB_CHUNK_RETRIES = 3;
+    static constexpr int ARB_CHUNK_RETRY_DELAY_MS = 20;  // Lets a USB-GPIB adapter recover
+    
+    // One chunk through viWriteAsync when available, waited for in ASYNC_WAIT_SLICE_MS
+    // slices; keepGoing() returning false aborts it (viTerminate)
+    ViStatus writeChunk(const unsigned char* bytes, ViUInt32 count, ViUInt32& written, const std::function<bool()>& keepGoing);
+    static bool viFailed(ViStatus status) { return ((uint32_t)status & 0x80000000u) != 0; }
+    bool asyncEventsEnabled = false;
+    static constexpr int ASYNC_WAIT_SLICE_MS = 20;
+    static constexpr int ARB_CHUNK_TIMEOUT_MS = 10000;
+    
+    // Command lanes (see CommandLane)
+    std::unique_lock<std::recursive_mutex> lockOrDefer(std::string_view cmd);  // Not owning: cmd was queued
+    void serviceLiveLane();  // Driver locked
+    void queueLive(std::string_view cmd);  // liveLaneMutex held
+    void endLongOperation();  // Driver locked
+    void waitForRealtimeGap(size_t blockBytes);  // Before a block that can't be preempted
+    struct LongOperation
+    {
+        explicit LongOperation(HP33120ADriver& d) : driver(d) { ++driver.longOperations; }
+        ~LongOperation() { driver.endLongOperation(); }
+        HP33120ADriver& driver;
+    };
+    std::atomic<int> longOperations { 0 };
+    mutable std::mutex liveLaneMutex;
+    std::array<std::vector<std::string>, 2> liveLanes;  // Realtime, Interactive
+    bool servicingLiveLane = false;
+    std::atomic<double> nextRealtimeDeadlineMs { 0.0 };
+    double blockBytesPerMs = DEFAULT_BLOCK_BYTES_PER_MS;  // EMA of binary block throughput
+    static constexpr size_t MAX_LIVE_LANE = 64;  // Per lane
+    static constexpr double DEFAULT_BLOCK_BYTES_PER_MS = 50.0;
+    static constexpr double REALTIME_GUARD_MS = 2.0;
+    static constexpr double MAX_BULK_DEFER_MS = 250.0;
+    static constexpr double BLOCK_RATE_SMOOTHING = 0.3;
+    std::string pickWaveformToEvict(const std::vector<std::string>& userWaveforms);
+    
+    // HP33120A DAC range for DATA:DAC (12-bit signed)
+    static constexpr int DAC_FULL_SCALE = 2047;
+    
+    // FORM:BORD is sent once per connection, before the first binary transfer
+    bool byteOrderConfigured = false;
+    bool lateReplyPending = false;  // *OPC? timed out without viClear - its reply is still to come
+    
+    // Mutex for thread safety (UI vs MIDI) - per driver, so other units never wait on it
     mutable std::recursive_mutex driverMutex;
     
-    bool connected = false;
-    void* rm = nullptr;  // VISA Resource Manager
+    std::shared_ptr<std::recursive_mutex> busMutex;  // Null when this unit has its interface to itself
+    std::unique_lock<std::recursive_mutex> lockBus();
+    
+    std::atomic<bool> connected { false };  // Read by the audio thread
+    std::atomic<bool> connecting { false };  // connectAsync() in progress
+    std::string idn;
+    mutable std::mutex idnMutex;  // Not driverMutex - the editor reads the IDN during long transfers
+    void* rm = nullptr;  // VISA Resource Manager - shared, see acquireResourceManager()
+    void* rmKey = nullptr;  // Which shared resource manager rm is
     void* session = nullptr;  // VISA Session
+    void* interfaceSession = nullptr;  // "<board>::INTFC", opened on the first group trigger
     std::string resourceName;
     std::string lastError;
     
@@ -146,6 +496,15 @@ private:
     typedef int (*ViScanf)(ViSession, ViString, ...);
     typedef ViStatus (*ViSetAttribute)(ViObject, ViUInt32, ViUInt32);
     typedef ViStatus (*ViFlush)(ViSession, ViUInt16);
+    typedef ViStatus (*ViAssertTrigger)(ViSession, ViUInt16);
+    typedef ViStatus (*ViGpibCommand)(ViSession, ViBuf, ViUInt32, ViUInt32*);
+    typedef ViStatus (*ViClear)(ViSession);
+    typedef ViStatus (*ViWriteAsync)(ViSession, ViBuf, ViUInt32, ViJobId*);
+    typedef ViStatus (*ViWaitOnEvent)(ViSession, ViEventType, ViUInt32, ViEventType*, ViEvent*);
+    typedef ViStatus (*ViEnableEvent)(ViSession, ViEventType, ViUInt16, ViUInt32);
+    typedef ViStatus (*ViDisableEvent)(ViSession, ViEventType, ViUInt16);
+    typedef ViStatus (*ViGetAttribute)(ViObject, ViUInt32, void*);
+    typedef ViStatus (*ViTerminate)(ViObject, ViUInt16, ViJobId);
     
     void* visaLib = nullptr;
     ViOpenDefaultRM viOpenDefaultRM = nullptr;
@@ -157,7 +516,26 @@ private:
     ViScanf viScanf = nullptr;
     ViSetAttribute viSetAttribute = nullptr;
     ViFlush viFlush = nullptr;
+    ViAssertTrigger viAssertTrigger = nullptr;  // Optional
+    ViGpibCommand viGpibCommand = nullptr;      // Optional
+    ViClear viClear = nullptr;                  // Optional
+    ViWriteAsync viWriteAsync = nullptr;        // Optional - async I/O needs all of these
+    ViWaitOnEvent viWaitOnEvent = nullptr;
+    ViEnableEvent viEnableEvent = nullptr;
+    ViDisableEvent viDisableEvent = nullptr;
+    ViGetAttribute viGetAttribute = nullptr;
+    ViTerminate viTerminate = nullptr;
     
     bool loadVISALibrary();
-    void unloadVISALibrary();
+    void unloadVISALibrary();  // Also clears the function pointers
+    
+    // The process-wide default resource manager for the loaded VISA implementation,
+    // opened by its first user and closed by its last (closing it closes every session
+    // opened through it)
+    ViStatus acquireResourceManager(ViSession* resourceManager);
+    void releaseResourceManager();
+    void useSimulatedVISA();   // SimulatedVISA in place of the library, for "SIM..." resources
+    bool usingSimulatedVISA = false;
+    
+    juce::ThreadPool ioPool { 1 };  // queryAsync(), connectAsync() - one thread keeps them in order
 };
\ No newline at end of file
@@ -0,0 +1,524 @@
+#include "InstrumentPool.h"
+#include <cmath>
+
+InstrumentPool::InstrumentPool(HP33120ADriver& primaryDriver)
+    : primary(primaryDriver)
+{
+    voiceNote.fill(-1);
+    voiceChannel.fill(-1);
+    triggerAddresses.reserve(MAX_UNITS);
+    rebuildTriggerGroups();
+    committer.startThread();
+}
+
+InstrumentPool::~InstrumentPool()
+{
+    committer.stopCommitter();  // Commits address the units below
+    disconnectUnits();
+
+    for (auto& unit : units)
+        if (unit) unit->stopWorker();
+}
+
+// ============================================================================
+// CONNECTION (message thread)
+// ============================================================================
+std::shared_ptr<std::recursive_mutex> InstrumentPool::busMutexFor(const std::string& resourceName)
+{
+    auto& mutex = busMutexes[HP33120ADriver::interfaceKey(resourceName)];
+    if (!mutex) mutex = std::make_shared<std::recursive_mutex>();
+    return mutex;
+}
+
+void InstrumentPool::attachPrimary(const std::string& resourceName)
+{
+    primary.setBusMutex(busMutexFor(resourceName));
+    {
+        std::lock_guard<std::mutex> lock(triggerGroupsMutex);
+        primaryResource = resourceName;
+    }
+    rebuildTriggerGroups();
+}
+
+InstrumentPool::Unit& InstrumentPool::prepareUnit(int index, const std::string& resourceName)
+{
+    auto& unit = units[(size_t)index];
+    if (!unit)
+    {
+        unit = std::make_unique<Unit>();
+        unit->startThread();
+    }
+    bindUnitLog(index);
+
+    // The bus lock has to be in place before the first transaction on a shared interface
+    unit->driver.setBusMutex(busMutexFor(resourceName));
+    return *unit;
+}
+
+void InstrumentPool::bindUnitLog(int index)
+{
+    units[(size_t)index]->driver.logCallback = [this, index](const std::string& message) {
+        if (primary.logCallback) primary.logCallback("[Unit " + std::to_string(index) + "] " + message);
+    };
+}
+
+bool InstrumentPool::addUnit(const std::string& resourceName)
+{
+    int index = numUnits.load();
+    if (index >= MAX_UNITS)
+    {
+        if (primary.logCallback)
+            primary.logCallback("Instrument pool full (" + std::to_string(MAX_UNITS) + " units) - ignoring " + resourceName);
+        return false;
+    }
+
+    Unit& unit = prepareUnit(index, resourceName);
+    if (!unit.driver.connect(resourceName))
+    {
+        if (primary.logCallback)
+            primary.logCallback("Unit " + std::to_string(index) + ": connection failed to " + resourceName
+                                + " - " + unit.driver.getLastError());
+        return false;
+    }
+
+    numUnits.store(index + 1, std::memory_order_release);
+    rebuildTriggerGroups();
+    return true;
+}
+
+int InstrumentPool::connectUnits(const std::vector<std::string>& resourceNames, const StateSyncRequest::Values& values,
+                                 UnitProgress onProgress)
+{
+    disconnectUnits();  // numUnits is 1 from here on, so no other thread addresses the slots below
+
+    const int count = juce::jmin((int)resourceNames.size(), MAX_UNITS - 1);
+    if ((int)resourceNames.size() > count && primary.logCallback)
+        primary.logCallback("Instrument pool full (" + std::to_string(MAX_UNITS) + " units) - ignoring "
+                            + std::to_string(resourceNames.size() - (size_t)count) + " more");
+    if (count <= 0) return 0;
+
+    // Shared with the workers' callbacks; each reports Connected or Failed exactly once
+    struct Outcome
+    {
+        std::array<std::atomic<bool>, MAX_UNITS> connected {};
+        std::atomic<int> remaining { 0 };
+        juce::WaitableEvent done;
+    };
+    auto outcome = std::make_shared<Outcome>();
+    outcome->remaining = count;
+
+    for (int i = 0; i < count; ++i)
+    {
+        const int index = i + 1;
+        Unit& unit = prepareUnit(index, resourceNames[(size_t)i]);
+        unit.driver.connectAsync(resourceNames[(size_t)i],
+            [this, outcome, index, onProgress](HP33120ADriver::ConnectStage stage, const std::string& detail)
+            {
+                if (onProgress) onProgress(index, stage, detail);
+                if (stage != HP33120ADriver::ConnectStage::Connected && stage != HP33120ADriver::ConnectStage::Failed)
+                    return;
+
+                if (stage == HP33120ADriver::ConnectStage::Failed && primary.logCallback)
+                    primary.logCallback("Unit " + std::to_string(index) + ": connection failed - " + detail);
+                outcome->connected[(size_t)index] = stage == HP33120ADriver::ConnectStage::Connected;
+                if (--outcome->remaining == 0) outcome->done.signal();
+            },
+            values);
+    }
+    outcome->done.wait();
+
+    // Close ranks over the units that failed, so 1..numUnits-1 are all connected
+    int published = 1;
+    for (int index = 1; index <= count; ++index)
+    {
+        if (!outcome->connected[(size_t)index]) continue;
+        if (index != published)
+        {
+            std::swap(units[(size_t)index], units[(size_t)published]);
+            bindUnitLog(published);
+            if (units[(size_t)index]) bindUnitLog(index);
+        }
+        ++published;
+    }
+
+    numUnits.store(published, std::memory_order_release);
+    rebuildTriggerGroups();
+    return published - 1;
+}
+
+void InstrumentPool::disconnectUnits()
+{
+    int count = numUnits.exchange(1);
+
+    for (int i = 1; i < count; ++i)
+        if (units[(size_t)i]) units[(size_t)i]->driver.disconnect();
+
+    voicesStale.store(true, std::memory_order_release);  // The audio thread owns the voice state
+    rebuildTriggerGroups();
+}
+
+HP33120ADriver* InstrumentPool::getDriver(int unit)
+{
+    if (unit == 0) return &primary;
+    if (unit > 0 && unit < getNumUnits()) return &units[(size_t)unit]->driver;
+    return nullptr;
+}
+
+// ============================================================================
+// PARAMETER UPDATES (any thread)
+// ============================================================================
+void InstrumentPool::queueUpdate(int unit, Parameters::DeviceParam param, double value)
+{
+    jassert(unit > 0);
+    if (unit > 0 && unit < getNumUnits())
+        units[(size_t)unit]->queueUpdate(param, value);
+}
+
+void InstrumentPool::mirror(Parameters::DeviceParam param, double value)
+{
+    int count = getNumUnits();
+    for (int i = 1; i < count; ++i)
+        units[(size_t)i]->queueUpdate(param, value);
+}
+
+void InstrumentPool::queueGlide(int unit, double freqHz, double glideMs)
+{
+    jassert(unit > 0);
+    if (unit > 0 && unit < getNumUnits())
+        units[(size_t)unit]->queueGlide(freqHz, glideMs);
+}
+
+void InstrumentPool::mirrorGlide(double freqHz, double glideMs)
+{
+    int count = getNumUnits();
+    for (int i = 1; i < count; ++i)
+        units[(size_t)i]->queueGlide(freqHz, glideMs);
+}
+
+void InstrumentPool::syncState(const StateSyncRequest::Values& values, int stateRegister)
+{
+    int count = getNumUnits();
+    for (int i = 1; i < count; ++i)
+        units[(size_t)i]->requestStateSync(values, stateRegister);
+}
+
+// ============================================================================
+// SYNCHRONIZED COMMIT
+// ============================================================================
+void InstrumentPool::queueTrigger(int unit)
+{
+    if (unit > 0 && unit < getNumUnits())
+        units[(size_t)unit]->queueTrigger();
+}
+
+void InstrumentPool::requestBusTrigger()
+{
+    committer.request();
+}
+
+bool InstrumentPool::commitBusTrigger(int stageTimeoutMs)
+{
+    int count = getNumUnits();
+    
+    // Staged: whatever the workers still hold was meant to be in place when this fires.
+    // Out of time, it fires anyway - a note late everywhere is worse than one unit off.
+    const double deadline = juce::Time::getMillisecondCounterHiRes() + stageTimeoutMs;
+    for (int i = 1; i < count; ++i)
+        units[(size_t)i]->waitUntilIdle(deadline);
+    
+    std::lock_guard<std::mutex> lock(triggerGroupsMutex);
+    auto fireAlone = [this](int unit) {
+        auto* driver = getDriver(unit);
+        return !driver || !driver->isConnected() || driver->assertTrigger();
+    };
+    
+    bool fired = true;
+    for (const auto& boardUnits : triggerBoards)
+    {
+        // In an ARB transfer: its own *TRG waits on the live lane instead of holding up the rest
+        triggerAddresses.clear();
+        HP33120ADriver* sender = nullptr;
+        for (int unit : boardUnits)
+        {
+            auto* driver = getDriver(unit);
+            if (!driver || !driver->isConnected()) continue;
+            if (driver->isInLongOperation())
+            {
+                fired = fireAlone(unit) && fired;
+                continue;
+            }
+            if (!sender) sender = driver;
+            triggerAddresses.push_back(driver->getGpibAddress());
+        }
+        if (!sender || sender->sendGroupTrigger(triggerAddresses)) continue;
+        
+        // No board-level access (e.g. some USB-GPIB adapters) - addressed triggers, one per unit
+        for (int unit : boardUnits)
+        {
+            auto* driver = getDriver(unit);
+            if (driver && !driver->isInLongOperation())
+                fired = fireAlone(unit) && fired;
+        }
+    }
+    
+    for (int unit : triggerOthers)
+        fired = fireAlone(unit) && fired;
+    
+    return fired;
+}
+
+void InstrumentPool::rebuildTriggerGroups()
+{
+    // The first unit on a board sends that board's GET
+    std::lock_guard<std::mutex> lock(triggerGroupsMutex);
+    std::map<std::string, size_t> boardIndex;  // interfaceKey -> triggerBoards entry
+    triggerBoards.clear();
+    triggerOthers.clear();
+    
+    int count = getNumUnits();
+    for (int i = 0; i < count; ++i)
+    {
+        const std::string& resource = i == 0 ? primaryResource : units[(size_t)i]->driver.getResourceName();
+        if (HP33120ADriver::gpibAddressOf(resource) < 0)
+        {
+            triggerOthers.push_back(i);
+            continue;
+        }
+        auto board = boardIndex.emplace(HP33120ADriver::interfaceKey(resource), triggerBoards.size());
+        if (board.second) triggerBoards.emplace_back();
+        triggerBoards[board.first->second].push_back(i);
+    }
+}
+
+InstrumentPool::TriggerCommitter::TriggerCommitter(InstrumentPool& owner)
+    : Thread("InstrumentTrigger"), pool(owner)
+{
+}
+
+void InstrumentPool::TriggerCommitter::request()
+{
+    requested.store(true, std::memory_order_release);
+    commitPending.notify();
+}
+
+void InstrumentPool::TriggerCommitter::stopCommitter()
+{
+    signalThreadShouldExit();
+    commitPending.wakeNow();
+    stopThread(1000);
+}
+
+void InstrumentPool::TriggerCommitter::run()
+{
+    while (!threadShouldExit())
+    {
+        commitPending.wait(-1, [this]() { return requested.load() || threadShouldExit(); });
+        if (requested.exchange(false, std::memory_order_acq_rel))
+            pool.commitBusTrigger();
+    }
+}
+
+// ============================================================================
+// VOICE ALLOCATION (audio thread)
+// ============================================================================
+void InstrumentPool::resetVoicesIfStale()
+{
+    if (!voicesStale.exchange(false, std::memory_order_acquire)) return;
+    voiceNote.fill(-1);
+    voiceChannel.fill(-1);
+}
+
+int InstrumentPool::allocateVoice(int midiChannel, int note, VoiceMode mode)
+{
+    resetVoicesIfStale();
+    int count = getNumUnits();
+
+    switch (mode)
+    {
+        case VoiceMode::Unison:
+            return ALL_UNITS;
+
+        case VoiceMode::MidiChannel:
+            return (juce::jmax(1, midiChannel) - 1) % count;
+
+        case VoiceMode::Polyphonic:
+        {
+            // A free unit if there is one, otherwise steal the oldest note
+            int chosen = 0;
+            for (int i = 0; i < count; ++i)
+            {
+                if (voiceNote[(size_t)i] < 0) { chosen = i; break; }
+                if (voiceAge[(size_t)i] < voiceAge[(size_t)chosen]) chosen = i;
+            }
+
+            voiceNote[(size_t)chosen] = note;
+            voiceChannel[(size_t)chosen] = midiChannel;
+            voiceAge[(size_t)chosen] = ++voiceCounter;
+            return chosen;
+        }
+    }
+
+    return ALL_UNITS;
+}
+
+int InstrumentPool::releaseVoice(int midiChannel, int note, VoiceMode mode)
+{
+    resetVoicesIfStale();
+    int count = getNumUnits();
+
+    if (mode == VoiceMode::Unison) return ALL_UNITS;
+    if (mode == VoiceMode::MidiChannel) return (juce::jmax(1, midiChannel) - 1) % count;
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (voiceNote[(size_t)i] == note && voiceChannel[(size_t)i] == midiChannel)
+        {
+            voiceNote[(size_t)i] = -1;
+            voiceChannel[(size_t)i] = -1;
+            return i;
+        }
+    }
+    return NO_UNIT;
+}
+
+// ============================================================================
+// UNIT WORKER
+// ============================================================================
+InstrumentPool::Unit::Unit() : Thread("InstrumentUnit")
+{
+    // Sleeps until there is something to send or check - no periodic wakeups
+    driver.setUncheckedCommandHook([this]() {
+        errorCheckPending.store(true);
+        commandPending.notify();
+    });
+}
+
+void InstrumentPool::Unit::queueUpdate(Parameters::DeviceParam param, double value)
+{
+    pending.store((int)param, value);
+    commandPending.notify();
+}
+
+void InstrumentPool::Unit::requestStateSync(const StateSyncRequest::Values& values, int stateRegister)
+{
+    stateSync.post(values, stateRegister);
+    commandPending.notify();
+}
+
+void InstrumentPool::Unit::queueGlide(double freqHz, double newGlideMs)
+{
+    {
+        std::lock_guard<std::mutex> lock(glideMutex);
+        glideTargetHz = freqHz;
+        glideMs = newGlideMs;
+    }
+    glidePending.store(true, std::memory_order_release);
+    commandPending.notify();
+}
+
+void InstrumentPool::Unit::queueTrigger()
+{
+    triggerPending.store(true, std::memory_order_release);
+    commandPending.notify();
+}
+
+void InstrumentPool::Unit::applyGlide()
+{
+    if (!glidePending.exchange(false, std::memory_order_acq_rel)) return;
+    
+    double target = 0.0, duration = 0.0;
+    {
+        std::lock_guard<std::mutex> lock(glideMutex);
+        target = glideTargetHz;
+        duration = glideMs;
+    }
+    if (driver.startGlide(target, duration))
+        triggerPending.store(false);  // The glide's sweep took the trigger
+}
+
+void InstrumentPool::Unit::stopWorker()
+{
+    signalThreadShouldExit();
+    commandPending.wakeNow();
+    stopThread(1000);
+}
+
+bool InstrumentPool::Unit::waitUntilIdle(double deadline)
+{
+    // applying is raised before the mailbox is claimed, so there is no gap between the two
+    while (pending.hasPending() || stateSync.isPending() || glidePending.load() || applying.load())
+    {
+        if (!driver.isConnected()) return true;
+        if (juce::Time::getMillisecondCounterHiRes() > deadline) return false;
+        juce::Thread::sleep(1);
+    }
+    return true;
+}
+
+void InstrumentPool::Unit::run()
+{
+    while (!threadShouldExit())
+    {
+        int waitMs = -1;
+        if (errorCheckPending.load())
+            waitMs = (int)juce::jmax((juce::int64)1, lastErrorCheck + ERROR_CHECK_INTERVAL_MS - juce::Time::currentTimeMillis());
+        if (driver.isGliding())
+        {
+            // Wake up to land the glide (a bulk transfer may hold it up - then retry shortly)
+            int untilLanding = (int)std::ceil(driver.getGlideEndMs() - juce::Time::getMillisecondCounterHiRes());
+            untilLanding = juce::jmax(1, untilLanding);
+            waitMs = waitMs < 0 ? untilLanding : juce::jmin(waitMs, untilLanding);
+        }
+        commandPending.wait(waitMs, [this]() {
+            return pending.hasPending() || stateSync.isPending() || glidePending.load() || triggerPending.load()
+                || threadShouldExit();
+        });
+
+        StateSyncRequest::Values syncValues;
+        int stateRegister = 0;
+        if (!driver.isConnected())
+        {
+            pending.takeDirty();  // Nothing to send to - the next connect starts from the panel state
+            stateSync.take(syncValues, stateRegister);
+            glidePending.store(false);
+            triggerPending.store(false);
+            if (errorCheckPending.exchange(false))
+                driver.checkDeferredErrors();  // Just drops the records
+            continue;
+        }
+
+        if (stateSync.isPending())
+        {
+            applying.store(true);
+            if (stateSync.take(syncValues, stateRegister))
+                StateSyncRequest::apply(driver, syncValues, stateRegister);
+            applying.store(false);
+        }
+
+        if (pending.hasPending())
+        {
+            // Same per-pass batching as DeviceCommandThread: one error check for everything applied
+            applying.store(true);
+            {
+                HP33120ADriver::ScopedErrorBatch batch(driver);
+                pending.consume([this](int index, double value) {
+                    driver.setParameter((Parameters::DeviceParam)index, value);
+                });
+            }
+            applying.store(false);
+        }
+
+        applyGlide();
+        driver.serviceGlide(juce::Time::getMillisecondCounterHiRes());
+        if (triggerPending.exchange(false))
+            driver.assertTrigger();  // After the note's frequency - the burst/sweep starts on it
+
+        juce::int64 currentTime = juce::Time::currentTimeMillis();
+        if (errorCheckPending.load() && currentTime - lastErrorCheck >= ERROR_CHECK_INTERVAL_MS)
+        {
+            lastErrorCheck = currentTime;
+            errorCheckPending.store(false);
+            driver.checkDeferredErrors();
+        }
+    }
+}
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "HP33120ADriver.h"
+#include "Parameters.h"
+#include "ParameterMailbox.h"
+#include "StateSyncRequest.h"
+#include "WorkerSignal.h"
+
+//==============================================================================
+// Several HP33120A units driven from one plugin instance
+//
+// Unit 0 is the processor's own driver (and DeviceCommandThread). Units 1..N-1 each
+// own a driver and a worker thread, so a slow adapter never holds up the others.
+// Units that share a physical interface (same GPIB board or serial port) share one
+// bus mutex: their transactions are serialized, units on other interfaces run in parallel.
+//
+// MIDI maps notes onto units by voice mode; panel and automation changes applied to
+// unit 0 are mirrored to every other unit. Unit objects live as long as the pool,
+// so the audio and scheduler threads can address them without locking.
+//==============================================================================
+class InstrumentPool
+{
+public:
+    enum class VoiceMode { Unison, MidiChannel, Polyphonic };
+
+    static constexpr int MAX_UNITS = 8;
+    static constexpr int ALL_UNITS = -1;
+    static constexpr int NO_UNIT = -2;
+
+    explicit InstrumentPool(HP33120ADriver& primaryDriver);
+    ~InstrumentPool();
+
+    // Message thread, or the processor's connect thread - one caller at a time
+    void attachPrimary(const std::string& resourceName);  // Before unit 0 connects - puts it on its interface's bus lock
+    bool addUnit(const std::string& resourceName);  // Connects the next free unit
+    void disconnectUnits();  // Units 1..N-1; unit 0 belongs to the processor
+    
+    // Connects units 1..N-1 at once, each on its own driver's I/O worker, and brings each
+    // in line with values as it comes up (HP33120ADriver::connectAsync()). Blocks until
+    // every unit has connected or failed, then publishes the ones that made it; returns
+    // how many did. onProgress gets each unit's stages, on that unit's worker.
+    using UnitProgress = std::function<void(int unit, HP33120ADriver::ConnectStage stage, const std::string& detail)>;
+    int connectUnits(const std::vector<std::string>& resourceNames, const StateSyncRequest::Values& values,
+                     UnitProgress onProgress = nullptr);
+
+    int getNumUnits() const { return numUnits.load(std::memory_order_acquire); }  // Including unit 0
+    HP33120ADriver* getDriver(int unit);
+
+    // Any thread, lock-free
+    void queueUpdate(int unit, Parameters::DeviceParam param, double value);  // unit >= 1
+    void mirror(Parameters::DeviceParam param, double value);                  // Every unit >= 1
+    void queueGlide(int unit, double freqHz, double glideMs);                  // HP33120ADriver::startGlide()
+    void mirrorGlide(double freqHz, double glideMs);
+    
+    // Message thread: every unit >= 1 reads itself back and gets only what differs from
+    // these values, each on its own worker - so units on separate interfaces sync in parallel
+    void syncState(const StateSyncRequest::Values& values, int stateRegister = 0);
+
+    // Stage then commit - keeps units in step when a change has to land everywhere at once.
+    // With the Trigger Source parameter on BUS, burst and sweep setups wait for a trigger.
+    // commit gives the workers until one shared deadline, stageTimeoutMs away, to apply
+    // what's already queued for them, then fires all units with a single Group Execute
+    // Trigger per GPIB board (*TRG on other interfaces), so commit latency doesn't grow
+    // with the number of units. The board grouping is worked out when the units change,
+    // not per commit. The trigger source itself is left to the parameter.
+    //
+    // requestBusTrigger() is for realtime threads (MidiEventScheduler commits unison notes
+    // with it): one atomic store and a wake-up, the commit runs on the pool's own thread.
+    // Requests made while one is pending fire once - the state in place then is the latest.
+    void requestBusTrigger();
+    bool commitBusTrigger(int stageTimeoutMs = COMMIT_STAGE_TIMEOUT_MS);  // Blocks
+    void queueTrigger(int unit);  // unit >= 1, fired by its worker after its queued updates
+    static constexpr int COMMIT_STAGE_TIMEOUT_MS = 10;
+    
+    // Audio thread - which unit plays a note. Returns ALL_UNITS for unison.
+    int allocateVoice(int midiChannel, int note, VoiceMode mode);
+    int releaseVoice(int midiChannel, int note, VoiceMode mode);  // NO_UNIT if it wasn't sounding
+
+private:
+    class Unit : public juce::Thread
+    {
+    public:
+        Unit();
+        ~Unit() override { stopWorker(); }
+
+        void run() override;
+        void queueUpdate(Parameters::DeviceParam param, double value);
+        void requestStateSync(const StateSyncRequest::Values& values, int stateRegister);
+        void queueGlide(double freqHz, double glideMs);
+        void queueTrigger();
+        void stopWorker();
+        bool waitUntilIdle(double deadlineMs);  // Queued updates applied by then (getMillisecondCounterHiRes())
+
+        HP33120ADriver driver;
+
+    private:
+        WorkerSignal commandPending;
+        std::atomic<bool> errorCheckPending { false };  // Raised by the driver's unchecked-command hook
+        ParameterMailbox<Parameters::NUM_DEVICE_PARAMS> pending;
+        StateSyncRequest stateSync;
+        std::atomic<bool> applying { false };
+        
+        // Latest glide wins; the worker also lands it when the sweep is over
+        std::mutex glideMutex;
+        double glideTargetHz = 0.0, glideMs = 0.0;
+        std::atomic<bool> glidePending { false };
+        std::atomic<bool> triggerPending { false };
+        void applyGlide();
+        juce::int64 lastErrorCheck { 0 };
+        static constexpr int ERROR_CHECK_INTERVAL_MS = 500;
+    };
+
+    // Runs commitBusTrigger() for requestBusTrigger()
+    class TriggerCommitter : public juce::Thread
+    {
+    public:
+        explicit TriggerCommitter(InstrumentPool& owner);  // Stopped by ~InstrumentPool(), before the units
+        
+        void run() override;
+        void request();
+        void stopCommitter();
+        
+    private:
+        InstrumentPool& pool;
+        WorkerSignal commitPending;
+        std::atomic<bool> requested { false };
+    };
+    
+    // Units grouped for the trigger - rebuilt by the connection calls, read by commits
+    std::mutex triggerGroupsMutex;
+    std::string primaryResource;
+    std::vector<std::vector<int>> triggerBoards;  // Units per GPIB board
+    std::vector<int> triggerOthers;               // Units on other interfaces
+    std::vector<int> triggerAddresses;            // Scratch for one board's GET
+    void rebuildTriggerGroups();
+    
+    std::shared_ptr<std::recursive_mutex> busMutexFor(const std::string& resourceName);
+    Unit& prepareUnit(int index, const std::string& resourceName);  // Creates the slot if need be
+    void bindUnitLog(int index);
+
+    HP33120ADriver& primary;
+    std::array<std::unique_ptr<Unit>, MAX_UNITS> units;  // Slot 0 unused (the primary)
+    std::atomic<int> numUnits { 1 };
+    std::map<std::string, std::shared_ptr<std::recursive_mutex>> busMutexes;  // interfaceKey -> lock
+    TriggerCommitter committer { *this };
+
+    // Audio thread only - polyphonic voice state per unit
+    std::array<int, MAX_UNITS> voiceNote;
+    std::array<int, MAX_UNITS> voiceChannel;
+    std::array<juce::uint32, MAX_UNITS> voiceAge {};
+    juce::uint32 voiceCounter = 0;
+    std::atomic<bool> voicesStale { false };  // Set by disconnectUnits(), cleared on the audio thread
+    void resetVoicesIfStale();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (InstrumentPool)
+};
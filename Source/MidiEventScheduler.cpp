@@ -0,0 +1,234 @@
+#include "MidiEventScheduler.h"
+#include <algorithm>
+#include <cmath>
+
+MidiEventScheduler::MidiEventScheduler(HP33120ADriver& driver)
+    : Thread("MidiEventScheduler"), device(driver)
+{
+    waiting.reserve(FIFO_SIZE * 2);  // Notes plus the glide ends they raise
+    followUps.reserve(FIFO_SIZE);
+}
+
+MidiEventScheduler::~MidiEventScheduler()
+{
+    stopScheduler();
+}
+
+void MidiEventScheduler::stopScheduler()
+{
+    signalThreadShouldExit();
+    eventPending.wakeNow();
+    stopThread(1000);
+}
+
+// ============================================================================
+// AUDIO THREAD
+// ============================================================================
+void MidiEventScheduler::prepare(double newSampleRate, int samplesPerBlock)
+{
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    blockSize = juce::jmax(1, samplesPerBlock);
+    anchored = false;
+    
+    // Enough head room for the device write itself, with margin for bus contention
+    lookAheadMs = juce::jmax(MIN_LOOKAHEAD_MS, busLatencyMs.load() * 2.0);
+}
+
+int MidiEventScheduler::getLatencySamples() const
+{
+    return (int)std::ceil(lookAheadMs * sampleRate / 1000.0);
+}
+
+void MidiEventScheduler::beginBlock(int numSamples)
+{
+    double now = juce::Time::getMillisecondCounterHiRes();
+    
+    if (!anchored)
+    {
+        anchorMs = now;
+        anchorPosition = streamPosition;
+        anchored = true;
+    }
+    
+    double expected = anchorMs + (double)(streamPosition - anchorPosition) * 1000.0 / sampleRate;
+    double error = now - expected;
+    double blockMs = (double)numSamples * 1000.0 / sampleRate;
+    
+    if (std::abs(error) > blockMs * 2.0 + 5.0)
+    {
+        // Dropout, host stall or buffer size change - start over from here
+        anchorMs = now;
+        anchorPosition = streamPosition;
+        expected = now;
+    }
+    else
+    {
+        anchorMs += error * DRIFT_CORRECTION;
+        expected += error * DRIFT_CORRECTION;
+    }
+    
+    blockStartMs = expected;
+    streamPosition += numSamples;
+}
+
+bool MidiEventScheduler::scheduleFrequency(int samplePosition, double freqHz, int unit, double glideMs, bool trigger)
+{
+    // The block is heard roughly one buffer after it's processed. The host already
+    // delivers MIDI lookAheadMs early (reported latency), so aim for that point and
+    // start the write early enough for it to land on time.
+    double audibleAtMs = blockStartMs + (double)samplePosition * 1000.0 / sampleRate
+                       + (double)blockSize * 1000.0 / sampleRate + lookAheadMs;
+    
+    Event event;
+    event.dispatchAtMs = audibleAtMs - busLatencyMs.load(std::memory_order_relaxed);
+    event.frequency = freqHz;
+    event.glideMs = glideMs;
+    event.unit = unit;
+    event.trigger = trigger;
+    
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite(1, start1, size1, start2, size2);
+    if (size1 + size2 < 1) return false;
+    
+    fifoBuffer[(size_t)(size1 > 0 ? start1 : start2)] = event;
+    fifo.finishedWrite(1);
+    eventPending.notify();  // Only a system call if the scheduler is asleep
+    return true;
+}
+
+// ============================================================================
+// SCHEDULER THREAD
+// ============================================================================
+void MidiEventScheduler::insertSorted(const Event& event)
+{
+    auto pos = std::upper_bound(waiting.begin(), waiting.end(), event,
+                                [](const Event& a, const Event& b) { return a.dispatchAtMs < b.dispatchAtMs; });
+    waiting.insert(pos, event);
+}
+
+void MidiEventScheduler::drainFifo()
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead(fifo.getNumReady(), start1, size1, start2, size2);
+    
+    for (int i = 0; i < size1; ++i) insertSorted(fifoBuffer[(size_t)(start1 + i)]);
+    for (int i = 0; i < size2; ++i) insertSorted(fifoBuffer[(size_t)(start2 + i)]);
+    
+    fifo.finishedRead(size1 + size2);
+}
+
+void MidiEventScheduler::dispatch(const Event& event)
+{
+    if (event.endsGlide)
+    {
+        // A glide restarted since has a later end of its own; serviceGlide() ignores this one
+        double now = juce::Time::getMillisecondCounterHiRes();
+        if (!device.serviceGlide(now))
+            followUps.push_back({ now + GLIDE_RETRY_MS, 0.0, 0.0, true, 0 });
+        return;
+    }
+    
+    // Other units have their own workers, so a slow adapter there never delays unit 0
+    if (pool && event.unit != 0)
+    {
+        if (event.unit > 0)
+        {
+            if (event.glideMs > 0.0)
+                pool->queueGlide(event.unit, event.frequency, event.glideMs);
+            else
+                pool->queueUpdate(event.unit, Parameters::DeviceParam::Frequency, event.frequency);
+            if (event.trigger)
+                pool->queueTrigger(event.unit);
+            return;
+        }
+        if (event.glideMs > 0.0)
+            pool->mirrorGlide(event.frequency, event.glideMs);
+        else
+            pool->mirror(Parameters::DeviceParam::Frequency, event.frequency);
+    }
+    
+    if (!device.isConnected()) return;
+    
+    // During an ARB transfer the write is only queued - that time says nothing about the bus
+    bool queued = device.isInLongOperation();
+    double start = juce::Time::getMillisecondCounterHiRes();
+    if (event.glideMs > 0.0 && device.startGlide(event.frequency, event.glideMs))
+        followUps.push_back({ device.getGlideEndMs(), 0.0, 0.0, true, 0 });
+    else if (event.glideMs <= 0.0)
+        device.setFrequency(event.frequency);
+    double elapsed = juce::Time::getMillisecondCounterHiRes() - start;
+    
+    if (event.trigger)
+    {
+        if (pool && event.unit == InstrumentPool::ALL_UNITS)
+            pool->requestBusTrigger();  // Commits on the pool's thread - this one doesn't block
+        else
+            device.assertTrigger();
+    }
+    if (queued) return;
+    
+    double latency = busLatencyMs.load(std::memory_order_relaxed);
+    busLatencyMs.store(latency + (elapsed - latency) * LATENCY_SMOOTHING, std::memory_order_relaxed);
+}
+
+// The driver holds a binary block back rather than let it sit on top of this note
+void MidiEventScheduler::announceNextDeadline()
+{
+    auto next = std::find_if(waiting.begin(), waiting.end(), [](const Event& e) {
+        return e.unit == 0 || e.unit == InstrumentPool::ALL_UNITS;
+    });
+    device.announceRealtimeDeadline(next != waiting.end() ? next->dispatchAtMs : 0.0);
+}
+
+void MidiEventScheduler::run()
+{
+    HP33120ADriver::setThreadLane(HP33120ADriver::CommandLane::Realtime);
+    auto hasNewEvents = [this]() { return fifo.getNumReady() > 0 || threadShouldExit(); };
+    
+    while (!threadShouldExit())
+    {
+        drainFifo();
+        announceNextDeadline();
+        
+        if (waiting.empty())
+        {
+            eventPending.wait(-1, hasNewEvents);  // Woken by the next note or stopScheduler()
+            continue;
+        }
+        
+        double now = juce::Time::getMillisecondCounterHiRes();
+        double untilNext = waiting.front().dispatchAtMs - now;
+        
+        if (untilNext > SPIN_THRESHOLD_MS)
+        {
+            // Sleep until just before the deadline; a new (earlier) note wakes us up
+            eventPending.wait((int)(untilNext - SPIN_THRESHOLD_MS + 0.5), hasNewEvents);
+            continue;
+        }
+        
+        if (untilNext > 0.0)
+        {
+            juce::Thread::yield();
+            continue;
+        }
+        
+        // Everything that is due goes out now; several due notes for the same unit
+        // only need the last one (and a unison note supersedes everything before it).
+        // Glide ends always run - a stale one does nothing.
+        auto firstNotDue = std::find_if(waiting.begin(), waiting.end(),
+                                        [now](const Event& e) { return e.dispatchAtMs > now; });
+        for (auto it = waiting.begin(); it != firstNotDue; ++it)
+        {
+            bool superseded = !it->endsGlide && std::any_of(it + 1, firstNotDue, [&it](const Event& later) {
+                return !later.endsGlide && (later.unit == it->unit || later.unit == InstrumentPool::ALL_UNITS);
+            });
+            if (!superseded) dispatch(*it);
+        }
+        waiting.erase(waiting.begin(), firstNotDue);
+        
+        for (const Event& followUp : followUps)
+            insertSorted(followUp);
+        followUps.clear();
+    }
+    device.announceRealtimeDeadline(0.0);
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include <atomic>
+#include <vector>
+#include "HP33120ADriver.h"
+#include "InstrumentPool.h"
+#include "WorkerSignal.h"
+
+//==============================================================================
+// Sample-accurate MIDI -> SCPI dispatch
+//
+// The audio thread stamps each note with the wall-clock time its sample position
+// will be heard, and pushes it into a lock-free FIFO. A high-priority thread sleeps
+// until that deadline (minus the measured bus latency) and then sends the command,
+// so timing follows the music instead of DeviceCommandThread's poll interval.
+// A note with a glide time starts an instrument-side sweep (HP33120ADriver::startGlide())
+// at its deadline; the scheduler also lands unit 0's glide when the sweep is over. A
+// note that triggers fires the bus trigger right after its frequency - for unison, one
+// InstrumentPool::requestBusTrigger(), committed across every unit on the pool's thread.
+//
+// The wall clock is anchored to the audio stream's own sample counter rather than
+// the host transport position, which stops and jumps on loops. The anchor follows
+// slow clock drift but ignores callback jitter, and re-anchors after dropouts.
+//==============================================================================
+class MidiEventScheduler : public juce::Thread
+{
+public:
+    explicit MidiEventScheduler(HP33120ADriver& driver);
+    ~MidiEventScheduler() override;
+    
+    // Notes for units other than 0 are handed to that unit's worker at their deadline
+    void setInstrumentPool(InstrumentPool* instrumentPool) { pool = instrumentPool; }
+    
+    // Audio thread
+    void prepare(double sampleRate, int samplesPerBlock);
+    void beginBlock(int numSamples);  // Call once per processBlock, before any schedule*()
+    bool scheduleFrequency(int samplePosition, double freqHz, int unit = 0,
+                           double glideMs = 0.0, bool trigger = false);  // false if the FIFO is full
+    
+    // Look-ahead the processor reports to the host so device changes line up with audio
+    int getLatencySamples() const;
+    double getLookAheadMs() const { return lookAheadMs; }
+    double getMeasuredBusLatencyMs() const { return busLatencyMs.load(); }
+    
+    void run() override;
+    void stopScheduler();
+    
+private:
+    struct Event
+    {
+        double dispatchAtMs = 0.0;  // juce::Time::getMillisecondCounterHiRes() domain
+        double frequency = 0.0;
+        double glideMs = 0.0;    // 0: straight to the frequency
+        bool endsGlide = false;  // Lands unit 0's glide instead of playing a note
+        int unit = 0;  // InstrumentPool unit, or InstrumentPool::ALL_UNITS
+        bool trigger = false;  // Fire the bus trigger once the frequency is out
+    };
+    
+    HP33120ADriver& device;
+    InstrumentPool* pool = nullptr;
+    WorkerSignal eventPending;
+    
+    // Audio thread -> scheduler thread
+    static constexpr int FIFO_SIZE = 256;
+    juce::AbstractFifo fifo { FIFO_SIZE };
+    std::array<Event, FIFO_SIZE> fifoBuffer;
+    
+    // Scheduler thread only - events waiting for their deadline, sorted by time
+    std::vector<Event> waiting;
+    std::vector<Event> followUps;  // Glide ends raised while dispatching, merged afterwards
+    void insertSorted(const Event& event);
+    void drainFifo();
+    void announceNextDeadline();
+    void dispatch(const Event& event);
+    
+    // Audio thread only - stream position to wall-clock mapping
+    double sampleRate = 44100.0;
+    int blockSize = 512;
+    juce::int64 streamPosition = 0;
+    juce::int64 anchorPosition = 0;
+    double anchorMs = 0.0;
+    bool anchored = false;
+    double blockStartMs = 0.0;
+    
+    // Reported look-ahead: max(MIN_LOOKAHEAD_MS, 2x the bus latency), fixed at prepare().
+    // The buffer the block is heard in is added per event in scheduleFrequency().
+    double lookAheadMs = MIN_LOOKAHEAD_MS;
+    std::atomic<double> busLatencyMs { 2.0 };  // EMA of measured write time
+    
+    static constexpr double MIN_LOOKAHEAD_MS = 5.0;
+    static constexpr double DRIFT_CORRECTION = 0.01;     // Fraction of anchor error corrected per block
+    static constexpr double LATENCY_SMOOTHING = 0.1;     // EMA weight of the newest measurement
+    static constexpr double SPIN_THRESHOLD_MS = 1.5;     // Below this, yield instead of sleeping
+    static constexpr double GLIDE_RETRY_MS = 5.0;        // Landing held up by an ARB transfer
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiEventScheduler)
+};
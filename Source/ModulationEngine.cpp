@@ -0,0 +1,172 @@
+#include "ModulationEngine.h"
+#include <cmath>
+
+ModulationEngine::ModulationEngine(juce::AudioProcessorValueTreeState& parameters)
+{
+    sourceParam = parameters.getRawParameterValue(Parameters::MOD_SOURCE);
+    targetParam = parameters.getRawParameterValue(Parameters::MOD_TARGET);
+    depthParam = parameters.getRawParameterValue(Parameters::MOD_DEPTH);
+    rateParam = parameters.getRawParameterValue(Parameters::MOD_RATE);
+    shapeParam = parameters.getRawParameterValue(Parameters::MOD_LFO_SHAPE);
+    attackParam = parameters.getRawParameterValue(Parameters::MOD_ATTACK);
+    decayParam = parameters.getRawParameterValue(Parameters::MOD_DECAY);
+    sustainParam = parameters.getRawParameterValue(Parameters::MOD_SUSTAIN);
+    releaseParam = parameters.getRawParameterValue(Parameters::MOD_RELEASE);
+    stepCountParam = parameters.getRawParameterValue(Parameters::MOD_STEP_COUNT);
+    
+    const char* stepIDs[] = { Parameters::MOD_STEP_1, Parameters::MOD_STEP_2, Parameters::MOD_STEP_3, Parameters::MOD_STEP_4,
+                              Parameters::MOD_STEP_5, Parameters::MOD_STEP_6, Parameters::MOD_STEP_7, Parameters::MOD_STEP_8 };
+    for (int i = 0; i < 8; ++i)
+        stepParams[i] = parameters.getRawParameterValue(stepIDs[i]);
+}
+
+void ModulationEngine::noteOn()
+{
+    gateOnMs = juce::Time::getMillisecondCounterHiRes();
+    gateOffMs = -1.0;
+}
+
+void ModulationEngine::noteOff()
+{
+    if (gateOnMs.load() >= 0.0 && gateOffMs.load() < 0.0)
+        gateOffMs = juce::Time::getMillisecondCounterHiRes();
+}
+
+bool ModulationEngine::isActive() const
+{
+    return sourceParam && (Source)(int)sourceParam->load() != Source::Off && depthParam->load() > 0.0f;
+}
+
+ModulationEngine::Target ModulationEngine::getTarget() const
+{
+    return (Target)juce::jlimit(0, 4, (int)targetParam->load());
+}
+
+Parameters::DeviceParam ModulationEngine::getTargetParam() const
+{
+    switch (getTarget())
+    {
+        case Target::Amplitude:   return Parameters::DeviceParam::Amplitude;
+        case Target::DutyCycle:   return Parameters::DeviceParam::DutyCycle;
+        case Target::AMDepth:     return Parameters::DeviceParam::AMDepth;
+        case Target::FMDeviation: return Parameters::DeviceParam::FMDeviation;
+        case Target::Frequency:
+        default:                  return Parameters::DeviceParam::Frequency;
+    }
+}
+
+std::atomic<double>& ModulationEngine::baseValue(HP33120ADriver& device, Parameters::DeviceParam target)
+{
+    std::atomic<double>* base = device.baseValueFor(target);
+    return base ? *base : device.baseFreq;
+}
+
+// ============================================================================
+// SOURCES
+// ============================================================================
+double ModulationEngine::evaluateSource(Source source, double nowMs)
+{
+    // Advance free-running phases by the real time since the last send
+    double dt = lastEvalMs >= 0.0 ? juce::jlimit(0.0, 1.0, (nowMs - lastEvalMs) / 1000.0) : 0.0;
+    lastEvalMs = nowMs;
+    double rate = (double)rateParam->load();
+    
+    lfoPhase += dt * rate;
+    if (lfoPhase >= 1.0)
+    {
+        lfoPhase -= std::floor(lfoPhase);
+        randomValue = random.nextDouble() * 2.0 - 1.0;  // Sample & hold: new value each cycle
+    }
+    
+    stepPhase += dt * rate;
+    if (stepPhase >= 1.0)
+    {
+        int count = juce::jlimit(2, 8, (int)stepCountParam->load());
+        stepIndex = (stepIndex + (int)std::floor(stepPhase)) % count;
+        stepPhase -= std::floor(stepPhase);
+    }
+    
+    switch (source)
+    {
+        case Source::LFO:      return evaluateLFO();
+        case Source::Step:     return evaluateStep();
+        case Source::Envelope: return evaluateEnvelope(nowMs);
+        case Source::Off:
+        default:               return 0.0;
+    }
+}
+
+double ModulationEngine::evaluateLFO() const
+{
+    switch ((LFOShape)(int)shapeParam->load())
+    {
+        case LFOShape::Triangle: return lfoPhase < 0.5 ? 4.0 * lfoPhase - 1.0 : 3.0 - 4.0 * lfoPhase;
+        case LFOShape::Square:   return lfoPhase < 0.5 ? 1.0 : -1.0;
+        case LFOShape::Saw:      return 2.0 * lfoPhase - 1.0;
+        case LFOShape::Random:   return randomValue;
+        case LFOShape::Sine:
+        default:                 return std::sin(lfoPhase * juce::MathConstants<double>::twoPi);
+    }
+}
+
+double ModulationEngine::evaluateStep() const
+{
+    int count = juce::jlimit(2, 8, (int)stepCountParam->load());
+    return (double)stepParams[stepIndex % count]->load() / 100.0;
+}
+
+double ModulationEngine::envelopeLevelAt(double t) const
+{
+    double attack = juce::jmax(0.001, (double)attackParam->load());
+    double decay = juce::jmax(0.001, (double)decayParam->load());
+    double sustain = (double)sustainParam->load() / 100.0;
+    
+    if (t < attack) return t / attack;
+    if (t < attack + decay) return 1.0 - (1.0 - sustain) * (t - attack) / decay;
+    return sustain;
+}
+
+double ModulationEngine::evaluateEnvelope(double nowMs) const
+{
+    double onMs = gateOnMs.load();
+    if (onMs < 0.0) return 0.0;
+    
+    double offMs = gateOffMs.load();
+    if (offMs < 0.0)
+        return envelopeLevelAt((nowMs - onMs) / 1000.0);
+    
+    // Release from wherever the envelope was when the note ended
+    double release = juce::jmax(0.001, (double)releaseParam->load());
+    double levelAtOff = envelopeLevelAt((offMs - onMs) / 1000.0);
+    return levelAtOff * juce::jmax(0.0, 1.0 - (nowMs - offMs) / 1000.0 / release);
+}
+
+// ============================================================================
+// OUTPUT
+// ============================================================================
+void ModulationEngine::sendModulatedValue(HP33120ADriver& device, double nowMs)
+{
+    double signal = evaluateSource((Source)(int)sourceParam->load(), nowMs);
+    double depth = (double)depthParam->load() / 100.0;
+    double amount = depth * signal;
+    
+    // Clamp to ranges the instrument accepts so modulation never produces SCPI errors
+    switch (getTarget())
+    {
+        case Target::Frequency:
+            device.updateFrequencyLive(juce::jlimit(0.0001, 15.0e6, device.baseFreq.load() * std::pow(2.0, amount * MAX_FREQ_OCTAVES)));
+            break;
+        case Target::Amplitude:
+            device.updateAmplitudeLive(juce::jlimit(0.05, 10.0, device.baseAmp.load() * (1.0 + amount)));
+            break;
+        case Target::DutyCycle:
+            device.updateDutyCycleLive(juce::jlimit(20.0, 80.0, device.baseDuty.load() + amount * MAX_DUTY_SWING));
+            break;
+        case Target::AMDepth:
+            device.updateAMDepthLive(juce::jlimit(0.0, 120.0, device.baseAMDepth.load() + amount * MAX_AM_DEPTH_SWING));
+            break;
+        case Target::FMDeviation:
+            device.updateFMDevLive(juce::jmax(0.01, device.baseFMDev.load() * (1.0 + amount)));
+            break;
+    }
+}
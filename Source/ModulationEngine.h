@@ -0,0 +1,77 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <atomic>
+#include "HP33120ADriver.h"
+#include "Parameters.h"
+
+//==============================================================================
+// Host-side modulation: one LFO / envelope / step sequencer source driving one
+// device parameter around its base* value on HP33120ADriver.
+//
+// Nothing runs at audio rate. DeviceCommandThread asks for a value exactly when the
+// target is due to be sent (its adaptive rate limit), so no value is ever computed
+// just to be thrown away. Settings are read from the Mod* parameters lock-free at
+// that point; note on/off only stamps the envelope gate.
+//==============================================================================
+class ModulationEngine
+{
+public:
+    enum class Source { Off, LFO, Envelope, Step };
+    enum class Target { Frequency, Amplitude, DutyCycle, AMDepth, FMDeviation };
+    enum class LFOShape { Sine, Triangle, Square, Saw, Random };
+    
+    explicit ModulationEngine(juce::AudioProcessorValueTreeState& parameters);
+    
+    // Envelope gate - safe from the audio thread
+    void noteOn();
+    void noteOff();
+    
+    // Command thread
+    bool isActive() const;
+    Parameters::DeviceParam getTargetParam() const;
+    void sendModulatedValue(HP33120ADriver& device, double nowMs);  // Via update*Live
+    
+    // The base a target modulates around; pending user changes to the target land here
+    static std::atomic<double>& baseValue(HP33120ADriver& device, Parameters::DeviceParam target);
+    
+private:
+    double evaluateSource(Source source, double nowMs);  // LFO/Step: -1..1, Envelope: 0..1
+    double evaluateLFO() const;
+    double evaluateStep() const;
+    double evaluateEnvelope(double nowMs) const;
+    double envelopeLevelAt(double secondsSinceOn) const;
+    
+    Target getTarget() const;
+    
+    std::atomic<float>* sourceParam = nullptr;
+    std::atomic<float>* targetParam = nullptr;
+    std::atomic<float>* depthParam = nullptr;
+    std::atomic<float>* rateParam = nullptr;
+    std::atomic<float>* shapeParam = nullptr;
+    std::atomic<float>* attackParam = nullptr;
+    std::atomic<float>* decayParam = nullptr;
+    std::atomic<float>* sustainParam = nullptr;
+    std::atomic<float>* releaseParam = nullptr;
+    std::atomic<float>* stepCountParam = nullptr;
+    std::atomic<float>* stepParams[8] = {};
+    
+    // Gate times in juce::Time::getMillisecondCounterHiRes() domain
+    std::atomic<double> gateOnMs { -1.0 };
+    std::atomic<double> gateOffMs { -1.0 };
+    
+    // Command thread only - phase is integrated so rate changes don't jump
+    double lastEvalMs = -1.0;
+    double lfoPhase = 0.0;
+    double randomValue = 0.0;
+    double stepPhase = 0.0;
+    int stepIndex = 0;
+    juce::Random random;
+    
+    static constexpr double MAX_FREQ_OCTAVES = 2.0;      // Depth 100% = +/- 2 octaves
+    static constexpr double MAX_DUTY_SWING = 30.0;       // Percentage points
+    static constexpr double MAX_AM_DEPTH_SWING = 100.0;  // Percentage points
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ModulationEngine)
+};
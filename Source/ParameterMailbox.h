@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+//==============================================================================
+// Latest-value mailbox for a fixed set of parameters
+//
+// Producers (audio thread, GUI, MIDI) store a value by index: one seqlock'd slot write
+// plus one fetch_or on the dirty mask - no locks, no allocation, no string compares.
+// The consumer (DeviceCommandThread) claims every dirty slot with a single exchange
+// and reads each value; values overwritten before the consumer gets to them are
+// coalesced, so only the most recent one is ever sent.
+//==============================================================================
+template <int NumSlots>
+class ParameterMailbox
+{
+    static_assert(NumSlots > 0 && NumSlots <= 64, "Dirty mask is a single 64-bit word");
+    
+public:
+    // Producer side - safe from any thread
+    void store(int index, double value) noexcept
+    {
+        Slot& slot = slots[index];
+        
+        // Writers take the sequence from even to odd; a concurrent writer on
+        // the same slot (rare - same parameter from two threads) spins briefly
+        uint32_t seq = slot.sequence.load(std::memory_order_relaxed);
+        for (;;)
+        {
+            if ((seq & 1u) == 0
+                && slot.sequence.compare_exchange_weak(seq, seq + 1, std::memory_order_acquire, std::memory_order_relaxed))
+                break;
+            seq = slot.sequence.load(std::memory_order_relaxed);
+        }
+        
+        slot.value.store(value, std::memory_order_relaxed);
+        slot.sequence.store(seq + 2, std::memory_order_release);
+        
+        dirtyMask.fetch_or(uint64_t(1) << index, std::memory_order_release);
+    }
+    
+    // Consumer side - returns the dirty set and clears it in one step
+    uint64_t takeDirty() noexcept
+    {
+        return dirtyMask.exchange(0, std::memory_order_acq_rel);
+    }
+    
+    double load(int index) const noexcept
+    {
+        const Slot& slot = slots[index];
+        for (;;)
+        {
+            uint32_t before = slot.sequence.load(std::memory_order_acquire);
+            if ((before & 1u) != 0) continue;  // Write in progress
+            
+            double value = slot.value.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            
+            if (slot.sequence.load(std::memory_order_relaxed) == before)
+                return value;
+        }
+    }
+    
+    // Calls fn(index, value) for every dirty slot, in index order
+    template <typename Fn>
+    void consume(Fn&& fn)
+    {
+        uint64_t dirty = takeDirty();
+        for (int i = 0; dirty != 0 && i < NumSlots; ++i)
+        {
+            uint64_t bit = uint64_t(1) << i;
+            if ((dirty & bit) == 0) continue;
+            dirty &= ~bit;
+            fn(i, load(i));
+        }
+    }
+    
+    bool hasPending() const noexcept { return dirtyMask.load(std::memory_order_acquire) != 0; }
+    
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> sequence{0};
+        std::atomic<double> value{0.0};
+    };
+    
+    Slot slots[NumSlots];
+    std::atomic<uint64_t> dirtyMask{0};
+};
@@ -54,6 +54,38 @@ namespace Parameters
     // Trigger Settings
     constexpr const char* TRIGGER_SOURCE = "Trigger Source";
     
+    // Multi-instrument (see InstrumentPool.h) and mono voices (see VoiceEngine.h)
+    constexpr const char* VOICE_MODE = "Voice Mode";
+    constexpr const char* NOTE_PRIORITY = "Note Priority";
+    constexpr const char* LEGATO = "Legato";
+    constexpr const char* GLIDE_TIME = "Glide Time";
+    
+    // Modulation (host-side LFO / envelope / step sequencer, see ModulationEngine.h)
+    constexpr const char* MOD_SOURCE = "Mod Source";
+    constexpr const char* MOD_TARGET = "Mod Target";
+    constexpr const char* MOD_DEPTH = "Mod Depth";
+    constexpr const char* MOD_RATE = "Mod Rate";
+    constexpr const char* MOD_LFO_SHAPE = "Mod LFO Shape";
+    constexpr const char* MOD_ATTACK = "Mod Attack";
+    constexpr const char* MOD_DECAY = "Mod Decay";
+    constexpr const char* MOD_SUSTAIN = "Mod Sustain";
+    constexpr const char* MOD_RELEASE = "Mod Release";
+    constexpr const char* MOD_STEP_COUNT = "Mod Step Count";
+    constexpr const char* MOD_STEP_1 = "Mod Step 1";
+    constexpr const char* MOD_STEP_2 = "Mod Step 2";
+    constexpr const char* MOD_STEP_3 = "Mod Step 3";
+    constexpr const char* MOD_STEP_4 = "Mod Step 4";
+    constexpr const char* MOD_STEP_5 = "Mod Step 5";
+    constexpr const char* MOD_STEP_6 = "Mod Step 6";
+    constexpr const char* MOD_STEP_7 = "Mod Step 7";
+    constexpr const char* MOD_STEP_8 = "Mod Step 8";
+    
+    // Wavetable morph across the loaded ARB slots (see WavetableMorph.h)
+    constexpr const char* MORPH_ENABLED = "Morph Enabled";
+    constexpr const char* MORPH_POSITION = "Morph Position";
+    constexpr const char* MORPH_RATE = "Morph Rate";
+    constexpr const char* MORPH_FRAME_RATE = "Morph Frame Rate";
+    
     // ARB Slot Parameters (4 slots)
     constexpr const char* ARB_SLOT1_NAME = "ARB Slot 1 Name";
     constexpr const char* ARB_SLOT1_POINTS = "ARB Slot 1 Points";
@@ -65,3 +97,65 @@ namespace Parameters
     constexpr const char* ARB_SLOT4_POINTS = "ARB Slot 4 Points";
 }
 
+//==============================================================================
+// Device parameters forwarded to the instrument by DeviceCommandThread
+// X(EnumName, PARAMETER_ID) - listed in the order a pass applies them
+// (waveform and output first so FREQ/VOLT land on the right function)
+#define HP33120A_DEVICE_PARAMETERS(X) \
+    X(Waveform,        WAVEFORM) \
+    X(OutputEnabled,   OUTPUT_ENABLED) \
+    X(Frequency,       FREQUENCY) \
+    X(Amplitude,       AMPLITUDE) \
+    X(Offset,          OFFSET) \
+    X(Phase,           PHASE) \
+    X(DutyCycle,       DUTY_CYCLE) \
+    X(AMEnabled,       AM_ENABLED) \
+    X(AMDepth,         AM_DEPTH) \
+    X(AMSource,        AM_SOURCE) \
+    X(AMIntWaveform,   AM_INT_WAVEFORM) \
+    X(AMIntFreq,       AM_INT_FREQ) \
+    X(FMEnabled,       FM_ENABLED) \
+    X(FMDeviation,     FM_DEVIATION) \
+    X(FMSource,        FM_SOURCE) \
+    X(FMIntWaveform,   FM_INT_WAVEFORM) \
+    X(FMIntFreq,       FM_INT_FREQ) \
+    X(FSKEnabled,      FSK_ENABLED) \
+    X(FSKFrequency,    FSK_FREQUENCY) \
+    X(FSKSource,       FSK_SOURCE) \
+    X(FSKRate,         FSK_RATE) \
+    X(SweepEnabled,    SWEEP_ENABLED) \
+    X(SweepStart,      SWEEP_START) \
+    X(SweepStop,       SWEEP_STOP) \
+    X(SweepTime,       SWEEP_TIME) \
+    X(BurstEnabled,    BURST_ENABLED) \
+    X(BurstCycles,     BURST_CYCLES) \
+    X(BurstPhase,      BURST_PHASE) \
+    X(BurstIntPeriod,  BURST_INT_PERIOD) \
+    X(BurstSource,     BURST_SOURCE) \
+    X(SyncEnabled,     SYNC_ENABLED) \
+    X(SyncPhase,       SYNC_PHASE) \
+    X(TriggerSource,   TRIGGER_SOURCE)
+
+namespace Parameters
+{
+    enum class DeviceParam : int
+    {
+       #define HP33120A_DEVICE_PARAM_ENUM(name, id) name,
+        HP33120A_DEVICE_PARAMETERS(HP33120A_DEVICE_PARAM_ENUM)
+       #undef HP33120A_DEVICE_PARAM_ENUM
+        Count
+    };
+    
+    constexpr int NUM_DEVICE_PARAMS = (int)DeviceParam::Count;
+    
+    // Parameter ID for each DeviceParam, indexed by the enum value
+    constexpr const char* DEVICE_PARAM_IDS[] =
+    {
+       #define HP33120A_DEVICE_PARAM_ID(name, id) id,
+        HP33120A_DEVICE_PARAMETERS(HP33120A_DEVICE_PARAM_ID)
+       #undef HP33120A_DEVICE_PARAM_ID
+    };
+    
+    static_assert(sizeof(DEVICE_PARAM_IDS) / sizeof(DEVICE_PARAM_IDS[0]) == NUM_DEVICE_PARAMS, "ID table out of sync");
+    static_assert(NUM_DEVICE_PARAMS <= 64, "Dirty mask is a single 64-bit word");
+}
@@ -141,6 +141,16 @@ HP33120APluginAudioProcessorEditor::HP33120APluginAudioProcessorEditor (HP33120A
     idnLabel.setText("IDN: (Not connected)", juce::dontSendNotification);
     addAndMakeVisible(&idnLabel);
     
+    refreshProgramCombo();
+    programCombo.setTooltip("Programs 1-" + juce::String(HP33120ADriver::NUM_STATE_REGISTERS)
+                            + " switch with a single *RCL once stored on the instrument");
+    programCombo.addListener(this);
+    addAndMakeVisible(&programCombo);
+    
+    storeProgramButton.setButtonText("Store");
+    storeProgramButton.addListener(this);
+    addAndMakeVisible(&storeProgramButton);
+    
     midiStatusLabel.setText("MIDI: Waiting...", juce::dontSendNotification);
     midiStatusLabel.setColour(juce::Label::textColourId, juce::Colours::grey);
     addAndMakeVisible(&midiStatusLabel);
@@ -545,6 +555,21 @@ HP33120APluginAudioProcessorEditor::HP33120APluginAudioProcessorEditor (HP33120A
         arbSlotUIs[i].fileNameLabel.setText("No file loaded", juce::dontSendNotification);
         arbSlotUIs[i].fileNameLabel.setColour(juce::Label::textColourId, juce::Colours::lightgrey);
         addAndMakeVisible(&arbSlotUIs[i].fileNameLabel);
+        
+        arbSlotUIs[i].cycleToggle.setButtonText("Cycles");
+        arbSlotUIs[i].cycleToggle.setTooltip("Keep whole pitch periods of the file, cut at zero crossings");
+        arbSlotUIs[i].cycleToggle.onClick = [this, i] {
+            arbSlotUIs[i].cycleCountSlider.setEnabled(arbSlotUIs[i].cycleToggle.getToggleState());
+        };
+        addAndMakeVisible(&arbSlotUIs[i].cycleToggle);
+        
+        arbSlotUIs[i].cycleCountSlider.setSliderStyle(juce::Slider::IncDecButtons);
+        arbSlotUIs[i].cycleCountSlider.setTextBoxStyle(juce::Slider::TextBoxLeft, false, 24, 16);
+        arbSlotUIs[i].cycleCountSlider.setRange(1.0, (double)ARBManager::MAX_EXTRACTED_CYCLES, 1.0);
+        arbSlotUIs[i].cycleCountSlider.setValue(1.0, juce::dontSendNotification);
+        arbSlotUIs[i].cycleCountSlider.setTooltip("Number of pitch periods to keep");
+        arbSlotUIs[i].cycleCountSlider.setEnabled(false);
+        addAndMakeVisible(&arbSlotUIs[i].cycleCountSlider);
     }
     
     // Refresh waveform combo box with ARB names (after ARB slots are initialized)
@@ -567,6 +592,21 @@ HP33120APluginAudioProcessorEditor::HP33120APluginAudioProcessorEditor (HP33120A
     statusBox.setFont(statusFont);
     addAndMakeVisible(&statusBox);
     
+    // Bus telemetry
+    telemetryBox.setMultiLine(true);
+    telemetryBox.setReadOnly(true);
+    telemetryBox.setFont(statusFont);
+    addAndMakeVisible(&telemetryBox);
+    
+    telemetryResetButton.setButtonText("Reset");
+    telemetryCsvButton.setButtonText("Export CSV");
+    telemetryJsonButton.setButtonText("Export JSON");
+    for (auto* button : { &telemetryResetButton, &telemetryCsvButton, &telemetryJsonButton })
+    {
+        button->addListener(this);
+        addAndMakeVisible(button);
+    }
+    
     // Set up MIDI status callback
     audioProcessor.midiStatusCallback = [this](const juce::String& message) {
         appendStatus(message);
@@ -683,18 +723,55 @@ HP33120APluginAudioProcessorEditor::HP33120APluginAudioProcessorEditor (HP33120A
             appendStatus(juce::String(msg));
         });
     };
+    
+    // Connection and note state are pushed to the editor rather than polled
+    audioProcessor.addChangeListener(this);
+    audioProcessor.keyboardState.addListener(this);
+    noteStateChanged = true;  // Notes may already be held
+    updateConnectionDisplay();
 }
 
 HP33120APluginAudioProcessorEditor::~HP33120APluginAudioProcessorEditor()
 {
     // Clear the log callback to avoid dangling pointer
     audioProcessor.device.logCallback = nullptr;
+    audioProcessor.keyboardState.removeListener(this);
+    audioProcessor.removeChangeListener(this);
     
     setLookAndFeel(nullptr);  // Clean up look and feel
 }
 
 //==============================================================================
 void HP33120APluginAudioProcessorEditor::paint (juce::Graphics& g)
+{
+    // Everything but the message count comes from the cached artwork
+    const float scale = g.getInternalContext().getPhysicalPixelScaleFactor();
+    if (!staticArtwork.isValid() || staticArtworkScale != scale)
+    {
+        staticArtwork = juce::Image(juce::Image::RGB, juce::jmax(1, juce::roundToInt((float)getWidth() * scale)),
+                                    juce::jmax(1, juce::roundToInt((float)getHeight() * scale)), false);
+        juce::Graphics artwork(staticArtwork);
+        artwork.addTransform(juce::AffineTransform::scale(scale));
+        drawStaticArtwork(artwork);
+        staticArtworkScale = scale;
+    }
+    g.drawImageTransformed(staticArtwork, juce::AffineTransform::scale(1.0f / staticArtworkScale));
+    
+    g.setColour(juce::Colour(0xFF6B7280));
+    g.setFont(juce::Font(11.0f));
+    g.drawText(juce::String(statusMessages.size()) + " messages", getMessageCountArea(),
+               juce::Justification::centredRight);
+}
+
+juce::Rectangle<int> HP33120APluginAudioProcessorEditor::getMessageCountArea() const
+{
+    // Right end of the status bar, left out of the cached artwork
+    const int statusBarHeight = 20;
+    const int padding = 8;
+    return juce::Rectangle<int>(getWidth() - 110, getHeight() - statusBarHeight + 1, 110 - padding, statusBarHeight - 1);
+}
+
+void HP33120APluginAudioProcessorEditor::drawStaticArtwork(juce::Graphics& g)
 {
     // Fill background with pure black
     g.fillAll(juce::Colour(0xFF000000));
@@ -750,11 +827,6 @@ void HP33120APluginAudioProcessorEditor::paint (juce::Graphics& g)
                statusBarArea.reduced(110, 0),
                juce::Justification::centredLeft);
     
-    juce::String statusRight = juce::String(statusMessages.size()) + " messages";
-    g.drawText(statusRight, 
-               statusBarArea.reduced(padding, 0),
-               juce::Justification::centredRight);
-    
     // ============================================
     // Draw messages area separator
     // ============================================
@@ -853,6 +925,11 @@ void HP33120APluginAudioProcessorEditor::paint (juce::Graphics& g)
     int burstH = sectionHeaderPadding * 2 + (toggleHeight + spacing) + (ctrlHeight + spacing) * 4;
     drawSectionBox(rightCol.removeFromTop(burstH), "BURST");
     
+    rightCol.removeFromTop(sectionGap);
+    
+    // BUS TELEMETRY: rest of the column
+    drawSectionBox(rightCol, "BUS TELEMETRY");
+    
     // Column dividers
     int mainTop = headerHeight + 8;
     g.setColour(juce::Colour(0xFF4ADE80).withAlpha(0.3f));
@@ -875,6 +952,7 @@ void HP33120APluginAudioProcessorEditor::resized()
     const int sectionGap = 12;
     
     auto area = getLocalBounds();
+    staticArtwork = {};  // Redrawn at the new size on the next paint
     
     // Hide group components
     basicGroup.setVisible(false);
@@ -894,6 +972,10 @@ void HP33120APluginAudioProcessorEditor::resized()
     gpibAddressEditor.setBounds(connRight.removeFromLeft(140).reduced(2));
     midiStatusLabel.setBounds(connRight.reduced(2));
     
+    auto programArea = headerArea.removeFromRight(230);
+    storeProgramButton.setBounds(programArea.removeFromRight(60).reduced(2));
+    programCombo.setBounds(programArea.reduced(2));
+    
     // IDN label - Moved further right to avoid title overlap
     idnLabel.setBounds(headerArea.withTrimmedLeft(350).reduced(2)); 
     gpibAddressLabel.setBounds(0, 0, 0, 0);
@@ -1004,6 +1086,8 @@ void HP33120APluginAudioProcessorEditor::resized()
         // Row 3: Status / File
         auto row3 = slotArea.removeFromTop(20);
         arbSlotUIs[i].statusLabel.setBounds(row3.removeFromRight(120).reduced(1));
+        arbSlotUIs[i].cycleCountSlider.setBounds(row3.removeFromRight(56).reduced(1));
+        arbSlotUIs[i].cycleToggle.setBounds(row3.removeFromRight(64).reduced(1));
         arbSlotUIs[i].fileNameLabel.setBounds(row3.reduced(1));
     }
     
@@ -1081,104 +1165,171 @@ void HP33120APluginAudioProcessorEditor::resized()
     
     // Hide unused
     triggerSourceLabel.setBounds(0, 0, 0, 0); triggerSourceCombo.setBounds(0, 0, 0, 0);
+    
+    rightCol.removeFromTop(sectionGap);
+    
+    // BUS TELEMETRY - rest of the column
+    auto telemetryArea = rightCol;
+    telemetryArea.removeFromTop(sectionHeaderPadding);
+    telemetryArea.removeFromBottom(sectionHeaderPadding);
+    
+    auto telemetryButtons = telemetryArea.removeFromTop(26);
+    int telemetryBtnW = telemetryButtons.getWidth() / 3;
+    telemetryResetButton.setBounds(telemetryButtons.removeFromLeft(telemetryBtnW).reduced(1));
+    telemetryCsvButton.setBounds(telemetryButtons.removeFromLeft(telemetryBtnW).reduced(1));
+    telemetryJsonButton.setBounds(telemetryButtons.reduced(1));
+    telemetryArea.removeFromTop(spacing);
+    telemetryBox.setBounds(telemetryArea);
+}
+
+void HP33120APluginAudioProcessorEditor::refreshProgramCombo()
+{
+    programCombo.clear(juce::dontSendNotification);
+    for (int i = 0; i < audioProcessor.getNumPrograms(); ++i)
+    {
+        juce::String name = audioProcessor.getProgramName(i);
+        if (ProgramBank::stateRegisterFor(i) > 0)
+            name << " [*RCL " << juce::String(ProgramBank::stateRegisterFor(i)) << "]";
+        programCombo.addItem(name, i + 1);
+    }
+    programCombo.setSelectedId(audioProcessor.getCurrentProgram() + 1, juce::dontSendNotification);
 }
 
 // PERFORMANCE: Timer runs at 100ms (10 Hz) - only for UI updates, not device communication
-// This is lightweight and only updates UI labels, never queries device
+// Connection and program state arrive as change messages; the timer covers the telemetry
+// table and the MIDI indicator, which only rescans the note table after a note event
 void HP33120APluginAudioProcessorEditor::timerCallback()
 {
-    // PERFORMANCE: Use cached IDN instead of querying device every 100ms
-    // Device queries are expensive (GPIB communication), so we cache on connection
-    if (audioProcessor.isDeviceConnected())
+    // Telemetry table - a snapshot is a few hundred atomic loads, no device traffic
+    if (++telemetryRefreshTicks >= TELEMETRY_REFRESH_TICKS)
     {
-        if (!idnCacheValid)
-        {
-            // Cache IDN on first timer tick after connection (lazy load)
-            cachedDeviceIDN = audioProcessor.getDeviceIDN();
-            idnCacheValid = true;
-        }
-        idnLabel.setText("IDN: " + cachedDeviceIDN, juce::dontSendNotification);
+        telemetryRefreshTicks = 0;
+        refreshTelemetry();
     }
+    
+    updateMidiStatus();
+}
+
+void HP33120APluginAudioProcessorEditor::changeListenerCallback(juce::ChangeBroadcaster* source)
+{
+    if (source != &audioProcessor) return;
+    
+    updateConnectionDisplay();
+    
+    // Program changes from MIDI or the host
+    if (programCombo.getSelectedId() != audioProcessor.getCurrentProgram() + 1)
+        programCombo.setSelectedId(audioProcessor.getCurrentProgram() + 1, juce::dontSendNotification);
+}
+
+void HP33120APluginAudioProcessorEditor::updateConnectionDisplay()
+{
+    // The IDN was read during connect - no device traffic here
+    if (audioProcessor.isDeviceConnecting())
+        idnLabel.setText("IDN: (Connecting...)", juce::dontSendNotification);
+    else if (audioProcessor.isDeviceConnected())
+        idnLabel.setText("IDN: " + juce::String(audioProcessor.getDeviceIDN()), juce::dontSendNotification);
     else
-    {
         idnLabel.setText("IDN: (Not connected)", juce::dontSendNotification);
-        idnCacheValid = false; // Reset cache on disconnect
-    }
     
-    // 2. Scan ALL 16 MIDI Channels for activity
+    midiIndicator = MidiIndicator::None;  // "Waiting" depends on the connection
+    updateMidiStatus();
+}
+
+void HP33120APluginAudioProcessorEditor::handleNoteOn(juce::MidiKeyboardState*, int, int, float)
+{
+    noteStateChanged.store(true, std::memory_order_release);
+}
+
+void HP33120APluginAudioProcessorEditor::handleNoteOff(juce::MidiKeyboardState*, int, int, float)
+{
+    noteStateChanged.store(true, std::memory_order_release);
+}
+
+void HP33120APluginAudioProcessorEditor::updateMidiStatus()
+{
     juce::int64 currentTime = juce::Time::currentTimeMillis();
-    bool hasActiveNotes = false;
     
-    for (int channel = 1; channel <= 16; ++channel)
+    // Scan ALL 16 MIDI Channels - only when a note has come or gone since the last scan
+    if (noteStateChanged.exchange(false, std::memory_order_acq_rel))
     {
-        for (int note = 0; note < 128; ++note)
-        {
-            if (audioProcessor.keyboardState.isNoteOn(channel, note))
-            {
-                hasActiveNotes = true;
-                lastMidiActivityTime = currentTime;
-                break;
-            }
-        }
-        if (hasActiveNotes) break;
+        notesHeld = false;
+        for (int channel = 1; channel <= 16 && !notesHeld; ++channel)
+            for (int note = 0; note < 128 && !notesHeld; ++note)
+                notesHeld = audioProcessor.keyboardState.isNoteOn(channel, note);
+        lastMidiActivityTime = currentTime;
     }
     
-    if (hasActiveNotes)
-    {
-        midiStatusLabel.setText("MIDI: Active", juce::dontSendNotification);
-        midiStatusLabel.setColour(juce::Label::textColourId, juce::Colours::green);
-    }
+    MidiIndicator indicator = MidiIndicator::Waiting;
+    if (notesHeld)
+        indicator = MidiIndicator::Active;
     else if (currentTime - lastMidiActivityTime < 500)
+        indicator = MidiIndicator::Received;
+    else if (!audioProcessor.isDeviceConnected())
+        indicator = MidiIndicator::WaitingForDevice;
+    
+    // The label only changes (and repaints) when the indicator does
+    if (indicator == midiIndicator) return;
+    midiIndicator = indicator;
+    
+    switch (indicator)
     {
-        midiStatusLabel.setText("MIDI: Received", juce::dontSendNotification);
-        midiStatusLabel.setColour(juce::Label::textColourId, juce::Colours::yellow);
-    }
-    else
-    {
-        if (!audioProcessor.isDeviceConnected())
-        {
+        case MidiIndicator::Active:
+            midiStatusLabel.setText("MIDI: Active", juce::dontSendNotification);
+            midiStatusLabel.setColour(juce::Label::textColourId, juce::Colours::green);
+            break;
+        case MidiIndicator::Received:
+            midiStatusLabel.setText("MIDI: Received", juce::dontSendNotification);
+            midiStatusLabel.setColour(juce::Label::textColourId, juce::Colours::yellow);
+            break;
+        case MidiIndicator::WaitingForDevice:
             midiStatusLabel.setText("MIDI: Waiting (Device not connected)", juce::dontSendNotification);
             midiStatusLabel.setColour(juce::Label::textColourId, juce::Colours::orange);
-        }
-        else
-        {
+            break;
+        case MidiIndicator::Waiting:
+        case MidiIndicator::None:
             midiStatusLabel.setText("MIDI: Waiting...", juce::dontSendNotification);
             midiStatusLabel.setColour(juce::Label::textColourId, juce::Colours::grey);
-        }
+            break;
     }
 }
 
 void HP33120APluginAudioProcessorEditor::buttonClicked(juce::Button* button)
 {
-    if (button == &connectButton)
+    if (button == &telemetryResetButton)
+    {
+        audioProcessor.getDevice().getTelemetry().reset();
+        refreshTelemetry();
+    }
+    else if (button == &telemetryCsvButton || button == &telemetryJsonButton)
+    {
+        exportTelemetry(button == &telemetryJsonButton);
+    }
+    else if (button == &storeProgramButton)
+    {
+        audioProcessor.storeCurrentProgram();
+        appendStatus("Stored " + audioProcessor.getProgramName(audioProcessor.getCurrentProgram()));
+    }
+    else if (button == &connectButton)
     {
         std::string address = gpibAddressEditor.getText().toStdString();
-        if (audioProcessor.connectDevice(address))
-        {
-            appendStatus("Connected to: " + address);
-            std::string idn = audioProcessor.getDeviceIDN();
-            appendStatus("Device IDN: " + idn);
-            
-            // PERFORMANCE: Cache IDN for timer callback (avoids expensive GPIB query every 100ms)
-            cachedDeviceIDN = juce::String(idn);
-            idnCacheValid = true;
+        if (audioProcessor.isDeviceConnecting()) return;
+        
+        // Opens, identifies and syncs in the background - the editor stays live meanwhile
+        appendStatus("Connecting to: " + address);
+        juce::Component::SafePointer<HP33120APluginAudioProcessorEditor> safeThis(this);
+        audioProcessor.connectDeviceAsync(address, [safeThis](const juce::String& message, bool finished, bool succeeded) {
+            if (safeThis == nullptr) return;
+            if (message.isNotEmpty()) safeThis->appendStatus(message);
+            if (!finished || !succeeded) return;
             
             // Query device for available waveforms and update combo boxes
-            refreshWaveformComboBoxesFromDevice();
-        }
-        else
-        {
-            appendStatus("Connection failed to: " + address);
-            appendStatus("Error: " + audioProcessor.getDevice().getLastError());
-        }
+            safeThis->refreshWaveformComboBoxesFromDevice();
+        });
     }
     else if (button == &disconnectButton)
     {
         audioProcessor.disconnectDevice();
         appendStatus("Disconnected");
-        // PERFORMANCE: Clear IDN cache on disconnect
-        idnCacheValid = false;
-        cachedDeviceIDN.clear();
     }
     // Check ARB slot buttons
     for (int i = 0; i < 4; ++i)
@@ -1190,7 +1341,11 @@ void HP33120APluginAudioProcessorEditor::buttonClicked(juce::Button* button)
         }
         else if (button == &arbSlotUIs[i].uploadButton)
         {
-            uploadSlotToDevice(i);
+            // Doubles as Cancel while the slot is queued or on the bus
+            if (audioProcessor.arbManager && audioProcessor.arbManager->isUploading(i))
+                audioProcessor.arbManager->cancelUpload(i);
+            else
+                uploadSlotToDevice(i);
             return;
         }
         else if (button == &arbSlotUIs[i].deleteButton)
@@ -1244,6 +1399,13 @@ void HP33120APluginAudioProcessorEditor::buttonClicked(juce::Button* button)
 
 void HP33120APluginAudioProcessorEditor::comboBoxChanged(juce::ComboBox* comboBox)
 {
+    if (comboBox == &programCombo)
+    {
+        // Works offline too - the recall waits for the connection
+        audioProcessor.setCurrentProgram(programCombo.getSelectedId() - 1);
+        return;
+    }
+    
     if (!audioProcessor.isDeviceConnected()) return;
     
     HP33120ADriver& device = audioProcessor.getDevice();
@@ -1418,23 +1580,23 @@ void HP33120APluginAudioProcessorEditor::updateSingleParameter(juce::Slider* sli
     
     if (slider == &frequencySlider) 
     {
-        cmdThread->queueFrequencyUpdate(frequencySlider.getValue());
+        cmdThread->queueUpdate(Parameters::DeviceParam::Frequency, frequencySlider.getValue());
     }
     else if (slider == &amplitudeSlider) 
     {
-        cmdThread->queueAmplitudeUpdate(amplitudeSlider.getValue());
+        cmdThread->queueUpdate(Parameters::DeviceParam::Amplitude, amplitudeSlider.getValue());
     }
     else if (slider == &offsetSlider) 
     {
-        cmdThread->queueOffsetUpdate(offsetSlider.getValue());
+        cmdThread->queueUpdate(Parameters::DeviceParam::Offset, offsetSlider.getValue());
     }
     else if (slider == &phaseSlider) 
     {
-        cmdThread->queuePhaseUpdate(phaseSlider.getValue());
+        cmdThread->queueUpdate(Parameters::DeviceParam::Phase, phaseSlider.getValue());
     }
     else if (slider == &dutyCycleSlider) 
     {
-        cmdThread->queueDutyCycleUpdate(dutyCycleSlider.getValue());
+        cmdThread->queueUpdate(Parameters::DeviceParam::DutyCycle, dutyCycleSlider.getValue());
     }
     else
     {
@@ -1794,7 +1956,8 @@ void HP33120APluginAudioProcessorEditor::loadAudioFileToSlot(int slotIndex)
             {
                 if (audioProcessor.arbManager && audioProcessor.audioFormatManager)
                 {
-                    bool success = audioProcessor.arbManager->loadAudioFile(slotIndex, file, *(audioProcessor.audioFormatManager.get()));
+                    bool success = audioProcessor.arbManager->loadAudioFile(slotIndex, file, *(audioProcessor.audioFormatManager.get()),
+                                                                            getImportOptions(slotIndex));
                     if (success)
                     {
                         arbSlotUIs[slotIndex].fileNameLabel.setText(file.getFileName(), juce::dontSendNotification);
@@ -1854,9 +2017,10 @@ void HP33120APluginAudioProcessorEditor::uploadSlotToDevice(int slotIndex)
         
         audioProcessor.arbManager->setSlotPointCount(slotIndex, pointCount);
         
-        // Set status to "Uploading..." immediately
-        arbSlotUIs[slotIndex].statusLabel.setText("Uploading...", juce::dontSendNotification);
+        // Set status to "Queued..." immediately - it turns into a percentage once on the bus
+        arbSlotUIs[slotIndex].statusLabel.setText("Queued...", juce::dontSendNotification);
         arbSlotUIs[slotIndex].statusLabel.setColour(juce::Label::textColourId, juce::Colours::orange);
+        arbSlotUIs[slotIndex].uploadButton.setButtonText("Cancel");
         appendStatus("ARB Slot " + juce::String(slotIndex + 1) + ": Starting upload...");
         
         // Use async upload to prevent UI freezing
@@ -1864,6 +2028,7 @@ void HP33120APluginAudioProcessorEditor::uploadSlotToDevice(int slotIndex)
             [this, slotIndex](int idx, bool success, const juce::String& message)
             {
                 // This callback runs on the message thread, safe to update UI
+                arbSlotUIs[idx].uploadButton.setButtonText("Upload");
                 if (success)
                 {
                     arbSlotUIs[idx].statusLabel.setText("Uploaded", juce::dontSendNotification);
@@ -1877,10 +2042,16 @@ void HP33120APluginAudioProcessorEditor::uploadSlotToDevice(int slotIndex)
                 }
                 else
                 {
-                    arbSlotUIs[idx].statusLabel.setText("Upload Failed", juce::dontSendNotification);
-                    arbSlotUIs[idx].statusLabel.setColour(juce::Label::textColourId, juce::Colours::red);
+                    bool cancelled = message == "Upload cancelled";
+                    arbSlotUIs[idx].statusLabel.setText(cancelled ? "Cancelled" : "Upload Failed", juce::dontSendNotification);
+                    arbSlotUIs[idx].statusLabel.setColour(juce::Label::textColourId, cancelled ? juce::Colours::orange : juce::Colours::red);
                     appendStatus("ARB Slot " + juce::String(idx + 1) + ": " + message);
                 }
+            },
+            [this](int idx, float progress)
+            {
+                arbSlotUIs[idx].statusLabel.setText("Uploading " + juce::String(juce::roundToInt(progress * 100.0f)) + "%",
+                                                    juce::dontSendNotification);
             });
     }
     catch (const std::exception& e)
@@ -1939,11 +2110,28 @@ void HP33120APluginAudioProcessorEditor::filesDropped(const juce::StringArray& f
 {
     if (files.isEmpty()) return;
     
-    juce::File file(files[0]);
-    if (!file.exists()) return;
-    
-    juce::String ext = file.getFileExtension().toLowerCase();
-    if (ext != ".wav" && ext != ".mp3") return;
+    // Audio files in drop order; a dropped folder contributes its audio files by name
+    juce::Array<juce::File> audioFiles;
+    auto isAudioFile = [](const juce::File& f) {
+        juce::String ext = f.getFileExtension().toLowerCase();
+        return ext == ".wav" || ext == ".mp3";
+    };
+    for (const auto& path : files)
+    {
+        juce::File f(path);
+        if (f.isDirectory())
+        {
+            auto children = f.findChildFiles(juce::File::findFiles, false, "*");
+            children.sort();
+            for (const auto& child : children)
+                if (isAudioFile(child)) audioFiles.add(child);
+        }
+        else if (f.existsAsFile() && isAudioFile(f))
+        {
+            audioFiles.add(f);
+        }
+    }
+    if (audioFiles.isEmpty()) return;
     
     // Determine which slot based on drop coordinates
     int slotIndex = -1;
@@ -1959,23 +2147,47 @@ void HP33120APluginAudioProcessorEditor::filesDropped(const juce::StringArray& f
     // If no specific slot found, use slot 0
     if (slotIndex < 0) slotIndex = 0;
     
-    // Load the file
-    if (audioProcessor.arbManager && audioProcessor.audioFormatManager)
+    if (!audioProcessor.arbManager) return;
+    
+    // Several files fill consecutive slots, prepared in parallel
+    for (int i = 0; i < audioFiles.size() && slotIndex + i < 4; ++i)
     {
-        bool success = audioProcessor.arbManager->loadAudioFile(slotIndex, file, *(audioProcessor.audioFormatManager.get()));
-        if (success)
-        {
-            arbSlotUIs[slotIndex].fileNameLabel.setText(file.getFileName(), juce::dontSendNotification);
-            arbSlotUIs[slotIndex].statusLabel.setText("Loaded", juce::dontSendNotification);
-            arbSlotUIs[slotIndex].statusLabel.setColour(juce::Label::textColourId, juce::Colours::green);
-            appendStatus("ARB Slot " + juce::String(slotIndex + 1) + ": Loaded " + file.getFileName() + " (drag & drop)");
-        }
-        else
+        arbSlotUIs[slotIndex + i].fileNameLabel.setText(audioFiles[i].getFileName(), juce::dontSendNotification);
+        arbSlotUIs[slotIndex + i].statusLabel.setText("Loading...", juce::dontSendNotification);
+        arbSlotUIs[slotIndex + i].statusLabel.setColour(juce::Label::textColourId, juce::Colours::orange);
+    }
+    if (slotIndex + audioFiles.size() > 4)
+        appendStatus("ARB: " + juce::String(slotIndex + audioFiles.size() - 4) + " dropped file(s) didn't fit in the remaining slots");
+    
+    audioProcessor.arbManager->loadAudioFilesAsync(slotIndex, audioFiles,
+        [this](int slot) { return getImportOptions(slot); },
+        [safeThis = juce::Component::SafePointer<HP33120APluginAudioProcessorEditor>(this)](int idx, bool success, const juce::String& message)
         {
-            arbSlotUIs[slotIndex].statusLabel.setText("Load Failed", juce::dontSendNotification);
-            arbSlotUIs[slotIndex].statusLabel.setColour(juce::Label::textColourId, juce::Colours::red);
-        }
+            // The editor may have been closed while the files were being prepared
+            if (safeThis != nullptr)
+                safeThis->showSlotLoadResult(idx, success, message + " (drag & drop)");
+        });
+}
+
+ARBManager::ImportOptions HP33120APluginAudioProcessorEditor::getImportOptions(int slotIndex) const
+{
+    return { arbSlotUIs[slotIndex].cycleToggle.getToggleState(),
+             (int)arbSlotUIs[slotIndex].cycleCountSlider.getValue() };
+}
+
+void HP33120APluginAudioProcessorEditor::showSlotLoadResult(int slotIndex, bool success, const juce::String& message)
+{
+    if (success)
+    {
+        arbSlotUIs[slotIndex].statusLabel.setText("Loaded", juce::dontSendNotification);
+        arbSlotUIs[slotIndex].statusLabel.setColour(juce::Label::textColourId, juce::Colours::green);
     }
+    else
+    {
+        arbSlotUIs[slotIndex].statusLabel.setText("Load Failed", juce::dontSendNotification);
+        arbSlotUIs[slotIndex].statusLabel.setColour(juce::Label::textColourId, juce::Colours::red);
+    }
+    appendStatus("ARB Slot " + juce::String(slotIndex + 1) + ": " + message);
 }
 
 void HP33120APluginAudioProcessorEditor::appendStatus(const juce::String& message)
@@ -1998,4 +2210,56 @@ void HP33120APluginAudioProcessorEditor::appendStatus(const juce::String& messag
     
     statusBox.setText(fullText);
     statusBox.moveCaretToEnd();
-}
\ No newline at end of file
+    repaint(getMessageCountArea());
+}
+//==============================================================================
+// Bus telemetry
+//==============================================================================
+void HP33120APluginAudioProcessorEditor::refreshTelemetry()
+{
+    auto snapshot = audioProcessor.getDevice().getTelemetry().snapshot();
+    
+    auto ms = [](double value) { return juce::String(value, value < 10.0 ? 2 : 1).paddedLeft(' ', 7); };
+    
+    juce::String text = juce::String("class (ms)").paddedRight(' ', 10) + "      n    p50    p99    max\n";
+    for (int i = 0; i < BusTelemetry::NUM_METRICS; ++i)
+    {
+        const auto& summary = snapshot.metrics[(size_t)i];
+        text << juce::String(BusTelemetry::getMetricName((BusTelemetry::Metric)i)).paddedRight(' ', 10)
+             << juce::String((juce::int64)summary.count).paddedLeft(' ', 7)
+             << ms(summary.p50Ms) << ms(summary.p99Ms) << ms(summary.maxMs) << "\n";
+    }
+    
+    text << "\nout " << juce::String(snapshot.writeBytesPerSecond / 1024.0, 2) << " KB/s"
+         << "   in " << juce::String(snapshot.readBytesPerSecond / 1024.0, 2) << " KB/s\n"
+         << "ARB block " << juce::String(snapshot.blockBytesPerSecond / 1024.0, 1) << " KB/s"
+         << "   (" << juce::String(snapshot.elapsedSeconds, 0) << " s)";
+    
+    // Avoid resetting the caret/selection when nothing changed
+    if (telemetryBox.getText() != text)
+        telemetryBox.setText(text, false);
+}
+
+void HP33120APluginAudioProcessorEditor::exportTelemetry(bool asJson)
+{
+    // Captured now, so the file matches what's on screen when the button was pressed
+    auto snapshot = audioProcessor.getDevice().getTelemetry().snapshot();
+    juce::String content = asJson ? BusTelemetry::toJSON(snapshot) : BusTelemetry::toCSV(snapshot);
+    
+    telemetryChooser = std::make_unique<juce::FileChooser>("Export bus telemetry",
+                                                           juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+                                                               .getChildFile(asJson ? "hp33120a-telemetry.json" : "hp33120a-telemetry.csv"),
+                                                           asJson ? "*.json" : "*.csv");
+    auto chooserFlags = juce::FileBrowserComponent::saveMode | juce::FileBrowserComponent::warnAboutOverwriting;
+    
+    telemetryChooser->launchAsync(chooserFlags, [this, content](const juce::FileChooser& fc)
+    {
+        auto file = fc.getResult();
+        if (file == juce::File()) return;  // Cancelled
+        
+        if (file.replaceWithText(content))
+            appendStatus("Telemetry exported: " + file.getFullPathName());
+        else
+            appendStatus("Telemetry export failed: " + file.getFullPathName());
+    });
+}
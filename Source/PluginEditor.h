@@ -6,6 +6,7 @@
 #include <juce_core/juce_core.h>
 #include <juce_events/juce_events.h>
 #include "PluginProcessor.h"
+#include "ARBManager.h"
 #include "Parameters.h"
 #include "VimLookAndFeel.h"
 
@@ -17,6 +18,8 @@ class HP33120APluginAudioProcessorEditor  : public juce::AudioProcessorEditor,
                                             public juce::Button::Listener,
                                             public juce::ComboBox::Listener,
                                             public juce::Slider::Listener,
+                                            public juce::ChangeListener,
+                                            private juce::MidiKeyboardState::Listener,
                                             public juce::FileDragAndDropTarget
 {
 public:
@@ -38,6 +41,9 @@ public:
     void sliderValueChanged(juce::Slider* slider) override;
     void sliderDragStarted(juce::Slider* slider) override;
     void sliderDragEnded(juce::Slider* slider) override;
+    
+    // Processor change messages - connection state and program changes
+    void changeListenerCallback(juce::ChangeBroadcaster* source) override;
 
 private:
     HP33120APluginAudioProcessor& audioProcessor;
@@ -49,6 +55,11 @@ private:
     juce::TextEditor gpibAddressEditor;
     juce::Label idnLabel;
     
+    // Programs - the first ones recall from the instrument's *SAV registers
+    juce::ComboBox programCombo;
+    juce::TextButton storeProgramButton;
+    void refreshProgramCombo();
+    
     // Basic Settings
     juce::GroupComponent basicGroup;
     juce::Label waveformLabel;
@@ -132,6 +143,8 @@ private:
         juce::TextButton deleteButton;
         juce::Label statusLabel;
         juce::Label fileNameLabel;  // Show loaded file name
+        juce::ToggleButton cycleToggle;  // Extract whole cycles instead of the whole file
+        juce::Slider cycleCountSlider;  // How many
         
         juce::Rectangle<int> bounds;  // Store bounds for drag-and-drop detection
         int slotIndex = 0;  // 0-3
@@ -146,12 +159,37 @@ private:
     juce::TextEditor statusBox;
     juce::Label midiStatusLabel;
     juce::int64 lastMidiActivityTime = 0;
+    
+    // Note activity - the keyboard state calls back on the audio thread and only raises
+    // a flag; the timer rescans the 16 x 128 note table when it has been raised
+    void handleNoteOn(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) override;
+    void handleNoteOff(juce::MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) override;
+    std::atomic<bool> noteStateChanged { false };
+    bool notesHeld = false;
+    enum class MidiIndicator { None, Active, Received, WaitingForDevice, Waiting };
+    MidiIndicator midiIndicator = MidiIndicator::None;
+    void updateMidiStatus();
+    void updateConnectionDisplay();
+    
+    // Header, status bar and section boxes don't change between repaints - drawn once
+    // into an image (at the display's pixel scale) and redrawn on resize
+    juce::Image staticArtwork;
+    float staticArtworkScale = 0.0f;
+    void drawStaticArtwork(juce::Graphics& g);
+    juce::Rectangle<int> getMessageCountArea() const;
     static constexpr int MAX_STATUS_MESSAGES = 30;  // Keep only last 30 messages
     juce::StringArray statusMessages;  // Circular buffer for status messages
     
-    // PERFORMANCE: Cache IDN to avoid expensive device query every 100ms in timer
-    juce::String cachedDeviceIDN;
-    bool idnCacheValid = false;
+    // Bus telemetry panel (see BusTelemetry.h) - refreshed from the timer, exportable
+    juce::TextEditor telemetryBox;
+    juce::TextButton telemetryResetButton;
+    juce::TextButton telemetryCsvButton;
+    juce::TextButton telemetryJsonButton;
+    std::unique_ptr<juce::FileChooser> telemetryChooser;
+    int telemetryRefreshTicks = 0;
+    static constexpr int TELEMETRY_REFRESH_TICKS = 5;  // 500ms at the 100ms timer
+    void refreshTelemetry();
+    void exportTelemetry(bool asJson);
     
     // Parameter attachments
     std::vector<std::unique_ptr<juce::AudioProcessorValueTreeState::SliderAttachment>> sliderAttachments;
@@ -166,6 +204,8 @@ private:
     
     // ARB slot management
     void loadAudioFileToSlot(int slotIndex);
+    ARBManager::ImportOptions getImportOptions(int slotIndex) const;
+    void showSlotLoadResult(int slotIndex, bool success, const juce::String& message);
     void uploadSlotToDevice(int slotIndex);
     void deleteARBFromDevice(int slotIndex);
     
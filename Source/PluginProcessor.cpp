@@ -1,6 +1,7 @@
 #include "PluginProcessor.h"
 #include "PluginEditor.h"
 #include "ARBManager.h"
+#include "DeviceParameterTable.h"
 
 // Helper function
 static juce::String formatFrequency(double freqHz)
@@ -10,6 +11,16 @@ static juce::String formatFrequency(double freqHz)
     else return juce::String(freqHz, 3) + " Hz";
 }
 
+// Menu entries for a choice parameter, in the order the instrument's table indexes them
+static juce::StringArray choicesFor(Parameters::DeviceParam param)
+{
+    const DeviceParameterTable::Command& command = DeviceParameterTable::get(param);
+    juce::StringArray names;
+    for (int i = 0; i < command.numChoices; ++i)
+        names.add(juce::String(command.choices[i].data(), command.choices[i].size()));
+    return names;
+}
+
 //==============================================================================
 HP33120APluginAudioProcessor::HP33120APluginAudioProcessor()
 #ifndef JucePlugin_PreferredChannelConfigurations
@@ -29,7 +40,7 @@ HP33120APluginAudioProcessor::HP33120APluginAudioProcessor()
             
             // Basic Settings - HP33120A: 100 µHz to 15 MHz (sine/square)
             std::make_unique<juce::AudioParameterChoice>(Parameters::WAVEFORM, "Waveform", 
-                juce::StringArray("SIN", "SQU", "TRI", "RAMP", "NOIS", "DC", "USER"), 0),
+                choicesFor(Parameters::DeviceParam::Waveform), 0),
             std::make_unique<juce::AudioParameterFloat>(Parameters::FREQUENCY, "Frequency", 
                 juce::NormalisableRange<float>(0.0001f, 15e6f, 0.0f, 0.25f), 1000.0f),
             std::make_unique<juce::AudioParameterFloat>(Parameters::AMPLITUDE, "Amplitude", 
@@ -47,9 +58,9 @@ HP33120APluginAudioProcessor::HP33120APluginAudioProcessor()
             std::make_unique<juce::AudioParameterFloat>(Parameters::AM_DEPTH, "AM Depth",
                 juce::NormalisableRange<float>(0.0f, 120.0f), 50.0f),
             std::make_unique<juce::AudioParameterChoice>(Parameters::AM_SOURCE, "AM Source",
-                juce::StringArray("BOTH", "EXT"), 0),
+                choicesFor(Parameters::DeviceParam::AMSource), 0),
             std::make_unique<juce::AudioParameterChoice>(Parameters::AM_INT_WAVEFORM, "AM Int Waveform",
-                juce::StringArray("SIN", "SQU", "TRI", "RAMP", "NOIS", "USER"), 0),
+                choicesFor(Parameters::DeviceParam::AMIntWaveform), 0),
             std::make_unique<juce::AudioParameterFloat>(Parameters::AM_INT_FREQ, "AM Int Frequency",
                 juce::NormalisableRange<float>(0.01f, 20000.0f, 0.0f, 0.3f), 100.0f),
             
@@ -58,9 +69,9 @@ HP33120APluginAudioProcessor::HP33120APluginAudioProcessor()
             std::make_unique<juce::AudioParameterFloat>(Parameters::FM_DEVIATION, "FM Deviation",
                 juce::NormalisableRange<float>(0.01f, 7.5e6f, 0.0f, 0.25f), 100.0f),
             std::make_unique<juce::AudioParameterChoice>(Parameters::FM_SOURCE, "FM Source",
-                juce::StringArray("INT", "EXT"), 0),
+                choicesFor(Parameters::DeviceParam::FMSource), 0),
             std::make_unique<juce::AudioParameterChoice>(Parameters::FM_INT_WAVEFORM, "FM Int Waveform",
-                juce::StringArray("SIN", "SQU", "TRI", "RAMP", "NOIS", "USER"), 0),
+                choicesFor(Parameters::DeviceParam::FMIntWaveform), 0),
             std::make_unique<juce::AudioParameterFloat>(Parameters::FM_INT_FREQ, "FM Int Frequency",
                 juce::NormalisableRange<float>(0.01f, 10000.0f, 0.0f, 0.3f), 10.0f),
             
@@ -69,7 +80,7 @@ HP33120APluginAudioProcessor::HP33120APluginAudioProcessor()
             std::make_unique<juce::AudioParameterFloat>(Parameters::FSK_FREQUENCY, "FSK Frequency",
                 juce::NormalisableRange<float>(0.0001f, 15e6f, 0.0f, 0.25f), 100.0f),
             std::make_unique<juce::AudioParameterChoice>(Parameters::FSK_SOURCE, "FSK Source",
-                juce::StringArray("INT", "EXT"), 0),
+                choicesFor(Parameters::DeviceParam::FSKSource), 0),
             std::make_unique<juce::AudioParameterFloat>(Parameters::FSK_RATE, "FSK Rate",
                 juce::NormalisableRange<float>(0.01f, 50000.0f, 0.0f, 0.3f), 10.0f),
             
@@ -91,7 +102,7 @@ HP33120APluginAudioProcessor::HP33120APluginAudioProcessor()
             std::make_unique<juce::AudioParameterFloat>(Parameters::BURST_INT_PERIOD, "Burst Int Period",
                 juce::NormalisableRange<float>(1e-6f, 3600.0f, 0.0f, 0.3f), 0.1f),
             std::make_unique<juce::AudioParameterChoice>(Parameters::BURST_SOURCE, "Burst Source",
-                juce::StringArray("INT", "EXT"), 0),
+                choicesFor(Parameters::DeviceParam::BurstSource), 0),
             
             // Sync Parameters - Full DAW automation
             std::make_unique<juce::AudioParameterBool>(Parameters::SYNC_ENABLED, "Sync Enabled", false),
@@ -100,7 +111,56 @@ HP33120APluginAudioProcessor::HP33120APluginAudioProcessor()
             
             // Trigger Parameters
             std::make_unique<juce::AudioParameterChoice>(Parameters::TRIGGER_SOURCE, "Trigger Source",
-                juce::StringArray("IMM", "EXT", "BUS"), 0),
+                choicesFor(Parameters::DeviceParam::TriggerSource), 0),
+            
+            // Multi-instrument - how MIDI notes are spread over the connected units
+            std::make_unique<juce::AudioParameterChoice>(Parameters::VOICE_MODE, "Voice Mode",
+                juce::StringArray("Unison", "MIDI Channel", "Polyphonic"), 0),
+            
+            // Mono voices - which held note plays, and portamento rendered by the instrument's sweep
+            std::make_unique<juce::AudioParameterChoice>(Parameters::NOTE_PRIORITY, "Note Priority",
+                juce::StringArray("Last", "Low", "High"), 0),
+            std::make_unique<juce::AudioParameterBool>(Parameters::LEGATO, "Legato", false),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::GLIDE_TIME, "Glide Time",
+                juce::NormalisableRange<float>(0.0f, 5000.0f, 0.0f, 0.3f), 0.0f),  // ms, 0 = off
+            
+            // Modulation - evaluated on the command thread at the bus update rate
+            std::make_unique<juce::AudioParameterChoice>(Parameters::MOD_SOURCE, "Mod Source",
+                juce::StringArray("Off", "LFO", "Envelope", "Step"), 0),
+            std::make_unique<juce::AudioParameterChoice>(Parameters::MOD_TARGET, "Mod Target",
+                juce::StringArray("Frequency", "Amplitude", "Duty Cycle", "AM Depth", "FM Deviation"), 0),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_DEPTH, "Mod Depth",
+                juce::NormalisableRange<float>(0.0f, 100.0f), 25.0f),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_RATE, "Mod Rate",
+                juce::NormalisableRange<float>(0.01f, 20.0f, 0.0f, 0.3f), 1.0f),
+            std::make_unique<juce::AudioParameterChoice>(Parameters::MOD_LFO_SHAPE, "Mod LFO Shape",
+                juce::StringArray("Sine", "Triangle", "Square", "Saw", "Random"), 0),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_ATTACK, "Mod Attack",
+                juce::NormalisableRange<float>(0.001f, 10.0f, 0.0f, 0.3f), 0.01f),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_DECAY, "Mod Decay",
+                juce::NormalisableRange<float>(0.001f, 10.0f, 0.0f, 0.3f), 0.3f),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_SUSTAIN, "Mod Sustain",
+                juce::NormalisableRange<float>(0.0f, 100.0f), 70.0f),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_RELEASE, "Mod Release",
+                juce::NormalisableRange<float>(0.001f, 10.0f, 0.0f, 0.3f), 0.5f),
+            std::make_unique<juce::AudioParameterInt>(Parameters::MOD_STEP_COUNT, "Mod Step Count", 2, 8, 8),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_STEP_1, "Mod Step 1", -100.0f, 100.0f, 0.0f),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_STEP_2, "Mod Step 2", -100.0f, 100.0f, 0.0f),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_STEP_3, "Mod Step 3", -100.0f, 100.0f, 0.0f),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_STEP_4, "Mod Step 4", -100.0f, 100.0f, 0.0f),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_STEP_5, "Mod Step 5", -100.0f, 100.0f, 0.0f),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_STEP_6, "Mod Step 6", -100.0f, 100.0f, 0.0f),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_STEP_7, "Mod Step 7", -100.0f, 100.0f, 0.0f),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MOD_STEP_8, "Mod Step 8", -100.0f, 100.0f, 0.0f),
+            
+            // Wavetable morph - Rate 0 leaves the position to Morph Position
+            std::make_unique<juce::AudioParameterBool>(Parameters::MORPH_ENABLED, "Morph Enabled", false),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MORPH_POSITION, "Morph Position",
+                juce::NormalisableRange<float>(0.0f, 1.0f), 0.0f),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MORPH_RATE, "Morph Rate",
+                juce::NormalisableRange<float>(0.0f, 5.0f, 0.0f, 0.4f), 0.0f),
+            std::make_unique<juce::AudioParameterFloat>(Parameters::MORPH_FRAME_RATE, "Morph Frame Rate",
+                juce::NormalisableRange<float>(1.0f, 50.0f), 10.0f),
             
             // ARB Slot Parameters (4 slots)
             std::make_unique<juce::AudioParameterInt>(Parameters::ARB_SLOT1_POINTS, "ARB Slot 1 Points", 8, 16000, 1024),
@@ -114,76 +174,75 @@ HP33120APluginAudioProcessor::HP33120APluginAudioProcessor()
     frequencyParam = parameters.getRawParameterValue(Parameters::FREQUENCY);
     amplitudeParam = parameters.getRawParameterValue(Parameters::AMPLITUDE);
     outputEnabledParam = parameters.getRawParameterValue(Parameters::OUTPUT_ENABLED);
+    triggerSourceParam = parameters.getRawParameterValue(Parameters::TRIGGER_SOURCE);
+    voiceModeParam = parameters.getRawParameterValue(Parameters::VOICE_MODE);
+    notePriorityParam = parameters.getRawParameterValue(Parameters::NOTE_PRIORITY);
+    legatoParam = parameters.getRawParameterValue(Parameters::LEGATO);
+    glideTimeParam = parameters.getRawParameterValue(Parameters::GLIDE_TIME);
+    
+    modulationEngine = std::make_unique<ModulationEngine>(parameters);
+    instrumentPool = std::make_unique<InstrumentPool>(device);
+    voiceEngine = std::make_unique<VoiceEngine>(*instrumentPool);
     
     // Start background thread for non-blocking device communication
     deviceCommandThread = std::make_unique<DeviceCommandThread>(device);
+    deviceCommandThread->setModulationEngine(modulationEngine.get());
+    deviceCommandThread->setInstrumentPool(instrumentPool.get());
+    deviceCommandThread->onNoteEvent = [this](const DeviceCommandThread::NoteEvent& event) {
+        // Formatted off the audio thread, shown on the message thread
+        juce::String logMsg = "MIDI On: " + juce::String(event.note) +
+                              " -> Freq: " + formatFrequency(event.frequency);
+        juce::MessageManager::callAsync([this, logMsg]() {
+            if (midiStatusCallback) midiStatusCallback(logMsg);
+        });
+    };
     deviceCommandThread->startThread();
     
+    midiScheduler = std::make_unique<MidiEventScheduler>(device);
+    midiScheduler->setInstrumentPool(instrumentPool.get());
+    midiScheduler->startThread(juce::Thread::Priority::highest);
+    
     // Initialize ARB Manager
     arbManager = std::make_unique<ARBManager>(device);
     
+    wavetableMorph = std::make_unique<WavetableMorph>(device, *arbManager, parameters);
+    wavetableMorph->startThread();
+    
     // Add parameter listener to handle automation/LFO changes
     // This enables full DAW automation for ALL device parameters
-    parameterListener = std::make_unique<ParameterListener>(*this);
-    
-    // Basic parameters
-    parameters.addParameterListener(Parameters::WAVEFORM, parameterListener.get());
-    parameters.addParameterListener(Parameters::FREQUENCY, parameterListener.get());
-    parameters.addParameterListener(Parameters::AMPLITUDE, parameterListener.get());
-    parameters.addParameterListener(Parameters::OFFSET, parameterListener.get());
-    parameters.addParameterListener(Parameters::PHASE, parameterListener.get());
-    parameters.addParameterListener(Parameters::DUTY_CYCLE, parameterListener.get());
-    parameters.addParameterListener(Parameters::OUTPUT_ENABLED, parameterListener.get());
-    
-    // AM parameters
-    parameters.addParameterListener(Parameters::AM_ENABLED, parameterListener.get());
-    parameters.addParameterListener(Parameters::AM_DEPTH, parameterListener.get());
-    parameters.addParameterListener(Parameters::AM_SOURCE, parameterListener.get());
-    parameters.addParameterListener(Parameters::AM_INT_WAVEFORM, parameterListener.get());
-    parameters.addParameterListener(Parameters::AM_INT_FREQ, parameterListener.get());
-    
-    // FM parameters
-    parameters.addParameterListener(Parameters::FM_ENABLED, parameterListener.get());
-    parameters.addParameterListener(Parameters::FM_DEVIATION, parameterListener.get());
-    parameters.addParameterListener(Parameters::FM_SOURCE, parameterListener.get());
-    parameters.addParameterListener(Parameters::FM_INT_WAVEFORM, parameterListener.get());
-    parameters.addParameterListener(Parameters::FM_INT_FREQ, parameterListener.get());
-    
-    // FSK parameters
-    parameters.addParameterListener(Parameters::FSK_ENABLED, parameterListener.get());
-    parameters.addParameterListener(Parameters::FSK_FREQUENCY, parameterListener.get());
-    parameters.addParameterListener(Parameters::FSK_SOURCE, parameterListener.get());
-    parameters.addParameterListener(Parameters::FSK_RATE, parameterListener.get());
-    
-    // Sweep parameters
-    parameters.addParameterListener(Parameters::SWEEP_ENABLED, parameterListener.get());
-    parameters.addParameterListener(Parameters::SWEEP_START, parameterListener.get());
-    parameters.addParameterListener(Parameters::SWEEP_STOP, parameterListener.get());
-    parameters.addParameterListener(Parameters::SWEEP_TIME, parameterListener.get());
-    
-    // Burst parameters
-    parameters.addParameterListener(Parameters::BURST_ENABLED, parameterListener.get());
-    parameters.addParameterListener(Parameters::BURST_CYCLES, parameterListener.get());
-    parameters.addParameterListener(Parameters::BURST_PHASE, parameterListener.get());
-    parameters.addParameterListener(Parameters::BURST_INT_PERIOD, parameterListener.get());
-    parameters.addParameterListener(Parameters::BURST_SOURCE, parameterListener.get());
-    
-    // Sync parameters
-    parameters.addParameterListener(Parameters::SYNC_ENABLED, parameterListener.get());
-    parameters.addParameterListener(Parameters::SYNC_PHASE, parameterListener.get());
-    
-    // Trigger parameters
-    parameters.addParameterListener(Parameters::TRIGGER_SOURCE, parameterListener.get());
+    for (int i = 0; i < Parameters::NUM_DEVICE_PARAMS; ++i)
+    {
+        parameterListeners.push_back(std::make_unique<ParameterListener>(*this, (Parameters::DeviceParam)i));
+        parameters.addParameterListener(Parameters::DEVICE_PARAM_IDS[i], parameterListeners.back().get());
+    }
 }
 
 HP33120APluginAudioProcessor::~HP33120APluginAudioProcessor()
 {
+    cancelPendingUpdate();  // A program change still on its way from the audio thread
+    // A connect in progress uses everything below and can't be interrupted - wait it out
+    // (the VISA timeouts bound it) rather than let it run on into a destroyed processor
+    connectPool.removeAllJobs(true, -1);
+    
+    // Reads the ARB slots - stop it before anything else goes (its destructor does)
+    wavetableMorph = nullptr;
+    
+    if (midiScheduler)
+    {
+        midiScheduler->stopScheduler();
+        midiScheduler = nullptr;
+    }
+    
     // Stop background thread safely
     if (deviceCommandThread)
     {
         deviceCommandThread->stopThreadSafely();
         deviceCommandThread = nullptr;
     }
+    
+    // Last - the threads above hand work to its units
+    voiceEngine = nullptr;
+    instrumentPool = nullptr;
 }
 
 
@@ -206,14 +265,82 @@ bool HP33120APluginAudioProcessor::isMidiEffect() const
    #endif
 }
 double HP33120APluginAudioProcessor::getTailLengthSeconds() const { return 0.0; }
-int HP33120APluginAudioProcessor::getNumPrograms() { return 1; }
-int HP33120APluginAudioProcessor::getCurrentProgram() { return 0; }
-void HP33120APluginAudioProcessor::setCurrentProgram (int) {}
-const juce::String HP33120APluginAudioProcessor::getProgramName (int) { return {}; }
-void HP33120APluginAudioProcessor::changeProgramName (int, const juce::String&) {}
+int HP33120APluginAudioProcessor::getNumPrograms() { return ProgramBank::NUM_PROGRAMS; }
+int HP33120APluginAudioProcessor::getCurrentProgram() { return programs.getCurrent(); }
+
+void HP33120APluginAudioProcessor::setCurrentProgram (int index)
+{
+    if (!ProgramBank::isValid(index)) return;
+    programs.setCurrent(index);
+    
+    auto& program = programs[index];
+    if (!program.stored)
+    {
+        // Empty slot - it takes over the panel as it is
+        program.values = currentDeviceState();
+        program.stored = true;
+    }
+    else
+    {
+        applyToParameters(program.values);
+    }
+    
+    // The program's own values rather than the parameters' - those have been through
+    // the float normalisation, and the register is matched against what was saved
+    syncDeviceState(program.values, ProgramBank::stateRegisterFor(index));
+    sendChangeMessage();
+}
 
-void HP33120APluginAudioProcessor::prepareToPlay (double /*sampleRate*/, int /*samplesPerBlock*/)
+const juce::String HP33120APluginAudioProcessor::getProgramName (int index)
 {
+    return ProgramBank::isValid(index) ? programs[index].name : juce::String();
+}
+
+void HP33120APluginAudioProcessor::changeProgramName (int index, const juce::String& newName)
+{
+    if (ProgramBank::isValid(index)) programs[index].name = newName;
+}
+
+void HP33120APluginAudioProcessor::storeCurrentProgram()
+{
+    auto& program = programs[programs.getCurrent()];
+    program.values = currentDeviceState();
+    program.stored = true;
+    
+    // The instrument already has these values, so this comes down to the readback and a *SAV
+    syncDeviceState(program.values, ProgramBank::stateRegisterFor(programs.getCurrent()));
+}
+
+// Host parameters follow a program - their listener callbacks are ignored, the
+// program's recall request covers the instrument
+void HP33120APluginAudioProcessor::applyToParameters(const StateSyncRequest::Values& values)
+{
+    restoringState.store(true);
+    for (int i = 0; i < Parameters::NUM_DEVICE_PARAMS; ++i)
+    {
+        if (auto* param = parameters.getParameter(Parameters::DEVICE_PARAM_IDS[i]))
+            param->setValueNotifyingHost(param->convertTo0to1((float)values[(size_t)i]));
+    }
+    restoringState.store(false);
+}
+
+void HP33120APluginAudioProcessor::handleAsyncUpdate()
+{
+    int index = pendingProgramChange.exchange(-1);
+    if (ProgramBank::isValid(index))
+    {
+        setCurrentProgram(index);
+        updateHostDisplay();
+    }
+}
+
+void HP33120APluginAudioProcessor::prepareToPlay (double sampleRate, int samplesPerBlock)
+{
+    // Report the scheduler's look-ahead so the host delivers notes early enough
+    // for the device change to coincide with the audio
+    midiScheduler->prepare(sampleRate, samplesPerBlock);
+    setLatencySamples(midiScheduler->getLatencySamples());
+    
     // Initialize audio format manager for WAV/MP3
     audioFormatManager = std::make_unique<juce::AudioFormatManager>();
     audioFormatManager->registerFormat(new juce::WavAudioFormat(), true);
@@ -249,6 +376,9 @@ void HP33120APluginAudioProcessor::processBlock (juce::AudioBuffer<float>& buffe
     // Update keyboard state for UI
     keyboardState.processNextMidiBuffer(midiMessages, 0, buffer.getNumSamples(), true);
     
+    // Map this block's sample positions to wall-clock time
+    midiScheduler->beginBlock(buffer.getNumSamples());
+    
     // Process MIDI
     if (midiMessages.getNumEvents() > 0)
     {
@@ -265,78 +395,191 @@ void HP33120APluginAudioProcessor::handleMIDI(const juce::MidiBuffer& midiMessag
 {
     if (!device.isConnected())
     {
-        // Don't log spam if not connected, just exit
+        // Don't log spam if not connected, just exit - held notes are forgotten, so
+        // nothing glides from a note played before the connection
+        voiceEngine->allNotesOff();
         return;
     }
     
+    VoiceEngine::Settings voiceSettings;
+    voiceSettings.mode = (InstrumentPool::VoiceMode)(int)voiceModeParam->load();
+    voiceSettings.priority = (NoteStack::Priority)(int)notePriorityParam->load();
+    voiceSettings.legato = legatoParam->load() > 0.5f;
+    voiceSettings.glideMs = glideTimeParam->load() >= HP33120ADriver::MIN_GLIDE_MS ? (double)glideTimeParam->load() : 0.0;
+    
+    // Trigger Source BUS: bursts and sweeps start on the note (a glide takes the sweep over)
+    const auto& triggerCommand = DeviceParameterTable::get(Parameters::DeviceParam::TriggerSource);
+    const bool busTriggered = (int)triggerSourceParam->load() == DeviceParameterTable::choiceIndex(triggerCommand, "BUS");
+    
     for (const auto metadata : midiMessages)
     {
         auto message = metadata.getMessage();
+        VoiceEngine::Action action;
         
         if (message.isNoteOn())
         {
-            int note = message.getNoteNumber();
+            action = voiceEngine->noteOn(message.getChannel(), message.getNoteNumber(), voiceSettings);
+        }
+        else if (message.isNoteOff())
+        {
+            action = voiceEngine->noteOff(message.getChannel(), message.getNoteNumber(), voiceSettings);
+        }
+        else if (message.isAllNotesOff() || message.isAllSoundOff())
+        {
+            voiceEngine->allNotesOff();
+            modulationEngine->noteOff();
+        }
+        else if (message.isProgramChange())
+        {
+            // Parameters and the recall request belong on the message thread; the latest one wins
+            pendingProgramChange.store(message.getProgramChangeNumber());
+            triggerAsyncUpdate();
+        }
+        
+        if (action.type == VoiceEngine::Action::Type::Release)
+        {
+            modulationEngine->noteOff();
+        }
+        else if (action.type == VoiceEngine::Action::Type::Play)
+        {
+            // 1. Calculate Frequency (A4 = 440Hz)
+            double freq = 440.0 * std::pow(2.0, (action.note - 69) / 12.0);
+            
+            // Rounding for display/device cleanliness
+            if (freq < 1.0) freq = std::round(freq * 100.0) / 100.0;
+            else if (freq < 1e3) freq = std::round(freq * 10.0) / 10.0;
+            else freq = std::round(freq);
+            
+            // 2. Update UI Parameter immediately (fast, non-blocking)
+            if (frequencyParam) *frequencyParam = (float)freq;
+            
+            if (action.retrigger)
+                modulationEngine->noteOn();  // Envelope gate
             
-            if (message.getVelocity() > 0)
+            // 3. Schedule the device update for the moment this sample is heard - a glide
+            //    starts the instrument's sweep then, a bus-triggered note fires the trigger
+            //    (falls back to the command threads, without either, if the scheduler FIFO is full)
+            const bool trigger = busTriggered && action.retrigger && action.glideMs <= 0.0;
+            if (!midiScheduler->scheduleFrequency(metadata.samplePosition, freq, action.unit, action.glideMs, trigger))
             {
-                // 1. Calculate Frequency (A4 = 440Hz)
-                double freq = 440.0 * std::pow(2.0, (note - 69) / 12.0);
-                
-                // Rounding for display/device cleanliness
-                if (freq < 1.0) freq = std::round(freq * 100.0) / 100.0;
-                else if (freq < 1e3) freq = std::round(freq * 10.0) / 10.0;
-                else freq = std::round(freq);
-                
-                // 2. Update UI Parameter immediately (fast, non-blocking)
-                if (frequencyParam) *frequencyParam = (float)freq;
-                
-                // 3. Queue device update in background thread (non-blocking, prevents audio thread stalls)
                 auto* cmdThread = getDeviceCommandThread();
-                if (cmdThread)
-                    cmdThread->queueFrequencyUpdate(freq);
-                
-                // 4. Log to UI (THREAD SAFE FIX)
-                // We must perform the callback on the Message Thread, otherwise the App crashes/freezes
-                if (midiStatusCallback)
-                {
-                    juce::String logMsg = "MIDI On: " + juce::String(note) + 
-                                          " -> Freq: " + formatFrequency(freq);
-                                          
-                    juce::MessageManager::callAsync([this, logMsg]() {
-                        if (midiStatusCallback) midiStatusCallback(logMsg);
-                    });
-                }
+                if (action.unit > 0)
+                    instrumentPool->queueUpdate(action.unit, Parameters::DeviceParam::Frequency, freq);
+                else if (cmdThread)
+                    cmdThread->queueUpdate(Parameters::DeviceParam::Frequency, freq);
             }
+            
+            // 4. Log to UI - the string is built on DeviceCommandThread, so nothing
+            //    allocates here (see onNoteEvent in the constructor)
+            if (midiStatusCallback && deviceCommandThread)
+                deviceCommandThread->pushNoteEvent({ action.note, freq });
         }
     }
 }
 
 // Device connection wrappers
-bool HP33120APluginAudioProcessor::connectDevice(const std::string& resourceName)
+void HP33120APluginAudioProcessor::connectDeviceAsync(const std::string& resourceName, ConnectProgress onProgress)
 {
-    if (device.connect(resourceName))
+    juce::StringArray resources;
+    resources.addTokens(juce::String(resourceName), ",", "\"");
+    resources.trim();
+    resources.removeEmptyStrings();
+    if (resources.isEmpty()) resources.add(juce::String(resourceName));
+    
+    // Progress goes to the message thread; the callback doesn't touch the processor
+    ConnectProgress post = [onProgress](const juce::String& message, bool finished, bool succeeded) {
+        juce::MessageManager::callAsync([onProgress, message, finished, succeeded]() {
+            if (onProgress) onProgress(message, finished, succeeded);
+        });
+    };
+    connectPool.addJob([this, resources, post]() {
+        connectDevices(resources, post);  // Broadcasts "connecting" itself
+        sendChangeMessage();
+    });
+}
+
+void HP33120APluginAudioProcessor::connectDevices(const juce::StringArray& resources, ConnectProgress post)
+{
+    using Stage = HP33120ADriver::ConnectStage;
+    const uint32_t generation = stateGeneration.load();  // Before the snapshot: a change during it counts
+    const auto values = currentDeviceState();  // Atomic reads - fine off the message thread
+    const std::string primaryResource = resources[0].toStdString();
+    
+    instrumentPool->disconnectUnits();
+    instrumentPool->attachPrimary(primaryResource);
+    
+    // Unit 0 on its own driver's worker while this thread brings up the rest
+    struct PrimaryOutcome { std::atomic<bool> connected { false }; juce::WaitableEvent done; };
+    auto primaryOutcome = std::make_shared<PrimaryOutcome>();
+    device.connectAsync(primaryResource, [post, primaryOutcome, primaryResource](Stage stage, const std::string& detail) {
+        switch (stage)
+        {
+            case Stage::Opening:      post("Opening " + juce::String(primaryResource) + "...", false, false); break;
+            case Stage::Identifying:  break;
+            case Stage::SyncingState: post("Device IDN: " + juce::String(detail), false, false); break;
+            case Stage::Connected:
+                primaryOutcome->connected = true;
+                primaryOutcome->done.signal();
+                break;
+            case Stage::Failed:
+                post("Connection failed to: " + juce::String(primaryResource), false, false);
+                post("Error: " + juce::String(detail), false, false);
+                primaryOutcome->done.signal();
+                break;
+        }
+    }, values);
+    sendChangeMessage();  // Connecting - connectAsync() has set it, so listeners see it
+    
+    std::vector<std::string> others;
+    for (int i = 1; i < resources.size(); ++i)
+        others.push_back(resources[i].toStdString());
+    int extraUnits = instrumentPool->connectUnits(others, values);
+    primaryOutcome->done.wait();
+    
+    if (!primaryOutcome->connected)
+    {
+        // Units without unit 0 would only get half of the changes
+        instrumentPool->disconnectUnits();
+        post("", true, false);
+        return;
+    }
+    
+    // The state went out as it was when connecting started. Changes made since were
+    // either dropped (not connected yet) or queued - only then is another read-back
+    // and diff against the current values worth it.
+    if (stateGeneration.load() != generation)
+        syncDeviceState(currentDeviceState());
+    if (deviceCommandThread) deviceCommandThread->notify();
+    post("Connected to: " + resources[0], false, false);
+    if (extraUnits > 0)
+        post("Instruments connected: " + juce::String(extraUnits + 1), false, false);
+    
+    // Sync ARBs from device on successful connection
+    // Note: HP33120A doesn't support querying ARB names, so sync just resets state
+    if (arbManager)
     {
-        // Sync ARBs from device on successful connection
-        // Note: HP33120A doesn't support querying ARB names, so sync just resets state
-        if (arbManager)
+        try
         {
-            try
-            {
-                arbManager->syncFromDevice();
-            }
-            catch (...)
-            {
-                // Ignore any exceptions from sync - device doesn't support ARB queries
-            }
+            arbManager->syncFromDevice();
+        }
+        catch (...)
+        {
+            // Ignore any exceptions from sync - device doesn't support ARB queries
         }
-        return true;
     }
-    return false;
+    post("", true, true);
+}
+
+void HP33120APluginAudioProcessor::disconnectDevice()
+{
+    connectPool.addJob([this]() {
+        instrumentPool->disconnectUnits();
+        device.disconnect();
+        sendChangeMessage();
+    });
 }
-void HP33120APluginAudioProcessor::disconnectDevice() { device.disconnect(); }
-std::string HP33120APluginAudioProcessor::getDeviceIDN() { return device.queryIDN(); }
 
-HP33120APluginAudioProcessor::DeviceCommandThread* HP33120APluginAudioProcessor::getDeviceCommandThread()
+DeviceCommandThread* HP33120APluginAudioProcessor::getDeviceCommandThread()
 {
     return deviceCommandThread.get();
 }
@@ -352,6 +595,7 @@ void HP33120APluginAudioProcessor::updateParameter(const juce::String& paramID,
 void HP33120APluginAudioProcessor::getStateInformation (juce::MemoryBlock& destData)
 {
     auto state = parameters.copyState();
+    programs.writeTo(state);
     std::unique_ptr<juce::XmlElement> xml (state.createXml());
     copyXmlToBinary (*xml, destData);
 }
@@ -360,884 +604,59 @@ void HP33120APluginAudioProcessor::setStateInformation (const void* data, int si
 {
     std::unique_ptr<juce::XmlElement> xmlState (getXmlFromBinary (data, sizeInBytes));
     if (xmlState.get() != nullptr && xmlState->hasTagName (parameters.state.getType()))
-        parameters.replaceState (juce::ValueTree::fromXml (*xmlState));
-}
-
-juce::AudioProcessorEditor* HP33120APluginAudioProcessor::createEditor() { return new HP33120APluginAudioProcessorEditor (*this); }
-bool HP33120APluginAudioProcessor::hasEditor() const { return true; }
-juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter() { return new HP33120APluginAudioProcessor(); }
-
-//==============================================================================
-// Background Thread Implementation for Non-Blocking Device Communication
-//==============================================================================
-
-// Helper function to convert waveform index to SCPI string
-static const char* waveformIndexToString(int index)
-{
-    static const char* waveforms[] = {"SIN", "SQU", "TRI", "RAMP", "NOIS", "DC", "USER"};
-    if (index >= 0 && index < 7) return waveforms[index];
-    return "SIN";
-}
-
-// Helper for AM/FM internal waveforms (no DC option)
-static const char* modWaveformIndexToString(int index)
-{
-    static const char* waveforms[] = {"SIN", "SQU", "TRI", "RAMP", "NOIS", "USER"};
-    if (index >= 0 && index < 6) return waveforms[index];
-    return "SIN";
-}
-
-// Helper for AM source
-static const char* amSourceIndexToString(int index)
-{
-    static const char* sources[] = {"BOTH", "EXT"};
-    if (index >= 0 && index < 2) return sources[index];
-    return "BOTH";
-}
-
-// Helper for FM/FSK source
-static const char* fmFskSourceIndexToString(int index)
-{
-    static const char* sources[] = {"INT", "EXT"};
-    if (index >= 0 && index < 2) return sources[index];
-    return "INT";
-}
-
-// Helper for Burst source
-static const char* burstSourceIndexToString(int index)
-{
-    static const char* sources[] = {"INT", "EXT"};
-    if (index >= 0 && index < 2) return sources[index];
-    return "INT";
-}
-
-// Helper for Trigger source
-static const char* triggerSourceIndexToString(int index)
-{
-    static const char* sources[] = {"IMM", "EXT", "BUS"};
-    if (index >= 0 && index < 3) return sources[index];
-    return "IMM";
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::run()
-{
-    while (!threadShouldExit())
     {
-        // Wait for a command with timeout - allows periodic error checking
-        commandPending.wait(100);  // 100ms timeout for responsive error checking
-        
-        if (!device.isConnected()) continue;
-        
-        // ==================== BASIC PARAMETERS ====================
-        if (hasPendingWaveform.load())
-        {
-            int wfIndex = pendingWaveform.load();
-            hasPendingWaveform = false;
-            device.setWaveform(waveformIndexToString(wfIndex));
-        }
-        
-        if (hasPendingOutput.load())
-        {
-            bool enabled = pendingOutput.load();
-            hasPendingOutput = false;
-            device.setOutputEnabled(enabled);
-        }
-        
-        if (hasPendingFreq.load())
-        {
-            double freq = pendingFreq.load();
-            hasPendingFreq = false;
-            device.setFrequency(freq);
-        }
-        
-        if (hasPendingAmp.load())
-        {
-            double amp = pendingAmp.load();
-            hasPendingAmp = false;
-            device.setAmplitude(amp);
-        }
-        
-        if (hasPendingOffset.load())
-        {
-            double offset = pendingOffset.load();
-            hasPendingOffset = false;
-            device.setOffset(offset);
-        }
-        
-        if (hasPendingPhase.load())
-        {
-            double phase = pendingPhase.load();
-            hasPendingPhase = false;
-            device.setPhase(phase);
-        }
-        
-        if (hasPendingDuty.load())
-        {
-            double duty = pendingDuty.load();
-            hasPendingDuty = false;
-            device.setDutyCycle(duty);
-        }
-        
-        // ==================== AM PARAMETERS ====================
-        if (hasPendingAMEnabled.load())
-        {
-            bool enabled = pendingAMEnabled.load();
-            hasPendingAMEnabled = false;
-            device.setAMEnabled(enabled);
-        }
-        
-        if (hasPendingAMDepth.load())
-        {
-            double depth = pendingAMDepth.load();
-            hasPendingAMDepth = false;
-            device.setAMDepth(depth);
-        }
-        
-        if (hasPendingAMSource.load())
-        {
-            int sourceIdx = pendingAMSource.load();
-            hasPendingAMSource = false;
-            device.setAMSource(amSourceIndexToString(sourceIdx));
-        }
-        
-        if (hasPendingAMIntWaveform.load())
-        {
-            int wfIdx = pendingAMIntWaveform.load();
-            hasPendingAMIntWaveform = false;
-            device.setAMInternalWaveform(modWaveformIndexToString(wfIdx));
-        }
-        
-        if (hasPendingAMIntFreq.load())
-        {
-            double freq = pendingAMIntFreq.load();
-            hasPendingAMIntFreq = false;
-            device.setAMInternalFrequency(freq);
-        }
-        
-        // ==================== FM PARAMETERS ====================
-        if (hasPendingFMEnabled.load())
-        {
-            bool enabled = pendingFMEnabled.load();
-            hasPendingFMEnabled = false;
-            device.setFMEnabled(enabled);
-        }
-        
-        if (hasPendingFMDeviation.load())
-        {
-            double dev = pendingFMDeviation.load();
-            hasPendingFMDeviation = false;
-            device.setFMDeviation(dev);
-        }
-        
-        if (hasPendingFMSource.load())
-        {
-            int sourceIdx = pendingFMSource.load();
-            hasPendingFMSource = false;
-            device.setFMSource(fmFskSourceIndexToString(sourceIdx));
-        }
-        
-        if (hasPendingFMIntWaveform.load())
-        {
-            int wfIdx = pendingFMIntWaveform.load();
-            hasPendingFMIntWaveform = false;
-            device.setFMInternalWaveform(modWaveformIndexToString(wfIdx));
-        }
-        
-        if (hasPendingFMIntFreq.load())
-        {
-            double freq = pendingFMIntFreq.load();
-            hasPendingFMIntFreq = false;
-            device.setFMInternalFrequency(freq);
-        }
-        
-        // ==================== FSK PARAMETERS ====================
-        if (hasPendingFSKEnabled.load())
-        {
-            bool enabled = pendingFSKEnabled.load();
-            hasPendingFSKEnabled = false;
-            device.setFSKEnabled(enabled);
-        }
-        
-        if (hasPendingFSKFrequency.load())
-        {
-            double freq = pendingFSKFrequency.load();
-            hasPendingFSKFrequency = false;
-            device.setFSKFrequency(freq);
-        }
-        
-        if (hasPendingFSKSource.load())
-        {
-            int sourceIdx = pendingFSKSource.load();
-            hasPendingFSKSource = false;
-            device.setFSKSource(fmFskSourceIndexToString(sourceIdx));
-        }
-        
-        if (hasPendingFSKRate.load())
-        {
-            double rate = pendingFSKRate.load();
-            hasPendingFSKRate = false;
-            device.setFSKInternalRate(rate);
-        }
-        
-        // ==================== SWEEP PARAMETERS ====================
-        if (hasPendingSweepEnabled.load())
-        {
-            bool enabled = pendingSweepEnabled.load();
-            hasPendingSweepEnabled = false;
-            device.setSweepEnabled(enabled);
-        }
-        
-        if (hasPendingSweepStart.load())
-        {
-            double freq = pendingSweepStart.load();
-            hasPendingSweepStart = false;
-            device.setSweepStartFreq(freq);
-        }
-        
-        if (hasPendingSweepStop.load())
-        {
-            double freq = pendingSweepStop.load();
-            hasPendingSweepStop = false;
-            device.setSweepStopFreq(freq);
-        }
-        
-        if (hasPendingSweepTime.load())
-        {
-            double time = pendingSweepTime.load();
-            hasPendingSweepTime = false;
-            device.setSweepTime(time);
-        }
-        
-        // ==================== BURST PARAMETERS ====================
-        if (hasPendingBurstEnabled.load())
-        {
-            bool enabled = pendingBurstEnabled.load();
-            hasPendingBurstEnabled = false;
-            device.setBurstEnabled(enabled);
-        }
-        
-        if (hasPendingBurstCycles.load())
-        {
-            int cycles = pendingBurstCycles.load();
-            hasPendingBurstCycles = false;
-            device.setBurstCycles(cycles);
-        }
-        
-        if (hasPendingBurstPhase.load())
-        {
-            double phase = pendingBurstPhase.load();
-            hasPendingBurstPhase = false;
-            device.setBurstPhase(phase);
-        }
+        auto state = juce::ValueTree::fromXml (*xmlState);
+        programs.readFrom(state);
         
-        if (hasPendingBurstIntPeriod.load())
-        {
-            double period = pendingBurstIntPeriod.load();
-            hasPendingBurstIntPeriod = false;
-            device.setBurstInternalPeriod(period);
-        }
+        restoringState.store(true);
+        parameters.replaceState (state);
+        restoringState.store(false);
         
-        if (hasPendingBurstSource.load())
-        {
-            int sourceIdx = pendingBurstSource.load();
-            hasPendingBurstSource = false;
-            device.setBurstSource(burstSourceIndexToString(sourceIdx));
-        }
-        
-        // ==================== SYNC PARAMETERS ====================
-        if (hasPendingSyncEnabled.load())
-        {
-            bool enabled = pendingSyncEnabled.load();
-            hasPendingSyncEnabled = false;
-            device.setSyncEnabled(enabled);
-        }
-        
-        if (hasPendingSyncPhase.load())
-        {
-            double phase = pendingSyncPhase.load();
-            hasPendingSyncPhase = false;
-            device.setSyncPhase(phase);
-        }
-        
-        // ==================== TRIGGER PARAMETERS ====================
-        if (hasPendingTriggerSource.load())
-        {
-            int sourceIdx = pendingTriggerSource.load();
-            hasPendingTriggerSource = false;
-            device.setTriggerSource(triggerSourceIndexToString(sourceIdx));
-        }
-        
-        // Periodic error checking - catches errors from writeFast() calls
-        // This ensures users still see device errors without blocking slider movements
-        juce::int64 currentTime = juce::Time::currentTimeMillis();
-        if (currentTime - lastErrorCheck >= ERROR_CHECK_INTERVAL_MS)
-        {
-            lastErrorCheck = currentTime;
-            
-            // Query device error queue
-            std::string error = device.queryError();
-            
-            // Check if there's a real error (not "+0,No error")
-            if (!error.empty() && 
-                error.find("+0") == std::string::npos &&
-                error.find("No error") == std::string::npos)
-            {
-                // Log the error via the device's log callback
-                if (device.logCallback)
-                {
-                    device.logCallback("[DEVICE ERROR] " + error);
-                }
-            }
-        }
+        syncDeviceState(currentDeviceState());  // Waits for the connection if there isn't one yet
     }
 }
 
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueFrequencyUpdate(double freq)
-{
-    // Atomically update the pending frequency (always stores latest value)
-    // This ensures that even if multiple updates come in between processing,
-    // we always send the most recent value to the device
-    pendingFreq = freq;
-    hasPendingFreq = true;
-    
-    // Signal the thread to wake up and process it
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueAmplitudeUpdate(double amp)
+StateSyncRequest::Values HP33120APluginAudioProcessor::currentDeviceState() const
 {
-    pendingAmp = amp;
-    hasPendingAmp = true;
-    commandPending.signal();
+    StateSyncRequest::Values values;
+    for (int i = 0; i < Parameters::NUM_DEVICE_PARAMS; ++i)
+        values[(size_t)i] = parameters.getRawParameterValue(Parameters::DEVICE_PARAM_IDS[i])->load();
+    return values;
 }
 
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueOffsetUpdate(double offset)
+void HP33120APluginAudioProcessor::syncDeviceState(const StateSyncRequest::Values& values, int stateRegister)
 {
-    pendingOffset = offset;
-    hasPendingOffset = true;
-    commandPending.signal();
+    if (deviceCommandThread) deviceCommandThread->requestStateSync(values, stateRegister);
+    instrumentPool->syncState(values, stateRegister);
 }
 
-void HP33120APluginAudioProcessor::DeviceCommandThread::queuePhaseUpdate(double phase)
-{
-    pendingPhase = phase;
-    hasPendingPhase = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueDutyCycleUpdate(double duty)
-{
-    pendingDuty = duty;
-    hasPendingDuty = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueWaveformUpdate(int waveformIndex)
-{
-    pendingWaveform = waveformIndex;
-    hasPendingWaveform = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueOutputUpdate(bool enabled)
-{
-    pendingOutput = enabled;
-    hasPendingOutput = true;
-    commandPending.signal();
-}
-
-// ==================== AM QUEUE METHODS ====================
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueAMEnabledUpdate(bool enabled)
-{
-    pendingAMEnabled = enabled;
-    hasPendingAMEnabled = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueAMDepthUpdate(double depth)
-{
-    pendingAMDepth = depth;
-    hasPendingAMDepth = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueAMSourceUpdate(int sourceIndex)
-{
-    pendingAMSource = sourceIndex;
-    hasPendingAMSource = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueAMIntWaveformUpdate(int waveformIndex)
-{
-    pendingAMIntWaveform = waveformIndex;
-    hasPendingAMIntWaveform = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueAMIntFreqUpdate(double freq)
-{
-    pendingAMIntFreq = freq;
-    hasPendingAMIntFreq = true;
-    commandPending.signal();
-}
-
-// ==================== FM QUEUE METHODS ====================
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueFMEnabledUpdate(bool enabled)
-{
-    pendingFMEnabled = enabled;
-    hasPendingFMEnabled = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueFMDeviationUpdate(double deviation)
-{
-    pendingFMDeviation = deviation;
-    hasPendingFMDeviation = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueFMSourceUpdate(int sourceIndex)
-{
-    pendingFMSource = sourceIndex;
-    hasPendingFMSource = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueFMIntWaveformUpdate(int waveformIndex)
-{
-    pendingFMIntWaveform = waveformIndex;
-    hasPendingFMIntWaveform = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueFMIntFreqUpdate(double freq)
-{
-    pendingFMIntFreq = freq;
-    hasPendingFMIntFreq = true;
-    commandPending.signal();
-}
-
-// ==================== FSK QUEUE METHODS ====================
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueFSKEnabledUpdate(bool enabled)
-{
-    pendingFSKEnabled = enabled;
-    hasPendingFSKEnabled = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueFSKFrequencyUpdate(double freq)
-{
-    pendingFSKFrequency = freq;
-    hasPendingFSKFrequency = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueFSKSourceUpdate(int sourceIndex)
-{
-    pendingFSKSource = sourceIndex;
-    hasPendingFSKSource = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueFSKRateUpdate(double rate)
-{
-    pendingFSKRate = rate;
-    hasPendingFSKRate = true;
-    commandPending.signal();
-}
-
-// ==================== SWEEP QUEUE METHODS ====================
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueSweepEnabledUpdate(bool enabled)
-{
-    pendingSweepEnabled = enabled;
-    hasPendingSweepEnabled = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueSweepStartUpdate(double freq)
-{
-    pendingSweepStart = freq;
-    hasPendingSweepStart = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueSweepStopUpdate(double freq)
-{
-    pendingSweepStop = freq;
-    hasPendingSweepStop = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueSweepTimeUpdate(double time)
-{
-    pendingSweepTime = time;
-    hasPendingSweepTime = true;
-    commandPending.signal();
-}
-
-// ==================== BURST QUEUE METHODS ====================
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueBurstEnabledUpdate(bool enabled)
-{
-    pendingBurstEnabled = enabled;
-    hasPendingBurstEnabled = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueBurstCyclesUpdate(int cycles)
-{
-    pendingBurstCycles = cycles;
-    hasPendingBurstCycles = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueBurstPhaseUpdate(double phase)
-{
-    pendingBurstPhase = phase;
-    hasPendingBurstPhase = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueBurstIntPeriodUpdate(double period)
-{
-    pendingBurstIntPeriod = period;
-    hasPendingBurstIntPeriod = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueBurstSourceUpdate(int sourceIndex)
-{
-    pendingBurstSource = sourceIndex;
-    hasPendingBurstSource = true;
-    commandPending.signal();
-}
-
-// ==================== SYNC QUEUE METHODS ====================
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueSyncEnabledUpdate(bool enabled)
-{
-    pendingSyncEnabled = enabled;
-    hasPendingSyncEnabled = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueSyncPhaseUpdate(double phase)
-{
-    pendingSyncPhase = phase;
-    hasPendingSyncPhase = true;
-    commandPending.signal();
-}
-
-// ==================== TRIGGER QUEUE METHODS ====================
-void HP33120APluginAudioProcessor::DeviceCommandThread::queueTriggerSourceUpdate(int sourceIndex)
-{
-    pendingTriggerSource = sourceIndex;
-    hasPendingTriggerSource = true;
-    commandPending.signal();
-}
-
-void HP33120APluginAudioProcessor::DeviceCommandThread::stopThreadSafely()
-{
-    signalThreadShouldExit();
-    commandPending.signal();
-    stopThread(1000); // Wait up to 1 second for thread to finish
-}
+juce::AudioProcessorEditor* HP33120APluginAudioProcessor::createEditor() { return new HP33120APluginAudioProcessorEditor (*this); }
+bool HP33120APluginAudioProcessor::hasEditor() const { return true; }
+juce::AudioProcessor* JUCE_CALLTYPE createPluginFilter() { return new HP33120APluginAudioProcessor(); }
 
 //==============================================================================
 // Parameter Listener Implementation for Automation/LFO
-// Throttles updates to 20 Hz (50ms) like the Python version for smooth operation
 // Enables full DAW automation for ALL device parameters
 //==============================================================================
-void HP33120APluginAudioProcessor::ParameterListener::parameterChanged(const juce::String& parameterID, float newValue)
+void HP33120APluginAudioProcessor::ParameterListener::parameterChanged(const juce::String&, float newValue)
 {
     // PERFORMANCE CRITICAL: This is called from the audio thread for EVERY automation/LFO update
     // Can be called thousands of times per second! Must be extremely lightweight.
     
+    // Counted even when it isn't sent - a connect in progress syncs again if this moved
+    processor.stateGeneration.fetch_add(1, std::memory_order_relaxed);
+    
     // Early exit if device not connected - no work needed
     if (!processor.device.isConnected()) return;
     
+    // A project/preset load - setStateInformation() syncs the whole state in one go
+    if (processor.restoringState.load()) return;
+    
     // Get command thread reference once (lightweight check)
     auto* cmdThread = processor.getDeviceCommandThread();
     if (!cmdThread) return; // No thread available, skip
     
-    // PERFORMANCE: Use fast time check (milliseconds, not high-resolution)
-    juce::int64 currentTime = juce::Time::currentTimeMillis();
-    
-    // CRITICAL PERFORMANCE OPTIMIZATION: Throttle to 20 Hz (50ms) to prevent message spam
-    // Without throttling, automation at 48kHz = 48,000 calls/second = device overload!
-    // With throttling: Max 20 calls/second = smooth operation
-    // Strategy: Only queue updates at throttled rate, skipping intermediate values
-    
-    // ==================== BASIC PARAMETERS ====================
-    if (parameterID == Parameters::WAVEFORM)
-    {
-        if (currentTime - lastWaveformUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastWaveformUpdate = currentTime;
-            cmdThread->queueWaveformUpdate((int)newValue);
-        }
-    }
-    else if (parameterID == Parameters::FREQUENCY)
-    {
-        if (currentTime - lastFreqUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastFreqUpdate = currentTime;
-            cmdThread->queueFrequencyUpdate((double)newValue);
-        }
-    }
-    else if (parameterID == Parameters::AMPLITUDE)
-    {
-        if (currentTime - lastAmpUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastAmpUpdate = currentTime;
-            cmdThread->queueAmplitudeUpdate((double)newValue);
-        }
-    }
-    else if (parameterID == Parameters::OFFSET)
-    {
-        if (currentTime - lastOffsetUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastOffsetUpdate = currentTime;
-            cmdThread->queueOffsetUpdate((double)newValue);
-        }
-    }
-    else if (parameterID == Parameters::PHASE)
-    {
-        if (currentTime - lastPhaseUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastPhaseUpdate = currentTime;
-            cmdThread->queuePhaseUpdate((double)newValue);
-        }
-    }
-    else if (parameterID == Parameters::DUTY_CYCLE)
-    {
-        if (currentTime - lastDutyUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastDutyUpdate = currentTime;
-            cmdThread->queueDutyCycleUpdate((double)newValue);
-        }
-    }
-    else if (parameterID == Parameters::OUTPUT_ENABLED)
-    {
-        if (currentTime - lastOutputUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastOutputUpdate = currentTime;
-            cmdThread->queueOutputUpdate(newValue > 0.5f);
-        }
-    }
-    // ==================== AM PARAMETERS ====================
-    else if (parameterID == Parameters::AM_ENABLED)
-    {
-        if (currentTime - lastAMEnabledUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastAMEnabledUpdate = currentTime;
-            cmdThread->queueAMEnabledUpdate(newValue > 0.5f);
-        }
-    }
-    else if (parameterID == Parameters::AM_DEPTH)
-    {
-        if (currentTime - lastAMDepthUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastAMDepthUpdate = currentTime;
-            cmdThread->queueAMDepthUpdate((double)newValue);
-        }
-    }
-    else if (parameterID == Parameters::AM_SOURCE)
-    {
-        if (currentTime - lastAMSourceUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastAMSourceUpdate = currentTime;
-            cmdThread->queueAMSourceUpdate((int)newValue);
-        }
-    }
-    else if (parameterID == Parameters::AM_INT_WAVEFORM)
-    {
-        if (currentTime - lastAMIntWaveformUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastAMIntWaveformUpdate = currentTime;
-            cmdThread->queueAMIntWaveformUpdate((int)newValue);
-        }
-    }
-    else if (parameterID == Parameters::AM_INT_FREQ)
-    {
-        if (currentTime - lastAMIntFreqUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastAMIntFreqUpdate = currentTime;
-            cmdThread->queueAMIntFreqUpdate((double)newValue);
-        }
-    }
-    // ==================== FM PARAMETERS ====================
-    else if (parameterID == Parameters::FM_ENABLED)
-    {
-        if (currentTime - lastFMEnabledUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastFMEnabledUpdate = currentTime;
-            cmdThread->queueFMEnabledUpdate(newValue > 0.5f);
-        }
-    }
-    else if (parameterID == Parameters::FM_DEVIATION)
-    {
-        if (currentTime - lastFMDeviationUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastFMDeviationUpdate = currentTime;
-            cmdThread->queueFMDeviationUpdate((double)newValue);
-        }
-    }
-    else if (parameterID == Parameters::FM_SOURCE)
-    {
-        if (currentTime - lastFMSourceUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastFMSourceUpdate = currentTime;
-            cmdThread->queueFMSourceUpdate((int)newValue);
-        }
-    }
-    else if (parameterID == Parameters::FM_INT_WAVEFORM)
-    {
-        if (currentTime - lastFMIntWaveformUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastFMIntWaveformUpdate = currentTime;
-            cmdThread->queueFMIntWaveformUpdate((int)newValue);
-        }
-    }
-    else if (parameterID == Parameters::FM_INT_FREQ)
-    {
-        if (currentTime - lastFMIntFreqUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastFMIntFreqUpdate = currentTime;
-            cmdThread->queueFMIntFreqUpdate((double)newValue);
-        }
-    }
-    // ==================== FSK PARAMETERS ====================
-    else if (parameterID == Parameters::FSK_ENABLED)
-    {
-        if (currentTime - lastFSKEnabledUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastFSKEnabledUpdate = currentTime;
-            cmdThread->queueFSKEnabledUpdate(newValue > 0.5f);
-        }
-    }
-    else if (parameterID == Parameters::FSK_FREQUENCY)
-    {
-        if (currentTime - lastFSKFrequencyUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastFSKFrequencyUpdate = currentTime;
-            cmdThread->queueFSKFrequencyUpdate((double)newValue);
-        }
-    }
-    else if (parameterID == Parameters::FSK_SOURCE)
-    {
-        if (currentTime - lastFSKSourceUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastFSKSourceUpdate = currentTime;
-            cmdThread->queueFSKSourceUpdate((int)newValue);
-        }
-    }
-    else if (parameterID == Parameters::FSK_RATE)
-    {
-        if (currentTime - lastFSKRateUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastFSKRateUpdate = currentTime;
-            cmdThread->queueFSKRateUpdate((double)newValue);
-        }
-    }
-    // ==================== SWEEP PARAMETERS ====================
-    else if (parameterID == Parameters::SWEEP_ENABLED)
-    {
-        if (currentTime - lastSweepEnabledUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastSweepEnabledUpdate = currentTime;
-            cmdThread->queueSweepEnabledUpdate(newValue > 0.5f);
-        }
-    }
-    else if (parameterID == Parameters::SWEEP_START)
-    {
-        if (currentTime - lastSweepStartUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastSweepStartUpdate = currentTime;
-            cmdThread->queueSweepStartUpdate((double)newValue);
-        }
-    }
-    else if (parameterID == Parameters::SWEEP_STOP)
-    {
-        if (currentTime - lastSweepStopUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastSweepStopUpdate = currentTime;
-            cmdThread->queueSweepStopUpdate((double)newValue);
-        }
-    }
-    else if (parameterID == Parameters::SWEEP_TIME)
-    {
-        if (currentTime - lastSweepTimeUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastSweepTimeUpdate = currentTime;
-            cmdThread->queueSweepTimeUpdate((double)newValue);
-        }
-    }
-    // ==================== BURST PARAMETERS ====================
-    else if (parameterID == Parameters::BURST_ENABLED)
-    {
-        if (currentTime - lastBurstEnabledUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastBurstEnabledUpdate = currentTime;
-            cmdThread->queueBurstEnabledUpdate(newValue > 0.5f);
-        }
-    }
-    else if (parameterID == Parameters::BURST_CYCLES)
-    {
-        if (currentTime - lastBurstCyclesUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastBurstCyclesUpdate = currentTime;
-            cmdThread->queueBurstCyclesUpdate((int)newValue);
-        }
-    }
-    else if (parameterID == Parameters::BURST_PHASE)
-    {
-        if (currentTime - lastBurstPhaseUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastBurstPhaseUpdate = currentTime;
-            cmdThread->queueBurstPhaseUpdate((double)newValue);
-        }
-    }
-    else if (parameterID == Parameters::BURST_INT_PERIOD)
-    {
-        if (currentTime - lastBurstIntPeriodUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastBurstIntPeriodUpdate = currentTime;
-            cmdThread->queueBurstIntPeriodUpdate((double)newValue);
-        }
-    }
-    else if (parameterID == Parameters::BURST_SOURCE)
-    {
-        if (currentTime - lastBurstSourceUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastBurstSourceUpdate = currentTime;
-            cmdThread->queueBurstSourceUpdate((int)newValue);
-        }
-    }
-    // ==================== SYNC PARAMETERS ====================
-    else if (parameterID == Parameters::SYNC_ENABLED)
-    {
-        if (currentTime - lastSyncEnabledUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastSyncEnabledUpdate = currentTime;
-            cmdThread->queueSyncEnabledUpdate(newValue > 0.5f);
-        }
-    }
-    else if (parameterID == Parameters::SYNC_PHASE)
-    {
-        if (currentTime - lastSyncPhaseUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastSyncPhaseUpdate = currentTime;
-            cmdThread->queueSyncPhaseUpdate((double)newValue);
-        }
-    }
-    // ==================== TRIGGER PARAMETERS ====================
-    else if (parameterID == Parameters::TRIGGER_SOURCE)
-    {
-        if (currentTime - lastTriggerSourceUpdate >= UPDATE_INTERVAL_MS)
-        {
-            lastTriggerSourceUpdate = currentTime;
-            cmdThread->queueTriggerSourceUpdate((int)newValue);
-        }
-    }
-    // PERFORMANCE: Other parameters are ignored (fast path)
-}
\ No newline at end of file
+    // Just a slot store - the command thread decides when it goes out, and always
+    // sends the final value even if automation stops inside a rate-limit window
+    cmdThread->queueUpdate(deviceParam, (double)newValue);
+}
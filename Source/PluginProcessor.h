@@ -6,15 +6,24 @@
 #include <juce_events/juce_events.h>
 #include "HP33120ADriver.h"
 #include "Parameters.h"
+#include "ParameterMailbox.h"
+#include "StateSyncRequest.h"
+#include "DeviceCommandThread.h"
+#include "MidiEventScheduler.h"
+#include "ModulationEngine.h"
+#include "InstrumentPool.h"
+#include "WavetableMorph.h"
+#include "ProgramBank.h"
+#include "VoiceEngine.h"
+#include <array>
 
 //==============================================================================
 /**
 */
-class HP33120APluginAudioProcessor  : public juce::AudioProcessor
+class HP33120APluginAudioProcessor  : public juce::AudioProcessor,
+                                       public juce::ChangeBroadcaster,  // Connection and program changes
+                                       private juce::AsyncUpdater
 {
-    // Forward declaration for nested class (needed for getDeviceCommandThread)
-    class DeviceCommandThread;
-    
 public:
     //==============================================================================
     HP33120APluginAudioProcessor();
@@ -49,17 +58,25 @@ public:
     void setCurrentProgram (int index) override;
     const juce::String getProgramName (int index) override;
     void changeProgramName (int index, const juce::String& newName) override;
+    
+    // Captures the panel into the current program (and its *SAV register, if it has one)
+    void storeCurrentProgram();
 
     //==============================================================================
     void getStateInformation (juce::MemoryBlock& destData) override;
     void setStateInformation (const void* data, int sizeInBytes) override;
     
     //==============================================================================
-    // Device connection
-    bool connectDevice(const std::string& resourceName = "GPIB0::10::INSTR");
+    // Device connection - a comma-separated list drives several units; the first one is unit 0.
+    // Runs on a background thread: every unit opens, identifies itself and takes the panel
+    // state in parallel. onProgress is called on the message thread for each step and once
+    // more with finished set; disconnectDevice() queues behind a connect in progress.
+    using ConnectProgress = std::function<void(const juce::String& message, bool finished, bool succeeded)>;
+    void connectDeviceAsync(const std::string& resourceName, ConnectProgress onProgress);
     void disconnectDevice();
     bool isDeviceConnected() const { return device.isConnected(); }
-    std::string getDeviceIDN();
+    bool isDeviceConnecting() const { return device.isConnecting(); }
+    std::string getDeviceIDN() const { return device.getIDN(); }  // Read during connect
     
     // Device control methods
     void updateParameter(const juce::String& paramID, float value);
@@ -67,6 +84,7 @@ public:
     // Device access
     HP33120ADriver& getDevice() { return device; }
     DeviceCommandThread* getDeviceCommandThread();
+    InstrumentPool& getInstrumentPool() { return *instrumentPool; }
     
     // MIDI note to frequency conversion
     static double midiNoteToFrequency(int noteNumber);
@@ -130,6 +148,10 @@ private:
     std::atomic<float>* syncPhaseParam = nullptr;
     
     std::atomic<float>* triggerSourceParam = nullptr;
+    std::atomic<float>* voiceModeParam = nullptr;
+    std::atomic<float>* notePriorityParam = nullptr;
+    std::atomic<float>* legatoParam = nullptr;
+    std::atomic<float>* glideTimeParam = nullptr;
     
     // MIDI handling
     void handleMIDI(const juce::MidiBuffer& midiMessages);
@@ -137,221 +159,55 @@ private:
     // Parameter update flags
     bool needsParameterUpdate = false;
     
-    // Background thread for non-blocking device communication
-    class DeviceCommandThread : public juce::Thread
-    {
-    public:
-        DeviceCommandThread(HP33120ADriver& dev) : Thread("DeviceCommandThread"), device(dev) {}
-        void run() override;
-        
-        // Basic parameters
-        void queueFrequencyUpdate(double freq);
-        void queueAmplitudeUpdate(double amp);
-        void queueOffsetUpdate(double offset);
-        void queuePhaseUpdate(double phase);
-        void queueDutyCycleUpdate(double duty);
-        void queueWaveformUpdate(int waveformIndex);
-        void queueOutputUpdate(bool enabled);
-        
-        // AM parameters
-        void queueAMEnabledUpdate(bool enabled);
-        void queueAMDepthUpdate(double depth);
-        void queueAMSourceUpdate(int sourceIndex);
-        void queueAMIntWaveformUpdate(int waveformIndex);
-        void queueAMIntFreqUpdate(double freq);
-        
-        // FM parameters
-        void queueFMEnabledUpdate(bool enabled);
-        void queueFMDeviationUpdate(double deviation);
-        void queueFMSourceUpdate(int sourceIndex);
-        void queueFMIntWaveformUpdate(int waveformIndex);
-        void queueFMIntFreqUpdate(double freq);
-        
-        // FSK parameters
-        void queueFSKEnabledUpdate(bool enabled);
-        void queueFSKFrequencyUpdate(double freq);
-        void queueFSKSourceUpdate(int sourceIndex);
-        void queueFSKRateUpdate(double rate);
-        
-        // Sweep parameters
-        void queueSweepEnabledUpdate(bool enabled);
-        void queueSweepStartUpdate(double freq);
-        void queueSweepStopUpdate(double freq);
-        void queueSweepTimeUpdate(double time);
-        
-        // Burst parameters
-        void queueBurstEnabledUpdate(bool enabled);
-        void queueBurstCyclesUpdate(int cycles);
-        void queueBurstPhaseUpdate(double phase);
-        void queueBurstIntPeriodUpdate(double period);
-        void queueBurstSourceUpdate(int sourceIndex);
-        
-        // Sync parameters
-        void queueSyncEnabledUpdate(bool enabled);
-        void queueSyncPhaseUpdate(double phase);
-        
-        // Trigger parameters
-        void queueTriggerSourceUpdate(int sourceIndex);
-        
-        void stopThreadSafely();
-        
-    private:
-        HP33120ADriver& device;
-        juce::WaitableEvent commandPending;
-        
-        // Basic parameters
-        std::atomic<double> pendingFreq{0.0};
-        std::atomic<bool> hasPendingFreq{false};
-        std::atomic<double> pendingAmp{0.0};
-        std::atomic<bool> hasPendingAmp{false};
-        std::atomic<double> pendingOffset{0.0};
-        std::atomic<bool> hasPendingOffset{false};
-        std::atomic<double> pendingPhase{0.0};
-        std::atomic<bool> hasPendingPhase{false};
-        std::atomic<double> pendingDuty{0.0};
-        std::atomic<bool> hasPendingDuty{false};
-        std::atomic<int> pendingWaveform{0};
-        std::atomic<bool> hasPendingWaveform{false};
-        std::atomic<bool> pendingOutput{false};
-        std::atomic<bool> hasPendingOutput{false};
-        
-        // AM parameters
-        std::atomic<bool> pendingAMEnabled{false};
-        std::atomic<bool> hasPendingAMEnabled{false};
-        std::atomic<double> pendingAMDepth{50.0};
-        std::atomic<bool> hasPendingAMDepth{false};
-        std::atomic<int> pendingAMSource{0};
-        std::atomic<bool> hasPendingAMSource{false};
-        std::atomic<int> pendingAMIntWaveform{0};
-        std::atomic<bool> hasPendingAMIntWaveform{false};
-        std::atomic<double> pendingAMIntFreq{100.0};
-        std::atomic<bool> hasPendingAMIntFreq{false};
-        
-        // FM parameters
-        std::atomic<bool> pendingFMEnabled{false};
-        std::atomic<bool> hasPendingFMEnabled{false};
-        std::atomic<double> pendingFMDeviation{100.0};
-        std::atomic<bool> hasPendingFMDeviation{false};
-        std::atomic<int> pendingFMSource{0};
-        std::atomic<bool> hasPendingFMSource{false};
-        std::atomic<int> pendingFMIntWaveform{0};
-        std::atomic<bool> hasPendingFMIntWaveform{false};
-        std::atomic<double> pendingFMIntFreq{10.0};
-        std::atomic<bool> hasPendingFMIntFreq{false};
-        
-        // FSK parameters
-        std::atomic<bool> pendingFSKEnabled{false};
-        std::atomic<bool> hasPendingFSKEnabled{false};
-        std::atomic<double> pendingFSKFrequency{100.0};
-        std::atomic<bool> hasPendingFSKFrequency{false};
-        std::atomic<int> pendingFSKSource{0};
-        std::atomic<bool> hasPendingFSKSource{false};
-        std::atomic<double> pendingFSKRate{10.0};
-        std::atomic<bool> hasPendingFSKRate{false};
-        
-        // Sweep parameters
-        std::atomic<bool> pendingSweepEnabled{false};
-        std::atomic<bool> hasPendingSweepEnabled{false};
-        std::atomic<double> pendingSweepStart{100.0};
-        std::atomic<bool> hasPendingSweepStart{false};
-        std::atomic<double> pendingSweepStop{10000.0};
-        std::atomic<bool> hasPendingSweepStop{false};
-        std::atomic<double> pendingSweepTime{1.0};
-        std::atomic<bool> hasPendingSweepTime{false};
-        
-        // Burst parameters
-        std::atomic<bool> pendingBurstEnabled{false};
-        std::atomic<bool> hasPendingBurstEnabled{false};
-        std::atomic<int> pendingBurstCycles{1};
-        std::atomic<bool> hasPendingBurstCycles{false};
-        std::atomic<double> pendingBurstPhase{0.0};
-        std::atomic<bool> hasPendingBurstPhase{false};
-        std::atomic<double> pendingBurstIntPeriod{0.1};
-        std::atomic<bool> hasPendingBurstIntPeriod{false};
-        std::atomic<int> pendingBurstSource{0};
-        std::atomic<bool> hasPendingBurstSource{false};
-        
-        // Sync parameters
-        std::atomic<bool> pendingSyncEnabled{false};
-        std::atomic<bool> hasPendingSyncEnabled{false};
-        std::atomic<double> pendingSyncPhase{0.0};
-        std::atomic<bool> hasPendingSyncPhase{false};
-        
-        // Trigger parameters
-        std::atomic<int> pendingTriggerSource{0};
-        std::atomic<bool> hasPendingTriggerSource{false};
-        
-        // Periodic error checking - check every 500ms to catch errors from writeFast()
-        juce::int64 lastErrorCheck{0};
-        static constexpr int ERROR_CHECK_INTERVAL_MS = 500;
-    };
-    
     // Parameter listener to handle automation/LFO changes
-    // Throttles updates to ~20 Hz (50ms) like the Python version for smooth operation
+    // One listener per device parameter, so the callback knows its index without
+    // comparing parameter IDs. Rate limiting happens in DeviceCommandThread.
     class ParameterListener : public juce::AudioProcessorValueTreeState::Listener
     {
     public:
-        ParameterListener(HP33120APluginAudioProcessor& p) : processor(p) {}
+        ParameterListener(HP33120APluginAudioProcessor& p, Parameters::DeviceParam param) : processor(p), deviceParam(param) {}
         void parameterChanged(const juce::String& parameterID, float newValue) override;
     private:
         HP33120APluginAudioProcessor& processor;
-        
-        // Throttle timestamps for all parameters
-        juce::int64 lastFreqUpdate = 0;
-        juce::int64 lastAmpUpdate = 0;
-        juce::int64 lastOffsetUpdate = 0;
-        juce::int64 lastPhaseUpdate = 0;
-        juce::int64 lastDutyUpdate = 0;
-        juce::int64 lastWaveformUpdate = 0;
-        juce::int64 lastOutputUpdate = 0;
-        
-        // AM
-        juce::int64 lastAMEnabledUpdate = 0;
-        juce::int64 lastAMDepthUpdate = 0;
-        juce::int64 lastAMSourceUpdate = 0;
-        juce::int64 lastAMIntWaveformUpdate = 0;
-        juce::int64 lastAMIntFreqUpdate = 0;
-        
-        // FM
-        juce::int64 lastFMEnabledUpdate = 0;
-        juce::int64 lastFMDeviationUpdate = 0;
-        juce::int64 lastFMSourceUpdate = 0;
-        juce::int64 lastFMIntWaveformUpdate = 0;
-        juce::int64 lastFMIntFreqUpdate = 0;
-        
-        // FSK
-        juce::int64 lastFSKEnabledUpdate = 0;
-        juce::int64 lastFSKFrequencyUpdate = 0;
-        juce::int64 lastFSKSourceUpdate = 0;
-        juce::int64 lastFSKRateUpdate = 0;
-        
-        // Sweep
-        juce::int64 lastSweepEnabledUpdate = 0;
-        juce::int64 lastSweepStartUpdate = 0;
-        juce::int64 lastSweepStopUpdate = 0;
-        juce::int64 lastSweepTimeUpdate = 0;
-        
-        // Burst
-        juce::int64 lastBurstEnabledUpdate = 0;
-        juce::int64 lastBurstCyclesUpdate = 0;
-        juce::int64 lastBurstPhaseUpdate = 0;
-        juce::int64 lastBurstIntPeriodUpdate = 0;
-        juce::int64 lastBurstSourceUpdate = 0;
-        
-        // Sync
-        juce::int64 lastSyncEnabledUpdate = 0;
-        juce::int64 lastSyncPhaseUpdate = 0;
-        
-        // Trigger
-        juce::int64 lastTriggerSourceUpdate = 0;
-        
-        static constexpr int UPDATE_INTERVAL_MS = 20; // 50 Hz max update rate for smooth operation
+        const Parameters::DeviceParam deviceParam;
     };
     
-    std::unique_ptr<ParameterListener> parameterListener;
+    std::vector<std::unique_ptr<ParameterListener>> parameterListeners;
+    
+    // State recall - replaceState() fires a listener callback per parameter; those are
+    // ignored while it runs, and one read-back-and-diff sync per unit goes out instead
+    std::atomic<bool> restoringState { false };
+    std::atomic<uint32_t> stateGeneration { 0 };  // Bumped by every device parameter change
+    StateSyncRequest::Values currentDeviceState() const;
+    void syncDeviceState(const StateSyncRequest::Values& values, int stateRegister = 0);
+    
+    // Programs - MIDI program changes arrive on the audio thread and are applied here
+    ProgramBank programs;
+    std::atomic<int> pendingProgramChange { -1 };
+    void handleAsyncUpdate() override;
+    void applyToParameters(const StateSyncRequest::Values& values);
     
     std::unique_ptr<DeviceCommandThread> deviceCommandThread;
     
+    // Timestamped note -> frequency dispatch (see MidiEventScheduler.h)
+    std::unique_ptr<MidiEventScheduler> midiScheduler;
+    
+    // LFO / envelope / step modulation (see ModulationEngine.h)
+    std::unique_ptr<ModulationEngine> modulationEngine;
+    
+    // Units 1..N-1 when several instruments are connected (see InstrumentPool.h)
+    std::unique_ptr<InstrumentPool> instrumentPool;
+    
+    // Note stacks, note priority and glide for the mono voice modes (see VoiceEngine.h)
+    std::unique_ptr<VoiceEngine> voiceEngine;
+    
+    // Connects and disconnects, one at a time, off the message thread
+    juce::ThreadPool connectPool { 1 };
+    void connectDevices(const juce::StringArray& resources, ConnectProgress onProgress);
+    
+    // Frames interpolated between ARB slots, streamed to VOLATILE (see WavetableMorph.h)
+    std::unique_ptr<WavetableMorph> wavetableMorph;
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (HP33120APluginAudioProcessor)
 };
 
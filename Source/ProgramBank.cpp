@@ -0,0 +1,64 @@
+#include "ProgramBank.h"
+
+const juce::Identifier ProgramBank::PROGRAMS_TYPE ("PROGRAMS");
+const juce::Identifier ProgramBank::PROGRAM_TYPE ("PROGRAM");
+const juce::Identifier ProgramBank::NAME_PROPERTY ("name");
+const juce::Identifier ProgramBank::CURRENT_PROPERTY ("current");
+
+ProgramBank::ProgramBank()
+{
+    for (int i = 0; i < NUM_PROGRAMS; ++i)
+        programs[(size_t)i].name = "Program " + juce::String(i + 1);
+}
+
+void ProgramBank::writeTo(juce::ValueTree& state) const
+{
+    juce::ValueTree bank(PROGRAMS_TYPE);
+    bank.setProperty(CURRENT_PROPERTY, current, nullptr);
+
+    for (const auto& program : programs)
+    {
+        juce::ValueTree child(PROGRAM_TYPE);
+        child.setProperty(NAME_PROPERTY, program.name, nullptr);
+        if (program.stored)
+        {
+            // By parameter ID, so a reordered parameter list still loads
+            for (int i = 0; i < Parameters::NUM_DEVICE_PARAMS; ++i)
+                child.setProperty(juce::Identifier(Parameters::DEVICE_PARAM_IDS[i]), program.values[(size_t)i], nullptr);
+        }
+        bank.appendChild(child, nullptr);
+    }
+
+    state.removeChild(state.getChildWithName(PROGRAMS_TYPE), nullptr);
+    state.appendChild(bank, nullptr);
+}
+
+void ProgramBank::readFrom(juce::ValueTree& state)
+{
+    juce::ValueTree bank = state.getChildWithName(PROGRAMS_TYPE);
+    if (!bank.isValid()) return;
+    state.removeChild(bank, nullptr);
+
+    for (int index = 0; index < NUM_PROGRAMS; ++index)
+    {
+        Program& program = programs[(size_t)index];
+        program = Program();
+        program.name = "Program " + juce::String(index + 1);
+
+        juce::ValueTree child = bank.getChild(index);
+        if (!child.isValid()) continue;
+
+        program.name = child.getProperty(NAME_PROPERTY, program.name).toString();
+        program.stored = true;
+        for (int i = 0; i < Parameters::NUM_DEVICE_PARAMS; ++i)
+        {
+            juce::Identifier id(Parameters::DEVICE_PARAM_IDS[i]);
+            if (child.hasProperty(id))
+                program.values[(size_t)i] = (double)child.getProperty(id);
+            else
+                program.stored = false;  // Saved before this parameter existed - capture again
+        }
+    }
+
+    setCurrent((int)bank.getProperty(CURRENT_PROPERTY, 0));
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <juce_data_structures/juce_data_structures.h>
+#include <array>
+#include "HP33120ADriver.h"
+#include "Parameters.h"
+#include "StateSyncRequest.h"
+
+//==============================================================================
+// The plugin's programs - a device parameter snapshot each
+//
+// The first HP33120ADriver::NUM_STATE_REGISTERS programs live on the instrument's
+// *SAV registers as well, so switching to one of them is a single *RCL once it has
+// been saved there; the rest are recalled as a read-back-and-diff batch. Stored in
+// the plugin state as a PROGRAMS child of the parameter tree. Message thread only.
+//==============================================================================
+class ProgramBank
+{
+public:
+    static constexpr int NUM_PROGRAMS = 8;
+
+    struct Program
+    {
+        juce::String name;
+        StateSyncRequest::Values values {};
+        bool stored = false;  // Never stored: taking it over captures the panel
+    };
+
+    ProgramBank();
+
+    static bool isValid(int index) { return index >= 0 && index < NUM_PROGRAMS; }
+
+    // *SAV/*RCL register for a program, 0 if it has none
+    static int stateRegisterFor(int index)
+    {
+        return index >= 0 && index < HP33120ADriver::NUM_STATE_REGISTERS ? index + 1 : 0;
+    }
+
+    Program& operator[](int index) { return programs[(size_t)index]; }
+    const Program& operator[](int index) const { return programs[(size_t)index]; }
+
+    int getCurrent() const { return current; }
+    void setCurrent(int index) { if (isValid(index)) current = index; }
+
+    // Adds the PROGRAMS child to a copy of the parameter state
+    void writeTo(juce::ValueTree& state) const;
+
+    // Reads the PROGRAMS child and removes it, so replaceState() gets the parameters only.
+    // A state without one (older projects) leaves the bank as it is.
+    void readFrom(juce::ValueTree& state);
+
+private:
+    std::array<Program, NUM_PROGRAMS> programs;
+    int current = 0;
+
+    static const juce::Identifier PROGRAMS_TYPE, PROGRAM_TYPE, NAME_PROPERTY, CURRENT_PROPERTY;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <string_view>
+
+// Floating-point std::to_chars needs libstdc++ 11 / macOS 13.3 - older runtimes take
+// the snprintf path in ScpiLine::appendFixed()
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+ #define SCPI_LINE_HAS_FLOAT_TO_CHARS 1
+#else
+ #define SCPI_LINE_HAS_FLOAT_TO_CHARS 0
+#endif
+
+//==============================================================================
+// Fixed-capacity SCPI command builder for the live update path
+//
+// The header prefix ("FREQ ", "AM:DEPT ") is copied in and the number is appended
+// with std::to_chars - locale independent (always '.'), and no heap allocation.
+// Without floating-point to_chars, snprintf formats into the buffer and whatever
+// decimal separator the C locale uses is replaced with '.'.
+//==============================================================================
+class ScpiLine
+{
+public:
+    static constexpr size_t CAPACITY = 96;
+    
+    explicit ScpiLine(std::string_view header)
+    {
+        append(header);
+        append(" ");
+    }
+    
+    ScpiLine& append(std::string_view text)
+    {
+        if (length + text.size() > CAPACITY) { overflow = true; return *this; }
+        std::memcpy(data + length, text.data(), text.size());
+        length += text.size();
+        return *this;
+    }
+    
+    // Fixed notation with the given number of decimals, e.g. appendFixed(1000.0, 6) -> "1000.000000"
+    ScpiLine& appendFixed(double value, int decimals)
+    {
+       #if SCPI_LINE_HAS_FLOAT_TO_CHARS
+        auto result = std::to_chars(data + length, data + CAPACITY, value, std::chars_format::fixed, decimals);
+        if (result.ec != std::errc()) { overflow = true; return *this; }
+        length = (size_t)(result.ptr - data);
+       #else
+        char text[CAPACITY + 1];
+        const int written = std::snprintf(text, sizeof(text), "%.*f", decimals, value);
+        if (written < 0 || (size_t)written >= sizeof(text)) { overflow = true; return *this; }
+        
+        // %f only produces a sign, digits and the separator, which may be more than one byte
+        size_t out = length;
+        bool separatorDone = false;
+        for (int i = 0; i < written; ++i)
+        {
+            const char c = text[i];
+            const bool keep = (c >= '0' && c <= '9') || (i == 0 && c == '-');
+            if (!keep && separatorDone) continue;
+            if (out == CAPACITY) { overflow = true; return *this; }
+            data[out++] = keep ? c : '.';
+            separatorDone = separatorDone || !keep;
+        }
+        length = out;
+       #endif
+        return *this;
+    }
+    
+    ScpiLine& appendInteger(long long value)
+    {
+        auto result = std::to_chars(data + length, data + CAPACITY, value);
+        if (result.ec != std::errc()) { overflow = true; return *this; }
+        length = (size_t)(result.ptr - data);
+        return *this;
+    }
+    
+    std::string_view view() const { return std::string_view(data, length); }
+    bool overflowed() const { return overflow; }
+    
+private:
+    char data[CAPACITY];
+    size_t length = 0;
+    bool overflow = false;
+};
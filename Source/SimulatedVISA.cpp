@@ -0,0 +1,775 @@
+#include "SimulatedVISA.h"
+#include <juce_core/juce_core.h>
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    constexpr ViStatus SUCCESS_MAX_CNT = (ViStatus)0x3FFF0006;  // Reply longer than the read buffer
+    constexpr ViStatus ERROR_NSUP_ATTR = (ViStatus)0xBFFF001D;
+    constexpr size_t MAX_ERRORS = 20;
+    constexpr size_t MIN_ARB_POINTS = 8;
+    constexpr size_t MAX_ARB_POINTS = 16000;
+    constexpr size_t NON_VOLATILE_SLOTS = 4;
+    constexpr int NUM_STATE_REGISTERS = 4;  // *SAV/*RCL 0..3
+    constexpr double MAX_FREQUENCY_HZ = 15.0e6;
+    constexpr double MAX_AMPLITUDE_VPP = 10.0;
+
+    // *ESR? bits
+    constexpr int ESR_OPC = 1, ESR_QYE = 4, ESR_DDE = 8, ESR_EXE = 16, ESR_CME = 32;
+
+    const char* const BUILT_IN_ARBS[] = { "SINC", "NEG_RAMP", "EXP_RISE", "EXP_FALL", "CARDIAC" };
+
+    double nowMs() { return juce::Time::getMillisecondCounterHiRes(); }
+
+    // Sleeps most of the way and yields for the last stretch, so short waits stay
+    // accurate without a core spinning through long ones
+    void waitUntil(double deadlineMs)
+    {
+        for (;;)
+        {
+            const double remainingMs = deadlineMs - nowMs();
+            if (remainingMs <= 0.0) return;
+            if (remainingMs > 2.0)
+                std::this_thread::sleep_for(std::chrono::microseconds((long long)((remainingMs - 1.5) * 1000.0)));
+            else
+                std::this_thread::yield();
+        }
+    }
+
+    std::string_view trim(std::string_view text)
+    {
+        while (!text.empty() && std::isspace((unsigned char)text.front())) text.remove_prefix(1);
+        while (!text.empty() && std::isspace((unsigned char)text.back())) text.remove_suffix(1);
+        return text;
+    }
+
+    // Binary payloads can end in bytes that look like whitespace - only the front is safe to trim
+    std::string_view trimCommand(std::string_view text)
+    {
+        while (!text.empty() && std::isspace((unsigned char)text.front())) text.remove_prefix(1);
+        return text.find('#') == std::string_view::npos ? trim(text) : text;
+    }
+
+    std::string toUpper(std::string_view text)
+    {
+        std::string upper(text);
+        for (auto& c : upper) c = (char)std::toupper((unsigned char)c);
+        return upper;
+    }
+
+    // Length of the IEEE 488.2 definite-length block starting at text[0] == '#', 0 if malformed
+    size_t blockLength(std::string_view text, size_t& payloadOffset, size_t& payloadSize)
+    {
+        if (text.size() < 2 || text[0] != '#' || text[1] < '1' || text[1] > '9') return 0;
+        const size_t digits = (size_t)(text[1] - '0');
+        if (text.size() < 2 + digits) return 0;
+
+        payloadSize = 0;
+        for (size_t i = 0; i < digits; ++i)
+        {
+            if (!std::isdigit((unsigned char)text[2 + i])) return 0;
+            payloadSize = payloadSize * 10 + (size_t)(text[2 + i] - '0');
+        }
+        payloadOffset = 2 + digits;
+        return payloadOffset + payloadSize <= text.size() ? payloadOffset + payloadSize : 0;
+    }
+
+    //==========================================================================
+    class SimulatedInstrument
+    {
+    public:
+        SimulatedInstrument(const SimulatedVISA::Model& m, std::function<void(std::string_view, double)> hook)
+            : model(m), commandHook(std::move(hook))
+        {
+            reset();
+        }
+
+        ViStatus write(const unsigned char* bytes, size_t count, size_t& written);
+        ViStatus read(unsigned char* buffer, size_t count, size_t& returned);
+        void clear();
+        void trigger();
+
+        void setTimeoutMs(ViUInt32 ms) { std::lock_guard<std::mutex> lock(mutex); timeoutMs = ms; }
+        void setSendEnd(bool enabled) { std::lock_guard<std::mutex> lock(mutex); sendEnd = enabled; }
+
+    private:
+        std::mutex mutex;
+        const SimulatedVISA::Model model;
+        const std::function<void(std::string_view, double)> commandHook;
+
+        ViUInt32 timeoutMs = 2000;
+        bool sendEnd = true;
+        int chunksWithoutEnd = 0;  // For Model::stallEveryNthChunk
+        double busyUntilMs = 0.0;  // Parser still executing the last message - the bus waits
+        std::string input;         // Message being received, until END
+        std::string output;        // Reply not yet read
+
+        std::deque<std::string> errors;
+        int esr = 0;
+        std::map<std::string, std::string> settings;  // Short-form header -> last argument
+        std::map<int, std::map<std::string, std::string>> storedStates;  // *SAV register -> settings
+        size_t volatilePoints = 0;
+        std::map<std::string, size_t> userWaveforms;  // Non-volatile slots
+
+        double transferMs(size_t bytes) const { return model.messageOverheadMs + (double)bytes * 1000.0 / model.bytesPerSecond; }
+
+        void reset();
+        void pushError(int code, const char* text);
+        double executeMessage(std::string_view message, double receivedMs);
+        double execute(const std::string& header, std::string_view argument, std::vector<std::string>& replies);
+        double loadVolatile(const std::string& header, std::string_view argument);
+        void copyToNonVolatile(std::string_view argument);
+        void deleteWaveform(std::string_view argument);
+        std::string catalog(bool nonVolatileOnly) const;
+        bool waveformExists(const std::string& name) const;
+    };
+
+    void SimulatedInstrument::reset()
+    {
+        // Power-on state the driver reads back; everything else starts unset
+        settings.clear();
+        settings["FUNC"] = "SIN";
+        settings["FREQ"] = "+1.0000000000000E+03";
+        settings["VOLT"] = "+1.0000000E-01";
+        settings["VOLT:OFFS"] = "+0.0000000E+00";
+        settings["FUNC:SQU:DCYC"] = "+5.0000000E+01";
+        settings["FUNC:USER"] = "SINC";
+        for (const char* state : { "AM:STAT", "FM:STAT", "FSK:STAT", "SWE:STAT", "BM:STAT" })
+            settings[state] = "0";
+        settings["OUTP"] = "1";
+        settings["OUTP:SYNC"] = "1";
+        settings["PHAS"] = "+0.0000000E+00";
+        settings["AM:DEPT"] = "+1.0000000E+02";
+        settings["AM:SOUR"] = "BOTH";
+        settings["AM:INT:FUNC"] = "SIN";
+        settings["AM:INT:FREQ"] = "+1.0000000E+02";
+        settings["FM:DEV"] = "+1.0000000E+02";
+        settings["FM:SOUR"] = "INT";
+        settings["FM:INT:FUNC"] = "SIN";
+        settings["FM:INT:FREQ"] = "+1.0000000E+01";
+        settings["FSK:FREQ"] = "+1.0000000E+02";
+        settings["FSK:SOUR"] = "INT";
+        settings["FSK:INT:RATE"] = "+1.0000000E+01";
+        settings["FREQ:STAR"] = "+1.0000000E+02";
+        settings["FREQ:STOP"] = "+1.0000000E+03";
+        settings["SWE:TIME"] = "+1.0000000E+00";
+        settings["BM:NCYC"] = "+1.0000000E+00";
+        settings["BM:PHAS"] = "+0.0000000E+00";
+        settings["BM:INT:RATE"] = "+1.0000000E+02";
+        settings["BM:SOUR"] = "INT";
+        settings["TRIG:SOUR"] = "IMM";
+    }
+
+    void SimulatedInstrument::pushError(int code, const char* text)
+    {
+        if (code <= -100 && code > -200) esr |= ESR_CME;
+        else if (code <= -200 && code > -300) esr |= ESR_EXE;
+        else if (code <= -400 && code > -500) esr |= ESR_QYE;
+        else esr |= ESR_DDE;
+
+        char entry[96];
+        std::snprintf(entry, sizeof(entry), "%+d,\"%s\"", code, text);
+        if (errors.size() < MAX_ERRORS - 1)
+            errors.emplace_back(entry);
+        else if (errors.size() == MAX_ERRORS - 1)
+            errors.emplace_back("-350,\"Queue overflow\"");
+    }
+}
+
+// ============================================================================
+// BUS SIDE
+// ============================================================================
+ViStatus SimulatedInstrument::write(const unsigned char* bytes, size_t count, size_t& written)
+{
+    double startMs;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        startMs = std::max(nowMs(), busyUntilMs);
+    }
+    waitUntil(startMs + transferMs(count));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!sendEnd && count > 1 && model.stallEveryNthChunk > 0 && ++chunksWithoutEnd % model.stallEveryNthChunk == 0)
+    {
+        // Part of the chunk gets through before the adapter gives up
+        written = count / 2;
+        input.append((const char*)bytes, written);
+        return VI_ERROR_TMO;
+    }
+    input.append((const char*)bytes, count);
+    written = count;
+    if (!sendEnd) return VI_SUCCESS;  // More of this message to come
+
+    std::string message;
+    message.swap(input);
+    if (!output.empty())
+    {
+        // A new message while a reply is still waiting to be read
+        output.clear();
+        pushError(-410, "Query INTERRUPTED");
+    }
+
+    const double receivedMs = nowMs();
+    busyUntilMs = receivedMs + executeMessage(message, receivedMs);
+    return VI_SUCCESS;
+}
+
+ViStatus SimulatedInstrument::read(unsigned char* buffer, size_t count, size_t& returned)
+{
+    returned = 0;
+    std::unique_lock<std::mutex> lock(mutex);
+    if (output.empty())
+    {
+        // Addressed to talk with nothing to say
+        pushError(-420, "Query UNTERMINATED");
+        const double giveUpMs = std::max(nowMs(), busyUntilMs) + timeoutMs;
+        lock.unlock();
+        waitUntil(giveUpMs);
+        return VI_ERROR_TMO;
+    }
+
+    // The reply exists once the parser has got to it
+    const size_t replyBytes = std::min(count, output.size());
+    const double doneMs = std::max(nowMs(), busyUntilMs) + transferMs(replyBytes);
+    lock.unlock();
+    waitUntil(doneMs);
+    lock.lock();
+
+    returned = std::min(replyBytes, output.size());  // viClear may have got in
+    std::copy(output.begin(), output.begin() + (std::ptrdiff_t)returned, buffer);
+    output.erase(0, returned);
+    return output.empty() ? VI_SUCCESS : SUCCESS_MAX_CNT;
+}
+
+void SimulatedInstrument::clear()
+{
+    // Device clear: input and output buffers go, the parser gives up on its message
+    std::lock_guard<std::mutex> lock(mutex);
+    input.clear();
+    output.clear();
+    busyUntilMs = nowMs();
+}
+
+void SimulatedInstrument::trigger()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (settings["TRIG:SOUR"] != "BUS")
+        pushError(-211, "Trigger ignored");
+}
+
+// ============================================================================
+// PARSER
+// ============================================================================
+namespace
+{
+    // SCPI nodes the driver uses, long form -> short form
+    const std::map<std::string, std::string>& longForms()
+    {
+        static const std::map<std::string, std::string> forms {
+            { "APPLY", "APPL" }, { "ATTRIBUTE", "ATTR" }, { "BORDER", "BORD" }, { "CATALOG", "CAT" },
+            { "DCYCLE", "DCYC" }, { "DELETE", "DEL" }, { "DEPTH", "DEPT" }, { "DEVIATION", "DEV" },
+            { "DISPLAY", "DISP" }, { "ERROR", "ERR" }, { "FORMAT", "FORM" }, { "FREQUENCY", "FREQ" },
+            { "FUNCTION", "FUNC" }, { "INTERNAL", "INT" }, { "LOCAL", "LOC" }, { "MEMORY", "MEM" },
+            { "NCYCLES", "NCYC" }, { "NVOLATILE", "NVOL" }, { "OFFSET", "OFFS" }, { "OUTPUT", "OUTP" },
+            { "PHASE", "PHAS" }, { "POINTS", "POIN" }, { "REMOTE", "REM" }, { "SHAPE", "SHAP" },
+            { "SOURCE", "SOUR" }, { "SQUARE", "SQU" }, { "START", "STAR" }, { "STATE", "STAT" },
+            { "SWEEP", "SWE" }, { "SYSTEM", "SYST" }, { "TRIGGER", "TRIG" }, { "VOLTAGE", "VOLT" }
+        };
+        return forms;
+    }
+
+    // Settings the 33120A takes but won't report - their queries are undefined headers
+    bool isWriteOnlyQuery(const std::string& header)
+    {
+        return header == "OUTP?" || header == "PHAS?";
+    }
+
+    bool isKnownRoot(const std::string& header)
+    {
+        static const char* const roots[] = { "APPL", "AM", "BM", "DATA", "DISP", "FM", "FORM", "FREQ", "FSK",
+                                             "FUNC", "MEM", "OUTP", "PHAS", "SWE", "SYST", "TRIG", "VOLT" };
+        static const char* const common[] = { "*CLS", "*ESE", "*ESR", "*IDN", "*OPC", "*PSC", "*RCL", "*RST",
+                                              "*SAV", "*SRE", "*STB", "*TRG", "*TST", "*WAI" };
+        std::string root = header.substr(0, header.find(':'));
+        if (!root.empty() && root.back() == '?') root.pop_back();
+        auto contains = [&root](const auto& names) {
+            return std::find(std::begin(names), std::end(names), root) != std::end(names);
+        };
+        return root[0] == '*' ? contains(common) : contains(roots);
+    }
+
+    // "SOURce:FREQuency:STARt?" -> "FREQ:STAR?"
+    std::string normalizeHeader(std::string_view header)
+    {
+        std::string upper = toUpper(header);
+        const bool isQuery = !upper.empty() && upper.back() == '?';
+        if (isQuery) upper.pop_back();
+
+        std::string normalized;
+        size_t start = 0;
+        while (start <= upper.size())
+        {
+            size_t end = upper.find(':', start);
+            if (end == std::string::npos) end = upper.size();
+            std::string node = upper.substr(start, end - start);
+            auto form = longForms().find(node);
+            if (form != longForms().end()) node = form->second;
+
+            if (!node.empty() && !(normalized.empty() && node == "SOUR"))
+                normalized += (normalized.empty() ? "" : ":") + node;
+            start = end + 1;
+        }
+        if (normalized == "FUNC:SHAP") normalized = "FUNC";  // SHAPe is FUNCtion's default node
+        return isQuery ? normalized + "?" : normalized;
+    }
+
+    // Splits a message on ';' and newlines, skipping over quoted strings and binary blocks
+    std::vector<std::string_view> splitCommands(std::string_view message)
+    {
+        std::vector<std::string_view> commands;
+        size_t start = 0, i = 0;
+        while (i < message.size())
+        {
+            const char c = message[i];
+            if (c == '"' || c == '\'')
+            {
+                size_t close = message.find(c, i + 1);
+                i = close == std::string_view::npos ? message.size() : close + 1;
+            }
+            else if (c == '#')
+            {
+                size_t offset = 0, size = 0;
+                size_t length = blockLength(message.substr(i), offset, size);
+                i += length > 0 ? length : 1;
+            }
+            else if (c == ';' || c == '\n')
+            {
+                commands.push_back(message.substr(start, i - start));
+                start = ++i;
+            }
+            else
+            {
+                ++i;
+            }
+        }
+        commands.push_back(message.substr(start));
+        return commands;
+    }
+}
+
+double SimulatedInstrument::executeMessage(std::string_view message, double receivedMs)
+{
+    std::vector<std::string> replies;
+    std::string path;  // Header path between commands of one message
+    double elapsedMs = 0.0;
+
+    for (std::string_view command : splitCommands(message))
+    {
+        command = trimCommand(command);
+        if (command.empty()) continue;
+
+        size_t space = 0;
+        while (space < command.size() && !std::isspace((unsigned char)command[space])) ++space;
+        std::string_view rawHeader = command.substr(0, space);
+        std::string_view argument = trimCommand(command.substr(space));
+
+        // "AM:DEPT 40;STAT ON" -> AM:STAT, ';:' goes back to the root, common commands leave the path alone
+        std::string header;
+        if (rawHeader[0] == '*')
+            header = toUpper(rawHeader);
+        else if (rawHeader[0] == ':')
+            header = normalizeHeader(rawHeader.substr(1));
+        else
+            header = normalizeHeader(path + std::string(rawHeader));
+
+        // Like the instrument, a header it doesn't know ends the message: nothing after
+        // it is parsed, so a compound query comes back with fewer replies than it asked for
+        if (header.empty() || !isKnownRoot(header) || isWriteOnlyQuery(header))
+        {
+            pushError(-113, "Undefined header");
+            elapsedMs += model.parseMsPerCommand;
+            break;
+        }
+
+        if (header[0] != '*')
+        {
+            size_t lastNode = header.rfind(':');
+            path = lastNode == std::string::npos ? std::string() : header.substr(0, lastNode + 1);
+        }
+
+        elapsedMs += execute(header, argument, replies);
+        if (commandHook) commandHook(command, receivedMs + elapsedMs);
+    }
+
+    if (!replies.empty())
+    {
+        for (size_t i = 0; i < replies.size(); ++i)
+            output += (i > 0 ? ";" : "") + replies[i];
+        output += "\n";
+    }
+    return elapsedMs;
+}
+
+double SimulatedInstrument::execute(const std::string& header, std::string_view argument, std::vector<std::string>& replies)
+{
+    double costMs = model.parseMsPerCommand;
+    const bool isQuery = header.back() == '?';
+    const std::string upperArgument = toUpper(argument);
+
+    // Common commands
+    if (header == "*IDN?") replies.push_back("HEWLETT-PACKARD,33120A,0,SIM-1.0");
+    else if (header == "*OPC?") replies.push_back("1");
+    else if (header == "*OPC") esr |= ESR_OPC;
+    else if (header == "*ESR?") { replies.push_back(std::to_string(esr)); esr = 0; }
+    else if (header == "*CLS") { errors.clear(); esr = 0; }
+    else if (header == "*RST") reset();
+    else if (header == "*TRG") { if (settings["TRIG:SOUR"] != "BUS") pushError(-211, "Trigger ignored"); }
+    else if (header == "*SAV" || header == "*RCL")
+    {
+        const int stateRegister = std::atoi(upperArgument.c_str());
+        auto stored = storedStates.find(stateRegister);
+        if (stateRegister < 0 || stateRegister >= NUM_STATE_REGISTERS || upperArgument.empty())
+            pushError(-222, "Data out of range");
+        else if (header == "*SAV")
+            storedStates[stateRegister] = settings;
+        else if (stored == storedStates.end())
+            pushError(810, "State has not been stored");
+        else
+            settings = stored->second;
+    }
+    else if (header[0] == '*') { if (isQuery) replies.push_back("+0"); }
+
+    // System
+    else if (header == "SYST:ERR?")
+    {
+        replies.push_back(errors.empty() ? "+0,\"No error\"" : errors.front());
+        if (!errors.empty()) errors.pop_front();
+    }
+
+    // ARB memory
+    else if ((header == "DATA" || header == "DATA:DAC") && !isQuery)
+    {
+        costMs += loadVolatile(header, argument);
+    }
+    else if (header == "DATA:COPY")
+    {
+        copyToNonVolatile(argument);
+        costMs += model.nonVolatileCopyMs;
+    }
+    else if (header == "DATA:DEL")
+    {
+        deleteWaveform(argument);
+    }
+    else if (header == "DATA:DEL:ALL")
+    {
+        userWaveforms.clear();
+        volatilePoints = 0;
+    }
+    else if (header == "DATA:CAT?") replies.push_back(catalog(false));
+    else if (header == "DATA:NVOL:CAT?") replies.push_back(catalog(true));
+    else if (header == "DATA:NVOL:FREE?") replies.push_back(std::to_string(NON_VOLATILE_SLOTS - userWaveforms.size()));
+    else if (header == "DATA:ATTR:POIN?")
+    {
+        std::string name = upperArgument.empty() ? "VOLATILE" : upperArgument;
+        auto user = userWaveforms.find(name);
+        if (name == "VOLATILE" && volatilePoints > 0) replies.push_back(std::to_string(volatilePoints));
+        else if (user != userWaveforms.end()) replies.push_back(std::to_string(user->second));
+        else pushError(785, "Specified arb waveform does not exist");
+    }
+    else if (header == "FUNC:USER" && !isQuery && !waveformExists(upperArgument))
+    {
+        pushError(785, "Specified arb waveform does not exist");
+    }
+
+    // Everything else is remembered as sent
+    else if (isQuery)
+    {
+        auto setting = settings.find(header.substr(0, header.size() - 1));
+        replies.push_back(setting != settings.end() ? setting->second : "+0");
+    }
+    else
+    {
+        const double value = std::atof(upperArgument.c_str());
+        const bool numeric = !upperArgument.empty() && (std::isdigit((unsigned char)upperArgument[0]) || upperArgument[0] == '-'
+                                                        || upperArgument[0] == '+' || upperArgument[0] == '.');
+        if (numeric && header == "FREQ" && (value < 0.0 || value > MAX_FREQUENCY_HZ))
+            pushError(-222, "Data out of range");
+        else if (numeric && header == "VOLT" && (value <= 0.0 || value > MAX_AMPLITUDE_VPP))
+            pushError(-222, "Data out of range");
+        else
+            settings[header] = upperArgument;
+    }
+
+    return costMs;
+}
+
+// ============================================================================
+// ARB MEMORY
+// ============================================================================
+double SimulatedInstrument::loadVolatile(const std::string& header, std::string_view argument)
+{
+    // "VOLATILE, #42000<bytes>" (DATA:DAC only) or "VOLATILE, v1, v2, ..."
+    size_t comma = argument.find(',');
+    if (comma == std::string_view::npos || toUpper(trim(argument.substr(0, comma))) != "VOLATILE")
+    {
+        pushError(-109, "Missing parameter");
+        return 0.0;
+    }
+    std::string_view data = trimCommand(argument.substr(comma + 1));
+
+    size_t points = 0;
+    double costMs = 0.0;
+    if (!data.empty() && data[0] == '#')
+    {
+        size_t offset = 0, size = 0;
+        if (header != "DATA:DAC" || blockLength(data, offset, size) == 0 || (size % 2) != 0)
+        {
+            pushError(-161, "Invalid block data");
+            return 0.0;
+        }
+        points = size / 2;
+        costMs = (double)points * model.parseMsPerBinaryPoint;
+    }
+    else
+    {
+        points = data.empty() ? 0 : (size_t)std::count(data.begin(), data.end(), ',') + 1;
+        costMs = (double)points * model.parseMsPerAsciiPoint;
+    }
+
+    if (points < MIN_ARB_POINTS || points > MAX_ARB_POINTS)
+    {
+        pushError(-222, "Data out of range");
+        return costMs;
+    }
+    volatilePoints = points;
+    return costMs;
+}
+
+void SimulatedInstrument::copyToNonVolatile(std::string_view argument)
+{
+    // "<name>,VOLATILE"
+    std::string name = toUpper(trim(argument.substr(0, argument.find(','))));
+    if (volatilePoints == 0)
+    {
+        pushError(780, "VOLATILE arb waveform has not been loaded");
+        return;
+    }
+    if (name.empty() || name.size() > 8 || !std::isalpha((unsigned char)name[0]))
+    {
+        pushError(-224, "Illegal parameter value");
+        return;
+    }
+    if (userWaveforms.count(name) == 0 && userWaveforms.size() >= NON_VOLATILE_SLOTS)
+    {
+        pushError(781, "Not enough non-volatile memory; use DATA:DEL");
+        return;
+    }
+    userWaveforms[name] = volatilePoints;
+}
+
+void SimulatedInstrument::deleteWaveform(std::string_view argument)
+{
+    std::string name = toUpper(trim(argument));
+    const bool playing = settings["FUNC"] == "USER" && settings["FUNC:USER"] == name;
+
+    if (name == "VOLATILE" ? volatilePoints == 0 : userWaveforms.count(name) == 0)
+        pushError(785, "Specified arb waveform does not exist");
+    else if (playing)
+        pushError(787, "Not able to delete the currently selected active arb waveform");
+    else if (name == "VOLATILE")
+        volatilePoints = 0;
+    else
+        userWaveforms.erase(name);
+}
+
+std::string SimulatedInstrument::catalog(bool nonVolatileOnly) const
+{
+    std::string list;
+    auto add = [&list](const std::string& name) { list += (list.empty() ? "\"" : ",\"") + name + "\""; };
+
+    if (!nonVolatileOnly)
+    {
+        if (volatilePoints > 0) add("VOLATILE");
+        for (const char* name : BUILT_IN_ARBS) add(name);
+    }
+    for (const auto& waveform : userWaveforms) add(waveform.first);
+    return list.empty() ? "\"\"" : list;
+}
+
+bool SimulatedInstrument::waveformExists(const std::string& name) const
+{
+    if (name == "VOLATILE") return volatilePoints > 0;
+    for (const char* builtIn : BUILT_IN_ARBS)
+        if (name == builtIn) return true;
+    return userWaveforms.count(name) > 0;
+}
+
+// ============================================================================
+// VISA ENTRY POINTS
+// ============================================================================
+namespace
+{
+    struct Registry
+    {
+        std::mutex mutex;
+        SimulatedVISA::Model model;
+        std::function<void(std::string_view, double)> commandHook;
+        std::map<void*, std::shared_ptr<SimulatedInstrument>> sessions;
+        int resourceManager = 0;  // Its address is the RM handle
+    };
+
+    Registry& registry()
+    {
+        static Registry instance;
+        return instance;
+    }
+
+    // Shared, so a session closed from another thread can't vanish mid-call
+    std::shared_ptr<SimulatedInstrument> findSession(ViObject object)
+    {
+        Registry& r = registry();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        auto session = r.sessions.find(object);
+        return session != r.sessions.end() ? session->second : nullptr;
+    }
+}
+
+SimulatedVISA::Model SimulatedVISA::rs232()
+{
+    Model model;
+    model.bytesPerSecond = 960.0;  // 10 bits per byte
+    model.messageOverheadMs = 0.0;
+    return model;
+}
+
+void SimulatedVISA::setModel(const Model& model)
+{
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    registry().model = model;
+}
+
+void SimulatedVISA::setCommandHook(std::function<void(std::string_view, double)> hook)
+{
+    std::lock_guard<std::mutex> lock(registry().mutex);
+    registry().commandHook = std::move(hook);
+}
+
+bool SimulatedVISA::isSimulatedResource(const std::string& resourceName)
+{
+    return resourceName.size() >= 3 && toUpper(resourceName.substr(0, 3)) == "SIM";
+}
+
+ViStatus SimulatedVISA::openDefaultRM(ViSession* rm)
+{
+    if (rm == nullptr) return ERROR_INVALID_OBJECT;
+    *rm = (ViSession)&registry().resourceManager;
+    return VI_SUCCESS;
+}
+
+ViStatus SimulatedVISA::open(ViSession rm, ViRsrc name, ViAccessMode, ViUInt32, ViSession* session)
+{
+    Registry& r = registry();
+    if (rm != (ViSession)&r.resourceManager || session == nullptr) return ERROR_INVALID_OBJECT;
+    if (name == nullptr || !isSimulatedResource(name)) return ERROR_RESOURCE_NOT_FOUND;
+
+    std::lock_guard<std::mutex> lock(r.mutex);
+    auto instrument = std::make_shared<SimulatedInstrument>(r.model, r.commandHook);
+    *session = (ViSession)instrument.get();
+    r.sessions[*session] = std::move(instrument);
+    return VI_SUCCESS;
+}
+
+ViStatus SimulatedVISA::close(ViObject object)
+{
+    Registry& r = registry();
+    if (object == (ViObject)&r.resourceManager) return VI_SUCCESS;
+
+    std::lock_guard<std::mutex> lock(r.mutex);
+    return r.sessions.erase(object) > 0 ? VI_SUCCESS : ERROR_INVALID_OBJECT;
+}
+
+ViStatus SimulatedVISA::write(ViSession session, ViBuf buffer, ViUInt32 count, ViUInt32* written)
+{
+    auto instrument = findSession(session);
+    if (!instrument) return ERROR_INVALID_OBJECT;
+
+    size_t sent = 0;
+    ViStatus status = instrument->write(buffer, (size_t)count, sent);
+    if (written) *written = (ViUInt32)sent;
+    return status;
+}
+
+ViStatus SimulatedVISA::read(ViSession session, ViBuf buffer, ViUInt32 count, ViUInt32* returned)
+{
+    auto instrument = findSession(session);
+    if (!instrument) return ERROR_INVALID_OBJECT;
+
+    size_t received = 0;
+    ViStatus status = instrument->read(buffer, (size_t)count, received);
+    if (returned) *returned = (ViUInt32)received;
+    return status;
+}
+
+int SimulatedVISA::printf(ViSession session, ViString format, ...)
+{
+    auto instrument = findSession(session);
+    if (!instrument || format == nullptr) return (int)ERROR_INVALID_OBJECT;
+
+    va_list args;
+    va_start(args, format);
+    va_list sizing;
+    va_copy(sizing, args);
+    const int length = std::vsnprintf(nullptr, 0, format, sizing);
+    va_end(sizing);
+
+    std::string text((size_t)std::max(length, 0) + 1, '\0');
+    if (length > 0) std::vsnprintf(&text[0], text.size(), format, args);
+    va_end(args);
+    text.resize((size_t)std::max(length, 0));
+
+    size_t sent = 0;
+    return (int)instrument->write((const unsigned char*)text.data(), text.size(), sent);
+}
+
+ViStatus SimulatedVISA::setAttribute(ViObject object, ViUInt32 attribute, ViUInt32 value)
+{
+    auto instrument = findSession(object);
+    if (!instrument) return object == (ViObject)&registry().resourceManager ? ERROR_NSUP_ATTR : ERROR_INVALID_OBJECT;
+
+    if (attribute == VI_ATTR_TMO_VALUE) instrument->setTimeoutMs(value);
+    else if (attribute == VI_ATTR_SEND_END_EN) instrument->setSendEnd(value != VI_FALSE);
+    else return ERROR_NSUP_ATTR;
+    return VI_SUCCESS;
+}
+
+ViStatus SimulatedVISA::flush(ViSession session, ViUInt16)
+{
+    return findSession(session) ? VI_SUCCESS : ERROR_INVALID_OBJECT;
+}
+
+ViStatus SimulatedVISA::clear(ViSession session)
+{
+    auto instrument = findSession(session);
+    if (!instrument) return ERROR_INVALID_OBJECT;
+    instrument->clear();
+    return VI_SUCCESS;
+}
+
+ViStatus SimulatedVISA::assertTrigger(ViSession session, ViUInt16)
+{
+    auto instrument = findSession(session);
+    if (!instrument) return ERROR_INVALID_OBJECT;
+    instrument->trigger();
+    return VI_SUCCESS;
+}
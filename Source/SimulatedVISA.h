@@ -0,0 +1,66 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <string_view>
+#include "HP33120ADriver.h"
+
+//==============================================================================
+// In-process stand-in for a VISA library with an HP33120A on the other end
+//
+// The entry points have the same signatures as the driver's VISA function pointers,
+// so HP33120ADriver runs its real code paths against it - connect() switches over
+// for any resource starting with "SIM" (e.g. "SIM::10::INSTR"). Each session is one
+// simulated instrument that costs real time: bytes move at the model's bus rate, and
+// the parser holds off the next transfer for as long as the last message takes to
+// execute, the way the 33120A holds NRFD. It keeps an error queue (20 entries, -350
+// on overflow), *ESR? bits, -410 Query INTERRUPTED, a VOLATILE plus four-slot
+// non-volatile ARB memory, and otherwise simply remembers every setting it's sent.
+// An unknown header - or a query of a write-only setting (OUTP?, PHAS?) - is a -113
+// and ends the message there, as on the instrument.
+// viGpibCommand and the asynchronous I/O calls are left out, so the driver takes its
+// synchronous paths.
+//==============================================================================
+class SimulatedVISA
+{
+public:
+    struct Model
+    {
+        double bytesPerSecond = 100000.0;    // Handshake-limited input rate
+        double messageOverheadMs = 0.3;      // Addressing / turnaround per viWrite or viRead
+        double parseMsPerCommand = 2.0;      // Per ';'-separated command
+        double parseMsPerBinaryPoint = 0.005;
+        double parseMsPerAsciiPoint = 0.05;
+        double nonVolatileCopyMs = 300.0;    // DATA:COPY into flash
+        int stallEveryNthChunk = 0;          // Flaky adapter: every Nth write with END withheld
+                                             // takes half its bytes, then times out (0: never)
+    };
+
+    static Model gpib() { return {}; }
+    static Model rs232();  // 9600 baud, 8N1
+
+    // Applies to sessions opened afterwards
+    static void setModel(const Model& model);
+
+    // Called on the I/O thread for each command as its message arrives, with the time
+    // the parser will have executed it (juce::Time::getMillisecondCounterHiRes()
+    // domain). Keep it short - the instrument is locked. Applies to sessions opened afterwards.
+    static void setCommandHook(std::function<void(std::string_view command, double atMs)> hook);
+
+    static bool isSimulatedResource(const std::string& resourceName);
+
+    // VISA entry points
+    static ViStatus openDefaultRM(ViSession* rm);
+    static ViStatus open(ViSession rm, ViRsrc name, ViAccessMode mode, ViUInt32 timeout, ViSession* session);
+    static ViStatus close(ViObject object);
+    static ViStatus write(ViSession session, ViBuf buffer, ViUInt32 count, ViUInt32* written);
+    static ViStatus read(ViSession session, ViBuf buffer, ViUInt32 count, ViUInt32* returned);
+    static int printf(ViSession session, ViString format, ...);
+    static ViStatus setAttribute(ViObject object, ViUInt32 attribute, ViUInt32 value);
+    static ViStatus flush(ViSession session, ViUInt16 mask);
+    static ViStatus clear(ViSession session);
+    static ViStatus assertTrigger(ViSession session, ViUInt16 protocol);
+
+    static constexpr ViStatus ERROR_INVALID_OBJECT = (ViStatus)0xBFFF000E;
+    static constexpr ViStatus ERROR_RESOURCE_NOT_FOUND = (ViStatus)0xBFFF0011;
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <mutex>
+#include "HP33120ADriver.h"
+#include "Parameters.h"
+
+//==============================================================================
+// "Bring the instrument in line with this panel state" - posted by the message
+// thread (project load, connect, program change), carried out by the worker that
+// owns the driver
+//
+// Only the latest request matters: posting again before the worker gets to it just
+// replaces it. The worker runs HP33120ADriver::recallStateRegister() for a program
+// that has a stored-state register, syncState() otherwise - either way only what
+// differs from the instrument is sent.
+//==============================================================================
+class StateSyncRequest
+{
+public:
+    using Values = std::array<double, Parameters::NUM_DEVICE_PARAMS>;
+
+    // Message thread
+    void post(const Values& newValues, int newStateRegister = 0)  // 0: no register
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            values = newValues;
+            stateRegister = newStateRegister;
+        }
+        pending.store(true, std::memory_order_release);
+    }
+
+    // Worker thread - false if nothing was posted since the last take()
+    bool take(Values& outValues, int& outStateRegister)
+    {
+        if (!pending.exchange(false, std::memory_order_acq_rel)) return false;
+        std::lock_guard<std::mutex> lock(mutex);
+        outValues = values;
+        outStateRegister = stateRegister;
+        return true;
+    }
+    
+    // Worker thread - carries out a taken request
+    static int apply(HP33120ADriver& driver, const Values& values, int stateRegister)
+    {
+        return stateRegister > 0 ? driver.recallStateRegister(stateRegister, values) : driver.syncState(values);
+    }
+
+    bool isPending() const noexcept { return pending.load(std::memory_order_acquire); }
+
+private:
+    std::mutex mutex;
+    Values values {};
+    int stateRegister = 0;
+    std::atomic<bool> pending { false };
+};
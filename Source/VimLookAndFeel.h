@@ -97,6 +97,8 @@ public:
         
         // Set monospace font as default
         setDefaultSansSerifTypefaceName(juce::Font::getDefaultMonospacedFontName());
+        
+        tickShape = getTickShape(0.75f);
     }
 
     //==============================================================================
@@ -145,21 +147,21 @@ public:
         
         auto trackWidth = juce::jmin(4.0f, (float)height * 0.25f);
         
-        juce::Point<float> startPoint((float)x, (float)y + (float)height * 0.5f);
-        juce::Point<float> endPoint((float)(x + width), startPoint.y);
-        
-        juce::Path backgroundTrack;
-        backgroundTrack.startNewSubPath(startPoint);
-        backgroundTrack.lineTo(endPoint);
+        // Round-capped tracks filled as rounded rectangles - the same pixels as stroking a
+        // line, without building a stroke outline. trackShape keeps its storage between
+        // calls, so a repaint doesn't allocate.
+        auto centreY = (float)y + (float)height * 0.5f;
+        auto track = juce::Rectangle<float>((float)x, centreY, (float)width, 0.0f).expanded(trackWidth * 0.5f);
+        trackShape.clear();
+        trackShape.addRoundedRectangle(track, trackWidth * 0.5f);
         g.setColour(sliderTrack);
-        g.strokePath(backgroundTrack, {trackWidth, juce::PathStrokeType::curved, juce::PathStrokeType::rounded});
+        g.fillPath(trackShape);
         
-        juce::Path valueTrack;
-        juce::Point<float> thumbPoint(sliderPos, startPoint.y);
-        valueTrack.startNewSubPath(startPoint);
-        valueTrack.lineTo(thumbPoint);
+        juce::Point<float> thumbPoint(sliderPos, centreY);
+        trackShape.clear();
+        trackShape.addRoundedRectangle(track.withRight(sliderPos + trackWidth * 0.5f), trackWidth * 0.5f);
         g.setColour(slider.isEnabled() ? sliderThumb : textGray);
-        g.strokePath(valueTrack, {trackWidth, juce::PathStrokeType::curved, juce::PathStrokeType::rounded});
+        g.fillPath(trackShape);
         
         auto thumbWidth = 12.0f;
         g.setColour(slider.isEnabled() ? sliderThumb : textGray);
@@ -264,8 +266,7 @@ public:
         if (ticked)
         {
             g.setColour(isEnabled ? textGreen : textGray);
-            auto tick = getTickShape(0.75f);
-            g.fillPath(tick, tick.getTransformToScaleToFit(tickBounds.reduced(4, 5).toFloat(), true));
+            g.fillPath(tickShape, tickShape.getTransformToScaleToFit(tickBounds.reduced(4, 5).toFloat(), true));
         }
     }
 
@@ -321,5 +322,8 @@ public:
     }
 
 private:
+    juce::Path tickShape;  // Built once, scaled into each tick box
+    juce::Path trackShape;  // Slider tracks, rebuilt in place (message thread only)
+    
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(VimLookAndFeel)
 };
@@ -0,0 +1,143 @@
+#include "VoiceEngine.h"
+#include <algorithm>
+
+// ============================================================================
+// NOTE STACK
+// ============================================================================
+void NoteStack::push(int note)
+{
+    remove(note);
+    if (count == CAPACITY)
+    {
+        std::copy(notes.begin() + 1, notes.end(), notes.begin());  // Forget the oldest
+        --count;
+    }
+    notes[(size_t)count++] = note;
+}
+
+bool NoteStack::remove(int note)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        if (notes[(size_t)i] == note)
+        {
+            std::copy(notes.begin() + i + 1, notes.begin() + count, notes.begin() + i);
+            --count;
+            return true;
+        }
+    }
+    return false;
+}
+
+int NoteStack::sounding(Priority priority) const
+{
+    if (count == 0) return -1;
+
+    switch (priority)
+    {
+        case Priority::Last: return notes[(size_t)count - 1];
+        case Priority::Low:  return *std::min_element(notes.begin(), notes.begin() + count);
+        case Priority::High: return *std::max_element(notes.begin(), notes.begin() + count);
+    }
+    return notes[(size_t)count - 1];
+}
+
+// ============================================================================
+// VOICES
+// ============================================================================
+VoiceEngine::VoiceEngine(InstrumentPool& instrumentPool)
+    : pool(instrumentPool)
+{
+}
+
+int VoiceEngine::voiceIndex(int midiChannel, InstrumentPool::VoiceMode mode)
+{
+    if (mode != InstrumentPool::VoiceMode::MidiChannel) return 0;
+    return juce::jlimit(0, NUM_VOICES - 1, midiChannel - 1);
+}
+
+int VoiceEngine::unitFor(int midiChannel, int note, InstrumentPool::VoiceMode mode)
+{
+    // Unison and MIDI Channel mapping is stateless in the pool
+    return pool.allocateVoice(midiChannel, note, mode);
+}
+
+VoiceEngine::Action VoiceEngine::noteOn(int midiChannel, int note, const Settings& settings)
+{
+    Action action;
+
+    if (settings.mode == InstrumentPool::VoiceMode::Polyphonic)
+    {
+        action.type = Action::Type::Play;
+        action.unit = pool.allocateVoice(midiChannel, note, settings.mode);
+        action.note = note;
+        action.retrigger = true;
+        return action;
+    }
+
+    Voice& voice = voices[(size_t)voiceIndex(midiChannel, settings.mode)];
+    const bool overlapping = !voice.held.isEmpty();
+    voice.held.push(note);
+
+    const int next = voice.held.sounding(settings.priority);
+    if (next == voice.sounding) return action;  // Low/high priority: a note that doesn't win
+
+    const int glideFrom = settings.legato ? (overlapping ? voice.sounding : -1) : voice.lastPlayed;
+    voice.sounding = next;
+    voice.lastPlayed = next;
+
+    action.type = Action::Type::Play;
+    action.unit = unitFor(midiChannel, next, settings.mode);
+    action.note = next;
+    action.glideMs = glideFrom >= 0 ? settings.glideMs : 0.0;
+    action.retrigger = !(settings.legato && overlapping);
+    return action;
+}
+
+VoiceEngine::Action VoiceEngine::noteOff(int midiChannel, int note, const Settings& settings)
+{
+    Action action;
+
+    if (settings.mode == InstrumentPool::VoiceMode::Polyphonic)
+    {
+        action.type = Action::Type::Release;
+        action.unit = pool.releaseVoice(midiChannel, note, settings.mode);
+        action.note = note;
+        return action;
+    }
+
+    Voice& voice = voices[(size_t)voiceIndex(midiChannel, settings.mode)];
+    if (!voice.held.remove(note)) return action;
+
+    if (voice.held.isEmpty())
+    {
+        voice.sounding = -1;
+        action.type = Action::Type::Release;
+        action.unit = pool.releaseVoice(midiChannel, note, settings.mode);
+        action.note = note;
+        return action;
+    }
+
+    // Back to a note still held - a glide (when there is one), never a retrigger
+    const int next = voice.held.sounding(settings.priority);
+    if (next == voice.sounding) return action;
+
+    voice.sounding = next;
+    voice.lastPlayed = next;
+
+    action.type = Action::Type::Play;
+    action.unit = unitFor(midiChannel, next, settings.mode);
+    action.note = next;
+    action.glideMs = settings.glideMs;
+    return action;
+}
+
+void VoiceEngine::allNotesOff()
+{
+    for (Voice& voice : voices)
+    {
+        voice.held.clear();
+        voice.sounding = -1;
+        voice.lastPlayed = -1;
+    }
+}
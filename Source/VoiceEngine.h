@@ -0,0 +1,88 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <array>
+#include "InstrumentPool.h"
+
+//==============================================================================
+// Notes held on one mono voice, oldest first
+//
+// Fixed capacity and no allocation - audio thread. When it's full the oldest note is
+// forgotten, as on a hardware mono synth with a short key buffer.
+//==============================================================================
+class NoteStack
+{
+public:
+    enum class Priority { Last, Low, High };
+
+    static constexpr int CAPACITY = 16;
+
+    void push(int note);     // A note already held moves to the top
+    bool remove(int note);   // false if it wasn't held
+    void clear() { count = 0; }
+    bool isEmpty() const { return count == 0; }
+
+    int sounding(Priority priority) const;  // -1 if nothing is held
+
+private:
+    std::array<int, CAPACITY> notes {};
+    int count = 0;
+};
+
+//==============================================================================
+// MIDI notes -> what each unit plays
+//
+// Unison drives every unit as one mono voice; MIDI Channel gives each channel its own
+// mono voice on the unit InstrumentPool maps it to. A mono voice keeps a note stack and
+// plays the held note the priority picks, so releasing a note falls back to one still
+// held. Polyphonic hands each note to the pool's voice allocator and doesn't glide.
+//
+// Glide: with legato, only between overlapping notes (and the envelope isn't
+// retriggered); without it, from whatever the voice played last. The glide itself runs
+// on the instrument, see HP33120ADriver::startGlide(). Audio thread only.
+//==============================================================================
+class VoiceEngine
+{
+public:
+    struct Settings
+    {
+        InstrumentPool::VoiceMode mode = InstrumentPool::VoiceMode::Unison;
+        NoteStack::Priority priority = NoteStack::Priority::Last;
+        bool legato = false;
+        double glideMs = 0.0;
+    };
+
+    struct Action
+    {
+        enum class Type { None, Play, Release };
+        Type type = Type::None;
+        int unit = 0;             // InstrumentPool unit, ALL_UNITS, or NO_UNIT
+        int note = -1;
+        double glideMs = 0.0;     // 0: straight to the note
+        bool retrigger = false;   // Gate the envelope again
+    };
+
+    explicit VoiceEngine(InstrumentPool& instrumentPool);
+
+    Action noteOn(int midiChannel, int note, const Settings& settings);
+    Action noteOff(int midiChannel, int note, const Settings& settings);
+    void allNotesOff();  // Forgets every held note - the next note doesn't glide
+
+private:
+    static constexpr int NUM_VOICES = 16;  // One per MIDI channel; Unison uses the first
+
+    struct Voice
+    {
+        NoteStack held;
+        int sounding = -1;    // Held note being played, -1 if none
+        int lastPlayed = -1;  // Kept after release - a non-legato glide starts there
+    };
+
+    static int voiceIndex(int midiChannel, InstrumentPool::VoiceMode mode);
+    int unitFor(int midiChannel, int note, InstrumentPool::VoiceMode mode);
+
+    InstrumentPool& pool;
+    std::array<Voice, NUM_VOICES> voices;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (VoiceEngine)
+};
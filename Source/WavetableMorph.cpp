@@ -0,0 +1,240 @@
+#include "WavetableMorph.h"
+#include "ARBManager.h"
+#include "ARBResampler.h"
+#include <cmath>
+
+WavetableMorph::WavetableMorph(HP33120ADriver& driver, ARBManager& manager, juce::AudioProcessorValueTreeState& parameters)
+    : Thread("WavetableMorph"), device(driver), arbManager(manager), state(parameters)
+{
+    enabledParam = parameters.getRawParameterValue(Parameters::MORPH_ENABLED);
+    positionParam = parameters.getRawParameterValue(Parameters::MORPH_POSITION);
+    rateParam = parameters.getRawParameterValue(Parameters::MORPH_RATE);
+    frameRateParam = parameters.getRawParameterValue(Parameters::MORPH_FRAME_RATE);
+    
+    state.addParameterListener(Parameters::MORPH_ENABLED, this);
+}
+
+WavetableMorph::~WavetableMorph()
+{
+    stopMorph();
+    cancelPendingUpdate();
+}
+
+void WavetableMorph::stopMorph()
+{
+    state.removeParameterListener(Parameters::MORPH_ENABLED, this);
+    builder.removeAllJobs(true, 5000);
+    
+    signalThreadShouldExit();
+    wakeUp.signal();
+    stopThread(2000);
+}
+
+void WavetableMorph::parameterChanged(const juce::String&, float)
+{
+    wakeUp.signal();  // Idle waits are unbounded while disabled
+}
+
+void WavetableMorph::handleAsyncUpdate()
+{
+    // The device is playing USER now - a later sync of the Waveform parameter mustn't
+    // put the previous shape back
+    auto* waveform = state.getParameter(Parameters::WAVEFORM);
+    const int user = DeviceParameterTable::choiceIndex(DeviceParameterTable::get(Parameters::DeviceParam::Waveform), "USER");
+    if (waveform && user >= 0)
+        waveform->setValueNotifyingHost(waveform->convertTo0to1((float)user));
+}
+
+int WavetableMorph::getPointCount() const
+{
+    const juce::ScopedLock sl(frameLock);
+    return frontFrames ? frontFrames->pointCount : 0;
+}
+
+bool WavetableMorph::uploadActive() const
+{
+    for (int i = 0; i < 4; ++i)
+        if (arbManager.isUploading(i)) return true;
+    return false;
+}
+
+// ============================================================================
+// FRAME SETS
+// ============================================================================
+juce::uint64 WavetableMorph::currentSourceKey() const
+{
+    juce::uint64 key = 0;
+    for (int i = 0; i < 4; ++i)
+    {
+        const auto& slot = arbManager.getSlot(i);
+        const juce::ScopedLock sl(slot.lock);
+        key = key * 1000003ull + (slot.hasData ? (juce::uint64)slot.dataVersion + 1 : 0);
+    }
+    return key;
+}
+
+int WavetableMorph::choosePointCount() const
+{
+    if (pointsPerSecond <= 0.0) return INITIAL_POINTS;
+    
+    double frameRate = juce::jmax(0.1, (double)frameRateParam->load());
+    int points = (int)(pointsPerSecond * FRAME_BUDGET / frameRate);
+    return juce::jlimit(MIN_POINTS, MAX_POINTS, points);
+}
+
+void WavetableMorph::requestBuild(int pointCount)
+{
+    if (buildPending.exchange(true)) return;
+    
+    builder.addJob([this, pointCount]()
+    {
+        auto frames = buildFrames(pointCount);
+        {
+            const juce::ScopedLock sl(frameLock);
+            frontFrames = std::move(frames);
+        }
+        buildPending = false;
+        wakeUp.signal();
+    });
+}
+
+std::shared_ptr<const WavetableMorph::FrameSet> WavetableMorph::buildFrames(int pointCount) const
+{
+    auto set = std::make_shared<FrameSet>();
+    set->pointCount = pointCount;
+    
+    // Copy each loaded slot out under its lock, resample outside it. The key is built
+    // from what was copied, so data changing mid-build just triggers another build.
+    std::vector<std::vector<float>> tables;
+    for (int i = 0; i < 4; ++i)
+    {
+        std::vector<float> master;
+        {
+            const auto& slot = arbManager.getSlot(i);
+            const juce::ScopedLock sl(slot.lock);
+            set->sourceKey = set->sourceKey * 1000003ull + (slot.hasData ? (juce::uint64)slot.dataVersion + 1 : 0);
+            if (slot.hasData) master = slot.originalAudioData;
+        }
+        if (master.empty()) continue;
+        
+        auto table = ARBResampler::resample(master, pointCount);
+        auto range = juce::FloatVectorOperations::findMinAndMax(table.data(), (int)table.size());
+        float peak = juce::jmax(std::abs(range.getStart()), std::abs(range.getEnd()));
+        if (peak > 0.0f)
+            juce::FloatVectorOperations::multiply(table.data(), 1.0f / peak, (int)table.size());
+        tables.push_back(std::move(table));
+    }
+    if (tables.empty()) return set;
+    
+    // FRAMES_PER_SEGMENT steps from each table towards the next, then the last table
+    std::vector<float> frame((size_t)pointCount);
+    for (size_t t = 0; t + 1 < tables.size(); ++t)
+    {
+        for (int step = 0; step < FRAMES_PER_SEGMENT; ++step)
+        {
+            float mix = (float)step / FRAMES_PER_SEGMENT;
+            for (int i = 0; i < pointCount; ++i)
+                frame[(size_t)i] = tables[t][(size_t)i] + mix * (tables[t + 1][(size_t)i] - tables[t][(size_t)i]);
+            set->frames.push_back(HP33120ADriver::encodeDACBlock(frame));
+        }
+    }
+    set->frames.push_back(HP33120ADriver::encodeDACBlock(tables.back()));
+    return set;
+}
+
+// ============================================================================
+// STREAMING
+// ============================================================================
+double WavetableMorph::advancePosition(double nowMs)
+{
+    double rate = rateParam->load();
+    double elapsed = lastPositionMs < 0.0 ? 0.0 : (nowMs - lastPositionMs) / 1000.0;
+    lastPositionMs = nowMs;
+    
+    if (rate <= 0.0) return juce::jlimit(0.0, 1.0, (double)positionParam->load());
+    
+    // Rate > 0 sweeps the whole path, first slot to last and back, rate times a second
+    sweepPhase = std::fmod(sweepPhase + rate * elapsed, 1.0);
+    return sweepPhase < 0.5 ? sweepPhase * 2.0 : 2.0 - sweepPhase * 2.0;
+}
+
+void WavetableMorph::run()
+{
+    HP33120ADriver::setThreadLane(HP33120ADriver::CommandLane::Bulk);
+    
+    while (!threadShouldExit())
+    {
+        if (!isEnabled() || !device.isConnected())
+        {
+            // Back to a clean start: the device may have been reset or reconnected
+            shapeSelected = false;
+            failureLogged = false;
+            lastSentFrames = nullptr;
+            lastSentIndex = -1;
+            lastPositionMs = -1.0;
+            measuredFps = 0.0;
+            wakeUp.wait(isEnabled() ? DISCONNECTED_WAIT_MS : -1);  // Connecting doesn't signal
+            continue;
+        }
+        
+        const double frameMs = 1000.0 / juce::jmax(0.1, (double)frameRateParam->load());
+        const double startMs = juce::Time::getMillisecondCounterHiRes();
+        
+        std::shared_ptr<const FrameSet> frames;
+        {
+            const juce::ScopedLock sl(frameLock);
+            frames = frontFrames;
+        }
+        
+        int wantedPoints = choosePointCount();
+        if (!frames || frames->sourceKey != currentSourceKey()
+            || std::abs(frames->pointCount - wantedPoints) > frames->pointCount * REBUILD_TOLERANCE)
+            requestBuild(wantedPoints);
+        
+        if (frames && !frames->frames.empty() && !uploadActive())
+        {
+            double position = advancePosition(startMs);
+            int index = juce::roundToInt(position * (double)(frames->frames.size() - 1));
+            
+            // A parked position costs nothing on the bus
+            if (index != lastSentIndex || frames != lastSentFrames)
+            {
+                if (device.writeVolatileFrame(frames->frames[(size_t)index], !shapeSelected))
+                {
+                    if (!shapeSelected) triggerAsyncUpdate();
+                    shapeSelected = true;
+                    failureLogged = false;
+                    lastSentFrames = frames;
+                    lastSentIndex = index;
+                    
+                    double seconds = (juce::Time::getMillisecondCounterHiRes() - startMs) / 1000.0;
+                    if (seconds > 0.0)
+                    {
+                        double rate = frames->pointCount / seconds;
+                        pointsPerSecond = pointsPerSecond <= 0.0 ? rate
+                                        : pointsPerSecond + THROUGHPUT_SMOOTHING * (rate - pointsPerSecond);
+                        measuredFps = juce::jmin(1.0 / seconds, 1000.0 / frameMs);
+                    }
+                    
+                    if (++framesSinceErrorCheck >= ERROR_CHECK_FRAMES)
+                    {
+                        framesSinceErrorCheck = 0;
+                        device.checkDeferredErrors();
+                    }
+                }
+                else
+                {
+                    if (!failureLogged && device.logCallback)
+                        device.logCallback("Wavetable morph: " + device.getLastError());
+                    failureLogged = true;
+                    wakeUp.wait(DISCONNECTED_WAIT_MS);
+                    continue;
+                }
+            }
+        }
+        
+        double remaining = frameMs - (juce::Time::getMillisecondCounterHiRes() - startMs);
+        if (remaining >= 1.0)
+            wakeUp.wait((int)remaining);
+    }
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <juce_audio_processors/juce_audio_processors.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include "HP33120ADriver.h"
+#include "Parameters.h"
+
+class ARBManager;
+
+//==============================================================================
+// Wavetable morph: streams frames interpolated between the loaded ARB slots into
+// VOLATILE while the position is swept (Morph Rate) or automated (Morph Position).
+//
+// Frames are precomputed - FRAMES_PER_SEGMENT between each pair of neighbouring loaded
+// slots, resampled and already encoded as DAC blocks - so streaming only picks one and
+// writes it. The point count follows measured throughput so a frame fits the target
+// frame rate. When it drifts, or a slot's data changes, the next frame set is built on
+// a worker while the current one keeps streaming, then the two are swapped.
+//==============================================================================
+class WavetableMorph : public juce::Thread,
+                       private juce::AudioProcessorValueTreeState::Listener,
+                       private juce::AsyncUpdater
+{
+public:
+    WavetableMorph(HP33120ADriver& driver, ARBManager& manager, juce::AudioProcessorValueTreeState& parameters);
+    ~WavetableMorph() override;  // Stops streaming and the frame builder
+    
+    // Streaming statistics - any thread
+    double getFramesPerSecond() const { return measuredFps.load(); }
+    int getPointCount() const;
+    
+    void run() override;
+    
+private:
+    struct FrameSet
+    {
+        int pointCount = 0;
+        juce::uint64 sourceKey = 0;  // Slot data the frames were built from, see currentSourceKey()
+        std::vector<std::vector<unsigned char>> frames;  // Encoded DAC blocks along the morph path
+    };
+    
+    void parameterChanged(const juce::String& parameterID, float newValue) override;
+    void handleAsyncUpdate() override;  // Waveform parameter to USER once streaming selected it
+    void stopMorph();
+    
+    bool isEnabled() const { return enabledParam->load() >= 0.5f; }
+    bool uploadActive() const;  // Uploads go through VOLATILE too
+    juce::uint64 currentSourceKey() const;
+    int choosePointCount() const;
+    void requestBuild(int pointCount);
+    std::shared_ptr<const FrameSet> buildFrames(int pointCount) const;
+    double advancePosition(double nowMs);
+    
+    HP33120ADriver& device;
+    ARBManager& arbManager;
+    juce::AudioProcessorValueTreeState& state;
+    
+    std::atomic<float>* enabledParam = nullptr;
+    std::atomic<float>* positionParam = nullptr;
+    std::atomic<float>* rateParam = nullptr;
+    std::atomic<float>* frameRateParam = nullptr;
+    
+    // Double-buffered staging: streaming reads the front set, builds fill the next one
+    juce::CriticalSection frameLock;
+    std::shared_ptr<const FrameSet> frontFrames;
+    std::atomic<bool> buildPending { false };
+    juce::ThreadPool builder { 1 };
+    
+    juce::WaitableEvent wakeUp;
+    
+    // Streaming thread only
+    std::shared_ptr<const FrameSet> lastSentFrames;
+    int lastSentIndex = -1;
+    bool shapeSelected = false;
+    bool failureLogged = false;
+    int framesSinceErrorCheck = 0;
+    double pointsPerSecond = 0.0;  // Smoothed, 0 until the first frame is timed
+    double sweepPhase = 0.0;
+    double lastPositionMs = -1.0;
+    
+    std::atomic<double> measuredFps { 0.0 };
+    
+    static constexpr int FRAMES_PER_SEGMENT = 16;
+    static constexpr int MIN_POINTS = 64;
+    static constexpr int MAX_POINTS = 16000;
+    static constexpr int INITIAL_POINTS = 1024;       // Until throughput has been measured
+    static constexpr double FRAME_BUDGET = 0.8;       // Share of the frame period spent on the bus
+    static constexpr double REBUILD_TOLERANCE = 0.15; // Point count drift that triggers a rebuild
+    static constexpr double THROUGHPUT_SMOOTHING = 0.3;
+    static constexpr int ERROR_CHECK_FRAMES = 25;
+    static constexpr int DISCONNECTED_WAIT_MS = 500;
+    
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (WavetableMorph)
+};
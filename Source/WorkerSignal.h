@@ -0,0 +1,43 @@
+#pragma once
+
+#include <juce_core/juce_core.h>
+#include <atomic>
+
+//==============================================================================
+// Wake-up for a worker thread that sleeps until there is something to do
+//
+// Producers publish their work (mailbox slot, FIFO entry) and then call notify().
+// The event is only touched when the worker is actually asleep, so a producer on
+// the audio thread normally pays one atomic exchange and no system call. The worker
+// announces that it's going to sleep before re-checking for work, so a notify()
+// that lands in between is never lost.
+//==============================================================================
+class WorkerSignal
+{
+public:
+    // Any thread, after the work is visible
+    void notify() noexcept
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (sleeping.exchange(false))
+            event.signal();
+    }
+
+    // Unconditional - for shutdown
+    void wakeNow() { event.signal(); }
+
+    // Worker thread: sleeps for up to timeoutMs (-1: until notified) unless hasWork()
+    template <typename HasWork>
+    void wait(int timeoutMs, HasWork&& hasWork)
+    {
+        sleeping.exchange(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!hasWork())
+            event.wait(timeoutMs);
+        sleeping.store(false);
+    }
+
+private:
+    juce::WaitableEvent event;
+    std::atomic<bool> sleeping { false };
+};